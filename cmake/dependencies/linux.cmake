@@ -10,4 +10,18 @@ pkg_check_modules(Va-Drm REQUIRED IMPORTED_TARGET GLOBAL libva-drm)
 pkg_check_modules(GL REQUIRED IMPORTED_TARGET GLOBAL gl)
 pkg_check_modules(GLES REQUIRED IMPORTED_TARGET GLOBAL glesv2)
 pkg_check_modules(EGL REQUIRED IMPORTED_TARGET GLOBAL egl)
-pkg_check_modules(MFX REQUIRED IMPORTED_TARGET GLOBAL libmfx)
\ No newline at end of file
+pkg_check_modules(MFX REQUIRED IMPORTED_TARGET GLOBAL libmfx)
+
+# openh264运行时用dlopen加载, 这里只需要头文件. 也是可选的, 找不到就不编译OpenH264Encoder
+pkg_check_modules(OpenH264 openh264)
+if (OpenH264_FOUND)
+    add_library(openh264 INTERFACE)
+    target_include_directories(openh264 INTERFACE ${OpenH264_INCLUDE_DIRS})
+endif()
+
+# x264是可选的, 同样运行时加载. 找不到头文件就不编译X264Encoder
+pkg_check_modules(X264 x264)
+if (X264_FOUND)
+    add_library(x264 INTERFACE)
+    target_include_directories(x264 INTERFACE ${X264_INCLUDE_DIRS})
+endif()
@@ -161,6 +161,7 @@ bool App::init() {
     max_mbps_ = static_cast<uint32_t>(settings_->getInteger("max_mbps").value_or(0));
     default_absolute_mouse_ = settings_->getBoolean("absolute_mouse").value_or(true);
     show_overlay_ = settings_->getBoolean("show_overlay").value_or(true);
+    av_sync_ = settings_->getBoolean("av_sync").value_or(false);
 
     std::optional<std::string> access_token = settings_->getString("access_token");
     if (access_token.has_value()) {
@@ -264,6 +265,8 @@ int App::exec(int argc, char** argv) {
     };
     params.set_show_overlay =
         [this](bool show) { postTask([this, show]() { setShowOverlay(show); }); };
+    params.set_av_sync =
+        [this](bool enable) { postTask([this, enable]() { setAVSync(enable); }); };
 
     gui_.init(params, argc, argv);
     thread_ = ltlib::BlockingThread::create(
@@ -323,6 +326,7 @@ GUI::Settings App::getSettings() const {
     settings.tcp = enable_tcp_;
     settings.max_mbps = max_mbps_;
     settings.show_overlay = show_overlay_;
+    settings.av_sync = av_sync_;
 
     return settings;
 }
@@ -354,6 +358,11 @@ void App::setShowOverlay(bool show) {
     settings_->setBoolean("show_overlay", show);
 }
 
+void App::setAVSync(bool enable) {
+    av_sync_ = enable;
+    settings_->setBoolean("av_sync", enable);
+}
+
 void App::setDefaultMouseMode(bool absolute) {
     default_absolute_mouse_ = absolute;
     settings_->setBoolean("absolute_mouse", absolute);
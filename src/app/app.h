@@ -77,6 +77,7 @@ private:
     void setRelayServer(const std::string& svr);
     void setDefaultMouseMode(bool absolute);
     void setShowOverlay(bool show);
+    void setAVSync(bool enable);
     void onUserConfirmedConnection(int64_t device_id, GUI::ConfirmResult result);
     void onOperateConnection(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onFullscreenModeChanged(bool is_windowed);
@@ -178,6 +179,7 @@ private:
     bool enable_tcp_ = false;
     bool enable_share_clipboard_ = false;
     bool show_overlay_ = true;
+    bool av_sync_ = false;
     uint32_t max_mbps_ = 0;
     std::optional<bool> windowed_fullscreen_;
     std::string relay_server_;
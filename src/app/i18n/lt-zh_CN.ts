@@ -414,6 +414,10 @@
         <source>Show overlay</source>
         <translation>显示浮层</translation>
     </message>
+    <message>
+        <source>Sync video to audio</source>
+        <translation>音画同步</translation>
+    </message>
     <message>
         <location filename="../views/mainwindow/mainwindow.ui" line="2040"/>
         <source>Status Color</source>
@@ -67,6 +67,7 @@ public:
         bool tcp;
         bool absolute_mouse;
         bool show_overlay;
+        bool av_sync;
         std::string relay_server;
         std::optional<bool> windowed_fullscreen;
         uint16_t min_port;
@@ -113,6 +114,7 @@ public:
         std::function<void(uint32_t)> set_max_mbps;
         std::function<void(bool)> set_absolute_mouse;
         std::function<void(bool)> set_show_overlay;
+        std::function<void(bool)> set_av_sync;
     };
 
 public:
@@ -256,6 +256,7 @@ void MainWindow::rebuildSettingsPageInCode() {
     settings_ledit_max_mbps_ = page_view.ledit_max_mbps;
     settings_btn_max_mbps_ = page_view.btn_max_mbps;
     settings_checkbox_overlay_ = page_view.checkbox_overlay;
+    settings_checkbox_av_sync_ = page_view.checkbox_av_sync;
     settings_ledit_red_ = page_view.ledit_red;
     settings_ledit_green_ = page_view.ledit_green;
     settings_ledit_blue_ = page_view.ledit_blue;
@@ -373,6 +374,7 @@ void MainWindow::setupSettingsPage() {
         settings_ledit_max_mbps_->setText(QString::number(settings.max_mbps));
     }
     settings_checkbox_overlay_->setChecked(settings.show_overlay);
+    settings_checkbox_av_sync_->setChecked(settings.av_sync);
     settings_btn_status_color_->setEnabled(false);
     settings_ledit_red_->setValidator(new QIntValidator(0, 255, this));
     settings_ledit_green_->setValidator(new QIntValidator(0, 255, this));
@@ -855,6 +857,7 @@ void MainWindow::setupOtherCallbacks() {
     context.settings_ledit_green = settings_ledit_green_;
     context.settings_ledit_blue = settings_ledit_blue_;
     context.settings_checkbox_overlay = settings_checkbox_overlay_;
+    context.settings_checkbox_av_sync = settings_checkbox_av_sync_;
     context.settings_btn_status_color = settings_btn_status_color_;
     context.settings_ledit_mouse_accel = settings_ledit_mouse_accel_;
     context.settings_btn_mouse_accel = settings_btn_mouse_accel_;
@@ -239,6 +239,7 @@ private:
     QLineEdit* settings_ledit_max_mbps_ = nullptr;
     QPushButton* settings_btn_max_mbps_ = nullptr;
     QCheckBox* settings_checkbox_overlay_ = nullptr;
+    QCheckBox* settings_checkbox_av_sync_ = nullptr;
     QLineEdit* settings_ledit_red_ = nullptr;
     QLineEdit* settings_ledit_green_ = nullptr;
     QLineEdit* settings_ledit_blue_ = nullptr;
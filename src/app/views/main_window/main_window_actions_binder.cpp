@@ -158,6 +158,8 @@ void MainWindowActionsBinder::bind(const MainWindowActionsBindingContext& c) con
             [c](const QString& text) { c.on_status_color_changed(text); });
     QObject::connect(c.settings_checkbox_overlay, check_state_changed_signal, c.owner,
             [c]() { c.params->set_show_overlay(c.settings_checkbox_overlay->isChecked()); });
+    QObject::connect(c.settings_checkbox_av_sync, check_state_changed_signal, c.owner,
+            [c]() { c.params->set_av_sync(c.settings_checkbox_av_sync->isChecked()); });
     QObject::connect(c.settings_btn_status_color, &QPushButton::clicked, c.owner, [c]() {
         c.settings_btn_status_color->setEnabled(false);
         if (c.settings_ledit_red->text().isEmpty() && c.settings_ledit_green->text().isEmpty() &&
@@ -49,6 +49,7 @@ struct MainWindowActionsBindingContext {
     QLineEdit* settings_ledit_green = nullptr;
     QLineEdit* settings_ledit_blue = nullptr;
     QCheckBox* settings_checkbox_overlay = nullptr;
+    QCheckBox* settings_checkbox_av_sync = nullptr;
     QPushButton* settings_btn_status_color = nullptr;
     QLineEdit* settings_ledit_mouse_accel = nullptr;
     QPushButton* settings_btn_mouse_accel = nullptr;
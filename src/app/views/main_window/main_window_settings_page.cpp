@@ -148,6 +148,8 @@ MainWindowSettingsPageView MainWindowSettingsPage::createPage(QWidget* parent) c
     gb_overlay_layout->setContentsMargins(9, 30, 9, 30);
     auto* checkbox_overlay = new QCheckBox(trMainWindow("Show overlay"), gb_overlay);
     gb_overlay_layout->addWidget(checkbox_overlay);
+    auto* checkbox_av_sync = new QCheckBox(trMainWindow("Sync video to audio"), gb_overlay);
+    gb_overlay_layout->addWidget(checkbox_av_sync);
     content_layout->addWidget(gb_overlay);
 
     auto* gb_status_color = new QGroupBox(trMainWindow("Status Color"), scroll_contents);
@@ -204,6 +206,7 @@ MainWindowSettingsPageView MainWindowSettingsPage::createPage(QWidget* parent) c
     view.ledit_max_mbps = ledit_max_mbps;
     view.btn_max_mbps = btn_max_mbps;
     view.checkbox_overlay = checkbox_overlay;
+    view.checkbox_av_sync = checkbox_av_sync;
     view.ledit_red = ledit_red;
     view.ledit_green = ledit_green;
     view.ledit_blue = ledit_blue;
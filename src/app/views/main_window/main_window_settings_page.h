@@ -30,6 +30,7 @@ struct MainWindowSettingsPageView {
     QLineEdit* ledit_max_mbps = nullptr;
     QPushButton* btn_max_mbps = nullptr;
     QCheckBox* checkbox_overlay = nullptr;
+    QCheckBox* checkbox_av_sync = nullptr;
     QLineEdit* ledit_red = nullptr;
     QLineEdit* ledit_green = nullptr;
     QLineEdit* ledit_blue = nullptr;
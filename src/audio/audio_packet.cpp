@@ -0,0 +1,115 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "audio_packet.h"
+
+namespace {
+
+constexpr uint8_t kMagic0 = 'L';
+constexpr uint8_t kMagic1 = 'A';
+constexpr uint8_t kVersion = 1;
+
+template <typename T> void writeLE(uint8_t* out, T value) {
+    for (size_t i = 0; i < sizeof(T); i++) {
+        out[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+    }
+}
+
+template <typename T> T readLE(const uint8_t* in) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < sizeof(T); i++) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return static_cast<T>(value);
+}
+
+} // namespace
+
+namespace lt {
+
+namespace audio {
+
+uint32_t audioPacketHeaderSize(uint32_t frames) {
+    return frames <= 1 ? kAudioPacketHeaderSize : kAudioPacketHeaderSize + 2 * frames;
+}
+
+void writeAudioPacketHeader(uint8_t* out, uint32_t sequence, int64_t capture_time_us,
+                            uint32_t frames) {
+    out[0] = kMagic0;
+    out[1] = kMagic1;
+    out[2] = kVersion;
+    out[3] = static_cast<uint8_t>(frames);
+    writeLE<uint32_t>(out + 4, sequence);
+    writeLE<int64_t>(out + 8, capture_time_us);
+}
+
+void writeAudioFrameSize(uint8_t* header, uint32_t index, uint16_t size) {
+    writeLE<uint16_t>(header + kAudioPacketHeaderSize + 2 * index, size);
+}
+
+std::optional<AudioPacket> parseAudioPacket(const uint8_t* data, uint32_t size) {
+    if (data == nullptr || size < kAudioPacketHeaderSize) {
+        return std::nullopt;
+    }
+    const uint32_t frames = data[3];
+    if (data[0] != kMagic0 || data[1] != kMagic1 || data[2] != kVersion || frames == 0 ||
+        frames > kMaxAudioFramesPerPacket) {
+        return std::nullopt;
+    }
+    const uint32_t header_size = audioPacketHeaderSize(frames);
+    if (size < header_size) {
+        return std::nullopt;
+    }
+    AudioPacket packet{};
+    packet.sequence = readLE<uint32_t>(data + 4);
+    packet.capture_time_us = readLE<int64_t>(data + 8);
+    packet.frames = frames;
+    if (frames == 1) {
+        packet.frame[0] = {data + header_size, size - header_size};
+        return packet;
+    }
+    uint32_t offset = header_size;
+    for (uint32_t i = 0; i < frames; i++) {
+        const uint32_t frame_size = readLE<uint16_t>(data + kAudioPacketHeaderSize + 2 * i);
+        if (offset + frame_size > size) {
+            return std::nullopt;
+        }
+        packet.frame[i] = {data + offset, frame_size};
+        offset += frame_size;
+    }
+    if (offset != size) {
+        return std::nullopt;
+    }
+    return packet;
+}
+
+} // namespace audio
+
+} // namespace lt
@@ -0,0 +1,80 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <optional>
+
+#include <ltlib/versions.h>
+
+namespace lt {
+
+namespace audio {
+
+// ltproto的AudioData和transport的lt::AudioData都只有一段数据, 序号和采集时间只能放在数据前面.
+// 小端:
+//   'L' 'A' version(1字节) frames(1字节) sequence(4字节) capture_time_us(8字节)
+// frames为1时后面直接是这一帧的数据. frames大于1时后面先是frames个2字节的长度, 再依次是
+// 每一帧的数据. 一条消息里的帧序号连续, 采集时间首尾相接. 长度为0的帧是DTX静音帧,
+// 只有包头也是合法的, 表示这一帧是静音而不是丢了
+constexpr uint32_t kAudioPacketHeaderSize = 16;
+constexpr uint32_t kMaxAudioFramesPerPacket = 8;
+// 从这个版本开始客户端才认识包头, 更早的客户端只能收一条消息一帧的裸数据
+constexpr int64_t kAudioPacketMinClientVersion = ltlib::combineVersion(0, 4, 3);
+
+struct AudioFrameView {
+    const uint8_t* data;
+    uint32_t size;
+};
+
+struct AudioPacket {
+    // 第一帧的序号
+    uint32_t sequence;
+    // 第一帧的采集时间, 主机上的steady时钟
+    int64_t capture_time_us;
+    uint32_t frames;
+    AudioFrameView frame[kMaxAudioFramesPerPacket];
+};
+
+// 带frames帧时包头(含长度表)的大小
+uint32_t audioPacketHeaderSize(uint32_t frames);
+
+// out至少有audioPacketHeaderSize(frames)字节. frames大于1时还要逐帧调用writeAudioFrameSize
+void writeAudioPacketHeader(uint8_t* out, uint32_t sequence, int64_t capture_time_us,
+                            uint32_t frames = 1);
+
+void writeAudioFrameSize(uint8_t* header, uint32_t index, uint16_t size);
+
+// 不是这个格式(比如旧版本主机发来的裸数据)返回nullopt
+std::optional<AudioPacket> parseAudioPacket(const uint8_t* data, uint32_t size);
+
+} // namespace audio
+
+} // namespace lt
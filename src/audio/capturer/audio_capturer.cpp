@@ -30,25 +30,54 @@
 
 #include "audio_capturer.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include <ltlib/logging.h>
+#include <ltlib/times.h>
 #include <opus/opus.h>
 #include <opus/opus_types.h>
 
 #include <ltproto/client2worker/audio_data.pb.h>
 #include <ltproto/ltproto.h>
 
+#include <audio/audio_packet.h>
+
 #include "fake_audio_capturer.h"
+#include "synthetic_audio_capturer.h"
 #if LT_WINDOWS
 #include "win_audio_capturer.h"
+#elif LT_LINUX
+#include "pulse_audio_capturer.h"
 #endif
 
+namespace {
+
+// 一个Opus包最大1275字节
+constexpr uint32_t kMaxOpusPacketSize = 1275;
+constexpr size_t kMaxMessagesInFlight = 8;
+
+// 旧版本客户端按10ms一帧解码, 也不认识DTX
+lt::audio::Capturer::OpusOptions legacyOpusOptions(lt::audio::Capturer::OpusOptions options) {
+    options.frame_ms = 10;
+    options.dtx = false;
+    return options;
+}
+
+} // namespace
+
 namespace lt {
 
 namespace audio {
 
 std::unique_ptr<Capturer> Capturer::create(const Params& params) {
+    if (params.backend == Backend::Synthetic) {
+        std::unique_ptr<Capturer> capturer{new SyntheticAudioCapturer{params}};
+        if (!capturer->init()) {
+            return nullptr;
+        }
+        return capturer;
+    }
     auto fake_capturer = std::make_unique<FakeAudioCapturer>(params);
 #if LT_WINDOWS
     std::unique_ptr<Capturer> capturer{new WinAudioCapturer{params}};
@@ -56,6 +85,13 @@ std::unique_ptr<Capturer> Capturer::create(const Params& params) {
         return fake_capturer;
     }
     return capturer;
+#elif LT_LINUX
+    std::unique_ptr<Capturer> capturer{new PulseAudioCapturer{params}};
+    if (!capturer->init()) {
+        LOG(WARNING) << "PulseAudio capturer unavailable, desktop audio won't be captured";
+        return fake_capturer;
+    }
+    return capturer;
 #else
     return fake_capturer;
 #endif
@@ -80,9 +116,31 @@ void Capturer::stop() {
     stoped_ = true;
 }
 
+void Capturer::updateLossRate(float rate) {
+    const auto percent = static_cast<uint32_t>(std::clamp(rate, 0.f, 1.f) * 100 + 0.5f);
+    loss_percent_ = std::max(percent, opus_options_.expected_loss_percent);
+}
+
+bool Capturer::stoped() const {
+    return stoped_;
+}
+
+void Capturer::stopCaptureThread() {
+    stoped_ = true;
+    capture_thread_.reset();
+}
+
 Capturer::Capturer(const Params& params)
     : type_{params.type}
-    , on_audio_data_{params.on_audio_data} {}
+    , opus_options_{params.packet_header ? params.opus : legacyOpusOptions(params.opus)}
+    , packet_header_{params.packet_header}
+    , max_packets_per_message_{
+          params.packet_header
+              ? std::clamp(params.max_packets_per_message, 1u, kMaxAudioFramesPerPacket)
+              : 1u}
+    , on_audio_data_{params.on_audio_data}
+    , loss_percent_{params.opus.expected_loss_percent}
+    , applied_loss_percent_{params.opus.expected_loss_percent} {}
 
 bool Capturer::init() {
     if (!initPlatform()) {
@@ -103,6 +161,10 @@ bool Capturer::initEncoder() {
         LOG(INFO) << "No need OPUS";
         return true;
     }
+    if (opus_options_.frame_ms != 10 && opus_options_.frame_ms != 20) {
+        LOG(ERR) << "Unsupported OPUS frame duration " << opus_options_.frame_ms << "ms";
+        return false;
+    }
     int error = 0;
     OpusEncoder* encoder =
         opus_encoder_create(framesPerSec(), channels(), OPUS_APPLICATION_AUDIO, &error);
@@ -110,77 +172,153 @@ bool Capturer::initEncoder() {
         LOG(ERR) << "opus_encoder_create failed with " << error;
         return false;
     }
-    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(framesPerSec() * bytesPerFrame() * 8));
-    LOGF(INFO, "OPUS encoder created. fs:%u, channels:%u, bitrate:%u", framesPerSec(), channels(),
-         framesPerSec() * bytesPerFrame() * 8);
-    opus_buffer_.resize(framesPer10ms() * bytesPerFrame());
     opus_encoder_ = encoder;
+    opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(static_cast<opus_int32>(
+                                  std::min(opus_options_.complexity, 10u))));
+    opus_encoder_ctl(encoder, OPUS_SET_INBAND_FEC(opus_options_.fec ? 1 : 0));
+    opus_encoder_ctl(encoder, OPUS_SET_DTX(opus_options_.dtx ? 1 : 0));
+    applyLossRate();
+    LOGF(INFO,
+         "OPUS encoder created. fs:%u, channels:%u, bitrate:%u, complexity:%u, frame:%ums, "
+         "fec:%d, dtx:%d",
+         framesPerSec(), channels(), opus_options_.bitrate_bps, opus_options_.complexity,
+         opus_options_.frame_ms, opus_options_.fec, opus_options_.dtx);
     return true;
 }
 
-void Capturer::onCapturedData(const uint8_t* data, uint32_t frames) {
-    if (data == nullptr) {
+uint32_t Capturer::framesPerPacket() const {
+    if (needEncode()) {
+        return framesPerSec() * opus_options_.frame_ms / 1000;
+    }
+    return framesPer10ms();
+}
+
+void Capturer::applyLossRate() {
+    const uint32_t loss_percent = loss_percent_;
+    auto encoder = reinterpret_cast<OpusEncoder*>(opus_encoder_);
+    // 编码器按丢包率决定FEC用多少码率, 丢包越多越偏向能带FEC的SILK模式.
+    // FEC会挤占正常编码的码率, 丢包严重时码率跟着提高一些
+    const uint32_t bitrate =
+        opus_options_.bitrate_bps / 100 * (100 + std::min(loss_percent, 25u));
+    opus_encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(static_cast<opus_int32>(loss_percent)));
+    opus_encoder_ctl(encoder, OPUS_SET_BITRATE(static_cast<opus_int32>(bitrate)));
+    if (loss_percent != applied_loss_percent_) {
+        LOG(INFO) << "OPUS encoder loss " << applied_loss_percent_ << "% -> " << loss_percent
+                  << "%, bitrate " << bitrate;
+    }
+    applied_loss_percent_ = loss_percent;
+}
+
+void Capturer::onCapturedData(const uint8_t* data, uint32_t frames, int64_t delay_us) {
+    if (data == nullptr || frames == 0) {
         return;
     }
     // static std::ofstream out1{"./audio_pcm", std::ios::binary | std::ios::trunc};
     // out1.write(reinterpret_cast<const char*>(data), frames * bytesPerFrame());
     // out1.flush();
-    std::shared_ptr<uint8_t> first_fragment;
-    std::vector<const uint8_t*> fragments;
-    uint32_t total_size = frames * bytesPerFrame();
-    uint32_t index = 0;
-    const uint32_t bytes_per_10ms = bytesPer10ms();
-    if (pcm_buffer_) {
-        uint32_t bytes_need = bytes_per_10ms - pcm_buffer_size_;
-        if (bytes_need <= total_size) {
-            memcpy(pcm_buffer_.get() + pcm_buffer_size_, data, bytes_need);
-            index -= bytes_need;
-            first_fragment = std::move(pcm_buffer_);
-            fragments.push_back(first_fragment.get());
-        }
-        else {
-            memcpy(pcm_buffer_.get() + pcm_buffer_size_, data, total_size);
-            pcm_buffer_size_ += total_size;
-            return;
-        }
+    if (pcm_ring_ == nullptr) {
+        prepareBuffers();
     }
-    for (; index < total_size; index += bytes_per_10ms) {
-        if (index + bytes_per_10ms >= total_size) {
-            break;
-        }
-        fragments.push_back(data + index);
+    if (needEncode() && loss_percent_ != applied_loss_percent_) {
+        applyLossRate();
     }
-    if (index < total_size) {
-        pcm_buffer_ = std::shared_ptr<uint8_t>{new uint8_t[bytes_per_10ms]};
-        memcpy(pcm_buffer_.get(), data + index, total_size - index);
-        pcm_buffer_size_ = total_size - index;
+    // 最后一个样本在delay_us之前采集到, 往前推算每个包的采集时间
+    const int64_t now_us = ltlib::steady_now_us() - delay_us;
+    const uint32_t samples_per_frame = bytesPerFrame() / sizeof(int16_t);
+    auto samples = reinterpret_cast<const int16_t*>(data);
+    uint32_t written = 0;
+    // 一次来的数据比环大时分几轮写, 每轮之后环里剩下不到一个包
+    while (written < frames) {
+        written += pcm_ring_->write(samples + written * samples_per_frame, frames - written);
+        sendPackets(now_us - static_cast<int64_t>(frames - written) * 1'000'000 / framesPerSec());
     }
+}
 
-    if (needEncode()) {
-        auto encoder = reinterpret_cast<OpusEncoder*>(opus_encoder_);
-        for (auto& fragment : fragments) {
-            auto pcm_data = reinterpret_cast<const opus_int16*>(fragment);
-            auto len = opus_encode(encoder, pcm_data, framesPer10ms(), opus_buffer_.data(),
-                                   static_cast<opus_int32>(opus_buffer_.size()));
-            if (len < 0) {
-                LOG(ERR) << "opus_encode failed with " << len;
-                return;
+void Capturer::prepareBuffers() {
+    // 子类在initPlatform()里才确定采集格式, 第一次收到数据时分配, 之后不再分配
+    const uint32_t samples_per_frame = bytesPerFrame() / sizeof(int16_t);
+    pcm_ring_ = std::make_unique<PcmRing>(framesPerPacket() * (max_packets_per_message_ + 1),
+                                          samples_per_frame);
+    packet_pcm_.resize(framesPerPacket() * samples_per_frame);
+    messages_.reserve(kMaxMessagesInFlight);
+}
+
+void Capturer::sendPackets(int64_t end_us) {
+    const uint32_t frames_per_packet = framesPerPacket();
+    const uint32_t max_frame_size =
+        needEncode() ? kMaxOpusPacketSize : frames_per_packet * bytesPerFrame();
+    auto encoder = reinterpret_cast<OpusEncoder*>(opus_encoder_);
+    while (pcm_ring_->size() >= frames_per_packet) {
+        const uint32_t count =
+            std::min(pcm_ring_->size() / frames_per_packet, max_packets_per_message_);
+        const int64_t capture_time_us =
+            end_us - static_cast<int64_t>(pcm_ring_->size()) * 1'000'000 / framesPerSec();
+        const uint32_t first_sequence = sequence_;
+        sequence_ += count;
+        auto msg = acquireMessage();
+        std::string* payload = msg->mutable_data();
+        const uint32_t header_size = packet_header_ ? audioPacketHeaderSize(count) : 0;
+        // 容量够的时候resize不会分配
+        payload->resize(header_size + count * max_frame_size);
+        auto header = reinterpret_cast<uint8_t*>(payload->data());
+        uint32_t offset = header_size;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t size = 0;
+            if (needEncode()) {
+                pcm_ring_->read(packet_pcm_.data(), frames_per_packet);
+                auto len = opus_encode(encoder, packet_pcm_.data(),
+                                       static_cast<int>(frames_per_packet), header + offset,
+                                       static_cast<opus_int32>(max_frame_size));
+                if (len < 0) {
+                    LOG(ERR) << "opus_encode failed with " << len;
+                }
+                // DTX: 静音期间编码器只出1~2字节, 不用发. 长度写0告诉客户端这一帧是静音,
+                // 不然客户端分不清是静音还是丢包, 会一直做丢包隐藏, 说话开头反而被丢掉
+                if (len < 0 || (packet_header_ && len <= 2)) {
+                    size = 0;
+                }
+                else {
+                    size = static_cast<uint32_t>(len);
+                }
+            }
+            else {
+                pcm_ring_->read(reinterpret_cast<int16_t*>(header + offset), frames_per_packet);
+                size = max_frame_size;
+            }
+            if (packet_header_ && count > 1) {
+                writeAudioFrameSize(header, i, static_cast<uint16_t>(size));
             }
-            auto msg = std::make_shared<ltproto::client2worker::AudioData>();
-            msg->set_data(opus_buffer_.data(), len);
-            on_audio_data_(msg);
-            // static std::ofstream out{"./audio_src", std::ios::binary | std::ios::trunc};
-            // out.write(reinterpret_cast<const char*>(opus_buffer_.data()), len);
-            // out.flush();
+            offset += size;
         }
+        payload->resize(offset);
+        if (!packet_header_) {
+            // 旧格式没法表示空帧, 编码失败的这一帧就不发了
+            if (offset != 0) {
+                on_audio_data_(msg);
+            }
+            continue;
+        }
+        writeAudioPacketHeader(header, first_sequence, capture_time_us, count);
+        on_audio_data_(msg);
+        // static std::ofstream out{"./audio_src", std::ios::binary | std::ios::trunc};
+        // out.write(reinterpret_cast<const char*>(header), offset);
+        // out.flush();
     }
-    else {
-        for (auto& fragment : fragments) {
-            auto msg = std::make_shared<ltproto::client2worker::AudioData>();
-            msg->set_data(fragment, bytes_per_10ms);
-            on_audio_data_(msg);
+}
+
+std::shared_ptr<ltproto::client2worker::AudioData> Capturer::acquireMessage() {
+    // 引用计数为1说明只剩自己持有, 发送线程已经用完了
+    for (auto& msg : messages_) {
+        if (msg.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return msg;
         }
     }
+    auto msg = std::make_shared<ltproto::client2worker::AudioData>();
+    if (messages_.size() < kMaxMessagesInFlight) {
+        messages_.push_back(msg);
+    }
+    return msg;
 }
 
 void Capturer::setBytesPerFrame(uint32_t value) {
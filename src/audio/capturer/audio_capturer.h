@@ -29,25 +29,71 @@
  */
 
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <google/protobuf/message_lite.h>
 
 #include <ltlib/threads.h>
+#include <ltproto/client2worker/audio_data.pb.h>
 
 #include <transport/transport.h>
 
+#include <audio/pcm_ring.h>
+
 namespace lt {
 
 namespace audio {
 
 class Capturer {
 public:
+    enum class Backend {
+        // Windows上是WASAPI, Linux上是PulseAudio. 失败或者其它平台是不出声音的FakeAudioCapturer
+        Platform,
+        // 生成合成的声音, 用于测试
+        Synthetic,
+    };
+    enum class SyntheticSignal {
+        // 440Hz加泛音
+        Tone,
+        Silence,
+        // 基频和音量不断变化, 中间有停顿, 接近人说话
+        Speech,
+        // 循环播放synthetic_wav_path, 16位PCM. 采样率不是48kHz时线性重采样
+        WavFile,
+    };
+    struct OpusOptions {
+        uint32_t bitrate_bps = 96'000;
+        // 0~10, 越高音质越好, 也越耗CPU
+        uint32_t complexity = 8;
+        // 10或者20
+        uint32_t frame_ms = 10;
+        bool fec = true;
+        // 收到丢包统计之前按这个丢包率准备FEC, 之后也不低于它
+        uint32_t expected_loss_percent = 2;
+        // 静音时几乎不出数据
+        bool dtx = true;
+    };
     struct Params {
         AudioCodecType type;
         std::function<void(const std::shared_ptr<google::protobuf::MessageLite>&)> on_audio_data;
+        OpusOptions opus;
+        // 采集设备, 空表示默认. Linux上是PulseAudio的source名, 默认录默认输出设备的monitor
+        std::string device;
+        // 一次采集回调里凑齐的多个包合成一条消息发出去, 不额外等待. 最多kMaxAudioFramesPerPacket
+        uint32_t max_packets_per_message = 4;
+        // false时按旧格式发: 没有包头, 一条消息一个10ms的包, 不开DTX.
+        // 给不认识包头的旧版本客户端用, 见kAudioPacketMinClientVersion
+        bool packet_header = true;
+        Backend backend = Backend::Platform;
+        SyntheticSignal synthetic_signal = SyntheticSignal::Tone;
+        // false时不按真实时间, 尽快生成
+        bool synthetic_paced = true;
+        std::string synthetic_wav_path;
     };
 
 public:
@@ -55,6 +101,8 @@ public:
     virtual ~Capturer();
     void start();
     void stop();
+    // 网络线程调用, 0~1. 按丢包率调整FEC和码率, 下一个包生效
+    void updateLossRate(float rate);
     uint32_t bytesPerFrame() const;
     uint32_t channels() const;
     uint32_t framesPerSec() const;
@@ -65,7 +113,11 @@ protected:
     Capturer(const Params& params);
     virtual bool initPlatform() = 0;
     virtual void captureLoop(const std::function<void()>& i_am_alive) = 0;
-    void onCapturedData(const uint8_t* data, uint32_t frames);
+    // delay_us: 最后一帧采集到之后又过了多久才交上来, 比如在系统音频服务里的缓冲时间
+    void onCapturedData(const uint8_t* data, uint32_t frames, int64_t delay_us = 0);
+    bool stoped() const;
+    // 只适用于会检查stoped()的captureLoop, 子类析构时调用, 保证编码器销毁前采集线程已经退出
+    void stopCaptureThread();
 
     void setBytesPerFrame(uint32_t value);
     void setChannels(uint32_t value);
@@ -75,19 +127,34 @@ private:
     bool init();
     bool needEncode() const;
     bool initEncoder();
+    uint32_t framesPerPacket() const;
+    void applyLossRate();
+    void prepareBuffers();
+    // end_us是环里最新一帧之后的时刻
+    void sendPackets(int64_t end_us);
+    std::shared_ptr<ltproto::client2worker::AudioData> acquireMessage();
 
 private:
     const AudioCodecType type_;
+    const OpusOptions opus_options_;
+    const bool packet_header_;
+    const uint32_t max_packets_per_message_;
     std::function<void(const std::shared_ptr<google::protobuf::MessageLite>&)> on_audio_data_;
     std::unique_ptr<ltlib::BlockingThread> capture_thread_;
     std::atomic<bool> stoped_{true};
     uint32_t bytes_per_frame_ = 0;
     uint32_t channels_ = 0;
     uint32_t frames_per_sec_ = 0;
-    std::shared_ptr<uint8_t> pcm_buffer_;
-    uint32_t pcm_buffer_size_ = 0;
-    std::vector<uint8_t> opus_buffer_;
+    // 把任意长度的采集数据切成整包, 容量固定
+    std::unique_ptr<PcmRing> pcm_ring_;
+    std::vector<int16_t> packet_pcm_;
+    // 发送方用完后复用, data字段保留原来的容量
+    std::vector<std::shared_ptr<ltproto::client2worker::AudioData>> messages_;
+    // 每个包一个序号, 客户端的抖动缓冲靠它排序和发现丢包
+    uint32_t sequence_ = 0;
     void* opus_encoder_ = nullptr;
+    std::atomic<uint32_t> loss_percent_;
+    uint32_t applied_loss_percent_;
 };
 
 } // namespace audio
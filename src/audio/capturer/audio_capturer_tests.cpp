@@ -0,0 +1,186 @@
+#include <time.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltproto/client2worker/audio_data.pb.h>
+
+#include <audio/audio_packet.h>
+#include <audio/capturer/audio_capturer.h>
+#include <audio/capturer/synthetic_audio_capturer.h>
+
+namespace {
+
+using lt::audio::Capturer;
+using lt::audio::SyntheticAudioCapturer;
+using Signal = Capturer::SyntheticSignal;
+
+constexpr uint32_t kSeconds = 10;
+
+struct Mode {
+    const char* name;
+    Capturer::OpusOptions opus;
+    // 编码前通知的丢包率
+    float loss_rate;
+};
+
+struct Result {
+    double bytes_per_sec;
+    double packets_per_sec;
+    // 编码1秒声音用的CPU时间占1秒的比例
+    double cpu_percent;
+};
+
+int64_t threadCpuUs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000 + ts.tv_nsec / 1'000;
+}
+
+std::optional<Result> encode(Signal signal, const Mode& mode) {
+    uint64_t bytes = 0;
+    uint64_t packets = 0;
+    Capturer::Params params{};
+    params.type = lt::AudioCodecType::OPUS;
+    params.opus = mode.opus;
+    params.backend = Capturer::Backend::Synthetic;
+    params.synthetic_signal = signal;
+    params.on_audio_data = [&](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        auto audio = std::static_pointer_cast<ltproto::client2worker::AudioData>(msg);
+        auto data = reinterpret_cast<const uint8_t*>(audio->data().data());
+        auto size = static_cast<uint32_t>(audio->data().size());
+        EXPECT_TRUE(lt::audio::parseAudioPacket(data, size).has_value());
+        // 包头算进去, 它也要占带宽
+        bytes += size;
+        packets++;
+    };
+    auto capturer = Capturer::create(params);
+    if (capturer == nullptr) {
+        return std::nullopt;
+    }
+    if (mode.loss_rate > 0) {
+        capturer->updateLossRate(mode.loss_rate);
+    }
+    auto synthetic = static_cast<SyntheticAudioCapturer*>(capturer.get());
+    const int64_t cpu_start_us = threadCpuUs();
+    synthetic->captureFrames(capturer->framesPerSec() * kSeconds);
+    const int64_t cpu_us = threadCpuUs() - cpu_start_us;
+    Result result{};
+    result.bytes_per_sec = static_cast<double>(bytes) / kSeconds;
+    result.packets_per_sec = static_cast<double>(packets) / kSeconds;
+    result.cpu_percent = cpu_us / (kSeconds * 10'000.0);
+    return result;
+}
+
+const char* toString(Signal signal) {
+    switch (signal) {
+    case Signal::Tone:
+        return "tone";
+    case Signal::Silence:
+        return "silence";
+    case Signal::Speech:
+    default:
+        return "speech";
+    }
+}
+
+Capturer::OpusOptions legacyOptions() {
+    // 以前的配置: 码率按PCM算, 默认复杂度, 没有FEC和DTX
+    Capturer::OpusOptions opus{};
+    opus.bitrate_bps = 48000 * 4 * 8;
+    opus.complexity = 10;
+    opus.fec = false;
+    opus.expected_loss_percent = 0;
+    opus.dtx = false;
+    return opus;
+}
+
+Capturer::OpusOptions options20ms() {
+    Capturer::OpusOptions opus{};
+    opus.frame_ms = 20;
+    return opus;
+}
+
+Capturer::OpusOptions optionsNoDtx() {
+    Capturer::OpusOptions opus{};
+    opus.dtx = false;
+    return opus;
+}
+
+TEST(AudioCapturerTest, OpusModes) {
+    const Mode modes[] = {
+        {"legacy", legacyOptions(), 0.f},   {"default", Capturer::OpusOptions{}, 0.f},
+        {"20ms", options20ms(), 0.f},       {"no-dtx", optionsNoDtx(), 0.f},
+        {"loss-20%", Capturer::OpusOptions{}, 0.2f},
+    };
+    const Signal signals[] = {Signal::Tone, Signal::Silence, Signal::Speech};
+    // [mode][signal]
+    Result results[5][3]{};
+    for (size_t m = 0; m < 5; m++) {
+        for (size_t s = 0; s < 3; s++) {
+            auto result = encode(signals[s], modes[m]);
+            if (!result.has_value()) {
+                GTEST_SKIP() << "Opus is not available";
+            }
+            results[m][s] = result.value();
+            std::printf("%-9s %-8s %8.0f bytes/s %6.1f packets/s, encode cpu %5.2f%%\n",
+                        modes[m].name, toString(signals[s]), result->bytes_per_sec,
+                        result->packets_per_sec, result->cpu_percent);
+        }
+    }
+    constexpr size_t kLegacy = 0, kDefault = 1, k20ms = 2, kNoDtx = 3, kLoss = 4;
+    constexpr size_t kTone = 0, kSilence = 1, kSpeech = 2;
+    // 默认码率96kbps, 加上包头不应该超出太多
+    EXPECT_LT(results[kDefault][kTone].bytes_per_sec, 96'000 / 8 * 1.3);
+    EXPECT_LT(results[kDefault][kTone].bytes_per_sec, results[kLegacy][kTone].bytes_per_sec / 2);
+    // DTX时静音只发包头, 告诉客户端这些帧是静音而不是丢了
+    EXPECT_LE(results[kDefault][kSilence].bytes_per_sec,
+              results[kDefault][kSilence].packets_per_sec *
+                  lt::audio::audioPacketHeaderSize(lt::audio::kMaxAudioFramesPerPacket));
+    EXPECT_LE(results[kDefault][kSilence].bytes_per_sec, results[kNoDtx][kSilence].bytes_per_sec);
+    // 句子之间的停顿也能省下来
+    EXPECT_LT(results[kDefault][kSpeech].bytes_per_sec, results[kNoDtx][kSpeech].bytes_per_sec);
+    // 20ms的包数减半
+    EXPECT_LT(results[k20ms][kTone].packets_per_sec, results[kDefault][kTone].packets_per_sec);
+    // 丢包多的时候带上更多FEC
+    EXPECT_GT(results[kLoss][kSpeech].bytes_per_sec, results[kDefault][kSpeech].bytes_per_sec);
+}
+
+TEST(AudioCapturerTest, NoPacketHeaderForOldClient) {
+    for (auto type : {lt::AudioCodecType::PCM, lt::AudioCodecType::OPUS}) {
+        std::vector<uint32_t> sizes;
+        Capturer::Params params{};
+        params.type = type;
+        params.opus = options20ms();
+        params.packet_header = false;
+        params.backend = Capturer::Backend::Synthetic;
+        params.synthetic_signal = Signal::Silence;
+        params.on_audio_data = [&](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+            auto audio = std::static_pointer_cast<ltproto::client2worker::AudioData>(msg);
+            sizes.push_back(static_cast<uint32_t>(audio->data().size()));
+        };
+        auto capturer = Capturer::create(params);
+        if (capturer == nullptr) {
+            GTEST_SKIP() << "Opus is not available";
+        }
+        auto synthetic = static_cast<SyntheticAudioCapturer*>(capturer.get());
+        synthetic->captureFrames(capturer->framesPerSec());
+        // 旧客户端按一条消息一个10ms的包解码, 静音也要照常发
+        ASSERT_EQ(sizes.size(), 100u);
+        for (auto size : sizes) {
+            if (type == lt::AudioCodecType::PCM) {
+                EXPECT_EQ(size, capturer->bytesPer10ms());
+            }
+            else {
+                EXPECT_GT(size, 0u);
+            }
+        }
+    }
+}
+
+} // namespace
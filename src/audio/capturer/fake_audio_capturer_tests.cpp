@@ -1,7 +1,81 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include <ltlib/times.h>
+#include <ltproto/client2worker/audio_data.pb.h>
+
+#include <audio/audio_packet.h>
 #include <audio/capturer/fake_audio_capturer.h>
 
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// 统计整个进程的堆分配
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+// FakeAudioCapturer自己不产生数据, 由测试直接喂
+class FeedableCapturer : public lt::audio::FakeAudioCapturer {
+public:
+    using FakeAudioCapturer::FakeAudioCapturer;
+    using FakeAudioCapturer::onCapturedData;
+};
+
+// 一帧是8字节, 按4个int16_t填, 值由帧号决定, 方便检查切出来的数据
+void fillFrames(std::vector<int16_t>& out, uint64_t first_frame, uint32_t frames) {
+    out.resize(frames * 4);
+    for (uint32_t i = 0; i < frames; i++) {
+        for (uint32_t k = 0; k < 4; k++) {
+            out[i * 4 + k] = static_cast<int16_t>((first_frame + i) * 4 + k);
+        }
+    }
+}
+
+uint32_t nextChunkFrames(uint32_t& seed, uint32_t max_frames) {
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) % (max_frames + 1);
+}
+
+} // namespace
+
 TEST(FakeAudioCapturerTest, DefaultParametersAreInitialized) {
     lt::audio::Capturer::Params params;
     params.type = lt::AudioCodecType::PCM;
@@ -29,3 +103,90 @@ TEST(FakeAudioCapturerTest, InitPlatformSucceedsAndCaptureLoopIsNoop) {
     capturer.captureLoop([&alive_call_count]() { ++alive_call_count; });
     EXPECT_EQ(alive_call_count, 0);
 }
+
+TEST(FakeAudioCapturerTest, ArbitraryChunkSizesAreSlicedIntoExactPackets) {
+    std::vector<int16_t> received;
+    uint32_t next_sequence = 0;
+    uint32_t max_frames_per_message = 0;
+    lt::audio::Capturer::Params params;
+    params.type = lt::AudioCodecType::PCM;
+    params.on_audio_data = [&](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        auto audio = std::static_pointer_cast<ltproto::client2worker::AudioData>(msg);
+        auto packet =
+            lt::audio::parseAudioPacket(reinterpret_cast<const uint8_t*>(audio->data().data()),
+                                        static_cast<uint32_t>(audio->data().size()));
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->sequence, next_sequence);
+        // 采集时间从回调的时刻往前推
+        EXPECT_LE(packet->capture_time_us, ltlib::steady_now_us());
+        next_sequence += packet->frames;
+        max_frames_per_message = std::max(max_frames_per_message, packet->frames);
+        for (uint32_t i = 0; i < packet->frames; i++) {
+            ASSERT_EQ(packet->frame[i].size, 3840u);
+            auto samples = reinterpret_cast<const int16_t*>(packet->frame[i].data);
+            received.insert(received.end(), samples, samples + packet->frame[i].size / 2);
+        }
+    };
+    FeedableCapturer capturer{params};
+
+    // 包括0帧, 不到一个包, 刚好一个包, 以及比内部环形缓冲还大的块
+    std::vector<uint32_t> chunks = {1, 479, 480, 481, 0, 960, 2399, 10000, 7};
+    uint32_t seed = 42;
+    for (int i = 0; i < 500; i++) {
+        chunks.push_back(nextChunkFrames(seed, 3000));
+    }
+    std::vector<int16_t> chunk;
+    uint64_t total_frames = 0;
+    for (uint32_t frames : chunks) {
+        fillFrames(chunk, total_frames, frames);
+        capturer.onCapturedData(reinterpret_cast<const uint8_t*>(chunk.data()), frames);
+        total_frames += frames;
+    }
+
+    // 不满一个包的尾巴还留在采集器里
+    const uint64_t packets = total_frames / 480;
+    EXPECT_EQ(next_sequence, packets);
+    ASSERT_EQ(received.size(), packets * 480 * 4);
+    std::vector<int16_t> expected;
+    fillFrames(expected, 0, static_cast<uint32_t>(packets * 480));
+    EXPECT_TRUE(received == expected);
+    // 一次来得多时合成一条消息, 但不超过默认的上限
+    EXPECT_EQ(max_frames_per_message, 4u);
+}
+
+TEST(FakeAudioCapturerTest, SteadyStateDoesNotAllocate) {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    // 模拟发送线程还没处理完的消息
+    std::array<std::shared_ptr<google::protobuf::MessageLite>, 3> in_flight;
+    lt::audio::Capturer::Params params;
+    params.type = lt::AudioCodecType::PCM;
+    params.on_audio_data = [&](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        in_flight[messages % in_flight.size()] = msg;
+        messages++;
+        bytes += std::static_pointer_cast<ltproto::client2worker::AudioData>(msg)->data().size();
+    };
+    FeedableCapturer capturer{params};
+
+    std::vector<int16_t> chunk;
+    fillFrames(chunk, 0, 3000);
+    auto data = reinterpret_cast<const uint8_t*>(chunk.data());
+    uint32_t seed = 7;
+    // 预热: 让池子里每条消息都长到最大
+    for (int i = 0; i < 1000; i++) {
+        capturer.onCapturedData(data, nextChunkFrames(seed, 3000));
+    }
+    constexpr int kChunks = 10000;
+    const uint64_t messages0 = messages;
+    const uint64_t allocations0 = g_allocations.load();
+    for (int i = 0; i < kChunks; i++) {
+        capturer.onCapturedData(data, nextChunkFrames(seed, 3000));
+    }
+    const uint64_t allocations = g_allocations.load() - allocations0;
+    std::printf("%d chunks -> %llu messages, %llu bytes, %llu allocations\n", kChunks,
+                static_cast<unsigned long long>(messages - messages0),
+                static_cast<unsigned long long>(bytes),
+                static_cast<unsigned long long>(allocations));
+    EXPECT_GT(messages, messages0);
+    EXPECT_EQ(allocations, 0u);
+}
@@ -0,0 +1,197 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pulse_audio_capturer.h"
+
+#include <thread>
+
+#include <ltlib/logging.h>
+
+namespace {
+
+// 和pulse/sample.h, pulse/def.h保持一致
+struct PaSampleSpec {
+    int format;
+    uint32_t rate;
+    uint8_t channels;
+};
+
+struct PaBufferAttr {
+    uint32_t maxlength;
+    uint32_t tlength;
+    uint32_t prebuf;
+    uint32_t minreq;
+    uint32_t fragsize;
+};
+
+constexpr int kPaSampleS16LE = 3;
+constexpr int kPaStreamRecord = 2;
+constexpr uint32_t kPaDefault = static_cast<uint32_t>(-1);
+constexpr uint64_t kPaInvalidLatency = static_cast<uint64_t>(-1);
+
+constexpr uint32_t kFrequency = 48000;
+constexpr uint32_t kChannels = 2;
+// 服务端每5ms交一次数据. 再小的话PulseAudio自己的调度开销就明显了
+constexpr uint32_t kFragmentFrames = kFrequency * 5 / 1000;
+// 默认输出设备的monitor
+constexpr const char* kDefaultMonitor = "@DEFAULT_MONITOR@";
+// 读失败后最多重开几次, 每次间隔多久. pipewire-pulse重启一般一两秒内就能连上
+constexpr int kMaxReopenAttempts = 10;
+constexpr auto kReopenInterval = std::chrono::milliseconds{500};
+
+} // namespace
+
+namespace lt {
+
+namespace audio {
+
+PulseAudioCapturer::PulseAudioCapturer(const Params& params)
+    : Capturer{params}
+    , device_{params.device} {
+    setBytesPerFrame(kChannels * sizeof(int16_t));
+    setFramesPerSec(kFrequency);
+    setChannels(kChannels);
+    buffer_.resize(kFragmentFrames * bytesPerFrame());
+}
+
+PulseAudioCapturer::~PulseAudioCapturer() {
+    stopCaptureThread();
+    closeStream();
+}
+
+bool PulseAudioCapturer::initPlatform() {
+    if (!loadApi()) {
+        return false;
+    }
+    return openStream();
+}
+
+bool PulseAudioCapturer::openStream() {
+    PaSampleSpec spec{};
+    spec.format = kPaSampleS16LE;
+    spec.rate = kFrequency;
+    spec.channels = static_cast<uint8_t>(kChannels);
+    // 只限制fragsize, 服务端攒够一个fragment就交给我们. 其它用服务端的默认值
+    PaBufferAttr attr{};
+    attr.maxlength = kPaDefault;
+    attr.tlength = kPaDefault;
+    attr.prebuf = kPaDefault;
+    attr.minreq = kPaDefault;
+    attr.fragsize = static_cast<uint32_t>(buffer_.size());
+    const char* device = device_.empty() ? kDefaultMonitor : device_.c_str();
+    int error = 0;
+    stream_ = pa_simple_new_(nullptr, "lanthing", kPaStreamRecord, device, "desktop audio", &spec,
+                             nullptr, &attr, &error);
+    if (stream_ == nullptr) {
+        LOG(ERR) << "pa_simple_new(" << device << ") failed: " << errorString(error);
+        return false;
+    }
+    LOG(INFO) << "PulseAudio capturer opened " << device << ", fragment " << kFragmentFrames
+              << " frames";
+    return true;
+}
+
+void PulseAudioCapturer::captureLoop(const std::function<void()>& i_am_alive) {
+    while (!stoped()) {
+        i_am_alive();
+        int error = 0;
+        // 阻塞到读满一个fragment. monitor会让对应的输出设备保持运行, 没声音时读到的是静音
+        if (pa_simple_read_(stream_, buffer_.data(), buffer_.size(), &error) < 0) {
+            LOG(WARNING) << "pa_simple_read failed: " << errorString(error) << ", reopening";
+            if (!reopenStream(i_am_alive)) {
+                break;
+            }
+            continue;
+        }
+        // 读出来的最后一帧在服务端等了多久
+        const uint64_t latency_us = pa_simple_get_latency_(stream_, &error);
+        onCapturedData(buffer_.data(), kFragmentFrames,
+                       latency_us == kPaInvalidLatency ? 0 : static_cast<int64_t>(latency_us));
+    }
+}
+
+void PulseAudioCapturer::closeStream() {
+    if (stream_ != nullptr) {
+        pa_simple_free_(stream_);
+        stream_ = nullptr;
+    }
+}
+
+bool PulseAudioCapturer::reopenStream(const std::function<void()>& i_am_alive) {
+    closeStream();
+    for (int attempt = 1; attempt <= kMaxReopenAttempts; attempt++) {
+        std::this_thread::sleep_for(kReopenInterval);
+        i_am_alive();
+        if (stoped()) {
+            return false;
+        }
+        if (openStream()) {
+            LOG(INFO) << "PulseAudio capturer reopened after " << attempt << " attempts";
+            return true;
+        }
+    }
+    LOG(ERR) << "Reopen PulseAudio capture stream failed " << kMaxReopenAttempts
+             << " times, audio capture stopped";
+    return false;
+}
+
+bool PulseAudioCapturer::loadApi() {
+    const std::string kLibName = "libpulse-simple.so.0";
+    pulse_lib_ = ltlib::DynamicLibrary::load(kLibName);
+    if (pulse_lib_ == nullptr) {
+        LOG(ERR) << "Load library " << kLibName << " failed";
+        return false;
+    }
+    pa_simple_new_ = reinterpret_cast<PaSimpleNew>(pulse_lib_->getFunc("pa_simple_new"));
+    pa_simple_read_ = reinterpret_cast<PaSimpleRead>(pulse_lib_->getFunc("pa_simple_read"));
+    pa_simple_get_latency_ =
+        reinterpret_cast<PaSimpleGetLatency>(pulse_lib_->getFunc("pa_simple_get_latency"));
+    pa_simple_free_ = reinterpret_cast<PaSimpleFree>(pulse_lib_->getFunc("pa_simple_free"));
+    // 在libpulse里, libpulse-simple依赖它, 通过同一个句柄能找到
+    pa_strerror_ = reinterpret_cast<PaStrerror>(pulse_lib_->getFunc("pa_strerror"));
+    if (pa_simple_new_ == nullptr || pa_simple_read_ == nullptr ||
+        pa_simple_get_latency_ == nullptr || pa_simple_free_ == nullptr) {
+        LOG(ERR) << "Load functions from " << kLibName << " failed";
+        return false;
+    }
+    return true;
+}
+
+const char* PulseAudioCapturer::errorString(int error) const {
+    if (pa_strerror_ == nullptr) {
+        return "unknown error";
+    }
+    const char* str = pa_strerror_(error);
+    return str == nullptr ? "unknown error" : str;
+}
+
+} // namespace audio
+
+} // namespace lt
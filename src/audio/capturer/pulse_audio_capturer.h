@@ -0,0 +1,87 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ltlib/load_library.h>
+
+#include <audio/capturer/audio_capturer.h>
+
+namespace lt {
+
+namespace audio {
+
+// 通过PulseAudio的simple API录制输出设备的monitor, 即"电脑正在播放的声音".
+// PipeWire的pipewire-pulse兼容层同样适用. libpulse-simple运行时加载, 编译不依赖它
+class PulseAudioCapturer : public Capturer {
+public:
+    PulseAudioCapturer(const Params& params);
+    ~PulseAudioCapturer() override;
+
+protected:
+    bool initPlatform() override;
+    void captureLoop(const std::function<void()>& i_am_alive) override;
+
+private:
+    bool loadApi();
+    bool openStream();
+    void closeStream();
+    // 读失败后(服务端重启, 设备被拔掉等)重新打开, 失败次数太多就放弃
+    bool reopenStream(const std::function<void()>& i_am_alive);
+    const char* errorString(int error) const;
+
+private:
+    // pulse/simple.h里的函数签名, 参数里的结构体用void*代替
+    using PaSimpleNew = void* (*)(const char* server, const char* name, int dir, const char* dev,
+                                  const char* stream_name, const void* ss, const void* map,
+                                  const void* attr, int* error);
+    using PaSimpleRead = int (*)(void* s, void* data, size_t bytes, int* error);
+    using PaSimpleGetLatency = uint64_t (*)(void* s, int* error);
+    using PaSimpleFree = void (*)(void* s);
+    using PaStrerror = const char* (*)(int error);
+
+    const std::string device_;
+    std::unique_ptr<ltlib::DynamicLibrary> pulse_lib_;
+    PaSimpleNew pa_simple_new_ = nullptr;
+    PaSimpleRead pa_simple_read_ = nullptr;
+    PaSimpleGetLatency pa_simple_get_latency_ = nullptr;
+    PaSimpleFree pa_simple_free_ = nullptr;
+    PaStrerror pa_strerror_ = nullptr;
+    void* stream_ = nullptr;
+    std::vector<uint8_t> buffer_;
+};
+
+} // namespace audio
+
+} // namespace lt
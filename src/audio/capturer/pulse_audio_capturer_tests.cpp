@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltlib/threads.h>
+#include <ltlib/times.h>
+#include <ltproto/client2worker/audio_data.pb.h>
+
+#include <audio/audio_packet.h>
+#include <audio/capturer/audio_capturer.h>
+#include <audio/capturer/pulse_audio_capturer.h>
+
+// 需要一个能连上的PulseAudio(或者pipewire-pulse), 无头环境可以用null sink:
+//   pulseaudio --daemonize --exit-idle-time=-1
+//   pactl load-module module-null-sink sink_name=lt_null && pactl set-default-sink lt_null
+// 连不上时跳过, 但同样的测量会对实时的合成声源跑一遍
+
+namespace {
+
+using lt::audio::Capturer;
+
+constexpr std::chrono::seconds kDuration{5};
+// 丢掉开头这段, 采集刚开始时服务端会一次交出积攒的数据
+constexpr int64_t kWarmupUs = 300'000;
+
+// 采集线程要向ThreadWatcher注册
+class ThreadWatcherEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override { ltlib::ThreadWatcher::init(std::this_thread::get_id()); }
+    void TearDown() override { ltlib::ThreadWatcher::uninit(); }
+};
+
+const auto* const kThreadWatcherEnv =
+    ::testing::AddGlobalTestEnvironment(new ThreadWatcherEnvironment);
+
+struct Timing {
+    uint64_t packets;
+    // 相邻两条消息交出来的间隔
+    double avg_gap_ms;
+    double max_gap_ms;
+    // 采集时间随序号增长的斜率和标称包长的偏差
+    double drift_ppm;
+    // 一条消息最后一个样本采集到, 到这条消息编码完交出来
+    double p50_latency_ms;
+    double p99_latency_ms;
+};
+
+class TimingRecorder {
+public:
+    void onAudioData(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        const int64_t now_us = ltlib::steady_now_us();
+        auto audio = std::static_pointer_cast<ltproto::client2worker::AudioData>(msg);
+        auto packet =
+            lt::audio::parseAudioPacket(reinterpret_cast<const uint8_t*>(audio->data().data()),
+                                        static_cast<uint32_t>(audio->data().size()));
+        if (!packet.has_value()) {
+            return;
+        }
+        std::lock_guard lock{mutex_};
+        if (start_us_ == 0) {
+            start_us_ = now_us;
+        }
+        if (now_us - start_us_ < kWarmupUs) {
+            return;
+        }
+        const int64_t end_of_packet_us =
+            packet->capture_time_us + packet->frames * kPacketDurationUs;
+        arrivals_us_.push_back(now_us);
+        latencies_us_.push_back(now_us - end_of_packet_us);
+        sequences_.push_back(packet->sequence);
+        capture_times_us_.push_back(packet->capture_time_us);
+    }
+
+    std::optional<Timing> timing() {
+        std::lock_guard lock{mutex_};
+        if (arrivals_us_.size() < 10) {
+            return std::nullopt;
+        }
+        Timing timing{};
+        timing.packets = sequences_.back() - sequences_.front();
+        int64_t max_gap_us = 0;
+        for (size_t i = 1; i < arrivals_us_.size(); i++) {
+            max_gap_us = std::max(max_gap_us, arrivals_us_[i] - arrivals_us_[i - 1]);
+        }
+        timing.avg_gap_ms =
+            (arrivals_us_.back() - arrivals_us_.front()) / 1000.0 / (arrivals_us_.size() - 1);
+        timing.max_gap_ms = max_gap_us / 1000.0;
+        // 单个包的采集时间受回调时刻抖动影响, 用最小二乘拟合整段的斜率
+        const double n = static_cast<double>(sequences_.size());
+        double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+        for (size_t i = 0; i < sequences_.size(); i++) {
+            const double x = sequences_[i] - sequences_.front();
+            const double y = static_cast<double>(capture_times_us_[i] - capture_times_us_.front());
+            sum_x += x;
+            sum_y += y;
+            sum_xx += x * x;
+            sum_xy += x * y;
+        }
+        const double slope = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+        timing.drift_ppm = (slope / kPacketDurationUs - 1) * 1e6;
+        std::sort(latencies_us_.begin(), latencies_us_.end());
+        timing.p50_latency_ms = latencies_us_[latencies_us_.size() / 2] / 1000.0;
+        timing.p99_latency_ms = latencies_us_[latencies_us_.size() * 99 / 100] / 1000.0;
+        return timing;
+    }
+
+private:
+    static constexpr int64_t kPacketDurationUs = 10'000;
+    std::mutex mutex_;
+    int64_t start_us_ = 0;
+    std::vector<int64_t> arrivals_us_;
+    std::vector<int64_t> latencies_us_;
+    std::vector<uint32_t> sequences_;
+    std::vector<int64_t> capture_times_us_;
+};
+
+Capturer::Params opusParams(TimingRecorder& recorder) {
+    Capturer::Params params{};
+    params.type = lt::AudioCodecType::OPUS;
+    // null sink的monitor全是静音, 打开DTX就只剩包头了
+    params.opus.dtx = false;
+    params.on_audio_data = [&recorder](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        recorder.onAudioData(msg);
+    };
+    return params;
+}
+
+std::optional<Timing> run(Capturer& capturer, TimingRecorder& recorder) {
+    capturer.start();
+    std::this_thread::sleep_for(kDuration);
+    capturer.stop();
+    return recorder.timing();
+}
+
+void print(const char* name, const Timing& timing) {
+    std::printf("%s: %llu packets, gap avg %.2fms max %.2fms, drift %.0fppm, "
+                "capture->encoded p50 %.2fms p99 %.2fms\n",
+                name, static_cast<unsigned long long>(timing.packets), timing.avg_gap_ms,
+                timing.max_gap_ms, timing.drift_ppm, timing.p50_latency_ms, timing.p99_latency_ms);
+}
+
+TEST(PulseAudioCapturerTest, MonitorCadenceDriftAndLatency) {
+    TimingRecorder recorder;
+    auto capturer = Capturer::create(opusParams(recorder));
+    ASSERT_NE(capturer, nullptr);
+    // 连不上PulseAudio时create()退回FakeAudioCapturer
+    if (dynamic_cast<lt::audio::PulseAudioCapturer*>(capturer.get()) == nullptr) {
+        GTEST_SKIP() << "PulseAudio is not available";
+    }
+    auto timing = run(*capturer, recorder);
+    capturer.reset();
+    ASSERT_TRUE(timing.has_value());
+    // 最大间隔和延迟受机器负载影响太大, 只打印出来看, 不做断言
+    print("pulse", timing.value());
+    // 5ms一个fragment, 平均每10ms一个包
+    EXPECT_NEAR(timing->avg_gap_ms, 10.0, 2.0);
+    // 声卡时钟和系统时钟有偏差, 正常在几十ppm
+    EXPECT_LT(std::abs(timing->drift_ppm), 2000.0);
+}
+
+TEST(PulseAudioCapturerTest, SyntheticRealtimeBaseline) {
+    TimingRecorder recorder;
+    auto params = opusParams(recorder);
+    params.backend = Capturer::Backend::Synthetic;
+    params.synthetic_signal = Capturer::SyntheticSignal::Speech;
+    auto capturer = Capturer::create(params);
+    if (capturer == nullptr) {
+        GTEST_SKIP() << "Opus is not available";
+    }
+    auto timing = run(*capturer, recorder);
+    capturer.reset();
+    ASSERT_TRUE(timing.has_value());
+    print("synthetic", timing.value());
+    // 7ms一块, 按系统时钟排期, 没有漂移
+    EXPECT_NEAR(timing->avg_gap_ms, 10.0, 2.0);
+    EXPECT_LT(std::abs(timing->drift_ppm), 2000.0);
+}
+
+} // namespace
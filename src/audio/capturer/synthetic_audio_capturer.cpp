@@ -0,0 +1,242 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "synthetic_audio_capturer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <ltlib/logging.h>
+#include <ltlib/times.h>
+
+namespace {
+
+constexpr uint32_t kFrequency = 48000;
+constexpr uint32_t kChannels = 2;
+constexpr uint32_t kChunkFrames = kFrequency * 7 / 1000;
+constexpr double kPi = 3.14159265358979323846;
+
+uint32_t readLE(const uint8_t* data, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace audio {
+
+SyntheticAudioCapturer::SyntheticAudioCapturer(const Params& params)
+    : Capturer{params}
+    , signal_{params.synthetic_signal}
+    , paced_{params.synthetic_paced}
+    , wav_path_{params.synthetic_wav_path} {
+    setBytesPerFrame(kChannels * sizeof(int16_t));
+    setFramesPerSec(kFrequency);
+    setChannels(kChannels);
+    buffer_.resize(kChunkFrames * kChannels);
+}
+
+SyntheticAudioCapturer::~SyntheticAudioCapturer() {
+    stopCaptureThread();
+}
+
+bool SyntheticAudioCapturer::initPlatform() {
+    if (signal_ == SyntheticSignal::WavFile) {
+        return loadWav();
+    }
+    return true;
+}
+
+void SyntheticAudioCapturer::captureLoop(const std::function<void()>& i_am_alive) {
+    const int64_t start_us = ltlib::steady_now_us();
+    const uint64_t start_position = position_;
+    while (!stoped()) {
+        i_am_alive();
+        if (paced_) {
+            // 等到这一块的最后一个样本"采集"到
+            const uint64_t frames = position_ - start_position + kChunkFrames;
+            const int64_t due_us = start_us + static_cast<int64_t>(frames * 1'000'000 / kFrequency);
+            const int64_t now_us = ltlib::steady_now_us();
+            if (due_us > now_us) {
+                std::this_thread::sleep_for(std::chrono::microseconds{due_us - now_us});
+            }
+        }
+        captureFrames(kChunkFrames);
+    }
+}
+
+void SyntheticAudioCapturer::captureFrames(uint32_t frames) {
+    while (frames > 0) {
+        const uint32_t chunk = std::min(frames, kChunkFrames);
+        generate(buffer_.data(), chunk);
+        onCapturedData(reinterpret_cast<const uint8_t*>(buffer_.data()), chunk);
+        frames -= chunk;
+    }
+}
+
+bool SyntheticAudioCapturer::loadWav() {
+    std::ifstream file{wav_path_, std::ios::binary};
+    if (!file) {
+        LOG(ERR) << "Open " << wav_path_ << " failed";
+        return false;
+    }
+    const std::vector<uint8_t> content{std::istreambuf_iterator<char>{file},
+                                       std::istreambuf_iterator<char>{}};
+    if (content.size() < 12 || memcmp(content.data(), "RIFF", 4) != 0 ||
+        memcmp(content.data() + 8, "WAVE", 4) != 0) {
+        LOG(ERR) << wav_path_ << " is not a WAV file";
+        return false;
+    }
+    uint32_t format = 0;
+    uint32_t channels = 0;
+    uint32_t rate = 0;
+    uint32_t bits = 0;
+    const uint8_t* samples = nullptr;
+    size_t samples_size = 0;
+    for (size_t offset = 12; offset + 8 <= content.size();) {
+        const uint8_t* chunk = content.data() + offset;
+        const size_t size = std::min<size_t>(readLE(chunk + 4, 4), content.size() - offset - 8);
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            format = readLE(chunk + 8, 2);
+            channels = readLE(chunk + 10, 2);
+            rate = readLE(chunk + 12, 4);
+            bits = readLE(chunk + 22, 2);
+        }
+        else if (memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            samples_size = size;
+        }
+        // 块按2字节对齐
+        offset += 8 + size + (size & 1);
+    }
+    // 1是PCM, 0xFFFE是WAVE_FORMAT_EXTENSIBLE, 位数一样时样本布局相同
+    if ((format != 1 && format != 0xFFFE) || bits != 16 || channels == 0 || rate == 0 ||
+        samples == nullptr) {
+        LOG(ERR) << "Unsupported WAV " << wav_path_ << ", format:" << format
+                 << " channels:" << channels << " rate:" << rate << " bits:" << bits;
+        return false;
+    }
+    const size_t in_frames = samples_size / (channels * sizeof(int16_t));
+    const auto out_frames =
+        static_cast<size_t>(static_cast<uint64_t>(in_frames) * kFrequency / rate);
+    if (out_frames == 0) {
+        LOG(ERR) << wav_path_ << " has no samples";
+        return false;
+    }
+    // 单声道复制到两个声道, 多于两个声道只取前两个
+    auto sample_at = [&](size_t frame, uint32_t channel) {
+        const size_t index = (frame % in_frames) * channels + std::min(channel, channels - 1);
+        return static_cast<double>(static_cast<int16_t>(readLE(samples + index * 2, 2)));
+    };
+    wav_.resize(out_frames * kChannels);
+    for (size_t i = 0; i < out_frames; i++) {
+        const double position = static_cast<double>(i) * rate / kFrequency;
+        const auto index = static_cast<size_t>(position);
+        const double frac = position - index;
+        for (uint32_t c = 0; c < kChannels; c++) {
+            // 最后一个样本和第一个样本插值, 循环播放时没有跳变
+            const double value = sample_at(index, c) * (1 - frac) + sample_at(index + 1, c) * frac;
+            wav_[i * kChannels + c] = static_cast<int16_t>(std::lround(value));
+        }
+    }
+    LOG(INFO) << "Loaded " << wav_path_ << ", " << channels << " channels " << rate << "Hz, "
+              << in_frames << " frames";
+    return true;
+}
+
+void SyntheticAudioCapturer::generate(int16_t* out, uint32_t frames) {
+    if (signal_ == SyntheticSignal::WavFile) {
+        const size_t wav_frames = wav_.size() / kChannels;
+        for (uint32_t i = 0; i < frames; i++) {
+            const size_t frame = (position_ + i) % wav_frames;
+            memcpy(out + i * kChannels, wav_.data() + frame * kChannels,
+                   kChannels * sizeof(int16_t));
+        }
+        position_ += frames;
+        return;
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        const double t = static_cast<double>(position_ + i) / kFrequency;
+        double value = 0;
+        switch (signal_) {
+        case SyntheticSignal::Tone:
+            value = 0.3 * std::sin(2 * kPi * 440 * t) + 0.1 * std::sin(2 * kPi * 880 * t) +
+                    0.05 * std::sin(2 * kPi * 1320 * t);
+            break;
+        case SyntheticSignal::Speech:
+            value = speechSample(t);
+            break;
+        case SyntheticSignal::Silence:
+        default:
+            break;
+        }
+        const auto sample = static_cast<int16_t>(std::lround(value * 32767));
+        for (uint32_t c = 0; c < kChannels; c++) {
+            out[i * kChannels + c] = sample;
+        }
+    }
+    position_ += frames;
+}
+
+double SyntheticAudioCapturer::speechSample(double t) const {
+    // 每句0.8秒, 停顿0.4秒, 一秒4个音节
+    const double in_sentence = std::fmod(t, 1.2);
+    if (in_sentence > 0.8) {
+        return 0;
+    }
+    const double syllable = std::sin(kPi * std::fmod(in_sentence * 4, 1.0));
+    const double envelope = syllable * syllable;
+    // 基频在80~140Hz之间缓慢变化, 相位取瞬时频率的积分, 不会有跳变
+    const double phase = 2 * kPi * (110 * t - 30 / (2 * kPi * 0.7) * std::cos(2 * kPi * 0.7 * t));
+    const double f0 = 110 + 30 * std::sin(2 * kPi * 0.7 * t);
+    double value = 0;
+    for (int k = 1; k <= 15; k++) {
+        // 两个共振峰
+        const double f = f0 * k;
+        const double weight = std::exp(-std::pow((f - 500) / 200, 2)) +
+                              0.6 * std::exp(-std::pow((f - 1500) / 300, 2)) + 0.1;
+        value += weight / k * std::sin(k * phase);
+    }
+    return 0.2 * envelope * value;
+}
+
+} // namespace audio
+
+} // namespace lt
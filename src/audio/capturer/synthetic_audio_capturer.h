@@ -0,0 +1,72 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <audio/capturer/audio_capturer.h>
+
+namespace lt {
+
+namespace audio {
+
+// 生成合成声音或者循环播放WAV文件的采集器, 48kHz双声道16位. 同样的参数总是得到同样的样本序列.
+// 每次回调7ms, 和编码的包长对不齐, 覆盖拼包的逻辑
+class SyntheticAudioCapturer : public Capturer {
+public:
+    SyntheticAudioCapturer(const Params& params);
+    ~SyntheticAudioCapturer() override;
+    // 在调用线程上生成frames帧并交给编码, 不需要start(). 测试用
+    void captureFrames(uint32_t frames);
+
+protected:
+    bool initPlatform() override;
+    void captureLoop(const std::function<void()>& i_am_alive) override;
+
+private:
+    bool loadWav();
+    void generate(int16_t* out, uint32_t frames);
+    double speechSample(double t) const;
+
+private:
+    const SyntheticSignal signal_;
+    const bool paced_;
+    const std::string wav_path_;
+    uint64_t position_ = 0;
+    std::vector<int16_t> buffer_;
+    // 已经重采样到48kHz双声道
+    std::vector<int16_t> wav_;
+};
+
+} // namespace audio
+
+} // namespace lt
@@ -0,0 +1,112 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltproto/client2worker/audio_data.pb.h>
+
+#include <audio/audio_packet.h>
+#include <audio/capturer/audio_capturer.h>
+#include <audio/capturer/synthetic_audio_capturer.h>
+
+namespace {
+
+using lt::audio::Capturer;
+using lt::audio::SyntheticAudioCapturer;
+
+constexpr double kPi = 3.14159265358979323846;
+
+void appendLE(std::vector<uint8_t>& out, uint32_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// 单声道16位PCM, 1kHz正弦
+std::string writeSineWav(const std::string& name, uint32_t rate, uint32_t frames) {
+    std::vector<uint8_t> wav;
+    const uint32_t data_size = frames * 2;
+    wav.insert(wav.end(), {'R', 'I', 'F', 'F'});
+    appendLE(wav, 36 + data_size, 4);
+    wav.insert(wav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    appendLE(wav, 16, 4);
+    appendLE(wav, 1, 2);
+    appendLE(wav, 1, 2);
+    appendLE(wav, rate, 4);
+    appendLE(wav, rate * 2, 4);
+    appendLE(wav, 2, 2);
+    appendLE(wav, 16, 2);
+    wav.insert(wav.end(), {'d', 'a', 't', 'a'});
+    appendLE(wav, data_size, 4);
+    for (uint32_t i = 0; i < frames; i++) {
+        const double value = 0.5 * std::sin(2 * kPi * 1000 * i / rate);
+        appendLE(wav, static_cast<uint16_t>(static_cast<int16_t>(std::lround(value * 32767))), 2);
+    }
+    const auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    file.write(reinterpret_cast<const char*>(wav.data()), static_cast<std::streamsize>(wav.size()));
+    return path;
+}
+
+Capturer::Params wavParams(const std::string& path, std::vector<int16_t>& pcm) {
+    Capturer::Params params{};
+    params.type = lt::AudioCodecType::PCM;
+    params.backend = Capturer::Backend::Synthetic;
+    params.synthetic_signal = Capturer::SyntheticSignal::WavFile;
+    params.synthetic_wav_path = path;
+    params.on_audio_data = [&pcm](const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        auto audio = std::static_pointer_cast<ltproto::client2worker::AudioData>(msg);
+        auto packet =
+            lt::audio::parseAudioPacket(reinterpret_cast<const uint8_t*>(audio->data().data()),
+                                        static_cast<uint32_t>(audio->data().size()));
+        ASSERT_TRUE(packet.has_value());
+        for (uint32_t i = 0; i < packet->frames; i++) {
+            auto samples = reinterpret_cast<const int16_t*>(packet->frame[i].data);
+            pcm.insert(pcm.end(), samples, samples + packet->frame[i].size / 2);
+        }
+    };
+    return params;
+}
+
+TEST(SyntheticAudioCapturerTest, PlaysWavResampledAndLooped) {
+    // 24kHz的0.5秒, 重采样到48kHz是24000帧
+    const auto path = writeSineWav("lt_synthetic_capturer_test.wav", 24000, 12000);
+    std::vector<int16_t> pcm;
+    auto capturer = Capturer::create(wavParams(path, pcm));
+    ASSERT_NE(capturer, nullptr);
+    static_cast<SyntheticAudioCapturer*>(capturer.get())->captureFrames(48000);
+    capturer.reset();
+    std::filesystem::remove(path);
+
+    ASSERT_EQ(pcm.size(), 48000u * 2);
+    double max_error = 0;
+    for (size_t i = 0; i < 48000; i++) {
+        EXPECT_EQ(pcm[i * 2], pcm[i * 2 + 1]);
+        const double expected = 0.5 * 32767 * std::sin(2 * kPi * 1000 * i / 48000);
+        max_error = std::max(max_error, std::abs(pcm[i * 2] - expected));
+    }
+    std::printf("max resample error %.1f\n", max_error);
+    // 线性插值在1kHz/24kHz下的误差不到1%
+    EXPECT_LT(max_error, 0.01 * 32767);
+    // 第二遍和第一遍一样
+    for (size_t i = 0; i < 24000 * 2; i++) {
+        ASSERT_EQ(pcm[i], pcm[i + 24000 * 2]) << i;
+    }
+}
+
+TEST(SyntheticAudioCapturerTest, RejectsInvalidWav) {
+    std::vector<int16_t> pcm;
+    EXPECT_EQ(Capturer::create(wavParams("/nonexistent/lanthing.wav", pcm)), nullptr);
+    const auto path = (std::filesystem::temp_directory_path() / "lt_not_a_wav.wav").string();
+    std::ofstream{path, std::ios::binary | std::ios::trunc} << "definitely not a wav file";
+    EXPECT_EQ(Capturer::create(wavParams(path, pcm)), nullptr);
+    std::filesystem::remove(path);
+}
+
+} // namespace
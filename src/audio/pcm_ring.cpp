@@ -0,0 +1,85 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "pcm_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace lt {
+
+namespace audio {
+
+PcmRing::PcmRing(uint32_t capacity_frames, uint32_t channels)
+    : capacity_{capacity_frames}
+    , channels_{channels} {
+    buffer_.resize(static_cast<size_t>(capacity_) * channels_);
+}
+
+uint32_t PcmRing::write(const int16_t* data, uint32_t frames) {
+    const uint64_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const uint64_t read_pos = read_pos_.load(std::memory_order_acquire);
+    const auto free_frames = static_cast<uint32_t>(capacity_ - (write_pos - read_pos));
+    frames = std::min(frames, free_frames);
+    const auto offset = static_cast<uint32_t>(write_pos % capacity_);
+    const uint32_t first = std::min(frames, capacity_ - offset);
+    memcpy(buffer_.data() + offset * channels_, data, first * channels_ * sizeof(int16_t));
+    memcpy(buffer_.data(), data + first * channels_,
+           (frames - first) * channels_ * sizeof(int16_t));
+    write_pos_.store(write_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+uint32_t PcmRing::read(int16_t* out, uint32_t frames) {
+    const uint64_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    const uint64_t write_pos = write_pos_.load(std::memory_order_acquire);
+    frames = std::min(frames, static_cast<uint32_t>(write_pos - read_pos));
+    const auto offset = static_cast<uint32_t>(read_pos % capacity_);
+    const uint32_t first = std::min(frames, capacity_ - offset);
+    memcpy(out, buffer_.data() + offset * channels_, first * channels_ * sizeof(int16_t));
+    memcpy(out + first * channels_, buffer_.data(),
+           (frames - first) * channels_ * sizeof(int16_t));
+    read_pos_.store(read_pos + frames, std::memory_order_release);
+    return frames;
+}
+
+uint32_t PcmRing::size() const {
+    const uint64_t read_pos = read_pos_.load(std::memory_order_acquire);
+    const uint64_t write_pos = write_pos_.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(write_pos - read_pos);
+}
+
+uint32_t PcmRing::capacity() const {
+    return capacity_;
+}
+
+} // namespace audio
+
+} // namespace lt
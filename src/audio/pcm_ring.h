@@ -0,0 +1,65 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace lt {
+
+namespace audio {
+
+// 单生产者单消费者的PCM环形缓冲, 两边都不加锁. 播放端生产者是播放线程, 消费者是声卡回调;
+// 采集端两边都是采集线程, 用来把任意长度的采集数据切成整包.
+// 长度以帧为单位, 一帧是channels个int16_t样本
+class PcmRing {
+public:
+    PcmRing(uint32_t capacity_frames, uint32_t channels);
+    // 只能由生产者调用, 空间不够时只写一部分, 返回写入的帧数
+    uint32_t write(const int16_t* data, uint32_t frames);
+    // 只能由消费者调用, 返回读出的帧数
+    uint32_t read(int16_t* out, uint32_t frames);
+    // 可读的帧数, 两边都可以调用
+    uint32_t size() const;
+    uint32_t capacity() const;
+
+private:
+    const uint32_t capacity_;
+    const uint32_t channels_;
+    std::vector<int16_t> buffer_;
+    // 只增不减, 取模得到下标
+    alignas(64) std::atomic<uint64_t> write_pos_{0};
+    alignas(64) std::atomic<uint64_t> read_pos_{0};
+};
+
+} // namespace audio
+
+} // namespace lt
@@ -0,0 +1,74 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <audio/pcm_ring.h>
+
+namespace {
+
+using lt::audio::PcmRing;
+
+TEST(PcmRingTest, WrapsAround) {
+    PcmRing ring{8, 2};
+    std::vector<int16_t> in(12);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = static_cast<int16_t>(i);
+    }
+    std::vector<int16_t> out(16);
+    for (int round = 0; round < 5; round++) {
+        ASSERT_EQ(ring.write(in.data(), 6), 6u);
+        EXPECT_EQ(ring.size(), 6u);
+        ASSERT_EQ(ring.read(out.data(), 8), 6u);
+        EXPECT_EQ(std::vector<int16_t>(out.begin(), out.begin() + 12), in);
+        EXPECT_EQ(ring.size(), 0u);
+    }
+}
+
+TEST(PcmRingTest, FullAndEmpty) {
+    PcmRing ring{4, 1};
+    const int16_t in[6] = {1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(ring.write(in, 6), 4u);
+    EXPECT_EQ(ring.write(in, 1), 0u);
+    int16_t out[6] = {};
+    EXPECT_EQ(ring.read(out, 2), 2u);
+    EXPECT_EQ(out[0], 1);
+    EXPECT_EQ(out[1], 2);
+    EXPECT_EQ(ring.write(in + 4, 2), 2u);
+    EXPECT_EQ(ring.read(out, 6), 4u);
+    EXPECT_EQ(out[0], 3);
+    EXPECT_EQ(out[3], 6);
+    EXPECT_EQ(ring.read(out, 1), 0u);
+}
+
+// 一个线程写一个线程读, 读出来的必须是连续递增的序列
+TEST(PcmRingTest, ProducerConsumer) {
+    constexpr int16_t kTotal = 30000;
+    PcmRing ring{256, 1};
+    std::thread producer{[&ring]() {
+        int16_t next = 0;
+        std::vector<int16_t> chunk(97);
+        while (next < kTotal) {
+            for (auto& sample : chunk) {
+                sample = next++;
+            }
+            uint32_t written = 0;
+            while (written < chunk.size()) {
+                written += ring.write(chunk.data() + written,
+                                      static_cast<uint32_t>(chunk.size()) - written);
+            }
+        }
+    }};
+    int16_t expected = 0;
+    std::vector<int16_t> out(61);
+    while (expected < kTotal) {
+        const uint32_t got = ring.read(out.data(), static_cast<uint32_t>(out.size()));
+        for (uint32_t i = 0; i < got; i++) {
+            ASSERT_EQ(out[i], expected++);
+        }
+    }
+    producer.join();
+}
+
+} // namespace
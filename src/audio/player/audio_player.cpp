@@ -31,11 +31,46 @@
 #include "audio_player.h"
 #include "sdl_audio_player.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <fstream>
 
 #include <ltlib/logging.h>
+#include <ltlib/times.h>
 #include <opus/opus.h>
 
+#include <audio/audio_packet.h>
+
+namespace {
+
+// 环形缓冲里至少留两个回调周期, 少了就从抖动缓冲取下一帧
+constexpr uint32_t kQueuedPeriods = 2;
+// Opus一个包最长120ms
+constexpr uint32_t kMaxPacket10ms = 12;
+// 正常只会用到两三个周期, 剩下的给拉伸和长包留余量
+constexpr uint32_t kRingCapacity10ms = 20;
+
+// 线性插值把一帧拉长或者压缩. 只在延迟偏离目标时做百分之几的伸缩, 听不出音高变化
+void resample(const int16_t* in, uint32_t in_frames, int16_t* out, uint32_t out_frames,
+              uint32_t channels) {
+    for (uint32_t i = 0; i < out_frames; i++) {
+        // 首尾对齐, 帧和帧之间不会跳变
+        const double pos =
+            out_frames == 1 ? 0.0 : static_cast<double>(i) * (in_frames - 1) / (out_frames - 1);
+        const uint32_t index = static_cast<uint32_t>(pos);
+        const uint32_t next = std::min(index + 1, in_frames - 1);
+        const double frac = pos - index;
+        for (uint32_t c = 0; c < channels; c++) {
+            const double a = in[index * channels + c];
+            const double b = in[next * channels + c];
+            out[i * channels + c] = static_cast<int16_t>(a + (b - a) * frac);
+        }
+    }
+}
+
+} // namespace
+
 namespace lt {
 
 namespace audio {
@@ -49,6 +84,7 @@ std::unique_ptr<Player> Player::create(const Params& params) {
 }
 
 Player::~Player() {
+    stopPlayout();
     if (opus_decoder_) {
         auto decoder = reinterpret_cast<OpusDecoder*>(opus_decoder_);
         opus_decoder_destroy(decoder);
@@ -59,8 +95,13 @@ Player::~Player() {
 Player::Player(const Params& params)
     : type_{params.type}
     , frames_per_sec_{params.frames_per_second}
-    , channels_{params.channels} {
-    buffer_.resize(framesPer10ms() * channels() * 2);
+    , channels_{params.channels}
+    , period_ms_{params.period_ms}
+    , av_sync_{params.av_sync}
+    , ring_{params.frames_per_second / 100 * kRingCapacity10ms, params.channels} {
+    buffer_.resize(framesPer10ms() * kMaxPacket10ms * channels() * sizeof(int16_t));
+    // 拉伸最多也就百分之几, 多留一个10ms足够
+    stretch_buffer_.resize(framesPer10ms() * (kMaxPacket10ms + 1) * channels() * sizeof(int16_t));
 }
 
 bool Player::init() {
@@ -70,6 +111,9 @@ bool Player::init() {
     if (!initPlatform()) {
         return false;
     }
+    playout_thread_ = ltlib::BlockingThread::create(
+        "lt_audio_playout",
+        [this](const std::function<void()>& i_am_alive) { playoutLoop(i_am_alive); });
     return true;
 }
 
@@ -88,39 +132,229 @@ bool Player::initDecoder() {
 }
 
 void Player::submit(const void* data, uint32_t size) {
+    const int64_t now_us = ltlib::steady_now_us();
+    auto bytes = reinterpret_cast<const uint8_t*>(data);
+    auto parsed = parseAudioPacket(bytes, size);
+    std::lock_guard lock{mutex_};
+    has_capture_time_ = parsed.has_value();
+    if (!parsed.has_value()) {
+        // 旧版本主机发来的裸数据, 按到达顺序编号, 只能把到达时间当成采集时间
+        JitterBuffer::Packet packet{};
+        packet.sequence = legacy_sequence_++;
+        packet.capture_time_us = now_us;
+        packet.data = bytes;
+        packet.size = size;
+        pushFrame(packet, now_us);
+        return;
+    }
+    // 一条消息里的帧采集时间首尾相接, DTX帧也占一个帧长
+    for (uint32_t i = 0; i < parsed->frames; i++) {
+        const int64_t duration_us =
+            frameDurationUs(parsed->frame[i].data, parsed->frame[i].size);
+        if (duration_us > 0) {
+            frame_duration_us_ = duration_us;
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < parsed->frames; i++) {
+        JitterBuffer::Packet packet{};
+        packet.sequence = parsed->sequence + i;
+        packet.capture_time_us = parsed->capture_time_us + i * frame_duration_us_;
+        packet.data = parsed->frame[i].data;
+        packet.size = parsed->frame[i].size;
+        pushFrame(packet, now_us);
+    }
+}
+
+int64_t Player::frameDurationUs(const uint8_t* data, uint32_t size) const {
+    if (data == nullptr || size == 0) {
+        return 0;
+    }
+    int32_t frames = 0;
     if (needDecode()) {
-        int32_t decoded_bytes = decode(data, size);
-        if (decoded_bytes > 0) {
-            play(buffer_.data(), decoded_bytes);
+        frames = opus_packet_get_nb_samples(data, static_cast<opus_int32>(size),
+                                            static_cast<opus_int32>(framesPerSec()));
+        if (frames <= 0) {
+            LOG(WARNING) << "Invalid opus packet, opus_packet_get_nb_samples returned " << frames;
+            return 0;
         }
     }
     else {
-        // static std::ofstream out{"./audio_dst", std::ios::binary | std::ios::trunc};
-        // out.write(reinterpret_cast<const char*>(data), size);
-        // out.flush();
-        play(data, size);
+        frames = static_cast<int32_t>(size / (channels() * sizeof(int16_t)));
+    }
+    return frames * int64_t{1'000'000} / framesPerSec();
+}
+
+void Player::pushFrame(JitterBuffer::Packet& packet, int64_t now_us) {
+    if (packet.size == 0) {
+        // DTX帧, 帧长沿用之前的
+        packet.duration_us = 0;
+        jitter_buffer_.push(packet, now_us);
+        return;
     }
+    packet.duration_us = frameDurationUs(packet.data, packet.size);
+    if (packet.duration_us <= 0) {
+        return;
+    }
+    jitter_buffer_.push(packet, now_us);
+}
+
+Player::Stat Player::getStat() {
+    Stat stat{};
+    stat.queued_frames = ring_.size();
+    stat.output_latency_us =
+        (stat.queued_frames + device_period_frames_.load()) * int64_t{1'000'000} / framesPerSec();
+    stat.played_frames = played_frames_.load();
+    stat.underruns = underruns_.load();
+    stat.underrun_frames = underrun_frames_.load();
+    std::lock_guard lock{mutex_};
+    stat.jitter_target_us = jitter_buffer_.targetDelayUs();
+    stat.jitter_delay_us = jitter_buffer_.playoutDelayUs();
+    stat.jitter = jitter_buffer_.stat();
+    return stat;
+}
+
+void Player::pull(uint8_t* out, uint32_t bytes) {
+    const uint32_t bytes_per_frame = channels() * sizeof(int16_t);
+    const uint32_t frames = bytes / bytes_per_frame;
+    const uint32_t got = ring_.read(reinterpret_cast<int16_t*>(out), frames);
+    played_frames_.fetch_add(got, std::memory_order_relaxed);
+    if (got == frames) {
+        return;
+    }
+    memset(out + got * bytes_per_frame, 0, bytes - got * bytes_per_frame);
+    // 主机没声音时不发数据, 这时候补静音不算欠载
+    if (playing_) {
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        underrun_frames_.fetch_add(frames - got, std::memory_order_relaxed);
+    }
+}
+
+void Player::setDevicePeriod(uint32_t frames) {
+    device_period_frames_ = frames;
+}
+
+void Player::stopPlayout() {
+    if (playout_thread_ == nullptr) {
+        return;
+    }
+    stoped_ = true;
+    playout_thread_.reset();
+    std::lock_guard lock{mutex_};
+    const auto& stat = jitter_buffer_.stat();
+    LOG(INFO) << "Audio playout stopped, normal:" << stat.normal << " silence:" << stat.silence
+              << " fec:" << stat.fec
+              << " plc:" << stat.plc << " underrun:" << stat.underrun << " late:" << stat.late
+              << " dropped:" << stat.dropped << " stretched:" << stat.stretched
+              << " shrunk:" << stat.shrunk << " target_delay:" << jitter_buffer_.targetDelayUs()
+              << "us, device underruns:" << underruns_ << " underrun_frames:" << underrun_frames_;
 }
 
 bool Player::needDecode() const {
     return type_ == AudioCodecType::OPUS;
 }
 
-int32_t Player::decode(const void* data, uint32_t input_size) {
-    // static std::ofstream out{"./audio_dst", std::ios::binary | std::ios::trunc};
-    // out.write(reinterpret_cast<const char*>(data), input_size);
-    // out.flush();
+void Player::playoutLoop(const std::function<void()>& i_am_alive) {
+    while (!stoped_) {
+        i_am_alive();
+        if (ring_.size() >= periodFrames() * kQueuedPeriods || !decodeOneFrame()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+    }
+}
+
+bool Player::decodeOneFrame() {
+    int32_t frames = 0;
+    int64_t stretch_us = 0;
+    int64_t capture_time_us = 0;
+    {
+        std::lock_guard lock{mutex_};
+        if (av_sync_ != nullptr) {
+            jitter_buffer_.setExtraDelayUs(av_sync_->audioExtraDelayUs());
+        }
+        JitterBuffer::Frame frame = jitter_buffer_.pop(ltlib::steady_now_us());
+        playing_ = frame.action != JitterBuffer::Action::Idle;
+        if (!playing_) {
+            return false;
+        }
+        // frame.data指向抖动缓冲内部, 要在锁里解码
+        frames = decode(frame);
+        stretch_us = frame.stretch_us;
+        capture_time_us = has_capture_time_ ? frame.capture_time_us : 0;
+    }
+    if (frames <= 0) {
+        return false;
+    }
+    const uint32_t stretched = stretch(static_cast<uint32_t>(frames), stretch_us);
+    const uint32_t to_write = stretched > 0 ? stretched : static_cast<uint32_t>(frames);
+    const auto& pcm = stretched > 0 ? stretch_buffer_ : buffer_;
+    // 这一帧要等环形缓冲里已有的数据和声卡正在播的一个周期播完才能听到
+    const uint32_t queued = ring_.size() + device_period_frames_.load();
+    const uint32_t written = ring_.write(reinterpret_cast<const int16_t*>(pcm.data()), to_write);
+    if (written < to_write) {
+        LOG(WARNING) << "Audio ring buffer full, dropped " << to_write - written << " frames";
+    }
+    if (av_sync_ != nullptr && capture_time_us != 0) {
+        av_sync_->onAudioPresented(capture_time_us,
+                                   ltlib::steady_now_us() +
+                                       queued * int64_t{1'000'000} / framesPerSec());
+    }
+    return true;
+}
+
+int32_t Player::decode(const JitterBuffer::Frame& frame) {
+    const uint32_t bytes_per_frame = channels() * sizeof(int16_t);
+    const int capacity = static_cast<int>(buffer_.size() / bytes_per_frame);
+    const int lost_frames = std::min(
+        capacity, static_cast<int>(frame.duration_us * framesPerSec() / 1'000'000));
+    if (!needDecode()) {
+        if (frame.action == JitterBuffer::Action::Normal) {
+            const uint32_t size = std::min<uint32_t>(frame.size, capacity * bytes_per_frame);
+            memcpy(buffer_.data(), frame.data, size);
+            return static_cast<int32_t>(size / bytes_per_frame);
+        }
+        // PCM没有办法恢复, 补静音. DTX帧本来就是静音
+        memset(buffer_.data(), 0, lost_frames * bytes_per_frame);
+        return lost_frames;
+    }
 
     auto decoder = reinterpret_cast<OpusDecoder*>(opus_decoder_);
-    auto input = reinterpret_cast<const unsigned char*>(data);
     auto output = reinterpret_cast<opus_int16*>(buffer_.data());
-    auto output_capacity = static_cast<int>(buffer_.size());
-    int frames = opus_decode(decoder, input, input_size, output, output_capacity, 0);
+    auto input = reinterpret_cast<const unsigned char*>(frame.data);
+    auto input_size = static_cast<opus_int32>(frame.size);
+    int frames = 0;
+    switch (frame.action) {
+    case JitterBuffer::Action::Normal:
+        frames = opus_decode(decoder, input, input_size, output, capacity, 0);
+        break;
+    case JitterBuffer::Action::Fec:
+        // 用下一个包里带的冗余数据恢复丢掉的这一帧, 长度必须和丢掉的帧一致
+        frames = opus_decode(decoder, input, input_size, output, lost_frames, 1);
+        break;
+    case JitterBuffer::Action::Silence:
+        // DTX期间按Opus的要求当成没收到包解码, 解码器会输出舒适噪声, 不会突然断掉
+    case JitterBuffer::Action::Plc:
+    default:
+        frames = opus_decode(decoder, nullptr, 0, output, lost_frames, 0);
+        break;
+    }
     if (frames < 0) {
         LOG(ERR) << "opus_decode failed with " << frames;
-        return frames;
     }
-    return frames * channels() * sizeof(opus_int16);
+    return frames;
+}
+
+uint32_t Player::stretch(uint32_t frames, int64_t stretch_us) {
+    const int64_t delta = stretch_us * framesPerSec() / 1'000'000;
+    const uint32_t capacity =
+        static_cast<uint32_t>(stretch_buffer_.size() / (channels() * sizeof(int16_t)));
+    if (delta == 0 || frames < 2 || frames + delta <= 0 || frames + delta > capacity) {
+        return 0;
+    }
+    const auto out_frames = static_cast<uint32_t>(frames + delta);
+    resample(reinterpret_cast<const int16_t*>(buffer_.data()), frames,
+             reinterpret_cast<int16_t*>(stretch_buffer_.data()), out_frames, channels());
+    return out_frames;
 }
 
 uint32_t Player::framesPerSec() const {
@@ -131,10 +365,14 @@ uint32_t Player::framesPer10ms() const {
     return framesPerSec() / 100;
 }
 
+uint32_t Player::periodFrames() const {
+    return framesPerSec() * period_ms_ / 1000;
+}
+
 uint32_t Player::channels() const {
     return channels_;
 }
 
 } // namespace audio
 
-} // namespace lt
\ No newline at end of file
+} // namespace lt
@@ -30,11 +30,18 @@
 
 #pragma once
 #include <cstdint>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <vector>
 
+#include <ltlib/av_sync.h>
+#include <ltlib/threads.h>
 #include <transport/transport.h>
 
+#include <audio/pcm_ring.h>
+#include <audio/player/jitter_buffer.h>
+
 namespace lt {
 
 namespace audio {
@@ -45,35 +52,85 @@ public:
         AudioCodecType type;
         uint32_t frames_per_second;
         uint32_t channels;
+        // 声卡每次回调取多少毫秒, 越小延迟越低, 越容易欠载
+        uint32_t period_ms = 10;
+        // 可选, 和视频共用, 汇报声音的播放进度, 按它的要求多缓冲一些
+        std::shared_ptr<ltlib::AVSync> av_sync;
+    };
+
+    struct Stat {
+        // 已经解码但是还没交给声卡的帧数
+        uint32_t queued_frames;
+        // 现在写进去的数据要多久才能播出来
+        int64_t output_latency_us;
+        uint64_t played_frames;
+        // 声卡回调时数据不够, 补了静音
+        uint64_t underruns;
+        uint64_t underrun_frames;
+        int64_t jitter_target_us;
+        int64_t jitter_delay_us;
+        JitterBuffer::Stat jitter;
     };
 
 public:
     static std::unique_ptr<Player> create(const Params& params);
     virtual ~Player();
+    // 网络线程调用, 只放进抖动缓冲, 由播放线程按声卡的节奏取出来解码
     void submit(const void* data, uint32_t size);
+    Stat getStat();
 
 protected:
     Player(const Params& params);
     virtual bool initPlatform() = 0;
-    virtual bool play(const void* data, uint32_t size) = 0;
+    // 声卡回调线程调用, 不能阻塞. 数据不够的部分补静音
+    void pull(uint8_t* out, uint32_t bytes);
+    // 子类析构时要先停掉播放线程, 再关闭设备
+    void stopPlayout();
+    // 设备实际的回调长度, 可能和periodFrames()不一样
+    void setDevicePeriod(uint32_t frames);
     uint32_t framesPerSec() const;
     uint32_t framesPer10ms() const;
+    uint32_t periodFrames() const;
     uint32_t channels() const;
 
 private:
     bool init();
     bool initDecoder();
     bool needDecode() const;
-    int32_t decode(const void* data, uint32_t size);
+    // 0表示不是合法的包
+    int64_t frameDurationUs(const uint8_t* data, uint32_t size) const;
+    void pushFrame(JitterBuffer::Packet& packet, int64_t now_us);
+    void playoutLoop(const std::function<void()>& i_am_alive);
+    bool decodeOneFrame();
+    int32_t decode(const JitterBuffer::Frame& frame);
+    uint32_t stretch(uint32_t frames, int64_t stretch_us);
 
 private:
     const AudioCodecType type_;
     void* opus_decoder_ = nullptr;
     uint32_t frames_per_sec_;
     uint32_t channels_;
+    const uint32_t period_ms_;
+    std::shared_ptr<ltlib::AVSync> av_sync_;
+    std::atomic<uint32_t> device_period_frames_{0};
     std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> stretch_buffer_;
+    std::mutex mutex_;
+    JitterBuffer jitter_buffer_;
+    uint32_t legacy_sequence_ = 0;
+    // 最近一个有数据的帧的时长, 整条消息都是DTX帧时用它推算采集时间
+    int64_t frame_duration_us_ = 10'000;
+    // 旧版本主机的包没有采集时间, 不能参与音视频同步
+    bool has_capture_time_ = false;
+    PcmRing ring_;
+    std::atomic<bool> playing_{false};
+    std::atomic<uint64_t> played_frames_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> underrun_frames_{0};
+    std::atomic<bool> stoped_{false};
+    std::unique_ptr<ltlib::BlockingThread> playout_thread_;
 };
 
 } // namespace audio
 
-} // namespace lt
\ No newline at end of file
+} // namespace lt
@@ -0,0 +1,270 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "jitter_buffer.h"
+
+#include <algorithm>
+
+namespace {
+
+int32_t sequenceDiff(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b);
+}
+
+} // namespace
+
+namespace lt {
+
+namespace audio {
+
+JitterBuffer::JitterBuffer()
+    : JitterBuffer{Params{}} {}
+
+JitterBuffer::JitterBuffer(const Params& params)
+    : params_{params}
+    , target_delay_us_{params.min_delay_us} {
+    transits_.reserve(params_.history_size);
+    sorted_transits_.reserve(params_.history_size);
+}
+
+void JitterBuffer::push(const Packet& packet, int64_t now_us) {
+    if (packet.duration_us > 0) {
+        frame_duration_us_ = packet.duration_us;
+    }
+    // 迟到的包也要算进抖动里
+    updateTargetDelay(now_us - packet.capture_time_us);
+    const int32_t capacity = static_cast<int32_t>(kCapacity);
+    if (has_packets_) {
+        const int32_t behind_newest = sequenceDiff(newest_sequence_, packet.sequence);
+        if (behind_newest >= capacity || behind_newest <= -capacity) {
+            // 序号不连续, 一般是主机那边重新开始采集了
+            reset();
+        }
+    }
+    if (!has_packets_) {
+        has_packets_ = true;
+        next_sequence_ = packet.sequence;
+        newest_sequence_ = packet.sequence;
+    }
+    else if (sequenceDiff(packet.sequence, next_sequence_) < 0) {
+        if (started_) {
+            stat_.late++;
+            return;
+        }
+        // 还没开始播放, 乱序先到的包不算迟到
+        next_sequence_ = packet.sequence;
+    }
+    while (sequenceDiff(packet.sequence, next_sequence_) >= capacity) {
+        Slot& oldest = slotOf(next_sequence_);
+        if (oldest.valid && oldest.sequence == next_sequence_) {
+            oldest.valid = false;
+            stat_.dropped++;
+        }
+        next_sequence_++;
+    }
+    Slot& slot = slotOf(packet.sequence);
+    if (slot.valid && slot.sequence == packet.sequence) {
+        stat_.duplicated++;
+        return;
+    }
+    slot.valid = true;
+    slot.sequence = packet.sequence;
+    slot.capture_time_us = packet.capture_time_us;
+    slot.data.assign(packet.data, packet.data + packet.size);
+    if (sequenceDiff(packet.sequence, newest_sequence_) > 0) {
+        newest_sequence_ = packet.sequence;
+    }
+}
+
+JitterBuffer::Frame JitterBuffer::pop(int64_t now_us) {
+    Frame frame{};
+    frame.action = Action::Idle;
+    frame.sequence = next_sequence_;
+    frame.duration_us = frame_duration_us_;
+    if (!has_packets_) {
+        return frame;
+    }
+    if (!started_) {
+        while (!slotOf(next_sequence_).valid && next_sequence_ != newest_sequence_) {
+            next_sequence_++;
+        }
+        const Slot& first = slotOf(next_sequence_);
+        if (!first.valid || delayOf(first, now_us) < playoutTargetUs()) {
+            return frame;
+        }
+        started_ = true;
+        filtered_delay_us_ = delayOf(first, now_us);
+    }
+
+    if (Slot& slot = slotOf(next_sequence_); slot.valid && slot.sequence == next_sequence_) {
+        if (delayOf(slot, now_us) > playoutTargetUs() + params_.drop_threshold_us) {
+            // 卡顿之后一下子来了很多包, 慢慢压缩要很久, 直接丢
+            dropTo(now_us);
+        }
+        Slot& current = slotOf(next_sequence_);
+        playout_delay_us_ = delayOf(current, now_us);
+        filtered_delay_us_ += (playout_delay_us_ - filtered_delay_us_) / 8;
+        frame.action = current.data.empty() ? Action::Silence : Action::Normal;
+        frame.sequence = next_sequence_;
+        frame.capture_time_us = current.capture_time_us;
+        frame.data = current.data.data();
+        frame.size = static_cast<uint32_t>(current.data.size());
+        current.valid = false;
+        next_sequence_++;
+        underrun_us_ = 0;
+        if (frame.action == Action::Silence) {
+            stat_.silence++;
+        }
+        else {
+            stat_.normal++;
+        }
+        const int64_t step_us = frame_duration_us_ * params_.stretch_percent / 100;
+        if (filtered_delay_us_ > playoutTargetUs() + frame_duration_us_) {
+            frame.stretch_us = -step_us;
+            stat_.shrunk++;
+        }
+        else if (filtered_delay_us_ < playoutTargetUs()) {
+            frame.stretch_us = step_us;
+            stat_.stretched++;
+        }
+        return frame;
+    }
+
+    if (sequenceDiff(newest_sequence_, next_sequence_) > 0) {
+        // 后面还有包, 说明这一帧丢了或者迟到太久
+        const Slot& following = slotOf(next_sequence_ + 1);
+        // DTX帧里没有FEC
+        if (following.valid && following.sequence == next_sequence_ + 1 &&
+            !following.data.empty()) {
+            frame.action = Action::Fec;
+            frame.capture_time_us = following.capture_time_us - frame_duration_us_;
+            frame.data = following.data.data();
+            frame.size = static_cast<uint32_t>(following.data.size());
+            stat_.fec++;
+        }
+        else {
+            frame.action = Action::Plc;
+            stat_.plc++;
+        }
+        next_sequence_++;
+        underrun_us_ = 0;
+        return frame;
+    }
+
+    // 缓冲区空了. 不跳过这一帧, 等它到了接着播, 多出来的延迟靠压缩消化
+    underrun_us_ += frame_duration_us_;
+    if (underrun_us_ > params_.max_delay_us) {
+        // 太久没有数据, 可能主机停止发送了, 重新缓冲
+        reset();
+        return frame;
+    }
+    frame.action = Action::Plc;
+    stat_.underrun++;
+    stat_.plc++;
+    return frame;
+}
+
+int64_t JitterBuffer::targetDelayUs() const {
+    return target_delay_us_;
+}
+
+void JitterBuffer::setExtraDelayUs(int64_t extra_us) {
+    extra_delay_us_ = std::max<int64_t>(extra_us, 0);
+}
+
+int64_t JitterBuffer::playoutDelayUs() const {
+    return playout_delay_us_;
+}
+
+const JitterBuffer::Stat& JitterBuffer::stat() const {
+    return stat_;
+}
+
+JitterBuffer::Slot& JitterBuffer::slotOf(uint32_t sequence) {
+    return slots_[sequence % kCapacity];
+}
+
+void JitterBuffer::updateTargetDelay(int64_t transit_us) {
+    if (params_.history_size == 0) {
+        return;
+    }
+    if (transits_.size() < params_.history_size) {
+        transits_.push_back(transit_us);
+    }
+    else {
+        transits_[transit_index_] = transit_us;
+        transit_index_ = (transit_index_ + 1) % transits_.size();
+    }
+    // 两端时钟不同步, 传输时间只有相对值有意义
+    min_transit_us_ = *std::min_element(transits_.begin(), transits_.end());
+    sorted_transits_.assign(transits_.begin(), transits_.end());
+    const size_t index = (sorted_transits_.size() - 1) * params_.jitter_percentile / 100;
+    std::nth_element(sorted_transits_.begin(), sorted_transits_.begin() + index,
+                     sorted_transits_.end());
+    const int64_t jitter_us = sorted_transits_[index] - min_transit_us_;
+    target_delay_us_ =
+        std::clamp(jitter_us + frame_duration_us_, params_.min_delay_us, params_.max_delay_us);
+}
+
+int64_t JitterBuffer::delayOf(const Slot& slot, int64_t now_us) const {
+    return now_us - slot.capture_time_us - min_transit_us_;
+}
+
+int64_t JitterBuffer::playoutTargetUs() const {
+    return target_delay_us_ + extra_delay_us_;
+}
+
+void JitterBuffer::dropTo(int64_t now_us) {
+    // 只在后一帧已经到了的时候丢, 不会丢出空洞
+    while (true) {
+        Slot& current = slotOf(next_sequence_);
+        const Slot& following = slotOf(next_sequence_ + 1);
+        if (!following.valid || following.sequence != next_sequence_ + 1 ||
+            delayOf(current, now_us) <= playoutTargetUs() + frame_duration_us_) {
+            break;
+        }
+        current.valid = false;
+        next_sequence_++;
+        stat_.dropped++;
+    }
+}
+
+void JitterBuffer::reset() {
+    for (auto& slot : slots_) {
+        slot.valid = false;
+    }
+    has_packets_ = false;
+    started_ = false;
+    underrun_us_ = 0;
+}
+
+} // namespace audio
+
+} // namespace lt
@@ -0,0 +1,162 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lt {
+
+namespace audio {
+
+// 客户端音频抖动缓冲. 按序号排序, 按采集时间估计网络抖动, 自适应调整目标延迟.
+// 不读时钟, 所有时间都由调用者传进来, 方便用合成的到达序列做确定性测试.
+// 不是线程安全的.
+class JitterBuffer {
+public:
+    struct Params {
+        int64_t min_delay_us = 20'000;
+        int64_t max_delay_us = 240'000;
+        // 目标延迟覆盖多少百分比的包的传输时间抖动
+        uint32_t jitter_percentile = 95;
+        // 统计最近多少个包的传输时间
+        uint32_t history_size = 200;
+        // 延迟偏离目标时每帧拉伸或压缩的比例
+        uint32_t stretch_percent = 2;
+        // 超过目标这么多就直接丢帧
+        int64_t drop_threshold_us = 80'000;
+    };
+
+    struct Packet {
+        uint32_t sequence;
+        int64_t capture_time_us;
+        // 0表示沿用之前的帧长
+        int64_t duration_us;
+        // size为0表示DTX, 主机那边是静音
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+    enum class Action {
+        // 还没开始播放, 什么都不用做
+        Idle,
+        Normal,
+        // 主机静音(DTX)没有发数据, 不算丢包
+        Silence,
+        // 这一帧丢了, 用下一帧里的FEC恢复
+        Fec,
+        // 这一帧丢了或者还没到, 由解码器做丢包隐藏
+        Plc,
+    };
+
+    struct Frame {
+        Action action;
+        uint32_t sequence;
+        int64_t duration_us;
+        // 主机时钟, Normal, Silence和Fec才有, 其它为0
+        int64_t capture_time_us;
+        // Normal是这一帧的数据, Fec是下一帧的数据. 下一次push/pop之前有效
+        const uint8_t* data;
+        uint32_t size;
+        // 正数表示这一帧要拉长多少微秒, 负数表示缩短
+        int64_t stretch_us;
+    };
+
+    struct Stat {
+        uint64_t normal = 0;
+        uint64_t silence = 0;
+        uint64_t fec = 0;
+        uint64_t plc = 0;
+        // 缓冲区空了, 只能隐藏并且等下一帧
+        uint64_t underrun = 0;
+        // 到达时已经播过了
+        uint64_t late = 0;
+        uint64_t duplicated = 0;
+        // 为了降低延迟丢掉的帧
+        uint64_t dropped = 0;
+        uint64_t stretched = 0;
+        uint64_t shrunk = 0;
+    };
+
+    // 最多缓存这么多帧
+    static constexpr uint32_t kCapacity = 64;
+
+public:
+    JitterBuffer();
+    JitterBuffer(const Params& params);
+    void push(const Packet& packet, int64_t now_us);
+    // 每播放完一帧调用一次
+    Frame pop(int64_t now_us);
+    int64_t targetDelayUs() const;
+    // 在抗抖动需要的目标延迟之外再多缓冲这么多, 用于音视频同步
+    void setExtraDelayUs(int64_t extra_us);
+    // 最近播放的帧从采集到播放的时间, 扣除了两端的时钟差和最小的网络延迟
+    int64_t playoutDelayUs() const;
+    const Stat& stat() const;
+
+private:
+    struct Slot {
+        bool valid = false;
+        uint32_t sequence = 0;
+        int64_t capture_time_us = 0;
+        std::vector<uint8_t> data;
+    };
+    Slot& slotOf(uint32_t sequence);
+    void updateTargetDelay(int64_t transit_us);
+    int64_t delayOf(const Slot& slot, int64_t now_us) const;
+    int64_t playoutTargetUs() const;
+    void dropTo(int64_t now_us);
+    void reset();
+
+private:
+    const Params params_;
+    std::array<Slot, kCapacity> slots_;
+    bool has_packets_ = false;
+    bool started_ = false;
+    uint32_t next_sequence_ = 0;
+    uint32_t newest_sequence_ = 0;
+    int64_t frame_duration_us_ = 10'000;
+    std::vector<int64_t> transits_;
+    std::vector<int64_t> sorted_transits_;
+    size_t transit_index_ = 0;
+    int64_t min_transit_us_ = 0;
+    int64_t target_delay_us_;
+    int64_t extra_delay_us_ = 0;
+    int64_t filtered_delay_us_ = 0;
+    int64_t playout_delay_us_ = 0;
+    int64_t underrun_us_ = 0;
+    Stat stat_;
+};
+
+} // namespace audio
+
+} // namespace lt
@@ -0,0 +1,278 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <audio/player/jitter_buffer.h>
+
+namespace {
+
+using lt::audio::JitterBuffer;
+
+constexpr int64_t kFrameUs = 10'000;
+// 主机和客户端的时钟差, 抖动缓冲不应该依赖它
+constexpr int64_t kHostClockOffsetUs = 123'456'789;
+
+struct Network {
+    int64_t base_delay_us = 30'000;
+    // 每个包额外的延迟在[0, jitter_us]里均匀分布
+    int64_t jitter_us = 0;
+    uint32_t loss_percent = 0;
+    // 这段时间里发出的包都卡到stall_end_us才到
+    int64_t stall_begin_us = -1;
+    int64_t stall_end_us = -1;
+    // 从这个时间开始主机序号从0重新开始
+    int64_t restart_us = -1;
+    // 这段时间里主机是静音, 只发长度为0的DTX帧
+    int64_t dtx_begin_us = -1;
+    int64_t dtx_end_us = -1;
+    int64_t duration_us = 10'000'000;
+    uint32_t seed = 1;
+    // 音视频同步要求多缓冲的延迟
+    int64_t extra_delay_us = 0;
+};
+
+struct Arrival {
+    int64_t arrive_us;
+    uint32_t sequence;
+    int64_t capture_us;
+    bool dtx;
+};
+
+struct Result {
+    JitterBuffer::Stat stat;
+    uint64_t lost = 0;
+    uint64_t out_of_order = 0;
+    // 以下只统计measure_from_us之后, 排除刚开始抖动还没估计准的阶段
+    uint64_t played = 0;
+    double concealment_rate = 0;
+    // 真实的采集到播放延迟
+    double avg_latency_ms = 0;
+    double max_latency_ms = 0;
+};
+
+// 主机每10ms采集一帧, 经过网络到达客户端. 客户端声卡每播完一帧取下一帧, 拉伸和压缩会改变取帧的间隔
+Result run(const Network& net, int64_t measure_from_us) {
+    std::mt19937 rng{net.seed};
+    std::uniform_int_distribution<int64_t> jitter{0, net.jitter_us};
+    std::uniform_int_distribution<uint32_t> percent{0, 99};
+    Result result;
+    std::vector<Arrival> arrivals;
+    uint32_t sequence = 0;
+    for (int64_t capture_us = 0; capture_us < net.duration_us; capture_us += kFrameUs) {
+        if (net.restart_us >= 0 && capture_us == net.restart_us) {
+            sequence = 0;
+        }
+        const uint32_t this_sequence = sequence++;
+        if (percent(rng) < net.loss_percent) {
+            result.lost++;
+            continue;
+        }
+        int64_t arrive_us = capture_us + net.base_delay_us + jitter(rng);
+        if (capture_us >= net.stall_begin_us && capture_us < net.stall_end_us) {
+            arrive_us = std::max(arrive_us, net.stall_end_us);
+        }
+        const bool dtx = capture_us >= net.dtx_begin_us && capture_us < net.dtx_end_us;
+        arrivals.push_back({arrive_us, this_sequence, capture_us, dtx});
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(),
+                     [](const Arrival& a, const Arrival& b) { return a.arrive_us < b.arrive_us; });
+    for (size_t i = 1; i < arrivals.size(); i++) {
+        if (arrivals[i].capture_us < arrivals[i - 1].capture_us) {
+            result.out_of_order++;
+        }
+    }
+
+    JitterBuffer buffer;
+    buffer.setExtraDelayUs(net.extra_delay_us);
+    std::vector<int64_t> captures(arrivals.size());
+    size_t next_arrival = 0;
+    double latency_sum_ms = 0;
+    uint64_t latency_count = 0;
+    bool started = false;
+    uint64_t concealed_before = 0;
+    int64_t now_us = 0;
+    while (now_us < net.duration_us + net.base_delay_us) {
+        for (; next_arrival < arrivals.size() && arrivals[next_arrival].arrive_us <= now_us;
+             next_arrival++) {
+            const Arrival& arrival = arrivals[next_arrival];
+            // 负载里放序号的低8位, 用来检查播放顺序
+            const uint8_t payload = static_cast<uint8_t>(arrival.sequence);
+            JitterBuffer::Packet packet{};
+            packet.sequence = arrival.sequence;
+            packet.capture_time_us = arrival.capture_us + kHostClockOffsetUs;
+            packet.duration_us = kFrameUs;
+            packet.data = &payload;
+            packet.size = arrival.dtx ? 0 : 1;
+            buffer.push(packet, arrival.arrive_us);
+        }
+        JitterBuffer::Frame frame = buffer.pop(now_us);
+        if (frame.action == JitterBuffer::Action::Idle) {
+            // 没开始播放的时候声卡不取数据, 1ms后再看
+            now_us += 1'000;
+            continue;
+        }
+        started = true;
+        const auto& stat = buffer.stat();
+        if (now_us < measure_from_us) {
+            concealed_before = stat.fec + stat.plc;
+        }
+        else {
+            result.played++;
+        }
+        if (frame.action == JitterBuffer::Action::Normal) {
+            EXPECT_EQ(frame.size, 1u);
+            EXPECT_EQ(frame.data[0], static_cast<uint8_t>(frame.sequence));
+            if (net.restart_us < 0) {
+                EXPECT_EQ(frame.capture_time_us, frame.sequence * kFrameUs + kHostClockOffsetUs);
+            }
+        }
+        if (frame.action == JitterBuffer::Action::Fec) {
+            EXPECT_EQ(frame.data[0], static_cast<uint8_t>(frame.sequence + 1));
+        }
+        if (frame.action == JitterBuffer::Action::Normal && now_us >= measure_from_us) {
+            // 重启之后的序号从restart_us开始算, 统计窗口要避开重启附近
+            const int64_t capture_us = frame.sequence * kFrameUs +
+                                       (net.restart_us >= 0 && now_us > net.restart_us + 500'000
+                                            ? net.restart_us
+                                            : 0);
+            const double latency_ms = (now_us - capture_us) / 1000.0;
+            latency_sum_ms += latency_ms;
+            latency_count++;
+            result.max_latency_ms = std::max(result.max_latency_ms, latency_ms);
+        }
+        now_us += frame.duration_us + frame.stretch_us;
+    }
+    EXPECT_TRUE(started);
+    result.stat = buffer.stat();
+    const uint64_t concealed = result.stat.fec + result.stat.plc - concealed_before;
+    result.concealment_rate =
+        result.played == 0 ? 0 : static_cast<double>(concealed) / result.played;
+    result.avg_latency_ms = latency_count == 0 ? 0 : latency_sum_ms / latency_count;
+    return result;
+}
+
+void print(const char* name, const Result& result) {
+    std::printf("%-8s lost %3llu, out of order %3llu, played %4llu: normal %4llu silence %3llu "
+                "fec %3llu plc %3llu underrun %3llu late %3llu dropped %3llu, concealment %.2f%%, "
+                "latency avg %.1fms max %.1fms\n",
+                name, static_cast<unsigned long long>(result.lost),
+                static_cast<unsigned long long>(result.out_of_order),
+                static_cast<unsigned long long>(result.played),
+                static_cast<unsigned long long>(result.stat.normal),
+                static_cast<unsigned long long>(result.stat.silence),
+                static_cast<unsigned long long>(result.stat.fec),
+                static_cast<unsigned long long>(result.stat.plc),
+                static_cast<unsigned long long>(result.stat.underrun),
+                static_cast<unsigned long long>(result.stat.late),
+                static_cast<unsigned long long>(result.stat.dropped),
+                result.concealment_rate * 100, result.avg_latency_ms, result.max_latency_ms);
+}
+
+TEST(JitterBufferTest, CleanNetwork) {
+    Network net{};
+    auto result = run(net, 5'000'000);
+    print("clean", result);
+    EXPECT_EQ(result.stat.fec + result.stat.plc, 0u);
+    EXPECT_EQ(result.stat.late, 0u);
+    // 网络延迟30ms, 只多缓冲最小目标延迟
+    EXPECT_LE(result.avg_latency_ms, 30 + 20 + 10);
+}
+
+TEST(JitterBufferTest, AbsorbsJitter) {
+    Network net{};
+    net.jitter_us = 60'000;
+    auto result = run(net, 5'000'000);
+    print("jitter", result);
+    EXPECT_GT(result.out_of_order, 0u);
+    EXPECT_LT(result.concealment_rate, 0.02);
+    // 延迟跟着抖动走, 但是不会顶到上限
+    EXPECT_GE(result.avg_latency_ms, 30 + 40);
+    EXPECT_LE(result.avg_latency_ms, 30 + 60 + 30);
+}
+
+TEST(JitterBufferTest, RecoversLossWithFec) {
+    Network net{};
+    net.loss_percent = 5;
+    auto result = run(net, 5'000'000);
+    print("loss", result);
+    // 没有抖动, 丢掉的每一帧都要隐藏, 单个丢包由下一帧的FEC恢复
+    EXPECT_EQ(result.stat.fec + result.stat.plc, result.lost);
+    EXPECT_GT(result.stat.fec, result.stat.plc);
+    EXPECT_EQ(result.stat.late, 0u);
+    EXPECT_LE(result.avg_latency_ms, 30 + 20 + 10);
+}
+
+TEST(JitterBufferTest, LossAndJitter) {
+    Network net{};
+    net.jitter_us = 40'000;
+    net.loss_percent = 3;
+    auto result = run(net, 5'000'000);
+    print("mixed", result);
+    EXPECT_LT(result.concealment_rate, 0.03 + 0.02);
+    EXPECT_LE(result.avg_latency_ms, 30 + 40 + 30);
+}
+
+TEST(JitterBufferTest, DrainsDelayAfterStall) {
+    Network net{};
+    net.jitter_us = 5'000;
+    net.stall_begin_us = 3'000'000;
+    net.stall_end_us = 3'300'000;
+    auto before = run(Network{net.base_delay_us, net.jitter_us}, 1'000'000);
+    auto after = run(net, 8'000'000);
+    print("before", before);
+    print("stall", after);
+    EXPECT_GT(after.stat.underrun, 0u);
+    // 卡顿积攒的延迟几秒内消化掉
+    EXPECT_LE(after.avg_latency_ms, before.avg_latency_ms + 15);
+    EXPECT_LE(after.max_latency_ms, before.max_latency_ms + 30);
+}
+
+TEST(JitterBufferTest, HoldsExtraDelayForAVSync) {
+    Network net{};
+    net.jitter_us = 5'000;
+    auto base = run(net, 5'000'000);
+    net.extra_delay_us = 50'000;
+    auto delayed = run(net, 5'000'000);
+    print("base", base);
+    print("extra", delayed);
+    // 多出来的延迟是刻意留的, 不会被当成积压压缩掉
+    EXPECT_EQ(delayed.stat.dropped, 0u);
+    EXPECT_EQ(delayed.stat.fec + delayed.stat.plc, 0u);
+    EXPECT_GE(delayed.avg_latency_ms, base.avg_latency_ms + 40);
+    EXPECT_LE(delayed.avg_latency_ms, base.avg_latency_ms + 60);
+}
+
+TEST(JitterBufferTest, SilenceToSpeech) {
+    Network net{};
+    net.jitter_us = 5'000;
+    auto base = run(net, 1'000'000);
+    // 句子之间停顿150ms, 主机开着DTX
+    net.dtx_begin_us = 3'000'000;
+    net.dtx_end_us = 3'150'000;
+    auto result = run(net, 1'000'000);
+    print("base", base);
+    print("dtx", result);
+    // 静音帧按时播放, 不当成丢包, 后面的第一句话也不会因为追延迟被丢掉
+    EXPECT_EQ(result.stat.silence, 15u);
+    EXPECT_EQ(result.stat.fec + result.stat.plc, 0u);
+    EXPECT_EQ(result.stat.underrun, 0u);
+    EXPECT_EQ(result.stat.dropped, 0u);
+    EXPECT_LE(result.max_latency_ms, base.max_latency_ms + 5);
+}
+
+TEST(JitterBufferTest, FollowsSequenceRestart) {
+    Network net{};
+    net.restart_us = 4'000'000;
+    auto result = run(net, 5'000'000);
+    print("restart", result);
+    // 重新缓冲之后正常播放, 不会把新序号当成迟到的包全部丢掉
+    EXPECT_EQ(result.stat.late, 0u);
+    EXPECT_GT(result.stat.normal, static_cast<uint64_t>(net.duration_us / kFrameUs) * 9 / 10);
+    EXPECT_LE(result.avg_latency_ms, 30 + 20 + 10);
+}
+
+} // namespace
@@ -44,6 +44,7 @@ SdlAudioPlayer::SdlAudioPlayer(const Params& params)
     : Player{params} {}
 
 SdlAudioPlayer::~SdlAudioPlayer() {
+    stopPlayout();
     if (device_id_ != std::numeric_limits<uint32_t>::max()) {
         SDL_PauseAudioDevice(device_id_, 1);
         SDL_CloseAudioDevice(device_id_);
@@ -57,26 +58,26 @@ bool SdlAudioPlayer::initPlatform() {
     desired.freq = framesPerSec();
     desired.format = AUDIO_S16;
     desired.channels = static_cast<Uint8>(channels());
-    desired.samples = 4096;
+    desired.samples = static_cast<Uint16>(periodFrames());
+    desired.callback = &SdlAudioPlayer::onAudioCallback;
+    desired.userdata = this;
 
     SDL_AudioDeviceID device_id = SDL_OpenAudioDevice(nullptr, SDL_FALSE, &desired, &obtained, 0);
     if (device_id == 0) {
         LOG(ERR) << "SDL_OpenAudioDevice failed:" << SDL_GetError();
         return false;
     }
+    LOGF(INFO, "SDL audio device opened, freq:%d, channels:%u, period:%u frames", obtained.freq,
+         obtained.channels, obtained.samples);
+    setDevicePeriod(obtained.samples);
     SDL_PauseAudioDevice(device_id, 0);
     device_id_ = device_id;
     return true;
 }
 
-bool SdlAudioPlayer::play(const void* data, uint32_t size) {
-    int ret = SDL_QueueAudio(device_id_, data, size);
-    if (ret != 0) {
-        // 这个错误太多了，注释掉
-        // LOG(WARNING) << "SDL_QueueAudio faield:" << SDL_GetError();
-        return false;
-    }
-    return true;
+void SdlAudioPlayer::onAudioCallback(void* userdata, uint8_t* stream, int len) {
+    auto that = reinterpret_cast<SdlAudioPlayer*>(userdata);
+    that->pull(stream, static_cast<uint32_t>(len));
 }
 
 } // namespace audio
@@ -41,7 +41,9 @@ public:
     SdlAudioPlayer(const Params& params);
     ~SdlAudioPlayer() override;
     bool initPlatform() override;
-    bool play(const void* data, uint32_t size) override;
+
+private:
+    static void onAudioCallback(void* userdata, uint8_t* stream, int len);
 
 private:
     uint32_t device_id_ = std::numeric_limits<uint32_t>::max();
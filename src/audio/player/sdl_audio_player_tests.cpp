@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <SDL.h>
+
+#include <ltlib/threads.h>
+#include <ltlib/times.h>
+
+#include <audio/audio_packet.h>
+#include <audio/player/audio_player.h>
+
+namespace {
+
+using lt::audio::Player;
+
+constexpr uint32_t kFrequency = 48000;
+constexpr uint32_t kChannels = 2;
+constexpr uint32_t kFramesPer10ms = kFrequency / 100;
+constexpr uint32_t kPackets = 300;
+// 前面这段时间抖动缓冲还在起步, 不统计欠载
+constexpr uint32_t kWarmupPackets = 50;
+
+// 没有声卡的机器上用SDL的dummy驱动, 它按真实的节奏调用回调, 只是不出声
+class SdlAudioEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override {
+        ltlib::ThreadWatcher::init(std::this_thread::get_id());
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+        sdl_ok = SDL_InitSubSystem(SDL_INIT_AUDIO) == 0;
+    }
+    void TearDown() override {
+        if (sdl_ok) {
+            SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        }
+        ltlib::ThreadWatcher::uninit();
+    }
+    static inline bool sdl_ok = false;
+};
+
+const auto* const kSdlAudioEnv = ::testing::AddGlobalTestEnvironment(new SdlAudioEnvironment);
+
+std::vector<uint8_t> makePacket(uint32_t sequence, int64_t capture_time_us) {
+    std::vector<uint8_t> packet(lt::audio::kAudioPacketHeaderSize +
+                                kFramesPer10ms * kChannels * sizeof(int16_t));
+    lt::audio::writeAudioPacketHeader(packet.data(), sequence, capture_time_us);
+    auto samples = reinterpret_cast<int16_t*>(packet.data() + lt::audio::kAudioPacketHeaderSize);
+    for (uint32_t i = 0; i < kFramesPer10ms; i++) {
+        const double t = static_cast<double>(sequence * kFramesPer10ms + i) / kFrequency;
+        const auto value = static_cast<int16_t>(8000 * std::sin(2 * 3.14159265 * 440 * t));
+        for (uint32_t c = 0; c < kChannels; c++) {
+            samples[i * kChannels + c] = value;
+        }
+    }
+    return packet;
+}
+
+class SdlAudioPlayerTest : public ::testing::TestWithParam<uint32_t> {};
+
+// 按10ms一个包的节奏送PCM, 记录每个包被声卡回调取走的时间, 算出从收到到输出的延迟
+TEST_P(SdlAudioPlayerTest, OutputLatency) {
+    if (!SdlAudioEnvironment::sdl_ok) {
+        GTEST_SKIP() << "SDL audio is not available";
+    }
+    const uint32_t period_ms = GetParam();
+    Player::Params params{};
+    params.type = lt::AudioCodecType::PCM;
+    params.frames_per_second = kFrequency;
+    params.channels = kChannels;
+    params.period_ms = period_ms;
+    auto player = Player::create(params);
+    ASSERT_NE(player, nullptr);
+
+    std::vector<int64_t> submit_us(kPackets);
+    std::vector<int64_t> latencies_us;
+    uint64_t underruns_after_warmup = 0;
+    uint32_t max_queued_frames = 0;
+    uint32_t consumed = 0;
+    const int64_t start_us = ltlib::steady_now_us();
+    for (uint32_t sequence = 0; sequence < kPackets || consumed < kPackets;) {
+        const int64_t now_us = ltlib::steady_now_us();
+        if (sequence < kPackets && now_us >= start_us + sequence * 10'000) {
+            auto packet = makePacket(sequence, now_us);
+            submit_us[sequence] = now_us;
+            player->submit(packet.data(), static_cast<uint32_t>(packet.size()));
+            sequence++;
+        }
+        auto stat = player->getStat();
+        max_queued_frames = std::max(max_queued_frames, stat.queued_frames);
+        // 拉伸会让帧数和包对不齐, 但只有百分之几, 对延迟的影响可以忽略
+        while (consumed < sequence && stat.played_frames >= (consumed + 1) * kFramesPer10ms) {
+            latencies_us.push_back(now_us - submit_us[consumed]);
+            consumed++;
+        }
+        if (consumed == kWarmupPackets) {
+            underruns_after_warmup = stat.underruns;
+        }
+        if (now_us > start_us + (kPackets + 100) * 10'000) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds{500});
+    }
+    auto stat = player->getStat();
+    underruns_after_warmup = stat.underruns - underruns_after_warmup;
+    ASSERT_GT(latencies_us.size(), kWarmupPackets);
+    std::vector<int64_t> steady{latencies_us.begin() + kWarmupPackets, latencies_us.end()};
+    std::sort(steady.begin(), steady.end());
+    double sum_ms = 0;
+    for (int64_t us : steady) {
+        sum_ms += us / 1000.0;
+    }
+    std::printf("period %ums: output latency avg %.1fms p50 %.1fms p99 %.1fms, estimated %.1fms, "
+                "max queued %u frames, underruns %llu (%llu after warmup)\n",
+                period_ms, sum_ms / steady.size(), steady[steady.size() / 2] / 1000.0,
+                steady[steady.size() * 99 / 100] / 1000.0, stat.output_latency_us / 1000.0,
+                max_queued_frames, static_cast<unsigned long long>(stat.underruns),
+                static_cast<unsigned long long>(underruns_after_warmup));
+    // 环形缓冲只保留几个周期
+    EXPECT_LE(max_queued_frames, kFramesPer10ms * 2 + kFrequency * period_ms * 2 / 1000);
+    EXPECT_LT(sum_ms / steady.size(), 100.0);
+    // 机器负载会影响调度, 只要求欠载很少
+    EXPECT_LE(underruns_after_warmup, (kPackets - kWarmupPackets) / 20);
+}
+
+INSTANTIATE_TEST_SUITE_P(Periods, SdlAudioPlayerTest, ::testing::Values(5u, 10u),
+                         [](const ::testing::TestParamInfo<uint32_t>& info) {
+                             return std::to_string(info.param) + "ms";
+                         });
+
+} // namespace
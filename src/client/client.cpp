@@ -38,6 +38,8 @@
 #include <ltproto/client2worker/change_streaming_params.pb.h>
 #include <ltproto/client2worker/change_streaming_params_ack.pb.h>
 #include <ltproto/client2worker/cursor_info.pb.h>
+#include <ltproto/client2worker/gamepad_ack.pb.h>
+#include <ltproto/client2worker/input_latency_report.pb.h>
 #include <ltproto/client2worker/request_keyframe.pb.h>
 #include <ltproto/client2worker/send_side_stat.pb.h>
 #include <ltproto/client2worker/start_transmission.pb.h>
@@ -288,6 +290,11 @@ bool Client::init() {
     absolute_mouse_ = settings_->getBoolean("absolute_mouse").value_or(true);
     video_params_.absolute_mouse = absolute_mouse_;
     video_params_.show_overlay = settings_->getBoolean("show_overlay").value_or(true);
+    // 以声音为准对齐画面会让画面最多晚150ms, 远程桌面和游戏更在意延迟, 默认不开
+    if (settings_->getBoolean("av_sync").value_or(false)) {
+        video_params_.av_sync = av_sync_;
+        audio_params_.av_sync = av_sync_;
+    }
     ioloop_ = ltlib::IOLoop::create();
     if (ioloop_ == nullptr) {
         LOG(ERR) << "Init IOLoop failed";
@@ -696,6 +703,7 @@ tp::Client* Client::createTcpClient() {
     params.user_data = this;
     params.on_data = &Client::onTpData;
     params.on_video = &Client::onTpVideoFrame;
+    params.on_shared_video = &Client::onTpSharedVideoFrame;
     params.on_audio = &Client::onTpAudioData;
     params.on_connected = &Client::onTpConnected;
     params.on_failed = &Client::onTpFailed;
@@ -794,26 +802,40 @@ void Client::onTpData(void* user_data, const uint8_t* data, uint32_t size, bool
 void Client::onTpVideoFrame(void* user_data, const lt::VideoFrame& frame) {
     // 跑在video线程
     auto that = reinterpret_cast<Client*>(user_data);
-    if (!that->first_decode_logged_) {
-        that->first_decode_logged_ = true;
+    that->submitVideoFrame(frame, nullptr);
+}
+
+void Client::onTpSharedVideoFrame(void* user_data, const lt::VideoFrame& frame,
+                                  const std::shared_ptr<const void>& holder) {
+    // 跑在video线程
+    auto that = reinterpret_cast<Client*>(user_data);
+    that->submitVideoFrame(frame, holder);
+}
+
+void Client::submitVideoFrame(const lt::VideoFrame& frame,
+                              const std::shared_ptr<const void>& holder) {
+    if (!first_decode_logged_) {
+        first_decode_logged_ = true;
         const int64_t now_ms = ltlib::steady_now_ms();
-        const int64_t base_ms = that->transport_up_ms_ > 0 ? that->transport_up_ms_ : now_ms;
-        logLtStage(that->trace_id_.empty() ? "na" : that->trace_id_, "first_frame_decode",
-               base_ms, now_ms, "ok");
+        const int64_t base_ms = transport_up_ms_ > 0 ? transport_up_ms_ : now_ms;
+        logLtStage(trace_id_.empty() ? "na" : trace_id_, "first_frame_decode", base_ms, now_ms,
+                   "ok");
     }
     video::DecodeRenderPipeline::Action action = video::DecodeRenderPipeline::Action::NONE;
     {
-        std::lock_guard lock{that->dr_mutex_};
-        if (that->video_pipeline_ == nullptr) {
+        std::lock_guard lock{dr_mutex_};
+        if (video_pipeline_ == nullptr) {
             return;
         }
-        action = that->video_pipeline_->submit(frame);
+        // holder为空说明frame.data只在回调期间有效, 由pipeline拷贝一份
+        action = holder == nullptr ? video_pipeline_->submit(frame)
+                                   : video_pipeline_->submit(frame, holder);
     }
     switch (action) {
     case video::DecodeRenderPipeline::Action::REQUEST_KEY_FRAME:
     {
         auto req = std::make_shared<ltproto::client2worker::RequestKeyframe>();
-        that->sendMessageToHost(ltproto::id(req), req, true);
+        sendMessageToHost(ltproto::id(req), req, true);
         break;
     }
     case video::DecodeRenderPipeline::Action::NONE:
@@ -966,6 +988,12 @@ void Client::dispatchRemoteMessage(uint32_t type,
     case ltproto::type::kCursorInfo:
         onCursorInfo(msg);
         break;
+    case ltproto::type::kGamepadAck:
+        onGamepadAck(msg);
+        break;
+    case ltproto::type::kInputLatencyReport:
+        onInputLatency(msg);
+        break;
     case ltproto::type::kChangeStreamingParams:
         onChangeStreamingParams(msg);
         break;
@@ -1026,7 +1054,11 @@ void Client::onStartTransmissionAck(const std::shared_ptr<google::protobuf::Mess
         trace_id_ = msg->trace_id();
     }
     if (msg->err_code() == ltproto::ErrorCode::Success) {
-        LOG(INFO) << "Received StartTransmissionAck with success";
+        LOG(INFO) << "Received StartTransmissionAck with success, host version "
+                  << msg->host_version();
+        if (input_capturer_ != nullptr) {
+            input_capturer_->setHostVersion(msg->host_version());
+        }
         auto switch_mouse = std::make_shared<ltproto::client2worker::SwitchMouseMode>();
         switch_mouse->set_absolute(absolute_mouse_);
         sendMessageToHost(ltproto::id(switch_mouse), switch_mouse, true);
@@ -1044,6 +1076,7 @@ void Client::onTimeSync(std::shared_ptr<google::protobuf::MessageLite> _msg) {
         rtt_ = result->rtt;
         time_diff_ = result->time_diff;
         LOG(DEBUG) << "rtt:" << rtt_ << ", time_diff:" << time_diff_;
+        av_sync_->setTimeDiff(time_diff_);
         {
             std::lock_guard lock{dr_mutex_};
             if (video_pipeline_) {
@@ -1079,6 +1112,42 @@ void Client::onSendSideStat(std::shared_ptr<google::protobuf::MessageLite> _msg)
     }
 }
 
+void Client::onGamepadAck(std::shared_ptr<google::protobuf::MessageLite> _msg) {
+    auto msg = std::static_pointer_cast<ltproto::client2worker::GamepadAck>(_msg);
+    if (input_capturer_ != nullptr) {
+        input_capturer_->onGamepadAck(msg->gamepad_index(),
+                                      static_cast<uint16_t>(msg->sequence()));
+    }
+}
+
+void Client::onInputLatency(std::shared_ptr<google::protobuf::MessageLite> _msg) {
+    auto msg = std::static_pointer_cast<ltproto::client2worker::InputLatencyReport>(_msg);
+    input::InputLatencyStat stat{};
+    if (msg->input_type() >= input::kInputLatencyTypes ||
+        msg->receive_us_size() != static_cast<int>(stat.receive_us.size()) ||
+        msg->inject_us_size() != static_cast<int>(stat.inject_us.size())) {
+        LOG(WARNING) << "Invalid InputLatencyReport, type " << msg->input_type();
+        return;
+    }
+    stat.type = static_cast<input::InputLatencyType>(msg->input_type());
+    stat.samples = msg->samples();
+    for (size_t i = 0; i < stat.receive_us.size(); i++) {
+        stat.receive_us[i] = msg->receive_us(static_cast<int>(i));
+        stat.inject_us[i] = msg->inject_us(static_cast<int>(i));
+    }
+    // 主机已经用TimeSync换算成同一个时钟
+    const char* name = input::toString(stat.type);
+    LOG(DEBUG) << "Input latency " << name << ": samples " << stat.samples
+               << ", receive p50/p95/p99 " << stat.receive_us[0] << "/" << stat.receive_us[1]
+               << "/" << stat.receive_us[2] << "us, inject " << stat.inject_us[0] << "/"
+               << stat.inject_us[1] << "/" << stat.inject_us[2] << "us";
+    std::lock_guard lock{dr_mutex_};
+    if (video_pipeline_) {
+        video_pipeline_->setInputLatency(name, stat.samples, stat.inject_us[0], stat.inject_us[1],
+                                         stat.inject_us[2]);
+    }
+}
+
 void Client::onCursorInfo(std::shared_ptr<google::protobuf::MessageLite> _msg) {
     auto msg = std::static_pointer_cast<ltproto::client2worker::CursorInfo>(_msg);
     LOGF(DEBUG, "onCursorInfo id:%d, w:%d, h:%d, x:%d, y:%d", msg->preset(), msg->w(), msg->h(),
@@ -1145,11 +1214,9 @@ void Client::onChangeStreamingParams(std::shared_ptr<google::protobuf::MessageLi
         input_capturer_->changeVideoParameters(video_params_.width, video_params_.height,
                                                video_params_.rotation, is_stretch_);
         std::lock_guard lock{dr_mutex_};
-        video_pipeline_.reset(); // 手动reset再create，保证不同时存在两份VideoDecodeRenderPipeline
-        video_pipeline_ = video::DecodeRenderPipeline::create(video_params_);
-        if (video_pipeline_ == nullptr) {
+        if (!reconfigureVideoPipeline()) {
             success = false;
-            LOG(ERR) << "Recreate VideoDecodeRenderPipeline failed";
+            LOG(ERR) << "Reconfigure VideoDecodeRenderPipeline failed";
         }
     }
     auto ack = std::make_shared<ltproto::client2worker::ChangeStreamingParamsAck>();
@@ -1223,10 +1290,7 @@ void Client::resetVideoPipeline() {
         bool need_exit = false;
         {
             std::lock_guard lock{dr_mutex_};
-            video_pipeline_
-                .reset(); // 手动reset再create，保证不同时存在两份VideoDecodeRenderPipeline
-            video_pipeline_ = video::DecodeRenderPipeline::create(video_params_);
-            if (video_pipeline_ == nullptr) {
+            if (!reconfigureVideoPipeline()) {
                 LOG(ERR) << "Recreate VideoDecodeRenderPipeline failed, exit process";
                 need_exit = true;
             }
@@ -1237,6 +1301,16 @@ void Client::resetVideoPipeline() {
     });
 }
 
+bool Client::reconfigureVideoPipeline() {
+    // 调用方持有dr_mutex_. 先尝试原地重配置, 避免重建窗口上下文和widgets导致的长时间黑屏
+    if (video_pipeline_ != nullptr && video_pipeline_->reconfigure(video_params_)) {
+        return true;
+    }
+    video_pipeline_.reset(); // 手动reset再create，保证不同时存在两份VideoDecodeRenderPipeline
+    video_pipeline_ = video::DecodeRenderPipeline::create(video_params_);
+    return video_pipeline_ != nullptr;
+}
+
 } // namespace cli
 
 } // namespace lt
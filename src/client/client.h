@@ -39,6 +39,7 @@
 #include <shared_mutex>
 #include <string>
 
+#include <ltlib/av_sync.h>
 #include <ltlib/io/client.h>
 #include <ltlib/io/ioloop.h>
 #include <ltlib/settings.h>
@@ -48,6 +49,7 @@
 
 #include <audio/player/audio_player.h>
 #include <inputs/capturer/input_capturer.h>
+#include <inputs/executor/input_latency.h>
 #include <plat/pc_sdl.h>
 #include <plat/video_device.h>
 #include <video/drpipeline/video_decode_render_pipeline.h>
@@ -140,8 +142,11 @@ private:
     tp::Client* createTcpClient();
     tp::Client* createRtcClient();
     tp::Client* createRtc2Client();
+    void submitVideoFrame(const lt::VideoFrame& frame, const std::shared_ptr<const void>& holder);
     static void onTpData(void* user_data, const uint8_t* data, uint32_t size, bool is_reliable);
     static void onTpVideoFrame(void* user_data, const lt::VideoFrame& frame);
+    static void onTpSharedVideoFrame(void* user_data, const lt::VideoFrame& frame,
+                                     const std::shared_ptr<const void>& holder);
     static void onTpAudioData(void* user_data, const lt::AudioData& audio_data);
     static void onTpConnected(void* user_data, lt::LinkType link_type);
     static void onTpConnChanged(void* user_data, lt::LinkType old_type, lt::LinkType new_type);
@@ -163,6 +168,8 @@ private:
     void onTimeSync(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onSendSideStat(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onCursorInfo(std::shared_ptr<google::protobuf::MessageLite> msg);
+    void onGamepadAck(std::shared_ptr<google::protobuf::MessageLite> msg);
+    void onInputLatency(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onChangeStreamingParams(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onRemoteClipboard(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onRemotePullFile(std::shared_ptr<google::protobuf::MessageLite> msg);
@@ -170,6 +177,7 @@ private:
     void onRemoteFileChunkAck(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onUserSwitchStretch();
     void resetVideoPipeline();
+    bool reconfigureVideoPipeline();
 
 private:
     std::unique_ptr<ltlib::Settings> settings_;
@@ -204,6 +212,8 @@ private:
     ltlib::TimeSync time_sync_;
     int64_t rtt_ = 0;
     int64_t time_diff_ = 0;
+    // 音频播放和视频渲染共用, 以声音为准对齐画面. 设置里打开av_sync才交给它们
+    std::shared_ptr<ltlib::AVSync> av_sync_ = std::make_shared<ltlib::AVSync>();
     bool windowed_fullscreen_ = true;
     int64_t status_color_ = -1;
     bool signaling_keepalive_inited_ = false;
@@ -32,8 +32,10 @@
 #include <plat/pc_sdl.h>
 
 #include <array>
+#include <mutex>
 
 #include <ltlib/logging.h>
+#include <ltlib/threads.h>
 #include <ltlib/times.h>
 #include <ltproto/client2worker/controller_added_removed.pb.h>
 #include <ltproto/client2worker/controller_status.pb.h>
@@ -43,20 +45,12 @@
 
 #include <ltlib/transform.h>
 
+#include <inputs/capturer/mouse_move_coalescer.h>
+#include <inputs/executor/gamepad_state.h>
 #include <inputs/executor/scancode.h>
 
 namespace {
 
-struct ControllerState {
-    uint32_t buttons = 0;
-    uint8_t left_trigger = 0;
-    uint8_t right_trigger = 0;
-    int16_t left_thumb_x = 0;
-    int16_t left_thumb_y = 0;
-    int16_t right_thumb_x = 0;
-    int16_t right_thumb_y = 0;
-};
-
 constexpr uint32_t kControllerA = 0x1000;
 constexpr uint32_t kControllerB = 0x2000;
 constexpr uint32_t kControllerX = 0x4000;
@@ -106,6 +100,8 @@ public:
     void init();
     void changeVideoParameters(uint32_t video_width, uint32_t video_height, uint32_t rotation,
                                bool stretch);
+    void setHostVersion(int64_t version);
+    void onGamepadAck(uint32_t gamepad_index, uint16_t sequence);
 
 private:
     void sendMessageToHost(uint32_t type, const std::shared_ptr<google::protobuf::MessageLite>& msg,
@@ -115,10 +111,16 @@ private:
     void handleMouseButton(const MouseButtonEvent& ev);
     void handleMouseWheel(const MouseWheelEvent& ev);
     void handleMouseMove(const MouseMoveEvent& ev);
+    // 调用前要持有send_mutex_
+    void flushMouseMove();
     void handleControllerAddedRemoved(const ControllerAddedRemovedEvent& ev);
     void handleControllerButton(const ControllerButtonEvent& ev);
     void handleControllerAxis(const ControllerAxisEvent& ev);
     void sendControllerState(uint32_t index);
+    // 调用前要持有send_mutex_
+    void scheduleGamepadPoll(int64_t now_us);
+    void pollGamepads();
+    void sendGamepadWire(const GamepadWire& wire, bool reliable);
     void processHotKeys();
     std::pair<float, float> calcAbsPos(int32_t x, int32_t y, int32_t w, int32_t h);
 
@@ -131,15 +133,25 @@ private:
     uint32_t video_height_;
     uint32_t rotation_;
     bool is_stretch_;
-    int64_t rel_mouse_accel_;
     std::function<void(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&, bool)>
         send_message_to_host_;
     std::function<void()> toggle_fullscreen_;
     std::function<void()> switch_mouse_mode_;
     // 0表示松开，非0表示按下。不用bool而用uint8_t是担心menset()之类函数不好处理bool数组
     std::array<uint8_t, 512> key_states_ = {0};
-    std::array<std::optional<ControllerState>, 4> cstates_;
+    std::array<std::optional<GamepadState>, 4> cstates_;
+    const int64_t gamepad_interval_us_;
     std::mutex mutex_;
+    // 鼠标移动可能在定时器线程发出去, 和其它输入消息一起串行, 保证主机收到的顺序不变
+    std::mutex send_mutex_;
+    MouseMoveCoalescer mouse_moves_;
+    bool mouse_flush_scheduled_ = false;
+    // 和cstates_对应, 手柄插上时创建
+    std::array<std::optional<GamepadStateEncoder>, 4> gamepad_encoders_;
+    bool gamepad_sequenced_ = false;
+    std::optional<int64_t> gamepad_poll_time_us_;
+    // 放在最后, 析构时先停掉定时器
+    std::unique_ptr<ltlib::TaskThread> flush_thread_;
 };
 
 std::unique_ptr<Capturer> Capturer::create(const Params& params) {
@@ -155,18 +167,29 @@ void Capturer::changeVideoParameters(uint32_t video_width, uint32_t video_height
     impl_->changeVideoParameters(video_width, video_height, rotation, stretch);
 }
 
+void Capturer::setHostVersion(int64_t version) {
+    impl_->setHostVersion(version);
+}
+
+void Capturer::onGamepadAck(uint32_t gamepad_index, uint16_t sequence) {
+    impl_->onGamepadAck(gamepad_index, sequence);
+}
+
 CapturerImpl::CapturerImpl(const Capturer::Params& params)
     : sdl_{params.sdl}
     , video_width_{params.video_width}
     , video_height_{params.video_height}
     , rotation_{params.rotation}
     , is_stretch_{params.stretch}
-    , rel_mouse_accel_{params.rel_mouse_accel}
     , send_message_to_host_{params.send_message}
     , toggle_fullscreen_{params.toggle_fullscreen}
-    , switch_mouse_mode_{params.switch_mouse_mode} {}
+    , switch_mouse_mode_{params.switch_mouse_mode}
+    , gamepad_interval_us_{params.gamepad_interval_us}
+    , mouse_moves_{MouseMoveCoalescer::Params{params.mouse_move_interval_us,
+                                              params.rel_mouse_accel}} {}
 
 void CapturerImpl::init() {
+    flush_thread_ = ltlib::TaskThread::create("lt_input_flush");
     sdl_->setInputHandler(
         std::bind(&CapturerImpl::onPlatformInputEvent, this, std::placeholders::_1));
 }
@@ -180,6 +203,29 @@ void CapturerImpl::changeVideoParameters(uint32_t video_width, uint32_t video_he
     is_stretch_ = stretch;
 }
 
+void CapturerImpl::setHostVersion(int64_t version) {
+    if (version < kGamepadSequencedMinHostVersion) {
+        LOG(INFO) << "Host version " << version << " predates sequenced gamepad states";
+        return;
+    }
+    std::lock_guard lock{send_mutex_};
+    gamepad_sequenced_ = true;
+    for (auto& encoder : gamepad_encoders_) {
+        if (encoder.has_value()) {
+            encoder->enableSequenced();
+        }
+    }
+}
+
+void CapturerImpl::onGamepadAck(uint32_t gamepad_index, uint16_t sequence) {
+    std::lock_guard lock{send_mutex_};
+    if (gamepad_index >= gamepad_encoders_.size() ||
+        !gamepad_encoders_[gamepad_index].has_value()) {
+        return;
+    }
+    gamepad_encoders_[gamepad_index]->onAck(sequence);
+}
+
 void CapturerImpl::sendMessageToHost(uint32_t type,
                                      const std::shared_ptr<google::protobuf::MessageLite>& msg,
                                      bool reliable) {
@@ -223,7 +269,11 @@ void CapturerImpl::handleKeyboardUpDown(const KeyboardEvent& ev) {
     msg->set_key(ev.scan_code);
     msg->set_down(ev.is_pressed);
     msg->set_client_send_timestamp_us(ltlib::steady_now_us());
-    sendMessageToHost(ltproto::id(msg), msg, true);
+    {
+        std::lock_guard lock{send_mutex_};
+        flushMouseMove();
+        sendMessageToHost(ltproto::id(msg), msg, true);
+    }
     LOG(DEBUG) << "Key:" << ev.scan_code << ", down:" << ev.is_pressed;
 }
 
@@ -264,6 +314,8 @@ void CapturerImpl::handleMouseButton(const MouseButtonEvent& ev) {
     }
     msg->set_x(x);
     msg->set_y(y);
+    std::lock_guard lock{send_mutex_};
+    flushMouseMove();
     sendMessageToHost(ltproto::id(msg), msg, true);
 }
 
@@ -271,29 +323,44 @@ void CapturerImpl::handleMouseWheel(const MouseWheelEvent& ev) {
     auto msg = std::make_shared<ltproto::client2worker::MouseEvent>();
     msg->set_delta_z(ev.amount);
     msg->set_client_send_timestamp_us(ltlib::steady_now_us());
+    std::lock_guard lock{send_mutex_};
+    flushMouseMove();
     sendMessageToHost(ltproto::id(msg), msg, true);
 }
 
 void CapturerImpl::handleMouseMove(const MouseMoveEvent& ev) {
-
-    // TODO: 相对模式可能要累积一段再发出去
-    auto msg = std::make_shared<ltproto::client2worker::MouseEvent>();
-    msg->set_client_send_timestamp_us(ltlib::steady_now_us());
     auto [x, y] = calcAbsPos(ev.x, ev.y, static_cast<int32_t>(ev.window_width),
                              static_cast<int32_t>(ev.window_height));
-    if (x < 0.f || x > 1.f || y < 0.f || y > 1.f) {
-        // ?
+    const int64_t now_us = ltlib::steady_now_us();
+    std::lock_guard lock{send_mutex_};
+    if (mouse_moves_.add(x, y, ev.delta_x, ev.delta_y, now_us)) {
+        flushMouseMove();
+        return;
     }
-    msg->set_x(x);
-    msg->set_y(y);
-    if (rel_mouse_accel_ >= 1 && rel_mouse_accel_ <= 30) {
-        msg->set_delta_x(static_cast<int32_t>(ev.delta_x * rel_mouse_accel_ / 10.0));
-        msg->set_delta_y(static_cast<int32_t>(ev.delta_y * rel_mouse_accel_ / 10.0));
+    if (mouse_flush_scheduled_) {
+        return;
     }
-    else {
-        msg->set_delta_x(ev.delta_x);
-        msg->set_delta_y(ev.delta_y);
+    // 这个周期剩下的移动到周期结束时一起发
+    mouse_flush_scheduled_ = true;
+    const int64_t delay_us = std::max<int64_t>(0, mouse_moves_.nextSendTime() - now_us);
+    flush_thread_->post_delay(ltlib::TimeDelta{delay_us}, [this]() {
+        std::lock_guard lock{send_mutex_};
+        mouse_flush_scheduled_ = false;
+        flushMouseMove();
+    });
+}
+
+void CapturerImpl::flushMouseMove() {
+    auto move = mouse_moves_.take(ltlib::steady_now_us());
+    if (!move.has_value()) {
+        return;
     }
+    auto msg = std::make_shared<ltproto::client2worker::MouseEvent>();
+    msg->set_client_send_timestamp_us(move->first_event_us);
+    msg->set_x(move->x);
+    msg->set_y(move->y);
+    msg->set_delta_x(move->delta_x);
+    msg->set_delta_y(move->delta_y);
     sendMessageToHost(ltproto::id(msg), msg, true);
 }
 
@@ -310,9 +377,19 @@ bool CapturerImpl::doHandleControllerAddedRemoved(const ControllerAddedRemovedEv
     msg->set_is_added(ev.is_added);
     if (!ev.is_added) {
         cstates_[ev.index] = std::nullopt;
+        std::lock_guard lock{send_mutex_};
+        gamepad_encoders_[ev.index] = std::nullopt;
     }
     else if (!cstates_[ev.index].has_value()) {
-        cstates_[ev.index] = ControllerState{};
+        cstates_[ev.index] = GamepadState{};
+        std::lock_guard lock{send_mutex_};
+        GamepadStateEncoder::Params params{};
+        params.index = ev.index;
+        params.min_interval_us = gamepad_interval_us_;
+        gamepad_encoders_[ev.index].emplace(params);
+        if (gamepad_sequenced_) {
+            gamepad_encoders_[ev.index]->enableSequenced();
+        }
         sendMessageToHost(ltproto::id(msg), msg, true);
     }
     return true;
@@ -478,16 +555,74 @@ void CapturerImpl::sendControllerState(uint32_t index) {
     if (!state.has_value()) {
         return;
     }
+    const int64_t now_us = ltlib::steady_now_us();
+    std::lock_guard lock{send_mutex_};
+    auto& encoder = gamepad_encoders_[index];
+    if (!encoder.has_value()) {
+        return;
+    }
+    encoder->update(*state, now_us,
+                    std::bind(&CapturerImpl::sendGamepadWire, this, std::placeholders::_1,
+                              std::placeholders::_2));
+    scheduleGamepadPoll(now_us);
+}
+
+void CapturerImpl::scheduleGamepadPoll(int64_t now_us) {
+    std::optional<int64_t> wake_us;
+    for (const auto& encoder : gamepad_encoders_) {
+        if (!encoder.has_value()) {
+            continue;
+        }
+        auto next = encoder->nextWakeTime();
+        if (next.has_value() && (!wake_us.has_value() || *next < *wake_us)) {
+            wake_us = next;
+        }
+    }
+    if (!wake_us.has_value() ||
+        (gamepad_poll_time_us_.has_value() && *gamepad_poll_time_us_ <= *wake_us)) {
+        return;
+    }
+    gamepad_poll_time_us_ = wake_us;
+    const int64_t delay_us = std::max<int64_t>(0, *wake_us - now_us);
+    flush_thread_->post_delay(ltlib::TimeDelta{delay_us}, [this]() { pollGamepads(); });
+}
+
+void CapturerImpl::pollGamepads() {
+    const int64_t now_us = ltlib::steady_now_us();
+    std::lock_guard lock{send_mutex_};
+    if (gamepad_poll_time_us_.has_value() && *gamepad_poll_time_us_ > now_us) {
+        // 已经有更早的任务处理过, 这个是之后重新安排的
+        return;
+    }
+    gamepad_poll_time_us_ = std::nullopt;
+    for (auto& encoder : gamepad_encoders_) {
+        if (!encoder.has_value()) {
+            continue;
+        }
+        auto next = encoder->nextWakeTime();
+        if (next.has_value() && *next <= now_us) {
+            encoder->poll(now_us, std::bind(&CapturerImpl::sendGamepadWire, this,
+                                            std::placeholders::_1, std::placeholders::_2));
+        }
+    }
+    scheduleGamepadPoll(now_us);
+}
+
+void CapturerImpl::sendGamepadWire(const GamepadWire& wire, bool reliable) {
     auto msg = std::make_shared<ltproto::client2worker::ControllerStatus>();
-    msg->set_button_flags(state->buttons);
-    msg->set_gamepad_index(index);
-    msg->set_left_stick_x(state->left_thumb_x);
-    msg->set_left_stick_y(state->left_thumb_y);
-    msg->set_right_stick_x(state->right_thumb_x);
-    msg->set_right_stick_y(state->right_thumb_y);
-    msg->set_left_trigger(state->left_trigger);
-    msg->set_right_trigger(state->right_trigger);
-    sendMessageToHost(ltproto::id(msg), msg, true);
+    msg->set_gamepad_index(wire.gamepad_index);
+    if (wire.sequence.has_value()) {
+        msg->set_sequence(*wire.sequence);
+    }
+    msg->set_base_distance(wire.base_distance);
+    msg->set_button_flags(wire.button_flags);
+    msg->set_left_stick_x(wire.left_stick_x);
+    msg->set_left_stick_y(wire.left_stick_y);
+    msg->set_right_stick_x(wire.right_stick_x);
+    msg->set_right_stick_y(wire.right_stick_y);
+    msg->set_left_trigger(wire.left_trigger);
+    msg->set_right_trigger(wire.right_trigger);
+    sendMessageToHost(ltproto::id(msg), msg, reliable);
 }
 
 void CapturerImpl::processHotKeys() {
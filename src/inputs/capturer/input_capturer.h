@@ -56,6 +56,10 @@ public:
         uint32_t rotation;
         bool stretch;
         int64_t rel_mouse_accel;
+        // 鼠标移动合并发送的周期, 1000Hz的鼠标不会每个事件发一条消息
+        int64_t mouse_move_interval_us = 4'000;
+        // 只有摇杆和扳机变化时, 手柄状态最快多久发一次. 按键变化马上发
+        int64_t gamepad_interval_us = 8'000;
         std::function<void(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&, bool)>
             send_message;
         std::function<void()> toggle_fullscreen;
@@ -66,6 +70,10 @@ public:
     static std::unique_ptr<Capturer> create(const Params& params);
     void changeVideoParameters(uint32_t video_width, uint32_t video_height, uint32_t rotation,
                                bool stretch);
+    // StartTransmissionAck里的主机版本, 够新时手柄状态改用增量编码
+    void setHostVersion(int64_t version);
+    // 主机对手柄状态的确认
+    void onGamepadAck(uint32_t gamepad_index, uint16_t sequence);
 
 private:
     Capturer() = default;
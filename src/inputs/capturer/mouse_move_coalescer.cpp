@@ -0,0 +1,96 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inputs/capturer/mouse_move_coalescer.h>
+
+namespace lt {
+
+namespace input {
+
+MouseMoveCoalescer::MouseMoveCoalescer()
+    : MouseMoveCoalescer{Params{}} {}
+
+MouseMoveCoalescer::MouseMoveCoalescer(const Params& params)
+    : params_{params} {}
+
+bool MouseMoveCoalescer::add(float x, float y, int32_t delta_x, int32_t delta_y, int64_t now_us) {
+    if (!has_pending_) {
+        first_event_us_ = now_us;
+    }
+    has_pending_ = true;
+    x_ = x;
+    y_ = y;
+    raw_delta_x_ += delta_x;
+    raw_delta_y_ += delta_y;
+    merged_++;
+    return !last_send_us_.has_value() || now_us - *last_send_us_ >= params_.interval_us;
+}
+
+std::optional<MouseMoveCoalescer::Move> MouseMoveCoalescer::take(int64_t now_us) {
+    if (!has_pending_) {
+        return std::nullopt;
+    }
+    Move move{};
+    move.x = x_;
+    move.y = y_;
+    move.delta_x = scale(raw_delta_x_, remainder_x_);
+    move.delta_y = scale(raw_delta_y_, remainder_y_);
+    move.merged = merged_;
+    move.first_event_us = first_event_us_;
+    has_pending_ = false;
+    merged_ = 0;
+    last_send_us_ = now_us;
+    return move;
+}
+
+bool MouseMoveCoalescer::empty() const {
+    return !has_pending_;
+}
+
+int64_t MouseMoveCoalescer::nextSendTime() const {
+    return last_send_us_.value_or(0) + params_.interval_us;
+}
+
+int32_t MouseMoveCoalescer::scale(int64_t& raw, int64_t& remainder) const {
+    if (params_.rel_mouse_accel < 1 || params_.rel_mouse_accel > 30) {
+        const auto delta = static_cast<int32_t>(raw);
+        raw = 0;
+        return delta;
+    }
+    // 向零取整, 余数带符号, 正反方向来回移动也不会漂
+    const int64_t scaled = raw * params_.rel_mouse_accel + remainder;
+    raw = 0;
+    remainder = scaled % 10;
+    return static_cast<int32_t>(scaled / 10);
+}
+
+} // namespace input
+
+} // namespace lt
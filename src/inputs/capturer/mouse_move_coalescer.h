@@ -0,0 +1,95 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <optional>
+
+namespace lt {
+
+namespace input {
+
+// 把一个发送周期里的鼠标移动合成一条消息. 相对位移全部累加, 绝对坐标只留最后一个.
+// 周期内第一个移动马上发, 之后的攒到周期结束再发, 所以零星的移动没有额外延迟.
+// 鼠标按键, 滚轮和键盘消息发送前要先take(), 保证主机看到的顺序和本地一致.
+// 不读时钟, 不加锁.
+class MouseMoveCoalescer {
+public:
+    struct Params {
+        // 发送周期. 1000Hz的鼠标每秒最多发1s/interval_us条
+        int64_t interval_us = 4'000;
+        // 相对位移的倍率, 以10为1倍, 合法范围1~30, 超出范围按1倍
+        int64_t rel_mouse_accel = 10;
+    };
+
+    struct Move {
+        float x;
+        float y;
+        int32_t delta_x;
+        int32_t delta_y;
+        // 合并了多少个移动事件
+        uint32_t merged;
+        // 最早那个移动事件的时间, 输入延迟从这里算起
+        int64_t first_event_us;
+    };
+
+public:
+    MouseMoveCoalescer();
+    explicit MouseMoveCoalescer(const Params& params);
+    // 返回true表示离上次发送已经满一个周期, 调用方应该马上take()并发送.
+    // 否则调用方要保证在nextSendTime()之前调用take()
+    bool add(float x, float y, int32_t delta_x, int32_t delta_y, int64_t now_us);
+    // 取出攒着的移动, 没有时返回nullopt
+    std::optional<Move> take(int64_t now_us);
+    bool empty() const;
+    int64_t nextSendTime() const;
+
+private:
+    int32_t scale(int64_t& raw, int64_t& remainder) const;
+
+private:
+    const Params params_;
+    bool has_pending_ = false;
+    float x_ = 0.f;
+    float y_ = 0.f;
+    // 累加的原始位移
+    int64_t raw_delta_x_ = 0;
+    int64_t raw_delta_y_ = 0;
+    // 乘倍率之后除不尽的部分留到下一次, 慢慢移动时不会丢位移
+    int64_t remainder_x_ = 0;
+    int64_t remainder_y_ = 0;
+    uint32_t merged_ = 0;
+    int64_t first_event_us_ = 0;
+    std::optional<int64_t> last_send_us_;
+};
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <inputs/capturer/mouse_move_coalescer.h>
+
+namespace {
+
+using lt::input::MouseMoveCoalescer;
+
+constexpr int64_t kMouseIntervalUs = 1'000;
+
+struct Sent {
+    enum class Kind { Move, Button };
+    Kind kind;
+    int64_t time_us;
+    int32_t delta_x;
+    int32_t delta_y;
+    float x;
+    // 按键发出时, 本地在它之前一共移动了多少
+    int64_t local_delta_x;
+};
+
+// 按CapturerImpl的方式使用MouseMoveCoalescer: 满一个周期马上发, 否则等定时器;
+// 按键前先把攒着的移动发出去
+class Harness {
+public:
+    explicit Harness(const MouseMoveCoalescer::Params& params)
+        : coalescer_{params} {}
+
+    void move(int32_t dx, int32_t dy, int64_t now_us) {
+        runTimer(now_us);
+        local_delta_x_ += dx;
+        local_x_ += 0.001f;
+        if (coalescer_.add(local_x_, 0.f, dx, dy, now_us)) {
+            sendMove(now_us);
+        }
+        else if (!timer_.has_value()) {
+            timer_ = coalescer_.nextSendTime();
+        }
+    }
+
+    void button(int64_t now_us) {
+        runTimer(now_us);
+        sendMove(now_us);
+        sent_.push_back({Sent::Kind::Button, now_us, 0, 0, 0.f, local_delta_x_});
+    }
+
+    void runTimer(int64_t now_us) {
+        if (timer_.has_value() && *timer_ <= now_us) {
+            const int64_t fire_us = *timer_;
+            timer_.reset();
+            sendMove(fire_us);
+        }
+    }
+
+    const std::vector<Sent>& sent() const { return sent_; }
+
+private:
+    void sendMove(int64_t now_us) {
+        auto move = coalescer_.take(now_us);
+        if (move.has_value()) {
+            sent_.push_back({Sent::Kind::Move, now_us, move->delta_x, move->delta_y, move->x, 0});
+        }
+    }
+
+private:
+    MouseMoveCoalescer coalescer_;
+    std::optional<int64_t> timer_;
+    std::vector<Sent> sent_;
+    int64_t local_delta_x_ = 0;
+    float local_x_ = 0.f;
+};
+
+TEST(MouseMoveCoalescerTest, FirstMoveIsSentImmediately) {
+    MouseMoveCoalescer coalescer;
+    EXPECT_TRUE(coalescer.add(0.1f, 0.2f, 1, 1, 1'000'000));
+    ASSERT_TRUE(coalescer.take(1'000'000).has_value());
+    EXPECT_TRUE(coalescer.empty());
+    // 同一个周期里的移动要攒着
+    EXPECT_FALSE(coalescer.add(0.1f, 0.2f, 1, 1, 1'001'000));
+    EXPECT_EQ(coalescer.nextSendTime(), 1'004'000);
+    ASSERT_TRUE(coalescer.take(1'004'000).has_value());
+    // 停了一阵之后再动, 不用等
+    EXPECT_TRUE(coalescer.add(0.1f, 0.2f, 1, 1, 1'100'000));
+}
+
+TEST(MouseMoveCoalescerTest, KeepsLatestPositionAndSumsDeltas) {
+    MouseMoveCoalescer coalescer;
+    ASSERT_TRUE(coalescer.add(0.1f, 0.1f, 1, 2, 0));
+    coalescer.take(0);
+    EXPECT_FALSE(coalescer.take(0).has_value());
+    coalescer.add(0.2f, 0.3f, 3, -1, 1'000);
+    coalescer.add(0.4f, 0.5f, -5, 7, 2'000);
+    coalescer.add(0.6f, 0.7f, 2, 0, 3'000);
+    auto move = coalescer.take(4'000);
+    ASSERT_TRUE(move.has_value());
+    EXPECT_FLOAT_EQ(move->x, 0.6f);
+    EXPECT_FLOAT_EQ(move->y, 0.7f);
+    EXPECT_EQ(move->delta_x, 0);
+    EXPECT_EQ(move->delta_y, 6);
+    EXPECT_EQ(move->merged, 3u);
+    EXPECT_EQ(move->first_event_us, 1'000);
+}
+
+TEST(MouseMoveCoalescerTest, AccelerationKeepsFractions) {
+    MouseMoveCoalescer::Params params{};
+    params.rel_mouse_accel = 15;
+    MouseMoveCoalescer coalescer{params};
+    // 每次移动1个像素, 1.5倍. 逐个取整的话每次都是1, 会丢掉三分之一
+    int64_t sent = 0;
+    for (int64_t i = 0; i < 1000; i++) {
+        coalescer.add(0.f, 0.f, 1, 0, i * 10'000);
+        sent += coalescer.take(i * 10'000)->delta_x;
+    }
+    EXPECT_EQ(sent, 1500);
+    // 反方向移动回去, 不会因为取整漂移
+    for (int64_t i = 0; i < 1000; i++) {
+        coalescer.add(0.f, 0.f, -1, 0, (1000 + i) * 10'000);
+        sent += coalescer.take((1000 + i) * 10'000)->delta_x;
+    }
+    EXPECT_EQ(sent, 0);
+}
+
+TEST(MouseMoveCoalescerTest, ButtonsFlushPendingMovesFirst) {
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<int32_t> delta{-4, 4};
+    std::uniform_int_distribution<int32_t> percent{0, 99};
+    Harness harness{MouseMoveCoalescer::Params{}};
+    int64_t total_x = 0;
+    int64_t total_y = 0;
+    int64_t now_us = 0;
+    for (int i = 0; i < 5000; i++) {
+        const int32_t dx = delta(rng);
+        const int32_t dy = delta(rng);
+        total_x += dx;
+        total_y += dy;
+        harness.move(dx, dy, now_us);
+        if (percent(rng) < 3) {
+            harness.button(now_us + 100);
+        }
+        now_us += kMouseIntervalUs;
+    }
+    harness.runTimer(now_us + 1'000'000);
+
+    int64_t sent_x = 0;
+    int64_t sent_y = 0;
+    int64_t last_time_us = -1;
+    float last_x = -1.f;
+    uint32_t buttons = 0;
+    for (const auto& sent : harness.sent()) {
+        EXPECT_GE(sent.time_us, last_time_us);
+        last_time_us = sent.time_us;
+        if (sent.kind == Sent::Kind::Button) {
+            // 主机收到按键时, 之前所有的移动都已经到了
+            EXPECT_EQ(sent_x, sent.local_delta_x);
+            buttons++;
+            continue;
+        }
+        EXPECT_GT(sent.x, last_x);
+        last_x = sent.x;
+        sent_x += sent.delta_x;
+        sent_y += sent.delta_y;
+    }
+    EXPECT_GT(buttons, 0u);
+    EXPECT_EQ(sent_x, total_x);
+    EXPECT_EQ(sent_y, total_y);
+}
+
+TEST(MouseMoveCoalescerTest, MessagesPerSecondAt1000Hz) {
+    constexpr int64_t kDurationUs = 10'000'000;
+    for (int64_t interval_us : {int64_t{1'000}, int64_t{4'000}, int64_t{8'000}}) {
+        MouseMoveCoalescer::Params params{};
+        params.interval_us = interval_us;
+        Harness harness{params};
+        // 1000Hz的鼠标, 上报时间带一点抖动
+        std::mt19937 rng{1};
+        std::uniform_int_distribution<int64_t> jitter{0, 200};
+        for (int64_t now_us = 0; now_us < kDurationUs; now_us += kMouseIntervalUs) {
+            harness.move(1, 0, now_us + jitter(rng));
+        }
+        harness.runTimer(kDurationUs + interval_us);
+        int64_t max_gap_us = 0;
+        for (size_t i = 1; i < harness.sent().size(); i++) {
+            max_gap_us = std::max(max_gap_us,
+                                  harness.sent()[i].time_us - harness.sent()[i - 1].time_us);
+        }
+        const double per_second = harness.sent().size() * 1'000'000.0 / kDurationUs;
+        std::printf("1000Hz mouse, %lldus tick: %.0f messages/s, max gap %.1fms\n",
+                    static_cast<long long>(interval_us), per_second, max_gap_us / 1000.0);
+        EXPECT_LE(per_second, 1'000'000.0 / interval_us + 1);
+        EXPECT_LE(max_gap_us, interval_us + kMouseIntervalUs);
+    }
+}
+
+} // namespace
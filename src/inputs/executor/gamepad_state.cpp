@@ -0,0 +1,319 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inputs/executor/gamepad_state.h>
+
+namespace {
+
+using lt::input::GamepadState;
+using lt::input::GamepadWire;
+
+int16_t sequenceDiff(uint16_t a, uint16_t b) {
+    return static_cast<int16_t>(a - b);
+}
+
+uint32_t zigzag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// 字段号都小于16, tag占一个字节. int32的负数按64位编码
+size_t fieldSize(int64_t value) {
+    return value == 0 ? 0 : 1 + varintSize(static_cast<uint64_t>(value));
+}
+
+GamepadWire fullWire(const GamepadState& state) {
+    GamepadWire wire{};
+    wire.button_flags = state.buttons;
+    wire.left_stick_x = state.left_thumb_x;
+    wire.left_stick_y = state.left_thumb_y;
+    wire.right_stick_x = state.right_thumb_x;
+    wire.right_stick_y = state.right_thumb_y;
+    wire.left_trigger = state.left_trigger;
+    wire.right_trigger = state.right_trigger;
+    return wire;
+}
+
+GamepadState fromFullWire(const GamepadWire& wire) {
+    GamepadState state{};
+    state.buttons = wire.button_flags;
+    state.left_thumb_x = static_cast<int16_t>(wire.left_stick_x);
+    state.left_thumb_y = static_cast<int16_t>(wire.left_stick_y);
+    state.right_thumb_x = static_cast<int16_t>(wire.right_stick_x);
+    state.right_thumb_y = static_cast<int16_t>(wire.right_stick_y);
+    state.left_trigger = static_cast<uint8_t>(wire.left_trigger);
+    state.right_trigger = static_cast<uint8_t>(wire.right_trigger);
+    return state;
+}
+
+int32_t encodeDiff(int32_t value, int32_t base) {
+    return static_cast<int32_t>(zigzag(value - base));
+}
+
+int32_t decodeDiff(int32_t diff, int32_t base) {
+    return base + unzigzag(static_cast<uint32_t>(diff));
+}
+
+GamepadWire deltaWire(const GamepadState& state, const GamepadState& base) {
+    GamepadWire wire{};
+    wire.button_flags = state.buttons ^ base.buttons;
+    wire.left_stick_x = encodeDiff(state.left_thumb_x, base.left_thumb_x);
+    wire.left_stick_y = encodeDiff(state.left_thumb_y, base.left_thumb_y);
+    wire.right_stick_x = encodeDiff(state.right_thumb_x, base.right_thumb_x);
+    wire.right_stick_y = encodeDiff(state.right_thumb_y, base.right_thumb_y);
+    wire.left_trigger = encodeDiff(state.left_trigger, base.left_trigger);
+    wire.right_trigger = encodeDiff(state.right_trigger, base.right_trigger);
+    return wire;
+}
+
+GamepadState applyDelta(const GamepadWire& wire, const GamepadState& base) {
+    GamepadState state{};
+    state.buttons = base.buttons ^ wire.button_flags;
+    state.left_thumb_x = static_cast<int16_t>(decodeDiff(wire.left_stick_x, base.left_thumb_x));
+    state.left_thumb_y = static_cast<int16_t>(decodeDiff(wire.left_stick_y, base.left_thumb_y));
+    state.right_thumb_x =
+        static_cast<int16_t>(decodeDiff(wire.right_stick_x, base.right_thumb_x));
+    state.right_thumb_y =
+        static_cast<int16_t>(decodeDiff(wire.right_stick_y, base.right_thumb_y));
+    state.left_trigger = static_cast<uint8_t>(decodeDiff(wire.left_trigger, base.left_trigger));
+    state.right_trigger =
+        static_cast<uint8_t>(decodeDiff(wire.right_trigger, base.right_trigger));
+    return state;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace input {
+
+size_t gamepadWireSize(const GamepadWire& wire) {
+    // sequence是optional, 0也会编码进去
+    const size_t sequence_size = wire.sequence.has_value() ? 1 + varintSize(*wire.sequence) : 0;
+    return fieldSize(wire.gamepad_index) + sequence_size + fieldSize(wire.base_distance) +
+           fieldSize(wire.button_flags) +
+           fieldSize(wire.left_stick_x) + fieldSize(wire.left_stick_y) +
+           fieldSize(wire.right_stick_x) + fieldSize(wire.right_stick_y) +
+           fieldSize(wire.left_trigger) + fieldSize(wire.right_trigger);
+}
+
+GamepadStateEncoder::GamepadStateEncoder()
+    : GamepadStateEncoder{Params{}} {}
+
+GamepadStateEncoder::GamepadStateEncoder(const Params& params)
+    : params_{params} {}
+
+void GamepadStateEncoder::update(const GamepadState& state, int64_t now_us, const Send& send) {
+    current_ = state;
+    if (current_ == last_sent_) {
+        // 摇杆晃回了上次发出去的位置
+        pending_ = false;
+        return;
+    }
+    if (current_.buttons != last_sent_.buttons || !last_send_us_.has_value() ||
+        now_us - *last_send_us_ >= params_.min_interval_us) {
+        sendNow(now_us, send);
+        return;
+    }
+    pending_ = true;
+}
+
+void GamepadStateEncoder::poll(int64_t now_us, const Send& send) {
+    if (pending_) {
+        if (now_us - *last_send_us_ >= params_.min_interval_us) {
+            sendNow(now_us, send);
+        }
+        return;
+    }
+    if (refreshDue(now_us)) {
+        last_send_us_ = now_us;
+        sendSequenced(now_us, send, /*allow_delta=*/false);
+    }
+}
+
+void GamepadStateEncoder::enableSequenced() {
+    sequenced_ = true;
+}
+
+void GamepadStateEncoder::onAck(uint16_t sequence) {
+    const Sent& sent = history_[sequence % history_.size()];
+    if (!sent.valid || sent.sequence != sequence) {
+        return;
+    }
+    if (acked_sequence_.has_value() && sequenceDiff(sequence, *acked_sequence_) <= 0) {
+        return;
+    }
+    acked_sequence_ = sequence;
+}
+
+std::optional<int64_t> GamepadStateEncoder::nextWakeTime() const {
+    if (pending_) {
+        return *last_send_us_ + params_.min_interval_us;
+    }
+    if (sequenced_ && last_send_us_.has_value() && acked_sequence_ != sequence_) {
+        return *last_send_us_ + params_.refresh_interval_us;
+    }
+    return std::nullopt;
+}
+
+bool GamepadStateEncoder::sequenced() const {
+    return sequenced_;
+}
+
+void GamepadStateEncoder::sendNow(int64_t now_us, const Send& send) {
+    pending_ = false;
+    last_sent_ = current_;
+    last_send_us_ = now_us;
+    if (sequenced_) {
+        sendSequenced(now_us, send, /*allow_delta=*/true);
+        return;
+    }
+    // 旧主机, 或者还不知道主机版本, 按旧格式可靠地发完整状态
+    GamepadWire wire = fullWire(current_);
+    wire.gamepad_index = params_.index;
+    send(wire, true);
+}
+
+void GamepadStateEncoder::sendSequenced(int64_t now_us, const Send& send, bool allow_delta) {
+    sequence_++;
+    GamepadWire wire{};
+    const Sent* base = nullptr;
+    uint16_t distance = 0;
+    if (allow_delta && acked_sequence_.has_value()) {
+        distance = static_cast<uint16_t>(sequence_ - *acked_sequence_);
+        const Sent& sent = history_[*acked_sequence_ % history_.size()];
+        if (distance >= 1 && distance <= kGamepadMaxBaseDistance && sent.valid &&
+            sent.sequence == *acked_sequence_) {
+            base = &sent;
+        }
+    }
+    if (base != nullptr) {
+        wire = deltaWire(current_, base->state);
+        wire.base_distance = distance;
+    }
+    else {
+        wire = fullWire(current_);
+        last_full_us_ = now_us;
+    }
+    wire.gamepad_index = params_.index;
+    wire.sequence = sequence_;
+    history_[sequence_ % history_.size()] = Sent{true, sequence_, current_};
+    send(wire, false);
+}
+
+bool GamepadStateEncoder::refreshDue(int64_t now_us) const {
+    return sequenced_ && last_send_us_.has_value() && acked_sequence_ != sequence_ &&
+           now_us - *last_send_us_ >= params_.refresh_interval_us;
+}
+
+GamepadStateDecoder::GamepadStateDecoder()
+    : GamepadStateDecoder{Params{}} {}
+
+GamepadStateDecoder::GamepadStateDecoder(const Params& params)
+    : params_{params} {}
+
+std::optional<GamepadStateDecoder::Decoded> GamepadStateDecoder::decode(const GamepadWire& wire) {
+    const uint32_t index = wire.gamepad_index;
+    if (index >= kMaxGamepads) {
+        return std::nullopt;
+    }
+    Pad& pad = pads_[index];
+    if (!wire.sequence.has_value()) {
+        if (pad.applied.has_value()) {
+            return std::nullopt;
+        }
+        return Decoded{index, fromFullWire(wire)};
+    }
+    const uint16_t sequence = *wire.sequence;
+    GamepadState state{};
+    if (wire.base_distance > 0) {
+        if (wire.base_distance > kGamepadMaxBaseDistance) {
+            return std::nullopt;
+        }
+        const auto base_sequence = static_cast<uint16_t>(sequence - wire.base_distance);
+        const Received& base = pad.history[base_sequence % pad.history.size()];
+        if (!base.valid || base.sequence != base_sequence) {
+            return std::nullopt;
+        }
+        state = applyDelta(wire, base.state);
+    }
+    else {
+        state = fromFullWire(wire);
+        pad.ack_now = true;
+    }
+    pad.history[sequence % pad.history.size()] = Received{true, sequence, state};
+    if (!pad.latest.has_value() || sequenceDiff(sequence, *pad.latest) > 0) {
+        pad.latest = sequence;
+    }
+    if (pad.applied.has_value() && sequenceDiff(sequence, *pad.applied) <= 0) {
+        return std::nullopt;
+    }
+    pad.applied = sequence;
+    return Decoded{index, state};
+}
+
+void GamepadStateDecoder::pollAcks(int64_t now_us,
+                                   const std::function<void(uint32_t, uint16_t)>& send_ack) {
+    for (uint32_t index = 0; index < pads_.size(); index++) {
+        Pad& pad = pads_[index];
+        if (!pad.latest.has_value() || pad.latest == pad.acked) {
+            continue;
+        }
+        if (!pad.ack_now && now_us - pad.last_ack_us < params_.ack_interval_us) {
+            continue;
+        }
+        pad.acked = pad.latest;
+        pad.ack_now = false;
+        pad.last_ack_us = now_us;
+        send_ack(index, *pad.latest);
+    }
+}
+
+void GamepadStateDecoder::reset(uint32_t index) {
+    if (index < pads_.size()) {
+        pads_[index] = Pad{};
+    }
+}
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,176 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+
+#include <ltlib/versions.h>
+
+namespace lt {
+
+namespace input {
+
+struct GamepadState {
+    uint32_t buttons = 0;
+    uint8_t left_trigger = 0;
+    uint8_t right_trigger = 0;
+    int16_t left_thumb_x = 0;
+    int16_t left_thumb_y = 0;
+    int16_t right_thumb_x = 0;
+    int16_t right_thumb_y = 0;
+
+    bool operator==(const GamepadState&) const = default;
+};
+
+// ControllerStatus里的字段. 没有sequence的是旧格式, 走可靠通道的完整状态.
+// base_distance大于0时是增量, 其余字段是相对sequence - base_distance那个状态的变化量.
+// 增量里按键是异或, 摇杆和扳机是差值的zigzag编码, 没变的字段是0, protobuf不会编码进去.
+// 主机用GamepadAck确认收到的最新序号.
+struct GamepadWire {
+    uint32_t gamepad_index = 0;
+    std::optional<uint16_t> sequence;
+    uint32_t base_distance = 0;
+    uint32_t button_flags = 0;
+    int32_t left_stick_x = 0;
+    int32_t left_stick_y = 0;
+    int32_t right_stick_x = 0;
+    int32_t right_stick_y = 0;
+    int32_t left_trigger = 0;
+    int32_t right_trigger = 0;
+};
+
+constexpr uint32_t kGamepadMaxBaseDistance = 63;
+// 从这个版本开始主机才认识ControllerStatus的sequence和base_distance. 旧主机会把增量当成完整状态
+constexpr int64_t kGamepadSequencedMinHostVersion = ltlib::combineVersion(0, 4, 3);
+
+// 按protobuf的编码规则估计一条ControllerStatus的大小
+size_t gamepadWireSize(const GamepadWire& wire);
+
+// 客户端, 每个手柄一个. 限制发送频率, 按键变化马上发. 知道主机版本够新之前按旧格式可靠地发
+// 完整状态; 之后走不可靠通道, 发相对最近确认状态的增量, 最新的状态迟迟没有确认就重发完整状态.
+// 不读时钟, 不加锁.
+class GamepadStateEncoder {
+public:
+    struct Params {
+        uint32_t index = 0;
+        // 只有摇杆和扳机变化时, 两次发送的最小间隔
+        int64_t min_interval_us = 8'000;
+        // 最新的状态这么久没有确认, 重发完整状态
+        int64_t refresh_interval_us = 100'000;
+    };
+    using Send = std::function<void(const GamepadWire& wire, bool reliable)>;
+
+public:
+    GamepadStateEncoder();
+    explicit GamepadStateEncoder(const Params& params);
+    void update(const GamepadState& state, int64_t now_us, const Send& send);
+    // 到了nextWakeTime()要调用一次
+    void poll(int64_t now_us, const Send& send);
+    // 主机版本不低于kGamepadSequencedMinHostVersion时调用, 下一次发送开始用新格式
+    void enableSequenced();
+    // GamepadAck里的序号
+    void onAck(uint16_t sequence);
+    std::optional<int64_t> nextWakeTime() const;
+    bool sequenced() const;
+
+private:
+    struct Sent {
+        bool valid = false;
+        uint16_t sequence = 0;
+        GamepadState state;
+    };
+    void sendNow(int64_t now_us, const Send& send);
+    void sendSequenced(int64_t now_us, const Send& send, bool allow_delta);
+    bool refreshDue(int64_t now_us) const;
+
+private:
+    const Params params_;
+    GamepadState current_;
+    GamepadState last_sent_;
+    bool pending_ = false;
+    std::optional<int64_t> last_send_us_;
+    bool sequenced_ = false;
+    uint16_t sequence_ = 0;
+    std::optional<uint16_t> acked_sequence_;
+    int64_t last_full_us_ = 0;
+    std::array<Sent, kGamepadMaxBaseDistance + 1> history_;
+};
+
+// 主机, 从完整状态和增量还原各个手柄的状态. 乱序到达的旧状态不会覆盖新状态,
+// 找不到基准的增量丢掉, 等客户端重发完整状态. 用过新格式之后不再接受旧格式的消息,
+// 免得客户端切换格式之前可靠通道里晚到的旧状态覆盖新状态. 不读时钟, 不加锁.
+class GamepadStateDecoder {
+public:
+    struct Params {
+        // 两次确认的最小间隔, 完整状态马上确认
+        int64_t ack_interval_us = 20'000;
+    };
+    struct Decoded {
+        uint32_t index;
+        GamepadState state;
+    };
+    static constexpr uint32_t kMaxGamepads = 4;
+
+public:
+    GamepadStateDecoder();
+    explicit GamepadStateDecoder(const Params& params);
+    // 返回nullopt表示不用更新手柄
+    std::optional<Decoded> decode(const GamepadWire& wire);
+    // send_ack的参数是GamepadAck的gamepad_index和sequence
+    void pollAcks(int64_t now_us, const std::function<void(uint32_t, uint16_t)>& send_ack);
+    void reset(uint32_t index);
+
+private:
+    struct Received {
+        bool valid = false;
+        uint16_t sequence = 0;
+        GamepadState state;
+    };
+    struct Pad {
+        std::array<Received, kGamepadMaxBaseDistance + 1> history;
+        std::optional<uint16_t> applied;
+        std::optional<uint16_t> latest;
+        std::optional<uint16_t> acked;
+        bool ack_now = false;
+        int64_t last_ack_us = 0;
+    };
+
+private:
+    const Params params_;
+    std::array<Pad, kMaxGamepads> pads_;
+};
+
+} // namespace input
+
+} // namespace lt
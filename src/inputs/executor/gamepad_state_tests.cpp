@@ -0,0 +1,346 @@
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <inputs/executor/gamepad_state.h>
+
+namespace {
+
+using lt::input::GamepadState;
+using lt::input::GamepadStateDecoder;
+using lt::input::GamepadStateEncoder;
+using lt::input::GamepadWire;
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int64_t kStepUs = 1'000;
+constexpr uint32_t kButtonA = 0x1000;
+
+using Key = std::array<int32_t, 7>;
+
+Key keyOf(const GamepadState& state) {
+    return {static_cast<int32_t>(state.buttons), state.left_trigger,  state.right_trigger,
+            state.left_thumb_x,                  state.left_thumb_y,  state.right_thumb_x,
+            state.right_thumb_y};
+}
+
+struct Network {
+    // 不可靠通道
+    uint32_t loss_percent = 0;
+    int64_t delay_us = 20'000;
+    // 每个包额外的延迟, 大于发送间隔时会乱序
+    int64_t jitter_us = 0;
+    // 旧主机只认识旧格式, 不回确认. 客户端从主机版本知道这一点, 不会发新格式
+    bool legacy_host = false;
+    // 客户端什么时候收到StartTransmissionAck, 知道主机的版本. 之前只能按旧格式发
+    int64_t host_version_us = 0;
+    uint32_t seed = 1;
+};
+
+struct Stats {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t reliable_messages = 0;
+    uint64_t acks = 0;
+    uint64_t acks_bytes = 0;
+    // 旧的发送方式: 每个事件发一条完整状态
+    uint64_t legacy_messages = 0;
+    uint64_t legacy_bytes = 0;
+    // 主机提交给手柄的状态里, 不是客户端真实出现过的状态的个数
+    uint64_t bogus_states = 0;
+    uint64_t applied = 0;
+    bool converged = false;
+};
+
+// 一个时间点上手柄的一次变化, 对应SDL的一个事件
+using Trace = std::function<std::optional<GamepadState>(int64_t now_us, GamepadState state)>;
+
+// 客户端按CapturerImpl的方式驱动编码器, 主机按Executor的方式解码并回确认
+Stats simulate(const Trace& trace, int64_t duration_us, const Network& net,
+               const GamepadStateEncoder::Params& params = {}) {
+    struct InFlight {
+        int64_t arrive_us;
+        uint64_t order;
+        GamepadWire wire;
+    };
+    struct Ack {
+        int64_t arrive_us;
+        uint16_t sequence;
+    };
+    std::mt19937 rng{net.seed};
+    std::uniform_int_distribution<uint32_t> percent{0, 99};
+    std::uniform_int_distribution<int64_t> jitter{0, net.jitter_us};
+    GamepadStateEncoder encoder{params};
+    GamepadStateDecoder decoder;
+    Stats stats;
+    std::vector<InFlight> in_flight;
+    std::deque<Ack> acks;
+    uint64_t order = 0;
+    int64_t last_reliable_arrive_us = 0;
+    GamepadState client{};
+    GamepadState host{};
+    std::set<Key> client_states{keyOf(client)};
+
+    auto send = [&](int64_t now_us) {
+        return [&, now_us](const GamepadWire& wire, bool reliable) {
+            stats.messages++;
+            stats.bytes += lt::input::gamepadWireSize(wire);
+            if (reliable) {
+                // 可靠通道不丢不乱序
+                stats.reliable_messages++;
+                last_reliable_arrive_us = std::max(last_reliable_arrive_us, now_us + net.delay_us);
+                in_flight.push_back({last_reliable_arrive_us, order++, wire});
+                return;
+            }
+            if (percent(rng) < net.loss_percent) {
+                return;
+            }
+            in_flight.push_back({now_us + net.delay_us + jitter(rng), order++, wire});
+        };
+    };
+    auto send_ack = [&](int64_t now_us) {
+        return [&, now_us](uint32_t index, uint16_t sequence) {
+            stats.acks++;
+            // GamepadAck和只有序号的ControllerStatus编码一样大
+            GamepadWire wire{};
+            wire.gamepad_index = index;
+            wire.sequence = sequence;
+            stats.acks_bytes += lt::input::gamepadWireSize(wire);
+            acks.push_back({now_us + net.delay_us, sequence});
+        };
+    };
+
+    const int64_t quiet_us = 2'000'000;
+    for (int64_t now_us = 0; now_us < duration_us + quiet_us; now_us += kStepUs) {
+        if (!net.legacy_host && now_us == net.host_version_us) {
+            encoder.enableSequenced();
+        }
+        if (now_us < duration_us) {
+            auto next = trace(now_us, client);
+            if (next.has_value() && !(*next == client)) {
+                client = *next;
+                client_states.insert(keyOf(client));
+                stats.legacy_messages++;
+                GamepadWire legacy{};
+                legacy.button_flags = client.buttons;
+                legacy.left_stick_x = client.left_thumb_x;
+                legacy.left_stick_y = client.left_thumb_y;
+                legacy.right_stick_x = client.right_thumb_x;
+                legacy.right_stick_y = client.right_thumb_y;
+                legacy.left_trigger = client.left_trigger;
+                legacy.right_trigger = client.right_trigger;
+                stats.legacy_bytes += lt::input::gamepadWireSize(legacy);
+                encoder.update(client, now_us, send(now_us));
+            }
+        }
+        auto wake = encoder.nextWakeTime();
+        if (wake.has_value() && *wake <= now_us) {
+            encoder.poll(now_us, send(now_us));
+        }
+
+        std::stable_sort(in_flight.begin(), in_flight.end(),
+                         [](const InFlight& a, const InFlight& b) {
+                             return a.arrive_us < b.arrive_us ||
+                                    (a.arrive_us == b.arrive_us && a.order < b.order);
+                         });
+        size_t delivered = 0;
+        for (; delivered < in_flight.size() && in_flight[delivered].arrive_us <= now_us;
+             delivered++) {
+            const GamepadWire& wire = in_flight[delivered].wire;
+            if (net.legacy_host) {
+                // 旧主机不认识sequence和base_distance, 都当完整状态
+                if (wire.gamepad_index < GamepadStateDecoder::kMaxGamepads) {
+                    host.buttons = wire.button_flags;
+                    host.left_thumb_x = static_cast<int16_t>(wire.left_stick_x);
+                    host.left_thumb_y = static_cast<int16_t>(wire.left_stick_y);
+                    host.right_thumb_x = static_cast<int16_t>(wire.right_stick_x);
+                    host.right_thumb_y = static_cast<int16_t>(wire.right_stick_y);
+                    host.left_trigger = static_cast<uint8_t>(wire.left_trigger);
+                    host.right_trigger = static_cast<uint8_t>(wire.right_trigger);
+                }
+                continue;
+            }
+            auto decoded = decoder.decode(wire);
+            if (decoded.has_value()) {
+                stats.applied++;
+                host = decoded->state;
+                if (client_states.count(keyOf(host)) == 0) {
+                    stats.bogus_states++;
+                }
+            }
+            decoder.pollAcks(now_us, send_ack(now_us));
+        }
+        in_flight.erase(in_flight.begin(), in_flight.begin() + delivered);
+        if (!net.legacy_host && now_us % 100'000 == 0) {
+            decoder.pollAcks(now_us, send_ack(now_us));
+        }
+        while (!acks.empty() && acks.front().arrive_us <= now_us) {
+            encoder.onAck(acks.front().sequence);
+            acks.pop_front();
+        }
+    }
+    stats.converged = host == client;
+    return stats;
+}
+
+// 左摇杆转圈, 每秒一圈. SDL每个轴单独上报, 每个轴500Hz
+Trace circleTrace() {
+    return [](int64_t now_us, GamepadState state) -> std::optional<GamepadState> {
+        if (now_us % 1'000 != 0) {
+            return std::nullopt;
+        }
+        const double angle = 2 * kPi * now_us / 1'000'000.0;
+        if ((now_us / 1'000) % 2 == 0) {
+            state.left_thumb_x = static_cast<int16_t>(30000 * std::cos(angle));
+        }
+        else {
+            state.left_thumb_y = static_cast<int16_t>(30000 * std::sin(angle));
+        }
+        return state;
+    };
+}
+
+// 摇杆放在中间, 传感器噪声在几百以内抖动, 125Hz
+Trace driftTrace() {
+    auto rng = std::make_shared<std::mt19937>(3);
+    return [rng](int64_t now_us, GamepadState state) -> std::optional<GamepadState> {
+        if (now_us % 8'000 != 0) {
+            return std::nullopt;
+        }
+        std::uniform_int_distribution<int32_t> noise{-300, 300};
+        state.left_thumb_x = static_cast<int16_t>(noise(*rng));
+        state.left_thumb_y = static_cast<int16_t>(noise(*rng));
+        return state;
+    };
+}
+
+// 一边推摇杆一边按键扣扳机
+Trace playingTrace(uint32_t seed) {
+    auto rng = std::make_shared<std::mt19937>(seed);
+    return [rng](int64_t now_us, GamepadState state) -> std::optional<GamepadState> {
+        std::uniform_int_distribution<uint32_t> percent{0, 999};
+        std::uniform_int_distribution<int32_t> step{-2000, 2000};
+        const uint32_t roll = percent(*rng);
+        if (roll < 10) {
+            state.buttons ^= 1u << (roll % 16);
+        }
+        else if (roll < 30) {
+            state.right_trigger = static_cast<uint8_t>(percent(*rng) % 256);
+        }
+        else if (roll < 600 && now_us % 2'000 == 0) {
+            auto move = [&](int16_t value) {
+                return static_cast<int16_t>(std::clamp(value + step(*rng), -32767, 32767));
+            };
+            state.right_thumb_x = move(state.right_thumb_x);
+            state.right_thumb_y = move(state.right_thumb_y);
+        }
+        else {
+            return std::nullopt;
+        }
+        return state;
+    };
+}
+
+TEST(GamepadStateTest, ButtonEdgesAreSentImmediately) {
+    GamepadStateEncoder encoder;
+    std::vector<GamepadWire> sent;
+    auto send = [&sent](const GamepadWire& wire, bool) { sent.push_back(wire); };
+    GamepadState state{};
+    state.left_thumb_x = 100;
+    encoder.update(state, 0, send);
+    const size_t first = sent.size();
+    ASSERT_GT(first, 0u);
+    // 间隔内的摇杆变化攒着
+    state.left_thumb_x = 200;
+    encoder.update(state, 1'000, send);
+    EXPECT_EQ(sent.size(), first);
+    ASSERT_TRUE(encoder.nextWakeTime().has_value());
+    EXPECT_EQ(*encoder.nextWakeTime(), 8'000);
+    // 按键马上发, 带上攒着的摇杆
+    state.buttons = kButtonA;
+    encoder.update(state, 2'000, send);
+    ASSERT_GT(sent.size(), first);
+    EXPECT_EQ(sent.back().button_flags, kButtonA);
+    EXPECT_EQ(sent.back().left_stick_x, 200);
+    EXPECT_FALSE(encoder.nextWakeTime().has_value());
+}
+
+TEST(GamepadStateTest, ReconstructsUnderLossAndReordering) {
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        Network net{};
+        net.loss_percent = 30;
+        net.jitter_us = 30'000;
+        net.seed = seed;
+        Stats stats = simulate(playingTrace(seed), 10'000'000, net);
+        EXPECT_GT(stats.acks, 0u) << "seed " << seed;
+        EXPECT_TRUE(stats.converged) << "seed " << seed;
+        EXPECT_EQ(stats.bogus_states, 0u) << "seed " << seed;
+        EXPECT_GT(stats.applied, 0u);
+    }
+}
+
+TEST(GamepadStateTest, SendsFullStatesToLegacyHost) {
+    Network net{};
+    net.legacy_host = true;
+    Stats stats = simulate(playingTrace(9), 10'000'000, net);
+    EXPECT_TRUE(stats.converged);
+    EXPECT_EQ(stats.reliable_messages, stats.messages);
+    EXPECT_EQ(stats.acks, 0u);
+}
+
+TEST(GamepadStateTest, SwitchesFormatWhenHostVersionArrives) {
+    for (uint32_t seed = 1; seed <= 5; seed++) {
+        Network net{};
+        net.loss_percent = 30;
+        net.jitter_us = 30'000;
+        net.seed = seed;
+        // 切换前后, 可靠通道的旧格式和不可靠通道的新格式交错到达
+        net.host_version_us = 1'000'000;
+        Stats stats = simulate(playingTrace(seed), 10'000'000, net);
+        EXPECT_GT(stats.reliable_messages, 0u) << "seed " << seed;
+        EXPECT_LT(stats.reliable_messages, stats.messages) << "seed " << seed;
+        EXPECT_TRUE(stats.converged) << "seed " << seed;
+        EXPECT_EQ(stats.bogus_states, 0u) << "seed " << seed;
+    }
+}
+
+TEST(GamepadStateTest, BytesPerSecondForStickTraces) {
+    constexpr int64_t kDurationUs = 10'000'000;
+    struct Case {
+        const char* name;
+        Trace trace;
+        // 相对每个事件发完整状态, 字节数至少降到这个比例
+        double max_ratio;
+    };
+    // 抖动本来就是125Hz, 只能省在差分上
+    const Case cases[] = {{"circle", circleTrace(), 0.2},
+                          {"drift", driftTrace(), 0.9},
+                          {"playing", playingTrace(5), 0.5}};
+    for (const auto& [name, trace, max_ratio] : cases) {
+        Network net{};
+        net.loss_percent = 2;
+        net.jitter_us = 5'000;
+        Stats stats = simulate(trace, kDurationUs, net);
+        const double seconds = kDurationUs / 1'000'000.0;
+        std::printf("%-8s full state per event: %5.0f msg/s %6.0f B/s | delta: %4.0f msg/s "
+                    "%5.0f B/s, acks %3.0f msg/s %4.0f B/s\n",
+                    name, stats.legacy_messages / seconds, stats.legacy_bytes / seconds,
+                    stats.messages / seconds, stats.bytes / seconds, stats.acks / seconds,
+                    stats.acks_bytes / seconds);
+        EXPECT_TRUE(stats.converged) << name;
+        EXPECT_LT(stats.bytes, stats.legacy_bytes * max_ratio) << name;
+        // 默认最快8ms一条, 加上按键和重发
+        EXPECT_LE(stats.messages / seconds, 150.0) << name;
+    }
+}
+
+} // namespace
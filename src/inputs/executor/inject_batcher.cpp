@@ -0,0 +1,80 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inputs/executor/inject_batcher.h>
+
+#include <utility>
+
+namespace lt {
+
+namespace input {
+
+void InjectBatcher::push(const InjectOp& op) {
+    if (!pending_.ops.empty()) {
+        InjectOp& last = pending_.ops.back();
+        // 只和紧挨着的同类操作合并, 点击之前最后一次移动的位置不会变
+        if (last.kind == op.kind) {
+            switch (op.kind) {
+            case InjectOp::Kind::MoveAbsolute:
+                last.x = op.x;
+                last.y = op.y;
+                pending_.coalesced++;
+                return;
+            case InjectOp::Kind::MoveRelative:
+            case InjectOp::Kind::Wheel:
+                last.x += op.x;
+                last.y += op.y;
+                pending_.coalesced++;
+                return;
+            default:
+                break;
+            }
+        }
+    }
+    pending_.ops.push_back(op);
+}
+
+void InjectBatcher::addStamp(const InjectStamp& stamp) {
+    pending_.stamps.push_back(stamp);
+}
+
+bool InjectBatcher::empty() const {
+    return pending_.ops.empty() && pending_.stamps.empty();
+}
+
+InjectBatcher::Batch InjectBatcher::take() {
+    Batch batch = std::move(pending_);
+    pending_ = Batch{};
+    return batch;
+}
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,90 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+
+#include <vector>
+
+#include <inputs/executor/input_latency.h>
+
+namespace lt {
+
+namespace input {
+
+// 一次要注入的操作, 坐标和按键码已经换算成目标平台的值
+struct InjectOp {
+    enum class Kind : uint8_t {
+        MoveAbsolute,
+        MoveRelative,
+        Button,
+        Wheel,
+        Key,
+    };
+    Kind kind;
+    // MoveAbsolute是屏幕坐标, MoveRelative是位移, Wheel只用y, 单位和MouseEvent::delta_z一样
+    int32_t x = 0;
+    int32_t y = 0;
+    // Button是按钮号, Key是键码
+    uint32_t code = 0;
+    bool down = false;
+};
+
+// 一条输入消息的时间, 注入完成后用来记录延迟
+struct InjectStamp {
+    InputLatencyType type;
+    int64_t client_us;
+    int64_t receive_us;
+};
+
+// 攒一批注入操作, 注入线程每次整批取走. 连续的移动合并成一次, 点击和按键保持原来的顺序,
+// 这样注入慢的时候堆积的移动不会把后面的点击拖慢. 不是线程安全的
+class InjectBatcher {
+public:
+    struct Batch {
+        std::vector<InjectOp> ops;
+        std::vector<InjectStamp> stamps;
+        // 被合并掉的操作个数
+        uint32_t coalesced = 0;
+    };
+
+public:
+    void push(const InjectOp& op);
+    void addStamp(const InjectStamp& stamp);
+    bool empty() const;
+    Batch take();
+
+private:
+    Batch pending_;
+};
+
+} // namespace input
+
+} // namespace lt
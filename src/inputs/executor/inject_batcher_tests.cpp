@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <inputs/executor/inject_batcher.h>
+
+namespace {
+
+using lt::input::InjectBatcher;
+using lt::input::InjectOp;
+using lt::input::InjectStamp;
+using lt::input::InputLatencyType;
+using Kind = lt::input::InjectOp::Kind;
+
+InjectOp move(int32_t x, int32_t y) {
+    return InjectOp{Kind::MoveAbsolute, x, y, 0, false};
+}
+
+InjectOp button(bool down) {
+    return InjectOp{Kind::Button, 0, 0, 1, down};
+}
+
+TEST(InjectBatcherTest, CoalescesMovesBetweenClicks) {
+    InjectBatcher batcher;
+    for (int32_t i = 0; i < 10; i++) {
+        batcher.push(move(i, i * 2));
+    }
+    batcher.push(button(true));
+    batcher.push(InjectOp{Kind::MoveRelative, 3, -1, 0, false});
+    batcher.push(InjectOp{Kind::MoveRelative, 4, -2, 0, false});
+    batcher.push(button(false));
+    batcher.push(InjectOp{Kind::Wheel, 0, 120, 0, false});
+    batcher.push(InjectOp{Kind::Wheel, 0, 120, 0, false});
+    batcher.push(InjectOp{Kind::Key, 0, 0, 38, true});
+    batcher.push(InjectOp{Kind::Key, 0, 0, 38, false});
+    batcher.addStamp(InjectStamp{InputLatencyType::Keyboard, 1, 2});
+    ASSERT_FALSE(batcher.empty());
+
+    auto batch = batcher.take();
+    EXPECT_TRUE(batcher.empty());
+    ASSERT_EQ(batch.ops.size(), 7u);
+    EXPECT_EQ(batch.coalesced, 11u);
+    // 点击的位置是它之前最后一次移动的位置
+    EXPECT_EQ(batch.ops[0].kind, Kind::MoveAbsolute);
+    EXPECT_EQ(batch.ops[0].x, 9);
+    EXPECT_EQ(batch.ops[0].y, 18);
+    EXPECT_EQ(batch.ops[1].kind, Kind::Button);
+    EXPECT_TRUE(batch.ops[1].down);
+    EXPECT_EQ(batch.ops[2].kind, Kind::MoveRelative);
+    EXPECT_EQ(batch.ops[2].x, 7);
+    EXPECT_EQ(batch.ops[2].y, -3);
+    EXPECT_EQ(batch.ops[3].kind, Kind::Button);
+    EXPECT_FALSE(batch.ops[3].down);
+    EXPECT_EQ(batch.ops[4].kind, Kind::Wheel);
+    EXPECT_EQ(batch.ops[4].y, 240);
+    // 按键不合并
+    EXPECT_EQ(batch.ops[5].kind, Kind::Key);
+    EXPECT_TRUE(batch.ops[5].down);
+    EXPECT_EQ(batch.ops[6].kind, Kind::Key);
+    EXPECT_FALSE(batch.ops[6].down);
+    ASSERT_EQ(batch.stamps.size(), 1u);
+    EXPECT_EQ(batch.stamps[0].receive_us, 2);
+}
+
+struct ClickLatency {
+    int64_t max_us = 0;
+    int64_t total_us = 0;
+    size_t clicks = 0;
+    size_t injected_ops = 0;
+};
+
+// 2kHz的鼠标移动, 每50ms一次点击, 注入一个操作要1ms, 注入跟不上输入.
+// coalesce为false时每条消息单独注入
+ClickLatency simulate(bool coalesce) {
+    constexpr int64_t kInputIntervalUs = 500;
+    constexpr int64_t kInjectCostUs = 1'000;
+    constexpr int64_t kClickIntervalUs = 50'000;
+    constexpr int64_t kDurationUs = 1'000'000;
+    struct Pending {
+        InjectOp op;
+        int64_t receive_us;
+    };
+    std::deque<Pending> arrived;
+    for (int64_t now = 0; now < kDurationUs; now += kInputIntervalUs) {
+        if (now % kClickIntervalUs == 0) {
+            arrived.push_back({button(true), now});
+        }
+        else {
+            arrived.push_back({move(static_cast<int32_t>(now / 1000), 0), now});
+        }
+    }
+
+    ClickLatency result;
+    int64_t now = 0;
+    while (!arrived.empty()) {
+        InjectBatcher batcher;
+        std::vector<int64_t> click_receive_us;
+        // 注入线程空闲时把已经到达的消息一次取走
+        now = std::max(now, arrived.front().receive_us);
+        while (!arrived.empty() && arrived.front().receive_us <= now) {
+            if (arrived.front().op.kind == Kind::Button) {
+                click_receive_us.push_back(arrived.front().receive_us);
+            }
+            batcher.push(arrived.front().op);
+            arrived.pop_front();
+            if (!coalesce) {
+                break;
+            }
+        }
+        auto batch = batcher.take();
+        for (const auto& op : batch.ops) {
+            now += kInjectCostUs;
+            result.injected_ops++;
+            if (op.kind == Kind::Button) {
+                const int64_t latency_us = now - click_receive_us.front();
+                click_receive_us.erase(click_receive_us.begin());
+                result.max_us = std::max(result.max_us, latency_us);
+                result.total_us += latency_us;
+                result.clicks++;
+            }
+        }
+    }
+    return result;
+}
+
+TEST(InjectBatcherTest, BacklogOfMovesDoesNotDelayClicks) {
+    const ClickLatency serial = simulate(false);
+    const ClickLatency coalesced = simulate(true);
+    std::printf("serial:    %zu ops injected, click latency avg %.1fms max %.1fms\n",
+                serial.injected_ops, serial.total_us / 1000.0 / serial.clicks,
+                serial.max_us / 1000.0);
+    std::printf("coalesced: %zu ops injected, click latency avg %.1fms max %.1fms\n",
+                coalesced.injected_ops, coalesced.total_us / 1000.0 / coalesced.clicks,
+                coalesced.max_us / 1000.0);
+    ASSERT_EQ(serial.clicks, 20u);
+    ASSERT_EQ(coalesced.clicks, 20u);
+    // 逐条注入的积压越来越多, 最后一次点击要等将近一秒
+    EXPECT_GT(serial.max_us, 500'000);
+    // 合并后每批最多一次移动加一次点击
+    EXPECT_LE(coalesced.max_us, 3'000);
+    // 注入速度只有输入的一半, 合并之后两条消息只注入一次
+    EXPECT_LE(coalesced.injected_ops, serial.injected_ops / 2 + 1);
+}
+
+} // namespace
@@ -28,25 +28,38 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#if defined(LT_WINDOWS)
 #include <Windows.h>
+#endif // LT_WINDOWS
 
 #include "input_executor.h"
 
+#if defined(LT_WINDOWS)
 #include <Xinput.h>
 
 #include <ViGEm/Common.h>
+#endif // LT_WINDOWS
 #include <ltlib/logging.h>
+#include <ltlib/times.h>
 
 #include <ltproto/client2worker/controller_added_removed.pb.h>
 #include <ltproto/client2worker/controller_response.pb.h>
 #include <ltproto/client2worker/controller_status.pb.h>
+#include <ltproto/client2worker/gamepad_ack.pb.h>
+#include <ltproto/client2worker/input_latency_report.pb.h>
+#include <ltproto/client2worker/keyboard_event.pb.h>
+#include <ltproto/client2worker/mouse_event.pb.h>
 #include <ltproto/client2worker/switch_mouse_mode.pb.h>
 #include <ltproto/client2worker/touch_event.pb.h>
 #include <ltproto/ltproto.h>
 
+#if defined(LT_WINDOWS)
 #include <inputs/executor/gamepad.h>
 #include <inputs/executor/win_send_input.h>
 #include <inputs/executor/win_touch_input.h>
+#elif defined(LT_LINUX)
+#include <inputs/executor/x11_xtest_input.h>
+#endif // LT_WINDOWS
 
 namespace lt {
 
@@ -57,12 +70,15 @@ namespace {
 enum class BackendType : uint8_t {
     WIN32_MESSAGE = 1,
     WIN32_DRIVER = 2,
+    X11_XTEST = 4,
 };
 
 uint8_t defaultInputTypes() {
 #if defined(LT_WINDOWS)
     return static_cast<uint8_t>(BackendType::WIN32_MESSAGE) |
            static_cast<uint8_t>(BackendType::WIN32_DRIVER);
+#elif defined(LT_LINUX)
+    return static_cast<uint8_t>(BackendType::X11_XTEST);
 #else
     return 0;
 #endif
@@ -76,26 +92,53 @@ std::unique_ptr<Executor> Executor::create(const Params& params) {
     }
     const uint8_t input_types = defaultInputTypes();
     std::unique_ptr<Executor> input;
+#if defined(LT_WINDOWS)
     if (input_types & static_cast<uint8_t>(BackendType::WIN32_MESSAGE)) {
         input = std::make_unique<Win32SendInput>(params.screen_width, params.screen_height,
                                                  params.monitor);
     }
-    else {
+#elif defined(LT_LINUX)
+    if (input_types & static_cast<uint8_t>(BackendType::X11_XTEST)) {
+        input = std::make_unique<XTestInput>(params.screen_width, params.screen_height,
+                                             params.monitor);
+    }
+#endif // LT_WINDOWS
+    if (input == nullptr) {
         return nullptr;
     }
     input->register_message_handler_ = params.register_message_handler;
     input->send_message_ = params.send_message;
+    input->report_input_latency_ = params.report_input_latency;
     if (!input->init()) {
         return nullptr;
     }
+#if defined(LT_WINDOWS)
     input->touch_ = WinTouch::create(params.screen_width, params.screen_height, params.monitor);
+#endif // LT_WINDOWS
     return input;
 }
 
+Executor::~Executor() {
+    // worker进程只服务一个会话, 退出时打印整个会话的输入延迟
+    std::lock_guard lk{latency_mutex_};
+    for (const auto& stat : latency_.sessionStats()) {
+        LOG(INFO) << "Input latency " << toString(stat.type) << ": samples " << stat.samples
+                  << ", receive p50/p95/p99 " << stat.receive_us[0] << "/" << stat.receive_us[1]
+                  << "/" << stat.receive_us[2] << "us, inject " << stat.inject_us[0] << "/"
+                  << stat.inject_us[1] << "/" << stat.inject_us[2] << "us";
+    }
+}
+
 void Executor::update() {
+#if defined(LT_WINDOWS)
     if (touch_) {
         touch_->update();
     }
+#endif // LT_WINDOWS
+    sendInputLatency();
+    // 客户端停止发送后, 最后一次的确认也要发出去
+    std::lock_guard lk{gamepad_mutex_};
+    sendGamepadAcks();
 }
 
 bool Executor::init() {
@@ -105,8 +148,10 @@ bool Executor::init() {
     if (!initKeyMouse()) {
         return false;
     }
+#if defined(LT_WINDOWS)
     gamepad_ = Gamepad::create(std::bind(&Executor::onGamepadResponse, this, std::placeholders::_1,
                                          std::placeholders::_2, std::placeholders::_3));
+#endif // LT_WINDOWS
     return true;
 }
 
@@ -114,8 +159,8 @@ bool Executor::registerHandlers() {
     namespace ltype = ltproto::type;
     namespace ph = std::placeholders;
     const std::pair<uint32_t, MessageHandler> handlers[] = {
-        {ltype::kMouseEvent, std::bind(&Executor::onMouseEvent, this, ph::_1)},
-        {ltype::kKeyboardEvent, std::bind(&Executor::onKeyboardEvent, this, ph::_1)},
+        {ltype::kMouseEvent, std::bind(&Executor::handleMouseEvent, this, ph::_1)},
+        {ltype::kKeyboardEvent, std::bind(&Executor::handleKeyboardEvent, this, ph::_1)},
         {ltype::kControllerAddedRemoved,
          std::bind(&Executor::onControllerAddedRemoved, this, ph::_1)},
         {ltype::kControllerStatus, std::bind(&Executor::onControllerStatus, this, ph::_1)},
@@ -134,6 +179,64 @@ void Executor::sendMessage(uint32_t type,
     send_message_(type, msg);
 }
 
+void Executor::handleMouseEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+    const int64_t receive_us = ltlib::steady_now_us();
+    onMouseEvent(msg);
+    if (injectAsync()) {
+        return;
+    }
+    const int64_t inject_us = ltlib::steady_now_us();
+    auto mouse = std::static_pointer_cast<ltproto::client2worker::MouseEvent>(msg);
+    InputLatencyType type = InputLatencyType::MouseMove;
+    if (mouse->has_key_falg()) {
+        type = InputLatencyType::MouseButton;
+    }
+    else if (mouse->has_delta_z()) {
+        type = InputLatencyType::MouseWheel;
+    }
+    // service已经把client_send_timestamp_us换算成本机时钟
+    recordInputLatency(type, mouse->client_send_timestamp_us(), receive_us, inject_us);
+}
+
+void Executor::handleKeyboardEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+    const int64_t receive_us = ltlib::steady_now_us();
+    onKeyboardEvent(msg);
+    if (injectAsync()) {
+        return;
+    }
+    const int64_t inject_us = ltlib::steady_now_us();
+    auto keyboard = std::static_pointer_cast<ltproto::client2worker::KeyboardEvent>(msg);
+    recordInputLatency(InputLatencyType::Keyboard, keyboard->client_send_timestamp_us(),
+                       receive_us, inject_us);
+}
+
+void Executor::recordInputLatency(InputLatencyType type, int64_t client_us, int64_t receive_us,
+                                  int64_t inject_us) {
+    std::lock_guard lk{latency_mutex_};
+    latency_.record(type, client_us, receive_us, inject_us);
+}
+
+void Executor::sendInputLatency() {
+    std::vector<InputLatencyStat> stats;
+    {
+        std::lock_guard lk{latency_mutex_};
+        stats = latency_.poll(ltlib::steady_now_us());
+    }
+    if (!report_input_latency_) {
+        return;
+    }
+    for (const auto& stat : stats) {
+        auto report = std::make_shared<ltproto::client2worker::InputLatencyReport>();
+        report->set_input_type(static_cast<uint32_t>(stat.type));
+        report->set_samples(stat.samples);
+        for (size_t i = 0; i < stat.receive_us.size(); i++) {
+            report->add_receive_us(stat.receive_us[i]);
+            report->add_inject_us(stat.inject_us[i]);
+        }
+        sendMessage(ltproto::id(report), report);
+    }
+}
+
 void Executor::onSwitchMouseMode(const std::shared_ptr<google::protobuf::MessageLite>& _msg) {
     auto msg = std::static_pointer_cast<ltproto::client2worker::SwitchMouseMode>(_msg);
     std::lock_guard lk{mutex_};
@@ -146,19 +249,29 @@ bool Executor::isAbsoluteMouse() {
 }
 
 void Executor::onControllerAddedRemoved(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+#if defined(LT_WINDOWS)
     if (gamepad_ == nullptr) {
         return;
     }
     auto controller = std::static_pointer_cast<ltproto::client2worker::ControllerAddedRemoved>(msg);
+    {
+        std::lock_guard lk{gamepad_mutex_};
+        gamepad_decoder_.reset(controller->index());
+    }
     if (controller->is_added()) {
         gamepad_->plugin(controller->index());
     }
     else {
         gamepad_->plugout(controller->index());
     }
+#else
+    // 只有Windows有虚拟手柄
+    (void)msg;
+#endif // LT_WINDOWS
 }
 
 void Executor::onControllerStatus(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+#if defined(LT_WINDOWS)
     if (gamepad_ == nullptr) {
         return;
     }
@@ -167,15 +280,51 @@ void Executor::onControllerStatus(const std::shared_ptr<google::protobuf::Messag
         LOG(ERR) << "Gamepad index exceed limit: " << controller->gamepad_index();
         return;
     }
+    GamepadWire wire{};
+    wire.gamepad_index = controller->gamepad_index();
+    if (controller->has_sequence()) {
+        wire.sequence = static_cast<uint16_t>(controller->sequence());
+    }
+    wire.base_distance = controller->base_distance();
+    wire.button_flags = controller->button_flags();
+    wire.left_stick_x = controller->left_stick_x();
+    wire.left_stick_y = controller->left_stick_y();
+    wire.right_stick_x = controller->right_stick_x();
+    wire.right_stick_y = controller->right_stick_y();
+    wire.left_trigger = controller->left_trigger();
+    wire.right_trigger = controller->right_trigger();
+    std::optional<GamepadStateDecoder::Decoded> decoded;
+    {
+        std::lock_guard lk{gamepad_mutex_};
+        decoded = gamepad_decoder_.decode(wire);
+        sendGamepadAcks();
+    }
+    if (!decoded.has_value()) {
+        return;
+    }
+    const GamepadState& state = decoded->state;
     XUSB_REPORT gamepad_report{};
-    gamepad_report.wButtons = static_cast<USHORT>(controller->button_flags());
-    gamepad_report.bLeftTrigger = static_cast<BYTE>(controller->left_trigger()); // 0-255
-    gamepad_report.bRightTrigger = static_cast<BYTE>(controller->right_trigger());
-    gamepad_report.sThumbLX = static_cast<USHORT>(controller->left_stick_x()); //-32768~ 32767
-    gamepad_report.sThumbLY = static_cast<USHORT>(controller->left_stick_y());
-    gamepad_report.sThumbRX = static_cast<USHORT>(controller->right_stick_x());
-    gamepad_report.sThumbRY = static_cast<USHORT>(controller->right_stick_y());
-    gamepad_->submit(controller->gamepad_index(), gamepad_report);
+    gamepad_report.wButtons = static_cast<USHORT>(state.buttons);
+    gamepad_report.bLeftTrigger = static_cast<BYTE>(state.left_trigger); // 0-255
+    gamepad_report.bRightTrigger = static_cast<BYTE>(state.right_trigger);
+    gamepad_report.sThumbLX = static_cast<USHORT>(state.left_thumb_x); //-32768~ 32767
+    gamepad_report.sThumbLY = static_cast<USHORT>(state.left_thumb_y);
+    gamepad_report.sThumbRX = static_cast<USHORT>(state.right_thumb_x);
+    gamepad_report.sThumbRY = static_cast<USHORT>(state.right_thumb_y);
+    gamepad_->submit(decoded->index, gamepad_report);
+#else
+    (void)msg;
+#endif // LT_WINDOWS
+}
+
+void Executor::sendGamepadAcks() {
+    auto send_ack = [this](uint32_t gamepad_index, uint16_t sequence) {
+        auto ack = std::make_shared<ltproto::client2worker::GamepadAck>();
+        ack->set_gamepad_index(gamepad_index);
+        ack->set_sequence(sequence);
+        sendMessage(ltproto::id(ack), ack);
+    };
+    gamepad_decoder_.pollAcks(ltlib::steady_now_us(), send_ack);
 }
 
 void Executor::onGamepadResponse(uint32_t index, uint16_t large_motor, uint16_t small_motor) {
@@ -187,9 +336,13 @@ void Executor::onGamepadResponse(uint32_t index, uint16_t large_motor, uint16_t
 }
 
 void Executor::onTouchEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+#if defined(LT_WINDOWS)
     if (touch_ != nullptr) {
         touch_->submit(msg);
     }
+#else
+    (void)msg;
+#endif // LT_WINDOWS
 }
 
 } // namespace input
@@ -38,6 +38,8 @@
 
 #include <google/protobuf/message_lite.h>
 
+#include <inputs/executor/gamepad_state.h>
+#include <inputs/executor/input_latency.h>
 #include <ltlib/system.h>
 #include <message_handler.h>
 
@@ -57,12 +59,14 @@ public:
         std::function<bool(uint32_t, const MessageHandler&)> register_message_handler;
         std::function<bool(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&)>
             send_message;
+        // 旧版本客户端不认识InputLatencyReport, 不给它发
+        bool report_input_latency = true;
     };
 
 public:
     static std::unique_ptr<Executor> create(const Params& params);
     void update();
-    virtual ~Executor() = default;
+    virtual ~Executor();
 
 protected:
     virtual bool initKeyMouse() = 0;
@@ -71,14 +75,24 @@ protected:
 
     void sendMessage(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>& msg);
     bool isAbsoluteMouse();
+    // 放到别的线程注入的子类返回true, 注入完成后自己调用recordInputLatency()
+    virtual bool injectAsync() const { return false; }
+    void recordInputLatency(InputLatencyType type, int64_t client_us, int64_t receive_us,
+                            int64_t inject_us);
 
 private:
     bool init();
     bool registerHandlers();
+    // 包一层onMouseEvent()/onKeyboardEvent(), 记录收到和注入完成的时间
+    void handleMouseEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg);
+    void handleKeyboardEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg);
+    void sendInputLatency();
     void onControllerAddedRemoved(const std::shared_ptr<google::protobuf::MessageLite>& msg);
     void onControllerStatus(const std::shared_ptr<google::protobuf::MessageLite>& msg);
     void onSwitchMouseMode(const std::shared_ptr<google::protobuf::MessageLite>& msg);
     void onGamepadResponse(uint32_t index, uint16_t large_motor, uint16_t small_motor);
+    // 调用前要持有gamepad_mutex_
+    void sendGamepadAcks();
     void onTouchEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg);
 
 private:
@@ -88,6 +102,11 @@ private:
     std::mutex mutex_;
     bool is_absolute_mouse_ = true;
     std::shared_ptr<Gamepad> gamepad_;
+    std::mutex gamepad_mutex_;
+    GamepadStateDecoder gamepad_decoder_;
+    std::mutex latency_mutex_;
+    InputLatencyRecorder latency_;
+    bool report_input_latency_ = true;
     std::shared_ptr<WinTouch> touch_;
 };
 
@@ -0,0 +1,186 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <inputs/executor/input_latency.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr std::array<uint32_t, 3> kPercentiles = {50, 95, 99};
+// 会话统计的直方图, 0.5ms一个桶, 最后一个桶装500ms以上的
+constexpr int64_t kBucketUs = 500;
+constexpr size_t kBuckets = 1000;
+
+// nearest-rank, sorted不能为空
+int64_t percentile(const std::vector<int64_t>& sorted, uint32_t pct) {
+    const size_t rank = (sorted.size() * pct + 99) / 100;
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+int64_t percentile(const std::vector<uint32_t>& buckets, uint64_t count, uint32_t pct) {
+    const uint64_t rank = std::max<uint64_t>((count * pct + 99) / 100, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return static_cast<int64_t>(i) * kBucketUs + kBucketUs / 2;
+        }
+    }
+    return static_cast<int64_t>(buckets.size()) * kBucketUs;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace input {
+
+const char* toString(InputLatencyType type) {
+    switch (type) {
+    case InputLatencyType::MouseMove:
+        return "mouse_move";
+    case InputLatencyType::MouseButton:
+        return "mouse_button";
+    case InputLatencyType::MouseWheel:
+        return "mouse_wheel";
+    case InputLatencyType::Keyboard:
+        return "keyboard";
+    default:
+        return "unknown";
+    }
+}
+
+InputLatencyRecorder::InputLatencyRecorder()
+    : InputLatencyRecorder{Params{}} {}
+
+InputLatencyRecorder::InputLatencyRecorder(const Params& params)
+    : params_{params} {
+    for (size_t i = 0; i < kInputLatencyTypes; i++) {
+        session_receive_[i].buckets.resize(kBuckets);
+        session_inject_[i].buckets.resize(kBuckets);
+    }
+}
+
+void InputLatencyRecorder::record(InputLatencyType type, int64_t client_us, int64_t receive_us,
+                                  int64_t inject_us) {
+    const auto index = static_cast<size_t>(type);
+    if (client_us == 0 || index >= kInputLatencyTypes) {
+        return;
+    }
+    // 时钟对齐有误差, 延迟很小时可能算出负数
+    const Sample sample{std::max<int64_t>(receive_us - client_us, 0),
+                        std::max<int64_t>(inject_us - client_us, 0)};
+    auto add_to = [](Histogram& histogram, int64_t us) {
+        const auto bucket = std::min(static_cast<size_t>(us / kBucketUs), kBuckets - 1);
+        histogram.buckets[bucket]++;
+        histogram.count++;
+    };
+    add_to(session_receive_[index], sample.receive_us);
+    add_to(session_inject_[index], sample.inject_us);
+
+    Window& window = windows_[index];
+    window.seen++;
+    if (window.samples.size() < params_.max_window_samples) {
+        window.samples.push_back(sample);
+        return;
+    }
+    // 蓄水池抽样, 周期内每个输入被留下的概率相同
+    std::uniform_int_distribution<uint64_t> pick{0, window.seen - 1};
+    const uint64_t slot = pick(rng_);
+    if (slot < window.samples.size()) {
+        window.samples[slot] = sample;
+    }
+}
+
+std::vector<InputLatencyStat> InputLatencyRecorder::poll(int64_t now_us) {
+    if (!window_start_us_.has_value()) {
+        window_start_us_ = now_us;
+    }
+    if (now_us - *window_start_us_ < params_.report_interval_us) {
+        return {};
+    }
+    window_start_us_ = now_us;
+    std::vector<InputLatencyStat> stats;
+    std::vector<int64_t> receive;
+    std::vector<int64_t> inject;
+    for (size_t i = 0; i < kInputLatencyTypes; i++) {
+        Window& window = windows_[i];
+        if (window.samples.empty()) {
+            continue;
+        }
+        receive.clear();
+        inject.clear();
+        for (const auto& sample : window.samples) {
+            receive.push_back(sample.receive_us);
+            inject.push_back(sample.inject_us);
+        }
+        std::sort(receive.begin(), receive.end());
+        std::sort(inject.begin(), inject.end());
+        InputLatencyStat stat{};
+        stat.type = static_cast<InputLatencyType>(i);
+        stat.samples = static_cast<uint32_t>(
+            std::min<uint64_t>(window.seen, std::numeric_limits<uint32_t>::max()));
+        for (size_t j = 0; j < kPercentiles.size(); j++) {
+            stat.receive_us[j] = percentile(receive, kPercentiles[j]);
+            stat.inject_us[j] = percentile(inject, kPercentiles[j]);
+        }
+        stats.push_back(stat);
+        window.samples.clear();
+        window.seen = 0;
+    }
+    return stats;
+}
+
+std::vector<InputLatencyStat> InputLatencyRecorder::sessionStats() const {
+    std::vector<InputLatencyStat> stats;
+    for (size_t i = 0; i < kInputLatencyTypes; i++) {
+        const Histogram& receive = session_receive_[i];
+        const Histogram& inject = session_inject_[i];
+        if (inject.count == 0) {
+            continue;
+        }
+        InputLatencyStat stat{};
+        stat.type = static_cast<InputLatencyType>(i);
+        stat.samples = static_cast<uint32_t>(
+            std::min<uint64_t>(inject.count, std::numeric_limits<uint32_t>::max()));
+        for (size_t j = 0; j < kPercentiles.size(); j++) {
+            stat.receive_us[j] = percentile(receive.buckets, receive.count, kPercentiles[j]);
+            stat.inject_us[j] = percentile(inject.buckets, inject.count, kPercentiles[j]);
+        }
+        stats.push_back(stat);
+    }
+    return stats;
+}
+
+} // namespace input
+
+} // namespace lt
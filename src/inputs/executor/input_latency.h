@@ -0,0 +1,112 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <ltlib/versions.h>
+
+namespace lt {
+
+namespace input {
+
+enum class InputLatencyType : uint32_t {
+    MouseMove = 0,
+    MouseButton = 1,
+    MouseWheel = 2,
+    Keyboard = 3,
+};
+
+constexpr uint32_t kInputLatencyTypes = 4;
+// 从这个版本开始客户端才认识InputLatencyReport
+constexpr int64_t kInputLatencyReportMinClientVersion = ltlib::combineVersion(0, 4, 3);
+
+const char* toString(InputLatencyType type);
+
+struct InputLatencyStat {
+    InputLatencyType type = InputLatencyType::MouseMove;
+    uint32_t samples = 0;
+    // 依次是p50, p95, p99. receive是客户端产生输入到主机收到, inject是到注入完成.
+    // 每个周期每类输入用一条InputLatencyReport回给客户端
+    std::array<int64_t, 3> receive_us{};
+    std::array<int64_t, 3> inject_us{};
+};
+
+// 主机, 记录每个输入从客户端产生到主机收到, 注入完成的时间, 按周期算百分位.
+// 时间都是主机时钟, 客户端的时间戳要先用TimeSync换算. 不读时钟, 不加锁.
+class InputLatencyRecorder {
+public:
+    struct Params {
+        int64_t report_interval_us = 1'000'000;
+        // 每个周期每类输入最多留多少样本, 再多就随机替换
+        size_t max_window_samples = 1024;
+    };
+
+public:
+    InputLatencyRecorder();
+    explicit InputLatencyRecorder(const Params& params);
+    // client_us为0表示时钟还没对齐, 丢掉
+    void record(InputLatencyType type, int64_t client_us, int64_t receive_us, int64_t inject_us);
+    // 满一个周期时返回这个周期里有输入的各类统计
+    std::vector<InputLatencyStat> poll(int64_t now_us);
+    // 整个会话的统计, 精度是直方图的桶宽
+    std::vector<InputLatencyStat> sessionStats() const;
+
+private:
+    struct Sample {
+        int64_t receive_us;
+        int64_t inject_us;
+    };
+    struct Window {
+        std::vector<Sample> samples;
+        uint64_t seen = 0;
+    };
+    struct Histogram {
+        std::vector<uint32_t> buckets;
+        uint64_t count = 0;
+    };
+
+private:
+    const Params params_;
+    std::array<Window, kInputLatencyTypes> windows_;
+    std::array<Histogram, kInputLatencyTypes> session_receive_;
+    std::array<Histogram, kInputLatencyTypes> session_inject_;
+    std::optional<int64_t> window_start_us_;
+    std::mt19937 rng_;
+};
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <inputs/executor/input_latency.h>
+#include <ltlib/time_sync.h>
+
+namespace {
+
+using lt::input::InputLatencyRecorder;
+using lt::input::InputLatencyStat;
+using lt::input::InputLatencyType;
+
+constexpr int64_t kStepUs = 100;
+// 两台机器的steady clock起点不同
+constexpr int64_t kClientClockOffsetUs = 3'600'000'000;
+constexpr int64_t kOneWayDelayUs = 15'000;
+constexpr int64_t kJitterUs = 4'000;
+
+struct Injected {
+    InputLatencyType type;
+    // 主机收到之后多久注入完成
+    int64_t inject_delay_us;
+    // 客户端每隔多久产生一个
+    int64_t period_us;
+};
+
+constexpr std::array<Injected, 4> kInputs = {{
+    {InputLatencyType::MouseMove, 200, 4'000},
+    {InputLatencyType::MouseButton, 500, 200'000},
+    {InputLatencyType::MouseWheel, 300, 500'000},
+    {InputLatencyType::Keyboard, 1'000, 100'000},
+}};
+
+struct InFlight {
+    int64_t arrive_us;
+    InputLatencyType type;
+    int64_t client_us;
+};
+
+int64_t injectDelay(InputLatencyType type) {
+    for (const auto& injected : kInputs) {
+        if (injected.type == type) {
+            return injected.inject_delay_us;
+        }
+    }
+    return 0;
+}
+
+// nearest-rank
+int64_t percentile(std::vector<int64_t> values, uint32_t pct) {
+    std::sort(values.begin(), values.end());
+    const size_t rank = std::max<size_t>((values.size() * pct + 99) / 100, 1);
+    return values[rank - 1];
+}
+
+// 假的执行端: 收到后等固定的时间算注入完成
+class FakeExecutor {
+public:
+    void onInput(const InFlight& input, int64_t host_client_us, int64_t now_us) {
+        recorder_.record(input.type, host_client_us, now_us, now_us + injectDelay(input.type));
+    }
+    // 对应Executor::update(), 每个统计是一条InputLatencyReport
+    std::vector<InputLatencyStat> update(int64_t now_us) { return recorder_.poll(now_us); }
+    std::vector<InputLatencyStat> sessionStats() const { return recorder_.sessionStats(); }
+
+private:
+    InputLatencyRecorder recorder_;
+};
+
+// 客户端 -> 有延迟的网络 -> 服务按TimeSync换算时间戳 -> 假执行端 -> 统计回到客户端
+TEST(InputLatencyTest, LoopbackMatchesInjectedDelay) {
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<int64_t> jitter{0, kJitterUs};
+    ltlib::TimeSync client_sync;
+    ltlib::TimeSync host_sync;
+    std::optional<int64_t> host_time_diff;
+    FakeExecutor executor;
+    std::map<InputLatencyType, uint32_t> reports;
+    // 这个统计周期里每个输入真实的网络延迟
+    std::map<InputLatencyType, std::vector<int64_t>> actual_us;
+    std::deque<InFlight> inputs;
+
+    constexpr int64_t kDurationUs = 5'000'000;
+    for (int64_t host_us = 1; host_us < kDurationUs; host_us += kStepUs) {
+        const int64_t client_us = host_us + kClientClockOffsetUs;
+        // 双方每500ms互发一次TimeSync, 时间同步消息的单程延迟固定
+        if (host_us % 500'000 == 1) {
+            const int64_t t1 = client_us + kOneWayDelayUs;
+            client_sync.calc(host_sync.getT0(), host_sync.getT1(), host_us, t1);
+            auto result = host_sync.calc(client_sync.getT0(), client_sync.getT1(),
+                                         t1 + kStepUs, host_us + 2 * kOneWayDelayUs + kStepUs);
+            if (result.has_value()) {
+                host_time_diff = result->time_diff;
+            }
+        }
+        for (const auto& injected : kInputs) {
+            if (host_us % injected.period_us == 1) {
+                inputs.push_back({host_us + kOneWayDelayUs + jitter(rng), injected.type,
+                                  client_us});
+            }
+        }
+        std::sort(inputs.begin(), inputs.end(), [](const InFlight& a, const InFlight& b) {
+            return a.arrive_us < b.arrive_us;
+        });
+        while (!inputs.empty() && inputs.front().arrive_us <= host_us) {
+            const InFlight& input = inputs.front();
+            // WorkerSession把客户端时间戳换算成主机时钟, 没对齐之前填0
+            const int64_t host_client_us =
+                host_time_diff.has_value() ? input.client_us + *host_time_diff : 0;
+            executor.onInput(input, host_client_us, host_us);
+            if (host_time_diff.has_value()) {
+                actual_us[input.type].push_back(host_us - (input.client_us - kClientClockOffsetUs));
+            }
+            inputs.pop_front();
+        }
+        if (host_us % 100'000 == 1) {
+            for (const auto& stat : executor.update(host_us)) {
+                // 客户端收到的百分位和真实延迟算出来的一致
+                auto& actual = actual_us[stat.type];
+                ASSERT_EQ(stat.samples, actual.size());
+                const int64_t inject_delay_us = injectDelay(stat.type);
+                const uint32_t pcts[] = {50, 95, 99};
+                for (size_t j = 0; j < 3; j++) {
+                    EXPECT_EQ(stat.receive_us[j], percentile(actual, pcts[j]));
+                    EXPECT_EQ(stat.inject_us[j], percentile(actual, pcts[j]) + inject_delay_us);
+                }
+                actual.clear();
+                reports[stat.type]++;
+            }
+        }
+    }
+
+    ASSERT_TRUE(host_time_diff.has_value());
+    EXPECT_EQ(*host_time_diff, -kClientClockOffsetUs);
+    ASSERT_EQ(reports.size(), kInputs.size());
+    auto session = executor.sessionStats();
+    ASSERT_EQ(session.size(), kInputs.size());
+    for (size_t i = 0; i < kInputs.size(); i++) {
+        const Injected& injected = kInputs[i];
+        const InputLatencyStat& stat = session[i];
+        std::printf("%-12s %4u samples, receive p50/p95/p99 %.2f/%.2f/%.2fms, "
+                    "inject %.2f/%.2f/%.2fms\n",
+                    lt::input::toString(injected.type), stat.samples, stat.receive_us[0] / 1e3,
+                    stat.receive_us[1] / 1e3, stat.receive_us[2] / 1e3, stat.inject_us[0] / 1e3,
+                    stat.inject_us[1] / 1e3, stat.inject_us[2] / 1e3);
+        EXPECT_EQ(stat.type, injected.type);
+        EXPECT_GE(stat.samples, kDurationUs / injected.period_us - 5);
+        EXPECT_GE(reports[injected.type], 4u);
+    }
+    // 鼠标移动样本够多, 会话统计符合均匀抖动, 精度是0.5ms的桶宽
+    const InputLatencyStat& moves = session[0];
+    EXPECT_NEAR(moves.receive_us[0], kOneWayDelayUs + kJitterUs * 50 / 100, 500);
+    EXPECT_NEAR(moves.receive_us[1], kOneWayDelayUs + kJitterUs * 95 / 100, 500);
+    EXPECT_NEAR(moves.receive_us[2], kOneWayDelayUs + kJitterUs * 99 / 100, 500);
+    EXPECT_NEAR(moves.inject_us[2] - moves.receive_us[2], injectDelay(moves.type), 500);
+}
+
+TEST(InputLatencyTest, SamplesLargeWindows) {
+    InputLatencyRecorder::Params params{};
+    params.max_window_samples = 512;
+    InputLatencyRecorder recorder{params};
+    EXPECT_TRUE(recorder.poll(0).empty());
+    std::mt19937 rng{3};
+    std::uniform_int_distribution<int64_t> latency{0, 9'999};
+    for (int i = 0; i < 20'000; i++) {
+        const int64_t client_us = 1'000'000 + i;
+        const int64_t receive_us = client_us + latency(rng);
+        recorder.record(InputLatencyType::MouseMove, client_us, receive_us, receive_us);
+    }
+    // 没对齐时钟的样本不算
+    recorder.record(InputLatencyType::Keyboard, 0, 5, 5);
+    EXPECT_TRUE(recorder.poll(999'999).empty());
+    auto stats = recorder.poll(1'000'000);
+    ASSERT_EQ(stats.size(), 1u);
+    EXPECT_EQ(stats[0].samples, 20'000u);
+    EXPECT_NEAR(stats[0].receive_us[0], 5'000, 600);
+    EXPECT_NEAR(stats[0].receive_us[1], 9'500, 300);
+    EXPECT_NEAR(stats[0].receive_us[2], 9'900, 150);
+    // 新周期重新开始
+    EXPECT_TRUE(recorder.poll(2'000'000).empty());
+}
+
+} // namespace
@@ -0,0 +1,307 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "x11_xtest_input.h"
+#include "scancode.h"
+
+#include <X11/Xlib.h>
+
+#include <array>
+#include <cstdlib>
+
+#include <ltproto/client2worker/keyboard_event.pb.h>
+#include <ltproto/client2worker/mouse_event.pb.h>
+
+#include <ltlib/logging.h>
+#include <ltlib/times.h>
+
+namespace {
+
+// 和Linux的hid-input.c一致, 下标是USB HID usage, 从SCANCODE_UNKNOWN到SCANCODE_F24
+// clang-format off
+constexpr std::array<uint8_t, 116> kHidToEvdev = {
+      0,   0,   0,   0,  30,  48,  46,  32,  18,  33,  34,  35,  23,  36,  37,  38,
+     50,  49,  24,  25,  16,  19,  31,  20,  22,  47,  17,  45,  21,  44,   2,   3,
+      4,   5,   6,   7,   8,   9,  10,  11,  28,   1,  14,  15,  57,  12,  13,  26,
+     27,  43,  43,  39,  40,  41,  51,  52,  53,  58,  59,  60,  61,  62,  63,  64,
+     65,  66,  67,  68,  87,  88,  99,  70, 119, 110, 102, 104, 111, 107, 109, 106,
+    105, 108, 103,  69,  98,  55,  74,  78,  96,  79,  80,  81,  75,  76,  77,  71,
+     72,  73,  82,  83,  86, 127, 116, 117, 183, 184, 185, 186, 187, 188, 189, 190,
+    191, 192, 193, 194,
+};
+// SCANCODE_LCTRL到SCANCODE_RGUI
+constexpr std::array<uint8_t, 8> kModifierToEvdev = {29, 42, 56, 125, 97, 54, 100, 126};
+// clang-format on
+
+constexpr int32_t kWheelDelta = 120;
+constexpr unsigned int kButtonWheelUp = 4;
+constexpr unsigned int kButtonWheelDown = 5;
+// X的键码比evdev的大8
+constexpr uint32_t kEvdevToXKeycode = 8;
+
+// ret: {x_button, down}, x_button为0表示不认识
+std::pair<unsigned int, bool> keyFlagToXButton(int flag) {
+    using namespace ltproto::client2worker;
+    switch (flag) {
+    case MouseEvent_KeyFlag_LeftDown:
+        return {1, true};
+    case MouseEvent_KeyFlag_LeftUp:
+        return {1, false};
+    case MouseEvent_KeyFlag_MidDown:
+        return {2, true};
+    case MouseEvent_KeyFlag_MidUp:
+        return {2, false};
+    case MouseEvent_KeyFlag_RightDown:
+        return {3, true};
+    case MouseEvent_KeyFlag_RightUp:
+        return {3, false};
+    case MouseEvent_KeyFlag_X1Down:
+        return {8, true};
+    case MouseEvent_KeyFlag_X1Up:
+        return {8, false};
+    case MouseEvent_KeyFlag_X2Down:
+        return {9, true};
+    case MouseEvent_KeyFlag_X2Up:
+        return {9, false};
+    default:
+        return {0, false};
+    }
+}
+
+} // namespace
+
+namespace lt {
+
+namespace input {
+
+uint32_t scancodeToEvdev(uint32_t scancode) {
+    if (scancode < kHidToEvdev.size()) {
+        return kHidToEvdev[scancode];
+    }
+    if (scancode >= Scancode::SCANCODE_LCTRL && scancode <= Scancode::SCANCODE_RGUI) {
+        return kModifierToEvdev[scancode - Scancode::SCANCODE_LCTRL];
+    }
+    return 0;
+}
+
+XTestInput::XTestInput(uint32_t screen_width, uint32_t screen_height, ltlib::Monitor monitor)
+    : screen_width_(screen_width)
+    , screen_height_(screen_height)
+    , monitor_(monitor) {}
+
+XTestInput::~XTestInput() {
+    // 先停注入线程, 再关display
+    inject_thread_.reset();
+    if (display_ != nullptr) {
+        XCloseDisplay(display_);
+        display_ = nullptr;
+    }
+}
+
+bool XTestInput::initKeyMouse() {
+    if (!loadApi()) {
+        return false;
+    }
+    display_ = XOpenDisplay(nullptr);
+    if (display_ == nullptr) {
+        const char* name = std::getenv("DISPLAY");
+        LOG(ERR) << "XOpenDisplay(" << (name == nullptr ? "" : name) << ") failed";
+        return false;
+    }
+    int event_base = 0;
+    int error_base = 0;
+    int major = 0;
+    int minor = 0;
+    if (!xtest_query_extension_(display_, &event_base, &error_base, &major, &minor)) {
+        LOG(ERR) << "X server doesn't support XTest extension";
+        return false;
+    }
+    screen_ = DefaultScreen(display_);
+    if (screen_width_ != 0 && screen_height_ != 0) {
+        left_ = monitor_.left;
+        top_ = monitor_.top;
+        width_ = static_cast<int32_t>(screen_width_);
+        height_ = static_cast<int32_t>(screen_height_);
+    }
+    else {
+        // Linux上还枚举不出显示器, 用整个X屏幕
+        width_ = DisplayWidth(display_, screen_);
+        height_ = DisplayHeight(display_, screen_);
+    }
+    inject_thread_ = ltlib::TaskThread::create("lt_xtest_inject");
+    LOG(INFO) << "XTest " << major << "." << minor << " input on " << DisplayString(display_)
+              << ", absolute mouse mapped to " << width_ << "x" << height_ << "+" << left_ << "+"
+              << top_;
+    return true;
+}
+
+bool XTestInput::loadApi() {
+    const std::string kLibName = "libXtst.so.6";
+    xtst_lib_ = ltlib::DynamicLibrary::load(kLibName);
+    if (xtst_lib_ == nullptr) {
+        LOG(ERR) << "Load library " << kLibName << " failed";
+        return false;
+    }
+    xtest_query_extension_ =
+        reinterpret_cast<XTestQueryExtension>(xtst_lib_->getFunc("XTestQueryExtension"));
+    xtest_fake_key_event_ =
+        reinterpret_cast<XTestFakeKeyEvent>(xtst_lib_->getFunc("XTestFakeKeyEvent"));
+    xtest_fake_button_event_ =
+        reinterpret_cast<XTestFakeButtonEvent>(xtst_lib_->getFunc("XTestFakeButtonEvent"));
+    xtest_fake_motion_event_ =
+        reinterpret_cast<XTestFakeMotionEvent>(xtst_lib_->getFunc("XTestFakeMotionEvent"));
+    xtest_fake_relative_motion_event_ = reinterpret_cast<XTestFakeRelativeMotionEvent>(
+        xtst_lib_->getFunc("XTestFakeRelativeMotionEvent"));
+    if (xtest_query_extension_ == nullptr || xtest_fake_key_event_ == nullptr ||
+        xtest_fake_button_event_ == nullptr || xtest_fake_motion_event_ == nullptr ||
+        xtest_fake_relative_motion_event_ == nullptr) {
+        LOG(ERR) << "Load functions from " << kLibName << " failed";
+        return false;
+    }
+    return true;
+}
+
+void XTestInput::onMouseEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+    const int64_t receive_us = ltlib::steady_now_us();
+    auto mouse = std::static_pointer_cast<ltproto::client2worker::MouseEvent>(msg);
+    // 和Win32SendInput一样, 同一条消息里先移动再按键
+    std::array<InjectOp, 3> ops;
+    size_t count = 0;
+    InputLatencyType type = InputLatencyType::MouseMove;
+    if (isAbsoluteMouse()) {
+        if (mouse->has_x() || mouse->has_y()) {
+            ops[count++] = InjectOp{InjectOp::Kind::MoveAbsolute,
+                                    left_ + static_cast<int32_t>(mouse->x() * width_),
+                                    top_ + static_cast<int32_t>(mouse->y() * height_), 0, false};
+        }
+    }
+    else {
+        if (mouse->has_delta_x() || mouse->has_delta_y()) {
+            ops[count++] = InjectOp{InjectOp::Kind::MoveRelative, mouse->delta_x(),
+                                    mouse->delta_y(), 0, false};
+        }
+    }
+    if (mouse->has_key_falg()) {
+        type = InputLatencyType::MouseButton;
+        auto [button, down] = keyFlagToXButton(mouse->key_falg());
+        if (button != 0) {
+            ops[count++] = InjectOp{InjectOp::Kind::Button, 0, 0, button, down};
+        }
+    }
+    else if (mouse->has_delta_z()) {
+        type = InputLatencyType::MouseWheel;
+        ops[count++] = InjectOp{InjectOp::Kind::Wheel, 0, mouse->delta_z(), 0, false};
+    }
+    push(ops.data(), count,
+         InjectStamp{type, static_cast<int64_t>(mouse->client_send_timestamp_us()), receive_us});
+}
+
+void XTestInput::onKeyboardEvent(const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+    const int64_t receive_us = ltlib::steady_now_us();
+    auto keyboard = std::static_pointer_cast<ltproto::client2worker::KeyboardEvent>(msg);
+    const uint32_t evdev = scancodeToEvdev(keyboard->key());
+    const InjectOp op{InjectOp::Kind::Key, 0, 0, evdev + kEvdevToXKeycode, keyboard->down()};
+    push(&op, evdev == 0 ? 0 : 1,
+         InjectStamp{InputLatencyType::Keyboard,
+                     static_cast<int64_t>(keyboard->client_send_timestamp_us()), receive_us});
+}
+
+void XTestInput::push(const InjectOp* ops, size_t count, const InjectStamp& stamp) {
+    {
+        std::lock_guard lk{inject_mutex_};
+        for (size_t i = 0; i < count; i++) {
+            batcher_.push(ops[i]);
+        }
+        batcher_.addStamp(stamp);
+        // 注入线程还没取走上一批, 跟着那一批一起注入
+        if (inject_scheduled_) {
+            return;
+        }
+        inject_scheduled_ = true;
+    }
+    inject_thread_->post(std::bind(&XTestInput::injectBatch, this));
+}
+
+void XTestInput::injectBatch() {
+    InjectBatcher::Batch batch;
+    {
+        std::lock_guard lk{inject_mutex_};
+        batch = batcher_.take();
+        inject_scheduled_ = false;
+    }
+    for (const auto& op : batch.ops) {
+        inject(op);
+    }
+    // 一批只刷一次, 请求一起写到X服务端
+    XFlush(display_);
+    const int64_t inject_us = ltlib::steady_now_us();
+    for (const auto& stamp : batch.stamps) {
+        recordInputLatency(stamp.type, stamp.client_us, stamp.receive_us, inject_us);
+    }
+}
+
+void XTestInput::inject(const InjectOp& op) {
+    switch (op.kind) {
+    case InjectOp::Kind::MoveAbsolute:
+        xtest_fake_motion_event_(display_, screen_, op.x, op.y, CurrentTime);
+        break;
+    case InjectOp::Kind::MoveRelative:
+        xtest_fake_relative_motion_event_(display_, op.x, op.y, CurrentTime);
+        break;
+    case InjectOp::Kind::Button:
+        xtest_fake_button_event_(display_, op.code, op.down ? True : False, CurrentTime);
+        break;
+    case InjectOp::Kind::Key:
+        xtest_fake_key_event_(display_, op.code, op.down ? True : False, CurrentTime);
+        break;
+    case InjectOp::Kind::Wheel:
+    {
+        // X的滚轮是按钮4/5的一次点击, 120为一格, 高精度滚轮不满一格的部分留到下次
+        if ((wheel_remainder_ > 0 && op.y < 0) || (wheel_remainder_ < 0 && op.y > 0)) {
+            wheel_remainder_ = 0;
+        }
+        wheel_remainder_ += op.y;
+        while (wheel_remainder_ >= kWheelDelta || wheel_remainder_ <= -kWheelDelta) {
+            const unsigned int button =
+                wheel_remainder_ > 0 ? kButtonWheelUp : kButtonWheelDown;
+            xtest_fake_button_event_(display_, button, True, CurrentTime);
+            xtest_fake_button_event_(display_, button, False, CurrentTime);
+            wheel_remainder_ += wheel_remainder_ > 0 ? -kWheelDelta : kWheelDelta;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,111 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+
+#include <memory>
+#include <mutex>
+
+#include <ltlib/load_library.h>
+#include <ltlib/system.h>
+#include <ltlib/threads.h>
+
+#include <inputs/executor/inject_batcher.h>
+#include <inputs/executor/input_executor.h>
+
+// Xlib里的Display, 不在头文件里引入Xlib.h, 它的宏会和别的代码冲突
+struct _XDisplay;
+
+namespace lt {
+
+namespace input {
+
+// SDL的scancode(即USB HID usage)转成Linux evdev键码, 不认识的返回0.
+// Xorg和Xvfb默认用evdev规则, X的键码就是evdev键码加8
+uint32_t scancodeToEvdev(uint32_t scancode);
+
+// 通过XTest扩展注入键鼠. 消息线程只做换算和排队, 注入线程把攒下的操作整批注入,
+// 连续的移动合并成一次, 每批XFlush一次. libXtst运行时加载, 编译不依赖它
+class XTestInput : public Executor {
+public:
+    XTestInput(uint32_t screen_width, uint32_t screen_height, ltlib::Monitor monitor);
+    ~XTestInput() override;
+
+private:
+    bool initKeyMouse() override;
+    void onMouseEvent(const std::shared_ptr<google::protobuf::MessageLite>&) override;
+    void onKeyboardEvent(const std::shared_ptr<google::protobuf::MessageLite>&) override;
+    bool injectAsync() const override { return true; }
+    bool loadApi();
+    void push(const InjectOp* ops, size_t count, const InjectStamp& stamp);
+    void injectBatch();
+    void inject(const InjectOp& op);
+
+private:
+    // X11/extensions/XTest.h里的函数签名, Bool是int
+    using XTestQueryExtension = int (*)(_XDisplay* dpy, int* event_base, int* error_base,
+                                        int* major, int* minor);
+    using XTestFakeKeyEvent = int (*)(_XDisplay* dpy, unsigned int keycode, int is_press,
+                                      unsigned long delay);
+    using XTestFakeButtonEvent = int (*)(_XDisplay* dpy, unsigned int button, int is_press,
+                                         unsigned long delay);
+    using XTestFakeMotionEvent = int (*)(_XDisplay* dpy, int screen, int x, int y,
+                                         unsigned long delay);
+    using XTestFakeRelativeMotionEvent = int (*)(_XDisplay* dpy, int x, int y,
+                                                 unsigned long delay);
+
+    uint32_t screen_width_;
+    uint32_t screen_height_;
+    ltlib::Monitor monitor_;
+    std::unique_ptr<ltlib::DynamicLibrary> xtst_lib_;
+    XTestQueryExtension xtest_query_extension_ = nullptr;
+    XTestFakeKeyEvent xtest_fake_key_event_ = nullptr;
+    XTestFakeButtonEvent xtest_fake_button_event_ = nullptr;
+    XTestFakeMotionEvent xtest_fake_motion_event_ = nullptr;
+    XTestFakeRelativeMotionEvent xtest_fake_relative_motion_event_ = nullptr;
+    // 只在注入线程上使用
+    _XDisplay* display_ = nullptr;
+    int screen_ = 0;
+    int32_t wheel_remainder_ = 0;
+    // 绝对坐标映射到的区域
+    int32_t left_ = 0;
+    int32_t top_ = 0;
+    int32_t width_ = 0;
+    int32_t height_ = 0;
+    std::mutex inject_mutex_;
+    InjectBatcher batcher_;
+    bool inject_scheduled_ = false;
+    std::unique_ptr<ltlib::TaskThread> inject_thread_;
+};
+
+} // namespace input
+
+} // namespace lt
@@ -0,0 +1,368 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+
+#include <gtest/gtest.h>
+
+#include <ltlib/threads.h>
+#include <ltlib/times.h>
+#include <ltproto/client2worker/keyboard_event.pb.h>
+#include <ltproto/client2worker/mouse_event.pb.h>
+#include <ltproto/ltproto.h>
+
+#include <inputs/executor/input_executor.h>
+#include <inputs/executor/scancode.h>
+#include <inputs/executor/x11_xtest_input.h>
+
+// Xlib的宏(None, Status, Bool...)会和上面的头文件冲突, 放在最后
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+
+// 需要一个带XTest扩展的X服务端, 无头环境用Xvfb:
+//   xvfb-run -a -s "-screen 0 1280x720x24" ctest -R test_x11_xtest_input
+// 打不开DISPLAY时跳过
+
+namespace {
+
+using lt::input::Executor;
+using MouseEvent = ltproto::client2worker::MouseEvent;
+using KeyboardEvent = ltproto::client2worker::KeyboardEvent;
+
+// 注入线程要向ThreadWatcher注册
+class ThreadWatcherEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override { ltlib::ThreadWatcher::init(std::this_thread::get_id()); }
+    void TearDown() override { ltlib::ThreadWatcher::uninit(); }
+};
+
+const auto* const kThreadWatcherEnv =
+    ::testing::AddGlobalTestEnvironment(new ThreadWatcherEnvironment);
+
+struct ProbeEvent {
+    int type;
+    int x;
+    int y;
+    unsigned int button;
+    KeySym keysym;
+    int64_t receive_us;
+};
+
+// 铺满屏幕的窗口, 在自己的X连接和线程上记录收到的键鼠事件
+class ProbeWindow {
+public:
+    static std::unique_ptr<ProbeWindow> create() {
+        std::unique_ptr<ProbeWindow> probe{new ProbeWindow};
+        if (!probe->init()) {
+            return nullptr;
+        }
+        return probe;
+    }
+
+    ~ProbeWindow() {
+        stoped_ = true;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        XDestroyWindow(display_, window_);
+        XCloseDisplay(display_);
+    }
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+
+    // 等到至少收到count个type类型的事件
+    std::vector<ProbeEvent> waitFor(int type, size_t count, std::chrono::milliseconds timeout) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (;;) {
+            {
+                std::lock_guard lock{mutex_};
+                const auto received =
+                    std::count_if(events_.begin(), events_.end(),
+                                  [type](const ProbeEvent& ev) { return ev.type == type; });
+                if (static_cast<size_t>(received) >= count ||
+                    std::chrono::steady_clock::now() > deadline) {
+                    return events_;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds{100});
+        }
+    }
+
+    void clear() {
+        std::lock_guard lock{mutex_};
+        events_.clear();
+    }
+
+private:
+    ProbeWindow() = default;
+
+    bool init() {
+        display_ = XOpenDisplay(nullptr);
+        if (display_ == nullptr) {
+            return false;
+        }
+        const int screen = DefaultScreen(display_);
+        width_ = DisplayWidth(display_, screen);
+        height_ = DisplayHeight(display_, screen);
+        XSetWindowAttributes attrs{};
+        // 不经过窗口管理器, 位置和大小就是我们设的
+        attrs.override_redirect = True;
+        attrs.event_mask = ButtonPressMask | ButtonReleaseMask | KeyPressMask | KeyReleaseMask |
+                           PointerMotionMask | StructureNotifyMask;
+        window_ = XCreateWindow(display_, RootWindow(display_, screen), 0, 0,
+                                static_cast<unsigned int>(width_),
+                                static_cast<unsigned int>(height_), 0, CopyFromParent,
+                                InputOutput, CopyFromParent, CWOverrideRedirect | CWEventMask,
+                                &attrs);
+        XMapRaised(display_, window_);
+        XEvent ev{};
+        do {
+            XNextEvent(display_, &ev);
+        } while (ev.type != MapNotify);
+        XSetInputFocus(display_, window_, RevertToParent, CurrentTime);
+        XSync(display_, False);
+        thread_ = std::thread{[this]() { loop(); }};
+        return true;
+    }
+
+    void loop() {
+        pollfd fd{ConnectionNumber(display_), POLLIN, 0};
+        while (!stoped_) {
+            if (XPending(display_) == 0) {
+                ::poll(&fd, 1, 1);
+                continue;
+            }
+            XEvent ev{};
+            XNextEvent(display_, &ev);
+            ProbeEvent probe{ev.type, 0, 0, 0, NoSymbol, ltlib::steady_now_us()};
+            switch (ev.type) {
+            case MotionNotify:
+                probe.x = ev.xmotion.x;
+                probe.y = ev.xmotion.y;
+                break;
+            case ButtonPress:
+            case ButtonRelease:
+                probe.x = ev.xbutton.x;
+                probe.y = ev.xbutton.y;
+                probe.button = ev.xbutton.button;
+                break;
+            case KeyPress:
+            case KeyRelease:
+                probe.keysym = XLookupKeysym(&ev.xkey, 0);
+                break;
+            default:
+                continue;
+            }
+            std::lock_guard lock{mutex_};
+            events_.push_back(probe);
+        }
+    }
+
+private:
+    Display* display_ = nullptr;
+    Window window_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    std::atomic<bool> stoped_{false};
+    std::thread thread_;
+    std::mutex mutex_;
+    std::vector<ProbeEvent> events_;
+};
+
+// 代替worker: 保存Executor注册的消息处理函数, 测试直接调用
+class ExecutorHarness {
+public:
+    bool init() {
+        Executor::Params params{};
+        params.register_message_handler = [this](uint32_t type,
+                                                 const lt::MessageHandler& handler) {
+            handlers_[type] = handler;
+            return true;
+        };
+        params.send_message = [](uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&) {
+            return true;
+        };
+        executor_ = Executor::create(params);
+        return executor_ != nullptr;
+    }
+
+    void moveTo(float x, float y) {
+        auto msg = std::make_shared<MouseEvent>();
+        msg->set_x(x);
+        msg->set_y(y);
+        handlers_[ltproto::type::kMouseEvent](msg);
+    }
+
+    void button(MouseEvent::KeyFlag flag) {
+        auto msg = std::make_shared<MouseEvent>();
+        msg->set_key_falg(flag);
+        handlers_[ltproto::type::kMouseEvent](msg);
+    }
+
+    void wheel(int32_t delta) {
+        auto msg = std::make_shared<MouseEvent>();
+        msg->set_delta_z(delta);
+        handlers_[ltproto::type::kMouseEvent](msg);
+    }
+
+    void key(lt::input::Scancode scancode, bool down) {
+        auto msg = std::make_shared<KeyboardEvent>();
+        msg->set_key(scancode);
+        msg->set_down(down);
+        handlers_[ltproto::type::kKeyboardEvent](msg);
+    }
+
+private:
+    std::map<uint32_t, lt::MessageHandler> handlers_;
+    std::unique_ptr<Executor> executor_;
+};
+
+TEST(XTestInputTest, ScancodeToEvdev) {
+    using namespace lt::input;
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_A), 30u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_Z), 44u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_1), 2u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_0), 11u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_RETURN), 28u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_F12), 88u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_UP), 103u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_KP_0), 82u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_LCTRL), 29u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_RGUI), 126u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_UNKNOWN), 0u);
+    EXPECT_EQ(scancodeToEvdev(SCANCODE_MODE), 0u);
+}
+
+TEST(XTestInputTest, InjectsKeysButtonsAndWheel) {
+    auto probe = ProbeWindow::create();
+    if (probe == nullptr) {
+        GTEST_SKIP() << "X server is not available";
+    }
+    ExecutorHarness harness;
+    if (!harness.init()) {
+        GTEST_SKIP() << "XTest is not available";
+    }
+    using namespace lt::input;
+    harness.moveTo(0.25f, 0.5f);
+    harness.button(ltproto::client2worker::MouseEvent_KeyFlag_LeftDown);
+    harness.button(ltproto::client2worker::MouseEvent_KeyFlag_LeftUp);
+    harness.wheel(-240);
+    harness.key(SCANCODE_A, true);
+    harness.key(SCANCODE_A, false);
+    // 高精度滚轮: 两个半格凑成一格
+    harness.wheel(60);
+    harness.wheel(60);
+    for (auto scancode : {SCANCODE_RETURN, SCANCODE_LSHIFT, SCANCODE_KP_5}) {
+        harness.key(scancode, true);
+        harness.key(scancode, false);
+    }
+
+    auto events = probe->waitFor(KeyRelease, 4, std::chrono::seconds{2});
+    std::vector<ProbeEvent> buttons;
+    std::vector<KeySym> keys;
+    for (const auto& ev : events) {
+        if (ev.type == ButtonPress) {
+            buttons.push_back(ev);
+        }
+        else if (ev.type == KeyPress) {
+            keys.push_back(ev.keysym);
+        }
+    }
+    ASSERT_EQ(buttons.size(), 4u);
+    EXPECT_EQ(buttons[0].button, 1u);
+    EXPECT_NEAR(buttons[0].x, probe->width() / 4, 1);
+    EXPECT_NEAR(buttons[0].y, probe->height() / 2, 1);
+    EXPECT_EQ(buttons[1].button, 5u);
+    EXPECT_EQ(buttons[2].button, 5u);
+    EXPECT_EQ(buttons[3].button, 4u);
+    // Xvfb默认的键盘布局是evdev规则下的us
+    ASSERT_EQ(keys.size(), 4u);
+    EXPECT_EQ(keys[0], static_cast<KeySym>(XK_a));
+    EXPECT_EQ(keys[1], static_cast<KeySym>(XK_Return));
+    EXPECT_EQ(keys[2], static_cast<KeySym>(XK_Shift_L));
+    EXPECT_EQ(keys[3], static_cast<KeySym>(XK_KP_Begin));
+}
+
+TEST(XTestInputTest, LatencyAndThroughput) {
+    auto probe = ProbeWindow::create();
+    if (probe == nullptr) {
+        GTEST_SKIP() << "X server is not available";
+    }
+    ExecutorHarness harness;
+    if (!harness.init()) {
+        GTEST_SKIP() << "XTest is not available";
+    }
+
+    // 一次一个按键, 从交给Executor到probe收到
+    constexpr size_t kKeys = 100;
+    std::vector<int64_t> latencies_us;
+    for (size_t i = 0; i < kKeys; i++) {
+        const int64_t send_us = ltlib::steady_now_us();
+        harness.key(lt::input::SCANCODE_A, true);
+        harness.key(lt::input::SCANCODE_A, false);
+        auto events = probe->waitFor(KeyPress, 1, std::chrono::seconds{1});
+        probe->clear();
+        ASSERT_FALSE(events.empty());
+        latencies_us.push_back(events.front().receive_us - send_us);
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const int64_t p50_us = latencies_us[kKeys / 2];
+    const int64_t p99_us = latencies_us[kKeys * 99 / 100];
+    std::printf("key inject latency p50 %.2fms p99 %.2fms\n", p50_us / 1000.0, p99_us / 1000.0);
+
+    // 尽快灌入移动, 中间夹着点击. 点击必须落在它之前最后一次移动的位置
+    constexpr size_t kMoves = 20'000;
+    constexpr size_t kMovesPerClick = 500;
+    std::vector<std::pair<int, int>> click_positions;
+    const int64_t start_us = ltlib::steady_now_us();
+    for (size_t i = 0; i < kMoves; i++) {
+        const float x = static_cast<float>(i % 1000) / 1000.0f;
+        const float y = static_cast<float>(i % 700) / 1000.0f;
+        harness.moveTo(x, y);
+        if ((i + 1) % kMovesPerClick == 0) {
+            click_positions.push_back({static_cast<int>(x * probe->width()),
+                                       static_cast<int>(y * probe->height())});
+            harness.button(ltproto::client2worker::MouseEvent_KeyFlag_LeftDown);
+            harness.button(ltproto::client2worker::MouseEvent_KeyFlag_LeftUp);
+        }
+    }
+    const int64_t sent_us = ltlib::steady_now_us();
+    auto events = probe->waitFor(ButtonRelease, click_positions.size(), std::chrono::seconds{10});
+    std::vector<ProbeEvent> clicks;
+    size_t motions = 0;
+    for (const auto& ev : events) {
+        if (ev.type == ButtonPress) {
+            clicks.push_back(ev);
+        }
+        else if (ev.type == MotionNotify) {
+            motions++;
+        }
+    }
+    ASSERT_EQ(clicks.size(), click_positions.size());
+    const int64_t done_us = clicks.back().receive_us;
+    std::printf("%zu moves + %zu clicks: sent in %.1fms, injected in %.1fms (%.0f msg/s), "
+                "%zu motion events reached the probe\n",
+                kMoves, clicks.size(), (sent_us - start_us) / 1000.0,
+                (done_us - start_us) / 1000.0,
+                (kMoves + clicks.size() * 2) * 1e6 / std::max<int64_t>(done_us - start_us, 1),
+                motions);
+    for (size_t i = 0; i < clicks.size(); i++) {
+        EXPECT_NEAR(clicks[i].x, click_positions[i].first, 1) << "click " << i;
+        EXPECT_NEAR(clicks[i].y, click_positions[i].second, 1) << "click " << i;
+    }
+    // 积压的移动被合并掉了
+    EXPECT_LT(motions, kMoves);
+    // 最后一次点击不会被前面的移动拖住
+    EXPECT_LT(done_us - sent_us, 100'000);
+}
+
+} // namespace
@@ -0,0 +1,158 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ltlib/av_sync.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// 延迟的平滑系数的倒数. 视频60fps时大约0.3秒
+constexpr int64_t kSmoothing = 16;
+constexpr int64_t kUpdateIntervalUs = 50'000;
+
+void smooth(std::optional<int64_t>& value, int64_t sample) {
+    if (!value.has_value()) {
+        value = sample;
+        return;
+    }
+    *value += (sample - *value) / kSmoothing;
+}
+
+} // namespace
+
+namespace ltlib {
+
+AVSync::AVSync()
+    : AVSync{Params{}} {}
+
+AVSync::AVSync(const Params& params)
+    : params_{params} {}
+
+void AVSync::setTimeDiff(int64_t time_diff_us) {
+    std::lock_guard lock{mutex_};
+    time_diff_us_ = time_diff_us;
+}
+
+int64_t AVSync::toLocalTime(int64_t remote_time_us) const {
+    std::lock_guard lock{mutex_};
+    return remote_time_us + time_diff_us_;
+}
+
+void AVSync::onAudioPresented(int64_t capture_time_us, int64_t present_time_us) {
+    std::lock_guard lock{mutex_};
+    smooth(audio_delay_us_, present_time_us - capture_time_us);
+    last_audio_us_ = present_time_us;
+    update(present_time_us);
+}
+
+void AVSync::onVideoPresented(int64_t capture_time_us, int64_t present_time_us) {
+    std::lock_guard lock{mutex_};
+    smooth(video_delay_us_, present_time_us - capture_time_us);
+    last_video_us_ = present_time_us;
+    update(present_time_us);
+}
+
+int64_t AVSync::audioExtraDelayUs() const {
+    std::lock_guard lock{mutex_};
+    return audio_extra_delay_us_;
+}
+
+int64_t AVSync::videoExtraDelayUs() const {
+    std::lock_guard lock{mutex_};
+    return video_extra_delay_us_;
+}
+
+AVSync::Stat AVSync::stat() const {
+    std::lock_guard lock{mutex_};
+    Stat stat{};
+    if (audio_delay_us_.has_value()) {
+        stat.audio_delay_us = *audio_delay_us_ - time_diff_us_;
+    }
+    if (video_delay_us_.has_value()) {
+        stat.video_delay_us = *video_delay_us_ - time_diff_us_;
+    }
+    if (audio_delay_us_.has_value() && video_delay_us_.has_value()) {
+        stat.sync_error_us = *audio_delay_us_ - *video_delay_us_;
+    }
+    stat.audio_extra_delay_us = audio_extra_delay_us_;
+    stat.video_extra_delay_us = video_extra_delay_us_;
+    return stat;
+}
+
+void AVSync::update(int64_t now_us) {
+    // 停了的那一路只能靠另一路的呈现来发现
+    if (audio_delay_us_.has_value() && now_us - last_audio_us_ > params_.stale_us) {
+        audio_delay_us_ = std::nullopt;
+    }
+    if (video_delay_us_.has_value() && now_us - last_video_us_ > params_.stale_us) {
+        video_delay_us_ = std::nullopt;
+    }
+    if (last_update_us_ == 0 || now_us < last_update_us_) {
+        last_update_us_ = now_us;
+        return;
+    }
+    const int64_t elapsed_us = now_us - last_update_us_;
+    if (elapsed_us < kUpdateIntervalUs) {
+        return;
+    }
+    last_update_us_ = now_us;
+    const int64_t max_step_us = params_.max_adjust_us_per_sec * elapsed_us / 1'000'000;
+    if (!audio_delay_us_.has_value() || !video_delay_us_.has_value()) {
+        // 只有一路在走, 没有东西可对齐, 不要一直按旧的估计多等
+        adjusting_ = false;
+        audio_extra_delay_us_ = std::max(audio_extra_delay_us_ - max_step_us, int64_t{0});
+        video_extra_delay_us_ = std::max(video_extra_delay_us_ - max_step_us, int64_t{0});
+        return;
+    }
+    // 测到的延迟已经包含了从路的额外延迟, 按误差慢慢修正, 相当于一个限速的积分器
+    const int64_t error_us = *audio_delay_us_ - *video_delay_us_;
+    if (std::abs(error_us) > params_.tolerance_us) {
+        adjusting_ = true;
+    }
+    else if (std::abs(error_us) < params_.tolerance_us / 4) {
+        adjusting_ = false;
+    }
+    if (!adjusting_) {
+        return;
+    }
+    const int64_t step_us = std::clamp(error_us, -max_step_us, max_step_us);
+    if (params_.master == Master::Audio) {
+        video_extra_delay_us_ =
+            std::clamp(video_extra_delay_us_ + step_us, int64_t{0}, params_.max_extra_delay_us);
+    }
+    else {
+        audio_extra_delay_us_ =
+            std::clamp(audio_extra_delay_us_ - step_us, int64_t{0}, params_.max_extra_delay_us);
+    }
+}
+
+} // namespace ltlib
@@ -0,0 +1,104 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+namespace ltlib {
+
+// 客户端的音视频同步. 两路都带主机上的采集时间, 各自在呈现时汇报"此刻呈现的是哪个时间采集的",
+// 由此得到各自从采集到呈现的延迟. 主路按自己的节奏走, 给从路加额外的延迟, 让两路的延迟一致.
+// 两路延迟相减时两端的时钟差会消掉, 所以没有time_diff也能同步, time_diff只用于换算和统计.
+// 线程安全.
+class AVSync {
+public:
+    enum class Master {
+        // 声音不动, 画面晚一点解码. 声音一卡顿人就能听出来, 画面多等几十毫秒不明显
+        Audio,
+        // 画面不动, 抖动缓冲多留一点声音. 声音本来就比画面慢时无能为力
+        Video,
+    };
+    struct Params {
+        Master master = Master::Audio;
+        // 从路最多额外延迟这么多
+        int64_t max_extra_delay_us = 150'000;
+        // 误差超过这个值才开始调整, 调到tolerance_us/4以内停止. 人对几十毫秒内的偏差不敏感
+        int64_t tolerance_us = 20'000;
+        // 额外延迟每秒最多变化这么多. 不超过声音拉伸的速度, 画面也不会突然停顿
+        int64_t max_adjust_us_per_sec = 10'000;
+        // 一路超过这么久没有呈现(主机静音, 抖动缓冲重置, 画面不动), 之前的估计作废,
+        // 额外延迟按max_adjust_us_per_sec退回0
+        int64_t stale_us = 1'000'000;
+    };
+    struct Stat {
+        // 从采集到呈现, 按time_diff换算到客户端时钟. 没有数据时为0
+        int64_t audio_delay_us;
+        int64_t video_delay_us;
+        // 正数表示声音比画面晚
+        int64_t sync_error_us;
+        int64_t audio_extra_delay_us;
+        int64_t video_extra_delay_us;
+    };
+
+public:
+    AVSync();
+    explicit AVSync(const Params& params);
+    // 客户端时钟减主机时钟, 即TimeSync算出来的time_diff
+    void setTimeDiff(int64_t time_diff_us);
+    // 主机上的时间换算成客户端的steady时钟
+    int64_t toLocalTime(int64_t remote_time_us) const;
+    // capture_time_us是主机时钟, present_time_us是客户端时钟(声音从扬声器出来/画面显示出来的时刻)
+    void onAudioPresented(int64_t capture_time_us, int64_t present_time_us);
+    void onVideoPresented(int64_t capture_time_us, int64_t present_time_us);
+    int64_t audioExtraDelayUs() const;
+    int64_t videoExtraDelayUs() const;
+    Stat stat() const;
+
+private:
+    void update(int64_t now_us);
+
+private:
+    const Params params_;
+    mutable std::mutex mutex_;
+    int64_t time_diff_us_ = 0;
+    // 平滑过的呈现时间减采集时间, 没有扣除时钟差
+    std::optional<int64_t> audio_delay_us_;
+    std::optional<int64_t> video_delay_us_;
+    int64_t last_audio_us_ = 0;
+    int64_t last_video_us_ = 0;
+    int64_t audio_extra_delay_us_ = 0;
+    int64_t video_extra_delay_us_ = 0;
+    int64_t last_update_us_ = 0;
+    bool adjusting_ = false;
+};
+
+} // namespace ltlib
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltlib/av_sync.h>
+
+namespace {
+
+using ltlib::AVSync;
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr int64_t kStepUs = 1'000;
+constexpr int64_t kDurationUs = 60'000'000;
+// 前面这段时间用来收敛, 不计入结果
+constexpr int64_t kWarmupUs = 15'000'000;
+constexpr int64_t kWindowUs = 1'000'000;
+// 客户端时钟减主机时钟
+constexpr int64_t kTimeDiffUs = 3'456'789'000;
+constexpr int64_t kAudioFrameUs = 10'000;
+// 抖动缓冲拉伸声音的速度, 约每秒20ms
+constexpr int64_t kAudioStretchUsPerStep = 20;
+constexpr int64_t kVideoFrameUs = 1'000'000 / 60;
+constexpr int64_t kVsyncUs = 1'000'000 / 60;
+constexpr int64_t kDecodeUs = 5'000;
+
+struct Scenario {
+    AVSync::Master master;
+    // 不含额外延迟时声音从采集到播放的延迟: base + amplitude * sin(2πt/period)
+    int64_t audio_base_us;
+    int64_t audio_amplitude_us;
+    int64_t audio_period_us;
+    // 视频的网络延迟和均匀分布的抖动
+    int64_t video_network_us;
+    int64_t video_jitter_us;
+};
+
+struct SyncResult {
+    // 每个窗口里声音平均延迟减画面平均延迟, 取绝对值
+    double mean_abs_error_ms;
+    double max_abs_error_ms;
+    AVSync::Stat stat;
+};
+
+struct Accumulator {
+    int64_t sum = 0;
+    int64_t count = 0;
+    void add(int64_t value) {
+        sum += value;
+        count++;
+    }
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+};
+
+struct VideoFrame {
+    int64_t capture_us;
+    int64_t arrive_us;
+    std::optional<int64_t> decoded_us;
+};
+
+// 按1ms的步长模拟客户端时钟. 时间都是客户端时钟, 采集时间是主机时钟
+SyncResult simulate(const Scenario& scenario, bool enable_sync) {
+    AVSync::Params params{};
+    params.master = scenario.master;
+    AVSync sync{params};
+    sync.setTimeDiff(kTimeDiffUs);
+    std::mt19937 rng{20240601};
+    std::uniform_int_distribution<int64_t> jitter{0, scenario.video_jitter_us};
+
+    const int64_t start_us = kTimeDiffUs + 1'000'000;
+    int64_t next_capture_us = start_us - kTimeDiffUs;
+    int64_t next_vsync_us = start_us;
+    int64_t audio_extra_us = 0;
+    std::deque<VideoFrame> in_flight;
+    std::optional<VideoFrame> latest_decoded;
+    int64_t last_presented_capture_us = -1;
+
+    std::vector<double> errors_ms;
+    Accumulator audio_window;
+    Accumulator video_window;
+    int64_t window_end_us = start_us + kWarmupUs + kWindowUs;
+    for (int64_t now_us = start_us; now_us < start_us + kDurationUs; now_us += kStepUs) {
+        const int64_t elapsed_us = now_us - start_us;
+        const int64_t video_extra_us = enable_sync ? sync.videoExtraDelayUs() : 0;
+        const int64_t audio_target_us = enable_sync ? sync.audioExtraDelayUs() : 0;
+        audio_extra_us += std::clamp(audio_target_us - audio_extra_us, -kAudioStretchUsPerStep,
+                                     kAudioStretchUsPerStep);
+
+        // 主机采集, 经过网络到达客户端
+        while (next_capture_us + kTimeDiffUs <= now_us) {
+            const int64_t arrive_us =
+                next_capture_us + kTimeDiffUs + scenario.video_network_us + jitter(rng);
+            in_flight.push_back({next_capture_us, arrive_us, std::nullopt});
+            next_capture_us += kVideoFrameUs;
+        }
+        // 到达后先按额外延迟压着, 再解码
+        for (auto& frame : in_flight) {
+            if (!frame.decoded_us.has_value() && frame.arrive_us <= now_us) {
+                frame.decoded_us = now_us + video_extra_us + kDecodeUs;
+            }
+        }
+        while (!in_flight.empty() && in_flight.front().decoded_us.has_value() &&
+               in_flight.front().decoded_us <= now_us) {
+            latest_decoded = in_flight.front();
+            in_flight.pop_front();
+        }
+        if (now_us >= next_vsync_us) {
+            if (latest_decoded.has_value() &&
+                latest_decoded->capture_us != last_presented_capture_us) {
+                last_presented_capture_us = latest_decoded->capture_us;
+                sync.onVideoPresented(latest_decoded->capture_us, next_vsync_us);
+                video_window.add(next_vsync_us - kTimeDiffUs - latest_decoded->capture_us);
+            }
+            next_vsync_us += kVsyncUs;
+        }
+
+        // 此刻从扬声器出来的声音是什么时候采集的
+        if (elapsed_us % kAudioFrameUs == 0) {
+            const double phase = 2 * kPi * elapsed_us / scenario.audio_period_us;
+            const auto natural_us = scenario.audio_base_us +
+                                    static_cast<int64_t>(scenario.audio_amplitude_us *
+                                                         std::sin(phase));
+            const int64_t delay_us = natural_us + audio_extra_us;
+            sync.onAudioPresented(now_us - kTimeDiffUs - delay_us, now_us);
+            audio_window.add(delay_us);
+        }
+
+        if (now_us >= window_end_us) {
+            if (now_us >= start_us + kWarmupUs) {
+                errors_ms.push_back(std::abs(audio_window.mean() - video_window.mean()) / 1000.0);
+            }
+            audio_window = {};
+            video_window = {};
+            window_end_us += kWindowUs;
+        }
+    }
+
+    SyncResult result{};
+    for (double error : errors_ms) {
+        result.mean_abs_error_ms += error;
+        result.max_abs_error_ms = std::max(result.max_abs_error_ms, error);
+    }
+    if (!errors_ms.empty()) {
+        result.mean_abs_error_ms /= errors_ms.size();
+    }
+    result.stat = sync.stat();
+    return result;
+}
+
+void print(const char* name, const SyncResult& result) {
+    std::printf("%s: |error| mean %.1fms max %.1fms, audio %.1fms video %.1fms, "
+                "extra audio %.1fms video %.1fms\n",
+                name, result.mean_abs_error_ms, result.max_abs_error_ms,
+                result.stat.audio_delay_us / 1000.0, result.stat.video_delay_us / 1000.0,
+                result.stat.audio_extra_delay_us / 1000.0,
+                result.stat.video_extra_delay_us / 1000.0);
+}
+
+TEST(AVSyncTest, AudioMasterDelaysVideo) {
+    // 声音延迟在50~110ms之间慢慢漂, 画面大约40ms
+    const Scenario scenario{AVSync::Master::Audio, 80'000, 30'000, 20'000'000, 20'000, 15'000};
+    const SyncResult baseline = simulate(scenario, false);
+    const SyncResult synced = simulate(scenario, true);
+    print("audio master, no sync", baseline);
+    print("audio master, synced ", synced);
+
+    EXPECT_GT(baseline.mean_abs_error_ms, 30.0);
+    EXPECT_LT(synced.mean_abs_error_ms, 15.0);
+    EXPECT_LT(synced.max_abs_error_ms, 30.0);
+    EXPECT_EQ(synced.stat.audio_extra_delay_us, 0);
+    EXPECT_GT(synced.stat.video_extra_delay_us, 0);
+    // 统计里的延迟已经扣掉了时钟差
+    EXPECT_GT(synced.stat.audio_delay_us, 0);
+    EXPECT_LT(synced.stat.audio_delay_us, 200'000);
+}
+
+TEST(AVSyncTest, VideoMasterDelaysAudio) {
+    // 画面走的链路慢, 大约90ms, 声音只有30ms左右
+    const Scenario scenario{AVSync::Master::Video, 30'000, 10'000, 15'000'000, 70'000, 15'000};
+    const SyncResult baseline = simulate(scenario, false);
+    const SyncResult synced = simulate(scenario, true);
+    print("video master, no sync", baseline);
+    print("video master, synced ", synced);
+
+    EXPECT_GT(baseline.mean_abs_error_ms, 30.0);
+    EXPECT_LT(synced.mean_abs_error_ms, 15.0);
+    EXPECT_LT(synced.max_abs_error_ms, 30.0);
+    EXPECT_EQ(synced.stat.video_extra_delay_us, 0);
+    EXPECT_GT(synced.stat.audio_extra_delay_us, 0);
+}
+
+TEST(AVSyncTest, ExtraDelayIsBounded) {
+    AVSync::Params params{};
+    params.max_extra_delay_us = 50'000;
+    AVSync sync{params};
+    // 声音比画面晚500ms, 只能补到上限
+    int64_t now_us = 1'000'000;
+    for (int i = 0; i < 1000; i++) {
+        sync.onAudioPresented(now_us - 500'000, now_us);
+        sync.onVideoPresented(now_us, now_us);
+        now_us += 20'000;
+    }
+    EXPECT_EQ(sync.videoExtraDelayUs(), 50'000);
+    EXPECT_EQ(sync.audioExtraDelayUs(), 0);
+    EXPECT_EQ(sync.toLocalTime(100), 100);
+    sync.setTimeDiff(-40);
+    EXPECT_EQ(sync.toLocalTime(100), 60);
+}
+
+TEST(AVSyncTest, StaleAudioReleasesVideoDelay) {
+    AVSync::Params params{};
+    params.max_extra_delay_us = 50'000;
+    AVSync sync{params};
+    int64_t now_us = 1'000'000;
+    for (int i = 0; i < 1000; i++) {
+        sync.onAudioPresented(now_us - 500'000, now_us);
+        sync.onVideoPresented(now_us, now_us);
+        now_us += 20'000;
+    }
+    ASSERT_EQ(sync.videoExtraDelayUs(), 50'000);
+    // 主机不出声了, 只有画面. 过了stale_us之后额外延迟按每秒10ms退回0
+    const int64_t audio_stopped_us = now_us;
+    int64_t released_us = -1;
+    for (int i = 0; i < 500 && released_us < 0; i++) {
+        sync.onVideoPresented(now_us, now_us);
+        if (sync.videoExtraDelayUs() == 0) {
+            released_us = now_us - audio_stopped_us;
+        }
+        now_us += 20'000;
+    }
+    EXPECT_GT(released_us, params.stale_us);
+    EXPECT_LE(released_us, params.stale_us + 5'000'000 + 100'000);
+    EXPECT_EQ(sync.stat().audio_delay_us, 0);
+    // 声音回来以后重新开始对齐
+    for (int i = 0; i < 1000; i++) {
+        sync.onAudioPresented(now_us - 500'000, now_us);
+        sync.onVideoPresented(now_us, now_us);
+        now_us += 20'000;
+    }
+    EXPECT_EQ(sync.videoExtraDelayUs(), 50'000);
+}
+
+} // namespace
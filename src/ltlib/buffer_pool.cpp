@@ -0,0 +1,93 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "buffer_pool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace ltlib {
+
+BufferPool::BufferPool()
+    : BufferPool{Params{}} {}
+
+BufferPool::BufferPool(const Params& params)
+    : params_{params}
+    , classes_(classIndex(params.max_size) + 1) {
+    for (auto& blocks : classes_) {
+        blocks.reserve(params_.max_buffers_per_class);
+    }
+}
+
+std::shared_ptr<uint8_t[]> BufferPool::acquire(size_t size) {
+    std::lock_guard lock{mutex_};
+    stat_.acquires++;
+    if (size > params_.max_size) {
+        stat_.allocations++;
+        return std::shared_ptr<uint8_t[]>(new uint8_t[size]);
+    }
+    const size_t index = classIndex(size);
+    auto& blocks = classes_[index];
+    // 只有池子自己持有的缓冲区才是空闲的. 引用计数只会在持有mutex_时从1变大,
+    // 所以这里读到1就不会再被别人拿走
+    for (auto& block : blocks) {
+        if (block.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return std::shared_ptr<uint8_t[]>(block, block->data.get());
+        }
+    }
+    const size_t capacity = params_.min_size << index;
+    stat_.allocations++;
+    auto block = std::make_shared<Block>(capacity);
+    if (blocks.size() < params_.max_buffers_per_class) {
+        blocks.push_back(block);
+        stat_.reserved_bytes += capacity;
+        stat_.reserved_bytes_high_water =
+            std::max(stat_.reserved_bytes_high_water, stat_.reserved_bytes);
+    }
+    return std::shared_ptr<uint8_t[]>(block, block->data.get());
+}
+
+BufferPool::Stat BufferPool::stat() const {
+    std::lock_guard lock{mutex_};
+    return stat_;
+}
+
+size_t BufferPool::classIndex(size_t size) const {
+    size_t index = 0;
+    size_t capacity = params_.min_size;
+    while (capacity < size) {
+        capacity <<= 1;
+        index++;
+    }
+    return index;
+}
+
+} // namespace ltlib
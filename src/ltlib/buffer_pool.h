@@ -0,0 +1,85 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ltlib {
+
+// 按2的幂分级的缓冲区池. acquire()返回的shared_ptr引用计数归零后, 缓冲区回到池里,
+// 稳定运行时不再有任何堆分配(包括shared_ptr的控制块).
+class BufferPool {
+public:
+    struct Params {
+        size_t min_size = 4 * 1024;
+        // 超过这个大小的不进池子, 用完就释放
+        size_t max_size = 16 * 1024 * 1024;
+        // 每一级最多保留多少个缓冲区
+        size_t max_buffers_per_class = 16;
+    };
+    struct Stat {
+        uint64_t acquires = 0;
+        // 真正向系统申请内存的次数
+        uint64_t allocations = 0;
+        // 池子当前持有的内存, 包括正在被使用的
+        size_t reserved_bytes = 0;
+        size_t reserved_bytes_high_water = 0;
+    };
+
+public:
+    BufferPool();
+    explicit BufferPool(const Params& params);
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    std::shared_ptr<uint8_t[]> acquire(size_t size);
+    Stat stat() const;
+
+private:
+    struct Block {
+        explicit Block(size_t _capacity)
+            : data{new uint8_t[_capacity]}
+            , capacity{_capacity} {}
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity;
+    };
+    size_t classIndex(size_t size) const;
+
+private:
+    const Params params_;
+    mutable std::mutex mutex_;
+    std::vector<std::vector<std::shared_ptr<Block>>> classes_;
+    Stat stat_;
+};
+
+} // namespace ltlib
@@ -0,0 +1,74 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltlib/buffer_pool.h>
+
+namespace {
+
+TEST(BufferPoolTest, RoundsUpToSizeClass) {
+    ltlib::BufferPool::Params params{};
+    params.min_size = 1024;
+    params.max_size = 8 * 1024;
+    ltlib::BufferPool pool{params};
+
+    auto small = pool.acquire(1);
+    auto medium = pool.acquire(1025);
+    auto large = pool.acquire(8 * 1024);
+    ASSERT_NE(small, nullptr);
+    ASSERT_NE(medium, nullptr);
+    ASSERT_NE(large, nullptr);
+    EXPECT_EQ(pool.stat().reserved_bytes, 1024U + 2048U + 8192U);
+}
+
+TEST(BufferPoolTest, ReleasedBufferIsReused) {
+    ltlib::BufferPool pool;
+    uint8_t* first = nullptr;
+    {
+        auto buffer = pool.acquire(100 * 1024);
+        first = buffer.get();
+    }
+    auto buffer = pool.acquire(90 * 1024);
+    EXPECT_EQ(buffer.get(), first);
+    EXPECT_EQ(pool.stat().acquires, 2U);
+    EXPECT_EQ(pool.stat().allocations, 1U);
+}
+
+TEST(BufferPoolTest, BufferInUseIsNotHandedOutTwice) {
+    ltlib::BufferPool pool;
+    auto a = pool.acquire(4096);
+    auto b = pool.acquire(4096);
+    EXPECT_NE(a.get(), b.get());
+    auto copy = a;
+    a.reset();
+    auto c = pool.acquire(4096);
+    EXPECT_NE(c.get(), copy.get());
+    EXPECT_NE(c.get(), b.get());
+}
+
+TEST(BufferPoolTest, OversizedBufferIsNotRetained) {
+    ltlib::BufferPool::Params params{};
+    params.max_size = 64 * 1024;
+    ltlib::BufferPool pool{params};
+    {
+        auto buffer = pool.acquire(params.max_size + 1);
+        ASSERT_NE(buffer, nullptr);
+    }
+    EXPECT_EQ(pool.stat().reserved_bytes, 0U);
+    (void)pool.acquire(params.max_size + 1);
+    EXPECT_EQ(pool.stat().allocations, 2U);
+}
+
+TEST(BufferPoolTest, ClassCapacityIsBounded) {
+    ltlib::BufferPool::Params params{};
+    params.max_buffers_per_class = 2;
+    ltlib::BufferPool pool{params};
+    std::vector<std::shared_ptr<uint8_t[]>> held;
+    for (int i = 0; i < 4; i++) {
+        held.push_back(pool.acquire(4096));
+    }
+    EXPECT_EQ(pool.stat().reserved_bytes, 2U * 4096U);
+    EXPECT_EQ(pool.stat().allocations, 4U);
+}
+
+} // namespace
@@ -93,8 +93,10 @@ std::thread::id ThreadWatcher::mainThreadID() {
 }
 
 ThreadWatcher::ThreadWatcher(std::thread::id main_thread_id)
-    : main_thread_id_{main_thread_id}
-    , thread_{std::bind(&ThreadWatcher::checkLoop, this)} {}
+    : main_thread_id_{main_thread_id} {
+    // mutex_和cv_声明在thread_后面, 要等它们构造完再启动线程
+    thread_ = std::thread{std::bind(&ThreadWatcher::checkLoop, this)};
+}
 
 ThreadWatcher::~ThreadWatcher() {
     {
@@ -67,6 +67,7 @@
 
 #include <ltlib/system.h>
 #include <ltlib/times.h>
+#include <ltlib/versions.h>
 
 #include <transport/transport_rtc.h>
 #include <transport/transport_tcp.h>
@@ -288,6 +289,7 @@ bool WorkerSession::init(std::shared_ptr<google::protobuf::MessageLite> _msg,
                          ltlib::IOLoop* ioloop) {
     auto msg = std::static_pointer_cast<ltproto::server::OpenConnection>(_msg);
     client_device_id_ = msg->client_device_id();
+    client_version_ = msg->client_version();
     auth_token_ = msg->auth_token();
     service_id_ = msg->service_id();
     room_id_ = msg->room_id();
@@ -813,6 +815,7 @@ bool WorkerSession::sendBootstrapToWorker() {
     msg->set_full_range(worker_bootstrap_full_range_);
     msg->set_need_negotiate(worker_bootstrap_need_negotiate_);
     msg->set_trace_id(trace_id_);
+    msg->set_client_version(client_version_);
 
     sendToWorker(ltproto::id(msg), msg);
     return true;
@@ -856,6 +859,9 @@ void WorkerSession::onPipeMessage(uint32_t fd, uint32_t type,
         onChangeStreamingParams(msg);
         [[fallthrough]];
     case ltype::kCursorInfo:
+    case ltype::kControllerResponse:
+    case ltype::kGamepadAck:
+    case ltype::kInputLatencyReport:
         bypassToClient(type, msg);
         break;
     default:
@@ -876,6 +882,9 @@ void WorkerSession::onStartWorkingAck(std::shared_ptr<google::protobuf::MessageL
         first_start_working_ack_received_ = true;
         auto ack = std::make_shared<ltproto::client2worker::StartTransmissionAck>();
         ack->set_trace_id(trace_id_);
+        // 客户端按主机版本决定用不用新的消息格式
+        ack->set_host_version(
+            ltlib::combineVersion(LT_VERSION_MAJOR, LT_VERSION_MINOR, LT_VERSION_PATCH));
         if (msg->err_code() == ltproto::ErrorCode::Success) {
             ack->set_err_code(ltproto::ErrorCode::Success);
             for (uint32_t type : msg->msg_type()) {
@@ -1066,6 +1075,8 @@ void WorkerSession::onTpStat(void* user_data, uint32_t bwe_bps, uint32_t nack) {
     msg->set_nack(nack);
     msg->set_loss_rate(that->loss_rate_);
     LOG(DEBUG) << "BWE " << bwe_bps << " NACK " << nack;
+    // 丢包率也给worker, 用来调整Opus的FEC
+    that->sendToWorkerFromOtherThread(ltproto::id(msg), msg);
     that->postTask([that, msg]() { that->sendMessageToRemoteClient(ltproto::id(msg), msg, true); });
 }
 
@@ -1122,10 +1133,18 @@ void WorkerSession::onTimeSync(std::shared_ptr<google::protobuf::MessageLite> _m
     if (result.has_value()) {
         rtt_ = result->rtt;
         time_diff_ = result->time_diff;
+        time_synced_ = true;
         LOG(DEBUG) << "rtt:" << rtt_ << ", time_diff:" << time_diff_;
     }
 }
 
+int64_t WorkerSession::clientTimeToHost(int64_t client_us) const {
+    if (!time_synced_ || client_us == 0) {
+        return 0;
+    }
+    return client_us + time_diff_;
+}
+
 void WorkerSession::dispatchDcMessage(uint32_t type,
                                       const std::shared_ptr<google::protobuf::MessageLite>& msg) {
     updateLastRecvTime();
@@ -1164,6 +1183,9 @@ void WorkerSession::dispatchDcMessage(uint32_t type,
             stat->set_first_input_service_ack_timestamp_us(ltlib::steady_now_us());
             sendMessageToRemoteClient(ltproto::id(stat), stat, true);
         }
+        // worker里的执行端用本机时钟统计输入延迟
+        mouse_msg->set_client_send_timestamp_us(
+            clientTimeToHost(mouse_msg->client_send_timestamp_us()));
         if (mouse_msg->has_key_falg()) {
             postTask(
                 std::bind(&WorkerSession::sendConnectionStatus, this, false, false, false, true));
@@ -1193,6 +1215,7 @@ void WorkerSession::dispatchDcMessage(uint32_t type,
             stat->set_first_input_service_ack_timestamp_us(ltlib::steady_now_us());
             sendMessageToRemoteClient(ltproto::id(stat), stat, true);
         }
+        kb_msg->set_client_send_timestamp_us(clientTimeToHost(kb_msg->client_send_timestamp_us()));
         postTask(std::bind(&WorkerSession::sendConnectionStatus, this, false, false, true, false));
         if (!enable_keyboard_) {
             return;
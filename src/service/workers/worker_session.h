@@ -181,6 +181,8 @@ private:
     void onCapturedVideo(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onCapturedAudio(std::shared_ptr<google::protobuf::MessageLite> msg);
     void onTimeSync(std::shared_ptr<google::protobuf::MessageLite> msg);
+    // 客户端时钟换算成本机时钟, 还没对齐时返回0
+    int64_t clientTimeToHost(int64_t client_us) const;
     bool sendMessageToRemoteClient(uint32_t type,
                                    const std::shared_ptr<google::protobuf::MessageLite>& msg,
                                    bool reliable);
@@ -215,6 +217,7 @@ private:
     std::set<uint32_t> worker_registered_msg_;
     std::shared_ptr<WorkerProcess> worker_process_;
     int64_t client_device_id_ = 0;
+    int64_t client_version_ = 0;
     std::string service_id_;
     std::string room_id_;
     std::string trace_id_;
@@ -237,6 +240,7 @@ private:
     int64_t rtt_ = 0;
     uint32_t bwe_bps_ = 0;
     int64_t time_diff_ = 0;
+    bool time_synced_ = false;
     std::atomic<float> loss_rate_{.0f};
     bool is_p2p_ = false;
     bool signaling_keepalive_inited_ = false;
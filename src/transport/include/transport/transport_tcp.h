@@ -52,12 +52,17 @@ namespace lt {
 
 namespace tp { // transport
 
+// 和OnVideo一样, 但是把持有VideoFrame::data的对象一起交出去, 接收方可以延长它的生命周期而不用拷贝
+typedef void (*OnSharedVideo)(void*, const VideoFrame&, const std::shared_ptr<const void>&);
+
 class ClientTCP : public Client {
 public:
     struct Params {
         void* user_data;
         OnData on_data;
         OnVideo on_video;
+        // 可选, 设置了就不再回调on_video
+        OnSharedVideo on_shared_video = nullptr;
         OnAudio on_audio;
         OnConnected on_connected;
         OnFailed on_failed;
@@ -193,7 +193,13 @@ void ClientTCP::onMessage(uint32_t type, std::shared_ptr<google::protobuf::Messa
         video_frame.capture_timestamp_us = frame->capture_timestamp_us();
         video_frame.start_encode_timestamp_us = frame->start_encode_timestamp_us();
         video_frame.end_encode_timestamp_us = frame->end_encode_timestamp_us();
-        params_.on_video(params_.user_data, video_frame);
+        if (params_.on_shared_video != nullptr) {
+            // 解析出来的protobuf消息本身就持有码流, 直接交给对方
+            params_.on_shared_video(params_.user_data, video_frame, frame);
+        }
+        else {
+            params_.on_video(params_.user_data, video_frame);
+        }
         break;
     }
     case ltype::kAudioData:
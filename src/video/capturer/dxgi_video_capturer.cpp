@@ -230,16 +230,22 @@ bool DxgiVideoCapturer::initD3D11() {
 }
 
 std::optional<Capturer::Frame> DxgiVideoCapturer::capture() {
-    FRAME_DATA frame;
+    FRAME_DATA frame{};
     bool timeout = false;
     RECORD_T(point1);
     auto hr = impl_->GetFrame(&frame, &timeout);
     if (hr == DUPL_RETURN::DUPL_RETURN_SUCCESS && !timeout) {
         RECORD_T(point2);
         Capturer::Frame out_frame{};
+        const bool dirty_rects_known = saveDirtyRects(frame);
+        out_frame.dirty_rects = dirty_rects_known ? &dirty_rects_ : nullptr;
         if (capture_foramt_ == CaptureFormat::D3D11_BGRA) {
             out_frame.data = frame.Frame;
         }
+        else if (dirty_rects_known && dirty_rects_.empty() && mem_buff_valid_) {
+            // 只有鼠标动了, 画面和上一次转换的一样
+            out_frame.data = mem_buff_.data();
+        }
         else {
             auto mem_data = toI420(frame.Frame);
             if (mem_data == nullptr) {
@@ -287,6 +293,7 @@ uint8_t* DxgiVideoCapturer::toI420(ID3D11Texture2D* frame) {
     d3d11_ctx_->CopyResource(stage_texture_.Get(), frame);
     D3D11_MAPPED_SUBRESOURCE mapped{};
     UINT subres = D3D11CalcSubresource(0, 0, 0);
+    mem_buff_valid_ = false;
     HRESULT hr = d3d11_ctx_->Map(stage_texture_.Get(), subres, D3D11_MAP_READ, 0, &mapped);
     if (FAILED(hr)) {
         LOGF(ERR, "ID3D11DeviceContext::Map failed %#x", hr);
@@ -308,9 +315,38 @@ uint8_t* DxgiVideoCapturer::toI420(ID3D11Texture2D* frame) {
         LOG(ERR) << "rtc::ARGBToI420 failed " << ret;
         return nullptr;
     }
+    mem_buff_valid_ = true;
     return mem_buff_.data();
 }
 
+// 返回false表示不知道哪里变了
+bool DxgiVideoCapturer::saveDirtyRects(const FRAME_DATA& frame) {
+    dirty_rects_.clear();
+    if (frame.FrameInfo.LastPresentTime.QuadPart == 0) {
+        // 桌面图像没有更新, 只是鼠标位置或形状变了
+        return true;
+    }
+    if (frame.FrameInfo.TotalMetadataBufferSize == 0 || frame.MetaData == nullptr) {
+        return false;
+    }
+    auto to_dirty_rect = [](const RECT& rect) {
+        return DirtyRect{static_cast<uint32_t>(rect.left), static_cast<uint32_t>(rect.top),
+                         static_cast<uint32_t>(rect.right - rect.left),
+                         static_cast<uint32_t>(rect.bottom - rect.top)};
+    };
+    // 移动的区域只有目标位置的内容变了, 源位置如果也变了会出现在dirty rects里
+    auto move_rects = reinterpret_cast<const DXGI_OUTDUPL_MOVE_RECT*>(frame.MetaData);
+    for (UINT i = 0; i < frame.MoveCount; i++) {
+        dirty_rects_.push_back(to_dirty_rect(move_rects[i].DestinationRect));
+    }
+    auto rects = reinterpret_cast<const RECT*>(frame.MetaData +
+                                               frame.MoveCount * sizeof(DXGI_OUTDUPL_MOVE_RECT));
+    for (UINT i = 0; i < frame.DirtyCount; i++) {
+        dirty_rects_.push_back(to_dirty_rect(rects[i]));
+    }
+    return true;
+}
+
 void DxgiVideoCapturer::saveCursorInfo(DXGI_OUTDUPL_FRAME_INFO* frame_info) {
     if (frame_info->LastMouseUpdateTime.QuadPart <= 0) {
         return;
@@ -67,6 +67,7 @@ private:
     bool initD3D11();
     uint8_t* toI420(ID3D11Texture2D* frame);
     void saveCursorInfo(DXGI_OUTDUPL_FRAME_INFO* frame_info);
+    bool saveDirtyRects(const FRAME_DATA& frame);
 
 private:
     std::unique_ptr<DUPLICATIONMANAGER> impl_;
@@ -75,6 +76,9 @@ private:
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3d11_ctx_;
     Microsoft::WRL::ComPtr<ID3D11Texture2D> stage_texture_;
     std::vector<uint8_t> mem_buff_;
+    // mem_buff_里是上一次成功转换的画面
+    bool mem_buff_valid_ = false;
+    std::vector<DirtyRect> dirty_rects_;
     int64_t luid_ = 0;
     uint32_t vendor_id_ = 0;
     ltlib::Monitor monitor_;
@@ -0,0 +1,623 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "synthetic_video_capturer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <thread>
+
+#include <ltlib/logging.h>
+#include <ltlib/times.h>
+
+namespace {
+
+using lt::video::DirtyRect;
+
+constexpr uint32_t kGlyphWidth = 8;
+constexpr uint32_t kLineHeight = 16;
+constexpr uint32_t kTextMargin = 8;
+constexpr uint32_t kTitleBarHeight = 24;
+constexpr uint32_t kScrollPixelsPerFrame = 2;
+// 60fps下每秒敲10个字符
+constexpr uint64_t kTypingFramesPerKey = 6;
+
+// splitmix64
+uint64_t mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+uint64_t hash(uint64_t a, uint64_t b) {
+    return mix(a ^ mix(b));
+}
+
+uint32_t bgra(uint32_t r, uint32_t g, uint32_t b) {
+    return 0xFF000000u | ((r & 0xFF) << 16) | ((g & 0xFF) << 8) | (b & 0xFF);
+}
+
+uint8_t clampByte(int32_t value) {
+    return static_cast<uint8_t>(std::clamp(value, 0, 255));
+}
+
+uint32_t alignDown2(uint32_t value) {
+    return value & ~1u;
+}
+
+void fillRect(std::vector<uint32_t>& buf, uint32_t buf_width, uint32_t buf_height, int64_t x,
+              int64_t y, int64_t w, int64_t h, uint32_t color) {
+    const int64_t x0 = std::max<int64_t>(0, x);
+    const int64_t y0 = std::max<int64_t>(0, y);
+    const int64_t x1 = std::min<int64_t>(buf_width, x + w);
+    const int64_t y1 = std::min<int64_t>(buf_height, y + h);
+    for (int64_t row = y0; row < y1; row++) {
+        std::fill_n(buf.data() + row * buf_width + x0, std::max<int64_t>(0, x1 - x0), color);
+    }
+}
+
+// 5x7点阵, 每个字符的形状由seed决定, 看起来像文字就够了
+uint64_t glyphBits(uint64_t seed, uint32_t code) {
+    return hash(seed, 0x10000 + code) & ((1ull << 35) - 1);
+}
+
+// 第line行第col个字符, 0表示空白
+uint32_t charAt(uint64_t seed, uint64_t line, uint32_t col) {
+    const uint64_t h = hash(seed, line);
+    const uint32_t indent = static_cast<uint32_t>(h >> 8) % 4 * 2;
+    const uint32_t length = static_cast<uint32_t>(h % 100);
+    if (col < indent || col >= length) {
+        return 0;
+    }
+    const uint32_t code = static_cast<uint32_t>(hash(h, col) % 80);
+    // 大约1/6是空格
+    return code < 13 ? 0 : code;
+}
+
+// 在area里画文字的[row_begin, row_end)像素行, 文字整体向上滚动了scroll_px像素
+void drawTextRows(std::vector<uint32_t>& buf, uint32_t buf_width, const DirtyRect& area,
+                  uint64_t seed, uint64_t scroll_px, uint32_t row_begin, uint32_t row_end,
+                  uint32_t fg, uint32_t bg) {
+    const uint32_t cols =
+        area.width > kTextMargin * 2 ? (area.width - kTextMargin * 2) / kGlyphWidth : 0;
+    for (uint32_t r = row_begin; r < row_end; r++) {
+        uint32_t* px = buf.data() + static_cast<size_t>(area.y + r) * buf_width + area.x;
+        std::fill_n(px, area.width, bg);
+        const uint64_t y_abs = scroll_px + r;
+        const uint64_t line = y_abs / kLineHeight;
+        const int32_t gy = static_cast<int32_t>(y_abs % kLineHeight) - 4;
+        if (gy < 0 || gy >= 7) {
+            continue;
+        }
+        for (uint32_t col = 0; col < cols; col++) {
+            const uint32_t code = charAt(seed, line, col);
+            if (code == 0) {
+                continue;
+            }
+            const uint32_t bits = static_cast<uint32_t>(glyphBits(seed, code) >> (gy * 5)) & 0x1F;
+            uint32_t* cell = px + kTextMargin + col * kGlyphWidth + 1;
+            for (uint32_t b = 0; b < 5; b++) {
+                if (bits & (1u << b)) {
+                    cell[b] = fg;
+                }
+            }
+        }
+    }
+}
+
+// 把一个字符格(kGlyphWidth x kLineHeight)填成bg, 再按drawTextRows()的位置画上字形
+void drawGlyphCell(std::vector<uint32_t>& buf, uint32_t buf_width, uint32_t x, uint32_t y,
+                   uint64_t bits, uint32_t fg, uint32_t bg) {
+    for (uint32_t r = 0; r < kLineHeight; r++) {
+        uint32_t* px = buf.data() + static_cast<size_t>(y + r) * buf_width + x;
+        std::fill_n(px, kGlyphWidth, bg);
+        const int32_t gy = static_cast<int32_t>(r) - 4;
+        if (gy < 0 || gy >= 7) {
+            continue;
+        }
+        const uint32_t row_bits = static_cast<uint32_t>(bits >> (gy * 5)) & 0x1F;
+        for (uint32_t b = 0; b < 5; b++) {
+            if (row_bits & (1u << b)) {
+                px[1 + b] = fg;
+            }
+        }
+    }
+}
+
+uint32_t triangle(uint64_t value, uint32_t range) {
+    if (range == 0) {
+        return 0;
+    }
+    const uint64_t p = value % (2ull * range);
+    return static_cast<uint32_t>(p <= range ? p : 2ull * range - p);
+}
+
+bool intersects(const DirtyRect& a, const DirtyRect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height &&
+           b.y < a.y + a.height;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+std::unique_ptr<SyntheticCapturer> SyntheticCapturer::create(const Params& params) {
+    std::unique_ptr<SyntheticCapturer> capturer{new SyntheticCapturer(params)};
+    if (!capturer->init()) {
+        return nullptr;
+    }
+    return capturer;
+}
+
+SyntheticCapturer::SyntheticCapturer(const Params& params)
+    : params_{params}
+    , interval_us_{params.fps == 0 ? 0 : 1'000'000 / static_cast<int64_t>(params.fps)} {}
+
+SyntheticCapturer::~SyntheticCapturer() = default;
+
+bool SyntheticCapturer::init() {
+    // I420要求宽高都是偶数
+    if (params_.width < 16 || params_.height < 16 || params_.width % 2 != 0 ||
+        params_.height % 2 != 0 || params_.fps == 0) {
+        LOGF(ERR, "Invalid SyntheticCapturer params w:%u, h:%u, fps:%u", params_.width,
+             params_.height, params_.fps);
+        return false;
+    }
+    const size_t pixels = static_cast<size_t>(params_.width) * params_.height;
+    canvas_.resize(pixels);
+    desktop_.resize(pixels);
+    i420_.resize(pixels * 3 / 2);
+    drawDesktop();
+    drawWindowSprite();
+    LOGF(INFO, "SyntheticCapturer %ux%u@%u content:%s seed:%" PRIu64, params_.width,
+         params_.height, params_.fps, toString(params_.content), params_.seed);
+    return true;
+}
+
+bool SyntheticCapturer::start() {
+    return true;
+}
+
+std::optional<Capturer::Frame> SyntheticCapturer::capture() {
+    const uint64_t index = frame_index_++;
+    dirty_rects_.clear();
+    drawFrame(index);
+    if (format_ == CaptureFormat::MEM_I420) {
+        for (const auto& rect : dirty_rects_) {
+            convertToI420(rect);
+        }
+    }
+    Capturer::Frame frame{};
+    frame.data = format_ == CaptureFormat::MEM_BGRA ? static_cast<void*>(canvas_.data())
+                                                    : static_cast<void*>(i420_.data());
+    frame.capture_timestamp_us = ltlib::steady_now_us();
+    frame.dirty_rects = &dirty_rects_;
+    return frame;
+}
+
+std::optional<CursorInfo> SyntheticCapturer::cursorInfo() {
+    return std::nullopt;
+}
+
+void SyntheticCapturer::doneWithFrame() {}
+
+void SyntheticCapturer::waitForVBlank() {
+    const int64_t now = ltlib::steady_now_us();
+    // 第一次, 或者落后超过一帧, 就从现在重新计时, 不追帧
+    if (next_vblank_us_ < 0 || now - next_vblank_us_ > interval_us_) {
+        next_vblank_us_ = now + interval_us_;
+        return;
+    }
+    if (next_vblank_us_ > now) {
+        std::this_thread::sleep_for(std::chrono::microseconds{next_vblank_us_ - now});
+    }
+    next_vblank_us_ += interval_us_;
+}
+
+Capturer::Backend SyntheticCapturer::backend() const {
+    return Backend::Synthetic;
+}
+
+void* SyntheticCapturer::device() {
+    return nullptr;
+}
+
+void* SyntheticCapturer::deviceContext() {
+    return nullptr;
+}
+
+uint32_t SyntheticCapturer::vendorID() {
+    return 0;
+}
+
+bool SyntheticCapturer::defaultOutput() {
+    return true;
+}
+
+bool SyntheticCapturer::setCaptureFormat(CaptureFormat format) {
+    switch (format) {
+    case CaptureFormat::MEM_I420:
+    case CaptureFormat::MEM_BGRA:
+        if (format != format_) {
+            format_ = format;
+            // 换格式后从第0帧重新开始, 保证下一帧整帧输出
+            frame_index_ = 0;
+        }
+        return true;
+    default:
+        LOG(ERR) << "SyntheticCapturer: Unsupported CaptureFormat " << (int)format;
+        return false;
+    }
+}
+
+ColorPrimaries SyntheticCapturer::colorPrimaries() {
+    return ColorPrimaries::BT709;
+}
+
+uint32_t SyntheticCapturer::width() const {
+    return params_.width;
+}
+
+uint32_t SyntheticCapturer::height() const {
+    return params_.height;
+}
+
+uint64_t SyntheticCapturer::frameIndex() const {
+    return frame_index_;
+}
+
+const char* SyntheticCapturer::toString(Content content) {
+    switch (content) {
+    case Content::StaticDesktop:
+        return "static";
+    case Content::ScrollingText:
+        return "scrolling_text";
+    case Content::Noise:
+        return "noise";
+    case Content::MovingWindow:
+        return "moving_window";
+    case Content::Typing:
+        return "typing";
+    default:
+        return "unknown";
+    }
+}
+
+std::optional<SyntheticCapturer::Content>
+SyntheticCapturer::contentFromString(const std::string& str) {
+    for (auto content : {Content::StaticDesktop, Content::ScrollingText, Content::Noise,
+                         Content::MovingWindow, Content::Typing}) {
+        if (str == toString(content)) {
+            return content;
+        }
+    }
+    return std::nullopt;
+}
+
+SyntheticCapturer::Params SyntheticCapturer::paramsFromMonitor(const ltlib::Monitor& monitor) {
+    Params params{};
+    if (monitor.width > 0 && monitor.height > 0) {
+        params.width = static_cast<uint32_t>(monitor.width);
+        params.height = static_cast<uint32_t>(monitor.height);
+    }
+    if (monitor.frequency > 0) {
+        params.fps = static_cast<uint32_t>(monitor.frequency);
+    }
+    return params;
+}
+
+void SyntheticCapturer::drawFrame(uint64_t index) {
+    const DirtyRect full{0, 0, params_.width, params_.height};
+    switch (params_.content) {
+    case Content::StaticDesktop:
+        if (index == 0) {
+            canvas_ = desktop_;
+            addDirtyRect(full);
+        }
+        break;
+    case Content::ScrollingText:
+    {
+        const DirtyRect term = terminalRect();
+        if (index == 0) {
+            canvas_ = desktop_;
+            drawTerminalRows(index, 0, term.height);
+            addDirtyRect(full);
+            break;
+        }
+        // 上一帧的内容整体上移, 只需要画底部新露出来的几行
+        const uint32_t shift = std::min(kScrollPixelsPerFrame, term.height);
+        for (uint32_t r = 0; r + shift < term.height; r++) {
+            uint32_t* dst = canvas_.data() + static_cast<size_t>(term.y + r) * params_.width;
+            const uint32_t* src = dst + static_cast<size_t>(shift) * params_.width;
+            memcpy(dst + term.x, src + term.x, term.width * sizeof(uint32_t));
+        }
+        drawTerminalRows(index, term.height - shift, term.height);
+        addDirtyRect(term);
+        break;
+    }
+    case Content::Noise:
+        drawNoise(index);
+        addDirtyRect(full);
+        break;
+    case Content::MovingWindow:
+    {
+        const DirtyRect rect = windowRectAt(index);
+        if (index == 0 || !last_window_rect_.has_value()) {
+            canvas_ = desktop_;
+            blitWindow(rect.x, rect.y);
+            addDirtyRect(full);
+        }
+        else if (last_window_rect_->x != rect.x || last_window_rect_->y != rect.y) {
+            restoreBackground(*last_window_rect_);
+            blitWindow(rect.x, rect.y);
+            addDirtyRect(*last_window_rect_);
+            addDirtyRect(rect);
+        }
+        last_window_rect_ = rect;
+        break;
+    }
+    case Content::Typing:
+        drawTyping(index);
+        break;
+    default:
+        break;
+    }
+}
+
+void SyntheticCapturer::drawDesktop() {
+    const uint32_t w = params_.width;
+    const uint32_t h = params_.height;
+    const uint64_t palette = hash(params_.seed, 1);
+    const uint32_t r0 = palette & 0x3F;
+    const uint32_t g0 = (palette >> 8) & 0x3F;
+    const uint32_t b0 = 64 + ((palette >> 16) & 0x3F);
+    for (uint32_t y = 0; y < h; y++) {
+        const uint32_t t = y * 96 / h;
+        std::fill_n(desktop_.data() + static_cast<size_t>(y) * w, w,
+                    bgra(r0 + t / 2, g0 + t, b0 + t));
+    }
+    // 左上角一列图标
+    const uint32_t icon = std::max(8u, std::min(w, h) / 20);
+    for (uint32_t i = 0; i < 6; i++) {
+        const uint64_t c = hash(params_.seed, 100 + i);
+        fillRect(desktop_, w, h, icon / 2, icon / 2 + i * icon * 2, icon, icon,
+                 bgra(static_cast<uint32_t>(c), static_cast<uint32_t>(c >> 8),
+                      static_cast<uint32_t>(c >> 16)));
+    }
+    // 任务栏
+    const uint32_t bar = std::max(8u, h / 27);
+    fillRect(desktop_, w, h, 0, h - bar, w, bar, bgra(32, 32, 40));
+    for (uint32_t i = 0; i < 8; i++) {
+        fillRect(desktop_, w, h, bar + i * bar * 3, h - bar + 4, bar * 2, bar - 8,
+                 bgra(64, 64, 80));
+    }
+    // 两个静止的窗口
+    for (uint32_t i = 0; i < 2; i++) {
+        const uint64_t r = hash(params_.seed, 200 + i);
+        const DirtyRect win{alignDown2(w / 6 + static_cast<uint32_t>(r % (w / 3 + 1))),
+                            alignDown2(h / 10 + static_cast<uint32_t>((r >> 20) % (h / 3 + 1))),
+                            alignDown2(w * 2 / 5), alignDown2(h * 2 / 5)};
+        fillRect(desktop_, w, h, win.x, win.y, win.width, kTitleBarHeight, bgra(40, 90, 160));
+        const int64_t client_h = static_cast<int64_t>(win.height) - kTitleBarHeight;
+        if (client_h <= 0 || win.x >= w || win.y + kTitleBarHeight >= h) {
+            continue;
+        }
+        const DirtyRect client{win.x, win.y + kTitleBarHeight, std::min(win.width, w - win.x),
+                               std::min<uint32_t>(static_cast<uint32_t>(client_h),
+                                                  h - win.y - kTitleBarHeight)};
+        drawTextRows(desktop_, w, client, hash(params_.seed, 300 + i), 0, 0, client.height,
+                     bgra(20, 20, 20), bgra(250, 250, 250));
+    }
+    // 终端窗口的标题栏, 滚动的内容在drawTerminalRows()里画
+    if (params_.content == Content::ScrollingText || params_.content == Content::Typing) {
+        const DirtyRect term = terminalRect();
+        fillRect(desktop_, w, h, term.x, static_cast<int64_t>(term.y) - kTitleBarHeight,
+                 term.width, kTitleBarHeight, bgra(70, 70, 70));
+    }
+}
+
+void SyntheticCapturer::drawWindowSprite() {
+    const DirtyRect rect = windowRectAt(0);
+    window_sprite_.resize(static_cast<size_t>(rect.width) * rect.height);
+    fillRect(window_sprite_, rect.width, rect.height, 0, 0, rect.width,
+             std::min(kTitleBarHeight, rect.height), bgra(160, 60, 40));
+    if (rect.height > kTitleBarHeight) {
+        const DirtyRect client{0, kTitleBarHeight, rect.width, rect.height - kTitleBarHeight};
+        drawTextRows(window_sprite_, rect.width, client, hash(params_.seed, 400), 0, 0,
+                     client.height, bgra(230, 230, 230), bgra(30, 30, 36));
+    }
+}
+
+void SyntheticCapturer::drawTerminalRows(uint64_t index, uint32_t first_row, uint32_t rows) {
+    drawTextRows(canvas_, params_.width, terminalRect(), hash(params_.seed, 500),
+                 index * kScrollPixelsPerFrame, first_row, rows, bgra(200, 220, 200),
+                 bgra(12, 12, 12));
+}
+
+void SyntheticCapturer::drawNoise(uint64_t index) {
+    // 缓慢移动的渐变叠加每帧不同的噪声, 编码器看来和视频差不多: 整帧都在变, 有运动也有细节
+    const uint32_t t = static_cast<uint32_t>(index);
+    for (uint32_t y = 0; y < params_.height; y++) {
+        uint64_t state = hash(params_.seed ^ mix(index), y) | 1;
+        uint32_t* px = canvas_.data() + static_cast<size_t>(y) * params_.width;
+        for (uint32_t x = 0; x < params_.width; x++) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            const int32_t noise = static_cast<int32_t>(state & 0x1F) - 16;
+            const int32_t r = static_cast<int32_t>(((x + y) / 2 + t * 3) & 0xFF);
+            const int32_t g = static_cast<int32_t>((y + t) & 0xFF);
+            const int32_t b = static_cast<int32_t>((x + t * 2) & 0xFF);
+            px[x] = bgra(clampByte(r + noise), clampByte(g + noise), clampByte(b + noise));
+        }
+    }
+}
+
+void SyntheticCapturer::drawTyping(uint64_t index) {
+    const DirtyRect term = terminalRect();
+    const uint32_t fg = bgra(200, 220, 200);
+    const uint32_t bg = bgra(12, 12, 12);
+    if (index == 0) {
+        canvas_ = desktop_;
+        fillRect(canvas_, params_.width, params_.height, term.x, term.y, term.width, term.height,
+                 bg);
+        addDirtyRect(DirtyRect{0, 0, params_.width, params_.height});
+    }
+    else if (index % kTypingFramesPerKey != 0) {
+        return;
+    }
+    const uint32_t cols =
+        term.width > kTextMargin * 2 ? (term.width - kTextMargin * 2) / kGlyphWidth : 0;
+    const uint32_t rows = term.height / kLineHeight;
+    if (cols == 0 || rows == 0) {
+        return;
+    }
+    const uint64_t cells = static_cast<uint64_t>(cols) * rows;
+    auto cellRect = [&](uint64_t pos) {
+        return DirtyRect{term.x + kTextMargin + static_cast<uint32_t>(pos % cols) * kGlyphWidth,
+                         term.y + static_cast<uint32_t>(pos / cols) * kLineHeight, kGlyphWidth,
+                         kLineHeight};
+    };
+    // 第typed个字符写在光标处, 光标后移一格. 写满后清屏从头开始
+    const uint64_t typed = index / kTypingFramesPerKey;
+    const uint64_t pos = typed == 0 ? 0 : (typed - 1) % cells;
+    if (typed > 0) {
+        if (pos == 0 && typed > 1) {
+            fillRect(canvas_, params_.width, params_.height, term.x, term.y, term.width,
+                     term.height, bg);
+            addDirtyRect(term);
+        }
+        const uint64_t code = hash(params_.seed ^ 600, typed) % 80;
+        // 大约1/6是空格
+        const uint64_t bits = code < 13 ? 0 : glyphBits(params_.seed, static_cast<uint32_t>(code));
+        const DirtyRect rect = cellRect(pos);
+        drawGlyphCell(canvas_, params_.width, rect.x, rect.y, bits, fg, bg);
+        addDirtyRect(rect);
+    }
+    const uint64_t cursor_pos = typed == 0 ? 0 : pos + 1;
+    if (cursor_pos < cells) {
+        const DirtyRect rect = cellRect(cursor_pos);
+        // 实心方块光标
+        drawGlyphCell(canvas_, params_.width, rect.x, rect.y, 0, fg, fg);
+        addDirtyRect(rect);
+    }
+}
+
+void SyntheticCapturer::restoreBackground(const DirtyRect& rect) {
+    for (uint32_t r = 0; r < rect.height; r++) {
+        const size_t offset = static_cast<size_t>(rect.y + r) * params_.width + rect.x;
+        memcpy(canvas_.data() + offset, desktop_.data() + offset, rect.width * sizeof(uint32_t));
+    }
+}
+
+void SyntheticCapturer::blitWindow(uint32_t x, uint32_t y) {
+    const DirtyRect rect = windowRectAt(0);
+    for (uint32_t r = 0; r < rect.height; r++) {
+        memcpy(canvas_.data() + static_cast<size_t>(y + r) * params_.width + x,
+               window_sprite_.data() + static_cast<size_t>(r) * rect.width,
+               rect.width * sizeof(uint32_t));
+    }
+}
+
+DirtyRect SyntheticCapturer::windowRectAt(uint64_t index) const {
+    const uint32_t w = alignDown2(std::max(16u, params_.width / 3));
+    const uint32_t h = alignDown2(std::max(16u, params_.height / 3));
+    // 每帧水平移动6像素, 垂直移动4像素, 碰到边缘反弹
+    const uint32_t x = alignDown2(triangle(index * 6, params_.width - w));
+    const uint32_t y = alignDown2(triangle(index * 4, params_.height - h));
+    return DirtyRect{x, y, w, h};
+}
+
+DirtyRect SyntheticCapturer::terminalRect() const {
+    const uint32_t x = alignDown2(params_.width / 8);
+    const uint32_t y = alignDown2(std::max(params_.height / 8, kTitleBarHeight));
+    return DirtyRect{x, y, alignDown2(params_.width * 3 / 4),
+                     alignDown2(std::min(params_.height * 3 / 4, params_.height - y))};
+}
+
+void SyntheticCapturer::addDirtyRect(DirtyRect rect) {
+    // 和已有的区域重叠就合并成外接矩形, 保证输出的区域互不重叠
+    for (auto it = dirty_rects_.begin(); it != dirty_rects_.end(); ++it) {
+        if (intersects(*it, rect)) {
+            const uint32_t x0 = std::min(it->x, rect.x);
+            const uint32_t y0 = std::min(it->y, rect.y);
+            const uint32_t x1 = std::max(it->x + it->width, rect.x + rect.width);
+            const uint32_t y1 = std::max(it->y + it->height, rect.y + rect.height);
+            dirty_rects_.erase(it);
+            addDirtyRect(DirtyRect{x0, y0, x1 - x0, y1 - y0});
+            return;
+        }
+    }
+    dirty_rects_.push_back(rect);
+}
+
+void SyntheticCapturer::convertToI420(const DirtyRect& rect) {
+    // BT.601 limited range, 和DxgiVideoCapturer里用的rtc::ARGBToI420一致
+    const uint32_t w = params_.width;
+    const uint32_t h = params_.height;
+    uint8_t* y_plane = i420_.data();
+    uint8_t* u_plane = y_plane + static_cast<size_t>(w) * h;
+    uint8_t* v_plane = u_plane + static_cast<size_t>(w / 2) * (h / 2);
+    for (uint32_t y = rect.y; y < rect.y + rect.height; y += 2) {
+        for (uint32_t x = rect.x; x < rect.x + rect.width; x += 2) {
+            int32_t sum_r = 0;
+            int32_t sum_g = 0;
+            int32_t sum_b = 0;
+            for (uint32_t dy = 0; dy < 2; dy++) {
+                for (uint32_t dx = 0; dx < 2; dx++) {
+                    const uint32_t p = canvas_[static_cast<size_t>(y + dy) * w + x + dx];
+                    const int32_t r = (p >> 16) & 0xFF;
+                    const int32_t g = (p >> 8) & 0xFF;
+                    const int32_t b = p & 0xFF;
+                    y_plane[static_cast<size_t>(y + dy) * w + x + dx] =
+                        static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                    sum_r += r;
+                    sum_g += g;
+                    sum_b += b;
+                }
+            }
+            const int32_t r = (sum_r + 2) / 4;
+            const int32_t g = (sum_g + 2) / 4;
+            const int32_t b = (sum_b + 2) / 4;
+            const size_t uv = static_cast<size_t>(y / 2) * (w / 2) + x / 2;
+            u_plane[uv] = clampByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[uv] = clampByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,130 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <video/capturer/video_capturer.h>
+
+namespace lt {
+
+namespace video {
+
+// 生成合成画面的采集器, 用于在没有显卡和桌面的机器上跑/测量采集编码流水线.
+// 第N帧的内容只由Params和N决定, 同样的参数(包括seed)总是得到一模一样的帧序列.
+// 支持MEM_I420和MEM_BGRA, 并且给出准确的脏区域. 脏区域的坐标和宽高都对齐到偶数
+class SyntheticCapturer : public Capturer {
+public:
+    enum class Content {
+        // 静止的桌面, 第一帧之后不再变化
+        StaticDesktop,
+        // 桌面上一个终端窗口, 文字不断向上滚动
+        ScrollingText,
+        // 整帧每一帧都在变, 接近播放视频
+        Noise,
+        // 静止桌面上一个窗口来回移动
+        MovingWindow,
+        // 在终端里打字, 每隔几帧多一个字符, 其余的帧完全不变
+        Typing,
+    };
+    struct Params {
+        uint32_t width = 1920;
+        uint32_t height = 1080;
+        uint32_t fps = 60;
+        Content content = Content::StaticDesktop;
+        uint64_t seed = 0;
+    };
+
+public:
+    static std::unique_ptr<SyntheticCapturer> create(const Params& params);
+    ~SyntheticCapturer() override;
+    bool start() override;
+    std::optional<Capturer::Frame> capture() override;
+    std::optional<CursorInfo> cursorInfo() override;
+    void doneWithFrame() override;
+    // 按fps节奏等到下一帧的时间点
+    void waitForVBlank() override;
+    Backend backend() const override;
+    void* device() override;
+    void* deviceContext() override;
+    uint32_t vendorID() override;
+    bool defaultOutput() override;
+    bool setCaptureFormat(CaptureFormat format) override;
+    ColorPrimaries colorPrimaries() override;
+
+    uint32_t width() const;
+    uint32_t height() const;
+    // 下一次capture()生成的帧序号, 从0开始
+    uint64_t frameIndex() const;
+
+    static const char* toString(Content content);
+    static std::optional<Content> contentFromString(const std::string& str);
+    // 分辨率和帧率取monitor的(有效时), 其余为默认值
+    static Params paramsFromMonitor(const ltlib::Monitor& monitor);
+
+private:
+    SyntheticCapturer(const Params& params);
+    bool init() override;
+    void drawFrame(uint64_t index);
+    void drawDesktop();
+    void drawWindowSprite();
+    void drawTerminalRows(uint64_t index, uint32_t first_row, uint32_t rows);
+    void drawNoise(uint64_t index);
+    void drawTyping(uint64_t index);
+    void restoreBackground(const DirtyRect& rect);
+    void blitWindow(uint32_t x, uint32_t y);
+    DirtyRect windowRectAt(uint64_t index) const;
+    DirtyRect terminalRect() const;
+    void addDirtyRect(DirtyRect rect);
+    void convertToI420(const DirtyRect& rect);
+
+private:
+    const Params params_;
+    const int64_t interval_us_;
+    CaptureFormat format_ = CaptureFormat::MEM_I420;
+    uint64_t frame_index_ = 0;
+    int64_t next_vblank_us_ = -1;
+    // 当前画面, 每个像素按字节是B,G,R,A
+    std::vector<uint32_t> canvas_;
+    // 不带终端和移动窗口的桌面
+    std::vector<uint32_t> desktop_;
+    std::vector<uint32_t> window_sprite_;
+    std::vector<uint8_t> i420_;
+    std::vector<DirtyRect> dirty_rects_;
+    std::optional<DirtyRect> last_window_rect_;
+};
+
+} // namespace video
+
+} // namespace lt
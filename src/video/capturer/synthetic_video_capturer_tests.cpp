@@ -0,0 +1,279 @@
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/capturer/synthetic_video_capturer.h>
+
+namespace {
+
+using lt::video::CaptureFormat;
+using lt::video::Capturer;
+using lt::video::DirtyRect;
+using lt::video::SyntheticCapturer;
+
+constexpr uint32_t kWidth = 320;
+constexpr uint32_t kHeight = 180;
+
+const SyntheticCapturer::Content kAllContents[] = {
+    SyntheticCapturer::Content::StaticDesktop, SyntheticCapturer::Content::ScrollingText,
+    SyntheticCapturer::Content::Noise, SyntheticCapturer::Content::MovingWindow,
+    SyntheticCapturer::Content::Typing};
+
+std::unique_ptr<SyntheticCapturer> makeCapturer(SyntheticCapturer::Content content,
+                                                uint64_t seed, CaptureFormat format) {
+    SyntheticCapturer::Params params{};
+    params.width = kWidth;
+    params.height = kHeight;
+    params.content = content;
+    params.seed = seed;
+    auto capturer = SyntheticCapturer::create(params);
+    if (capturer != nullptr) {
+        capturer->setCaptureFormat(format);
+    }
+    return capturer;
+}
+
+std::vector<uint8_t> captureBytes(SyntheticCapturer& capturer, size_t size,
+                                  std::vector<DirtyRect>* dirty = nullptr) {
+    auto frame = capturer.capture();
+    EXPECT_TRUE(frame.has_value());
+    EXPECT_NE(frame->dirty_rects, nullptr);
+    if (dirty != nullptr) {
+        *dirty = *frame->dirty_rects;
+    }
+    const auto* data = static_cast<const uint8_t*>(frame->data);
+    std::vector<uint8_t> bytes{data, data + size};
+    capturer.doneWithFrame();
+    return bytes;
+}
+
+constexpr size_t kI420Size = kWidth * kHeight * 3 / 2;
+constexpr size_t kBgraSize = kWidth * kHeight * 4;
+
+bool inside(const std::vector<DirtyRect>& rects, uint32_t x, uint32_t y) {
+    for (const auto& r : rects) {
+        if (x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 整帧按BT.601 limited range转成I420, 和实现无关的参考结果
+std::vector<uint8_t> referenceI420(const std::vector<uint8_t>& bgra) {
+    std::vector<uint8_t> out(kI420Size);
+    auto at = [&](uint32_t x, uint32_t y, int c) {
+        return static_cast<int32_t>(bgra[(static_cast<size_t>(y) * kWidth + x) * 4 + c]);
+    };
+    for (uint32_t y = 0; y < kHeight; y++) {
+        for (uint32_t x = 0; x < kWidth; x++) {
+            const int32_t b = at(x, y, 0), g = at(x, y, 1), r = at(x, y, 2);
+            out[y * kWidth + x] =
+                static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+    uint8_t* u = out.data() + kWidth * kHeight;
+    uint8_t* v = u + kWidth * kHeight / 4;
+    for (uint32_t y = 0; y < kHeight; y += 2) {
+        for (uint32_t x = 0; x < kWidth; x += 2) {
+            int32_t sum[3] = {0, 0, 0};
+            for (int c = 0; c < 3; c++) {
+                sum[c] = at(x, y, c) + at(x + 1, y, c) + at(x, y + 1, c) + at(x + 1, y + 1, c);
+            }
+            const int32_t b = (sum[0] + 2) / 4, g = (sum[1] + 2) / 4, r = (sum[2] + 2) / 4;
+            const size_t i = y / 2 * (kWidth / 2) + x / 2;
+            u[i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v[i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(SyntheticCapturerTest, RejectsInvalidParams) {
+    SyntheticCapturer::Params params{};
+    params.width = 321;
+    params.height = 180;
+    EXPECT_EQ(SyntheticCapturer::create(params), nullptr);
+    params.width = 320;
+    params.fps = 0;
+    EXPECT_EQ(SyntheticCapturer::create(params), nullptr);
+}
+
+TEST(SyntheticCapturerTest, CreateFromBackend) {
+    ltlib::Monitor monitor{};
+    monitor.width = 640;
+    monitor.height = 360;
+    monitor.frequency = 30;
+    auto capturer = Capturer::create(Capturer::Backend::Synthetic, monitor);
+    ASSERT_NE(capturer, nullptr);
+    EXPECT_EQ(capturer->backend(), Capturer::Backend::Synthetic);
+    EXPECT_TRUE(capturer->setCaptureFormat(CaptureFormat::MEM_I420));
+    EXPECT_TRUE(capturer->setCaptureFormat(CaptureFormat::MEM_BGRA));
+    EXPECT_FALSE(capturer->setCaptureFormat(CaptureFormat::D3D11_BGRA));
+}
+
+TEST(SyntheticCapturerTest, ContentNames) {
+    for (auto content : kAllContents) {
+        auto parsed = SyntheticCapturer::contentFromString(SyntheticCapturer::toString(content));
+        ASSERT_TRUE(parsed.has_value());
+        EXPECT_EQ(*parsed, content);
+    }
+    EXPECT_FALSE(SyntheticCapturer::contentFromString("desktop").has_value());
+}
+
+TEST(SyntheticCapturerTest, SameSeedIsReproducible) {
+    for (auto content : kAllContents) {
+        auto a = makeCapturer(content, 42, CaptureFormat::MEM_I420);
+        auto b = makeCapturer(content, 42, CaptureFormat::MEM_I420);
+        ASSERT_NE(a, nullptr);
+        ASSERT_NE(b, nullptr);
+        for (int i = 0; i < 10; i++) {
+            EXPECT_EQ(captureBytes(*a, kI420Size), captureBytes(*b, kI420Size))
+                << SyntheticCapturer::toString(content) << " frame " << i;
+        }
+    }
+}
+
+TEST(SyntheticCapturerTest, DifferentSeedsDiffer) {
+    for (auto content : kAllContents) {
+        auto a = makeCapturer(content, 1, CaptureFormat::MEM_I420);
+        auto b = makeCapturer(content, 2, CaptureFormat::MEM_I420);
+        EXPECT_NE(captureBytes(*a, kI420Size), captureBytes(*b, kI420Size))
+            << SyntheticCapturer::toString(content);
+    }
+}
+
+TEST(SyntheticCapturerTest, StaticDesktopOnlyFirstFrameDirty) {
+    auto capturer =
+        makeCapturer(SyntheticCapturer::Content::StaticDesktop, 7, CaptureFormat::MEM_I420);
+    std::vector<DirtyRect> dirty;
+    const auto first = captureBytes(*capturer, kI420Size, &dirty);
+    ASSERT_EQ(dirty.size(), 1u);
+    EXPECT_EQ(dirty[0].width, kWidth);
+    EXPECT_EQ(dirty[0].height, kHeight);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(captureBytes(*capturer, kI420Size, &dirty), first);
+        EXPECT_TRUE(dirty.empty());
+    }
+}
+
+TEST(SyntheticCapturerTest, DirtyRectsCoverEveryChange) {
+    for (auto content : kAllContents) {
+        auto capturer = makeCapturer(content, 3, CaptureFormat::MEM_BGRA);
+        auto prev = captureBytes(*capturer, kBgraSize);
+        size_t changed_frames = 0;
+        for (int i = 1; i < 60; i++) {
+            std::vector<DirtyRect> dirty;
+            auto cur = captureBytes(*capturer, kBgraSize, &dirty);
+            for (size_t a = 0; a < dirty.size(); a++) {
+                const auto& r = dirty[a];
+                EXPECT_EQ(r.x % 2, 0u);
+                EXPECT_EQ(r.y % 2, 0u);
+                EXPECT_EQ(r.width % 2, 0u);
+                EXPECT_EQ(r.height % 2, 0u);
+                EXPECT_LE(r.x + r.width, kWidth);
+                EXPECT_LE(r.y + r.height, kHeight);
+                for (size_t b = a + 1; b < dirty.size(); b++) {
+                    const auto& o = dirty[b];
+                    const bool overlap = r.x < o.x + o.width && o.x < r.x + r.width &&
+                                         r.y < o.y + o.height && o.y < r.y + r.height;
+                    EXPECT_FALSE(overlap);
+                }
+            }
+            bool changed = false;
+            for (uint32_t y = 0; y < kHeight; y++) {
+                for (uint32_t x = 0; x < kWidth; x++) {
+                    const size_t offset = (static_cast<size_t>(y) * kWidth + x) * 4;
+                    if (memcmp(&prev[offset], &cur[offset], 4) != 0) {
+                        changed = true;
+                        ASSERT_TRUE(inside(dirty, x, y))
+                            << SyntheticCapturer::toString(content) << " frame " << i << " ("
+                            << x << "," << y << ")";
+                    }
+                }
+            }
+            changed_frames += changed ? 1 : 0;
+            prev = std::move(cur);
+        }
+        if (content == SyntheticCapturer::Content::StaticDesktop) {
+            EXPECT_EQ(changed_frames, 0u);
+        }
+        else if (content == SyntheticCapturer::Content::Typing) {
+            // 每6帧敲一个字符
+            EXPECT_EQ(changed_frames, 59u / 6);
+        }
+        else {
+            EXPECT_EQ(changed_frames, 59u) << SyntheticCapturer::toString(content);
+        }
+    }
+}
+
+TEST(SyntheticCapturerTest, TypingOnlyDirtiesCharacterCells) {
+    auto capturer = makeCapturer(SyntheticCapturer::Content::Typing, 11, CaptureFormat::MEM_I420);
+    std::vector<DirtyRect> dirty;
+    captureBytes(*capturer, kI420Size, &dirty);
+    for (int i = 1; i < 120; i++) {
+        captureBytes(*capturer, kI420Size, &dirty);
+        if (i % 6 != 0) {
+            EXPECT_TRUE(dirty.empty()) << "frame " << i;
+            continue;
+        }
+        // 只有新字符和光标两格
+        ASSERT_EQ(dirty.size(), 2u) << "frame " << i;
+        for (const auto& rect : dirty) {
+            EXPECT_EQ(rect.width, 8u);
+            EXPECT_EQ(rect.height, 16u);
+        }
+    }
+}
+
+TEST(SyntheticCapturerTest, IncrementalI420MatchesFullConversion) {
+    // I420只转换脏区域, 结果必须和整帧重新转换一样
+    for (auto content : kAllContents) {
+        auto bgra = makeCapturer(content, 9, CaptureFormat::MEM_BGRA);
+        auto i420 = makeCapturer(content, 9, CaptureFormat::MEM_I420);
+        for (int i = 0; i < 30; i++) {
+            auto expected = referenceI420(captureBytes(*bgra, kBgraSize));
+            EXPECT_EQ(captureBytes(*i420, kI420Size), expected)
+                << SyntheticCapturer::toString(content) << " frame " << i;
+        }
+    }
+}
+
+TEST(SyntheticCapturerTest, SwitchingFormatRestartsWithFullFrame) {
+    auto capturer =
+        makeCapturer(SyntheticCapturer::Content::MovingWindow, 5, CaptureFormat::MEM_I420);
+    captureBytes(*capturer, kI420Size);
+    captureBytes(*capturer, kI420Size);
+    EXPECT_EQ(capturer->frameIndex(), 2u);
+    ASSERT_TRUE(capturer->setCaptureFormat(CaptureFormat::MEM_BGRA));
+    EXPECT_EQ(capturer->frameIndex(), 0u);
+    std::vector<DirtyRect> dirty;
+    captureBytes(*capturer, kBgraSize, &dirty);
+    ASSERT_EQ(dirty.size(), 1u);
+    EXPECT_EQ(dirty[0].width, kWidth);
+    EXPECT_EQ(dirty[0].height, kHeight);
+}
+
+TEST(SyntheticCapturerTest, WaitForVBlankPacesToFps) {
+    SyntheticCapturer::Params params{};
+    params.width = kWidth;
+    params.height = kHeight;
+    params.fps = 100;
+    auto capturer = SyntheticCapturer::create(params);
+    ASSERT_NE(capturer, nullptr);
+    capturer->waitForVBlank();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 10; i++) {
+        capturer->waitForVBlank();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    // 第一次之后每次等一个周期(10ms)
+    EXPECT_GE(elapsed, std::chrono::milliseconds{85});
+    EXPECT_LT(elapsed, std::chrono::milliseconds{500});
+}
@@ -0,0 +1,235 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "system_cursor.h"
+
+#include <Windows.h>
+#include <winuser.h>
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <ltproto/client2worker/cursor_info.pb.h>
+
+#include <ltlib/logging.h>
+#include <ltlib/system.h>
+
+namespace lt {
+
+namespace video {
+
+namespace {
+
+CursorFormat getCursorDataFromHcursor(HCURSOR hcursor, std::vector<uint8_t>& cursor_data,
+                                      uint32_t& w, uint32_t& h, uint16_t& hot_x,
+                                      uint16_t& hot_y, uint32_t& pitch) {
+    int32_t color_width = 0;
+    int32_t color_height = 0;
+    int32_t color_bits_pixel = 0;
+    int32_t mask_width = 0;
+    int32_t mask_height = 0;
+    int32_t mask_bits_pixel = 0;
+    std::vector<uint8_t> color_data;
+    std::vector<uint8_t> mask_data;
+    ICONINFO iconinfo{};
+    BOOL ret = GetIconInfo(hcursor, &iconinfo);
+    if (ret != TRUE) {
+        LOG(ERR) << "GetIconInfo failed: 0x" << std::hex << GetLastError();
+        return CursorFormat::Unknown;
+    }
+    hot_x = static_cast<uint16_t>(iconinfo.xHotspot);
+    hot_y = static_cast<uint16_t>(iconinfo.yHotspot);
+    if (iconinfo.hbmColor) {
+        BITMAP bmp{};
+        GetObjectA(iconinfo.hbmColor, sizeof(BITMAP), &bmp);
+        if (!bmp.bmWidthBytes || !bmp.bmHeight) {
+            return CursorFormat::Unknown;
+        }
+
+        color_data.resize(bmp.bmWidthBytes * bmp.bmHeight);
+        if (!GetBitmapBits(iconinfo.hbmColor, bmp.bmWidthBytes * bmp.bmHeight, color_data.data())) {
+            return CursorFormat::Unknown;
+        }
+
+        color_width = bmp.bmWidth;
+        color_height = bmp.bmHeight;
+        color_bits_pixel = bmp.bmBitsPixel;
+    }
+    if (iconinfo.hbmMask) {
+        BITMAP bmp{};
+        GetObjectA(iconinfo.hbmMask, sizeof(BITMAP), &bmp);
+        if (!bmp.bmWidthBytes || !bmp.bmHeight) {
+            return CursorFormat::Unknown;
+        }
+
+        mask_data.resize(bmp.bmWidthBytes * bmp.bmHeight);
+        if (!GetBitmapBits(iconinfo.hbmMask, bmp.bmWidthBytes * bmp.bmHeight, mask_data.data())) {
+            return CursorFormat::Unknown;
+        }
+
+        mask_width = bmp.bmWidth;
+        mask_height = bmp.bmHeight;
+        mask_bits_pixel = bmp.bmBitsPixel;
+    }
+    if (iconinfo.hbmColor) {
+        DeleteObject(iconinfo.hbmColor);
+    }
+    if (iconinfo.hbmMask) {
+        DeleteObject(iconinfo.hbmMask);
+    }
+    if (color_data.empty() && !mask_data.empty() && mask_bits_pixel == 1) {
+        w = mask_width;
+        h = mask_height;
+        pitch = static_cast<uint32_t>(mask_data.size() / h);
+        cursor_data = std::move(mask_data);
+        return CursorFormat::MonoChrome;
+    }
+    else if (!color_data.empty() && !mask_data.empty() && mask_bits_pixel == 32) { // ???
+        w = color_width;
+        h = color_height;
+        pitch = color_width * 4;
+        cursor_data.resize(color_data.size() + mask_data.size());
+        memcpy(cursor_data.data(), color_data.data(), color_data.size());
+        memcpy(cursor_data.data() + color_data.size(), mask_data.data(), mask_data.size());
+        return CursorFormat::MaskedColor;
+    }
+    else if (!color_data.empty()) {
+        w = color_width;
+        h = color_height;
+        pitch = color_width * 4;
+        cursor_data = std::move(color_data);
+        return CursorFormat::Color;
+    }
+    LOG(WARNING) << "getCursorDataFromHcursor failed, color size:" << color_data.size()
+                 << ", mask size:" << mask_data.size() << ", mask_bits_pixel:" << mask_bits_pixel;
+    return CursorFormat::Unknown;
+}
+
+
+class Win32SystemCursor : public SystemCursor {
+public:
+    Win32SystemCursor();
+    std::optional<Info> get() override;
+
+private:
+    std::map<HCURSOR, int32_t> cursors_;
+    bool get_win32_cursor_failed_ = false;
+};
+
+Win32SystemCursor::Win32SystemCursor() { // 释放?
+    cursors_[LoadCursorA(nullptr, IDC_ARROW)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_Arrow;
+    cursors_[LoadCursorA(nullptr, IDC_IBEAM)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_Ibeam;
+    cursors_[LoadCursorA(nullptr, IDC_WAIT)] = ltproto::client2worker::CursorInfo_PresetCursor_Wait;
+    cursors_[LoadCursorA(nullptr, IDC_CROSS)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_Cross;
+    cursors_[LoadCursorA(nullptr, IDC_SIZENWSE)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_SizeNwse;
+    cursors_[LoadCursorA(nullptr, IDC_SIZENESW)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_SizeNesw;
+    cursors_[LoadCursorA(nullptr, IDC_SIZEWE)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_SizeWe;
+    cursors_[LoadCursorA(nullptr, IDC_SIZENS)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_SizeNs;
+    cursors_[LoadCursorA(nullptr, IDC_SIZEALL)] =
+        ltproto::client2worker::CursorInfo_PresetCursor_SizeAll;
+    cursors_[LoadCursorA(nullptr, IDC_NO)] = ltproto::client2worker::CursorInfo_PresetCursor_No;
+    cursors_[LoadCursorA(nullptr, IDC_HAND)] = ltproto::client2worker::CursorInfo_PresetCursor_Hand;
+}
+
+std::optional<SystemCursor::Info> Win32SystemCursor::get() {
+    Info info{};
+    CURSORINFO pci{};
+    POINT pos{};
+    DWORD error1 = 0;
+    DWORD error2 = 0;
+    pci.cbSize = sizeof(pci);
+    if (GetCursorInfo(&pci)) {
+        get_win32_cursor_failed_ = false;
+        info.cursor.visible = pci.flags != 0;
+        auto iter = cursors_.find(pci.hCursor);
+        if (iter != cursors_.end()) {
+            info.preset = iter->second;
+        }
+        uint16_t hot_x = 0, hot_y = 0;
+        uint32_t cursor_w = 0, cursor_h = 0, pitch = 0;
+        CursorFormat format = getCursorDataFromHcursor(pci.hCursor, info.cursor.data, cursor_w,
+                                                       cursor_h, hot_x, hot_y, pitch);
+        if (format == CursorFormat::Unknown) {
+            // some log
+        }
+        else {
+            info.cursor.x = pci.ptScreenPos.x - hot_x;
+            info.cursor.y = pci.ptScreenPos.y - hot_y;
+            info.cursor.hot_x = hot_x;
+            info.cursor.hot_y = hot_y;
+            info.cursor.format = format;
+            info.cursor.w = cursor_w;
+            info.cursor.h = cursor_h;
+            info.cursor.pitch = static_cast<uint16_t>(pitch);
+            return info;
+        }
+    }
+    else {
+        error1 = GetLastError();
+    }
+    ltlib::setThreadDesktop();
+    if (GetCursorPos(&pos)) {
+        get_win32_cursor_failed_ = false;
+        info = Info{};
+        info.preset = ltproto::client2worker::CursorInfo_PresetCursor_Arrow;
+        info.cursor.x = pos.x;
+        info.cursor.y = pos.y;
+        info.cursor.visible = true;
+        return info;
+    }
+    else {
+        error2 = GetLastError();
+    }
+
+    // 这个标志位是为了只打一次这个日志
+    if (!get_win32_cursor_failed_) {
+        // 这么写获取不到错误码，但是要获得错误码的写法很丑
+        LOGF(ERR, "GetCursorInfo=>%u and GetCursorPos=>%u", error1, error2);
+    }
+    get_win32_cursor_failed_ = true;
+    return std::nullopt;
+}
+
+} // namespace
+
+std::unique_ptr<SystemCursor> SystemCursor::create() {
+    return std::make_unique<Win32SystemCursor>();
+}
+
+} // namespace video
+
+} // namespace lt
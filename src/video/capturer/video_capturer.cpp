@@ -37,12 +37,17 @@
 #if LT_WINDOWS
 #include "dxgi_video_capturer.h"
 #endif
+#include "synthetic_video_capturer.h"
 
 namespace lt {
 
 namespace video {
 
 std::unique_ptr<Capturer> Capturer::create(Backend backend, ltlib::Monitor monitor) {
+    if (backend == Backend::Synthetic) {
+        // 画面内容用默认值, 需要指定内容的直接用SyntheticCapturer::create()
+        return SyntheticCapturer::create(SyntheticCapturer::paramsFromMonitor(monitor));
+    }
 #if LT_WINDOWS
     if (backend != Backend::Dxgi) {
         LOG(FATAL) << "Only support dxgi video capturer!";
@@ -56,7 +61,7 @@ std::unique_ptr<Capturer> Capturer::create(Backend backend, ltlib::Monitor monit
 #else
     (void)backend;
     (void)monitor;
-    LOG(ERR) << "Video capturer is only available on Windows";
+    LOG(ERR) << "Only synthetic video capturer is available on this platform";
     return nullptr;
 #endif
 }
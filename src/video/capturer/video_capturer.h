@@ -34,6 +34,7 @@
 #include <future>
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include <ltlib/system.h>
 #include <video/types.h>
@@ -45,6 +46,15 @@ namespace video {
 enum class CaptureFormat {
     D3D11_BGRA,
     MEM_I420,
+    // 内存里紧密排列的BGRA, stride = width * 4
+    MEM_BGRA,
+};
+
+struct DirtyRect {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
 };
 
 enum class CursorFormat { Unknown, MonoChrome, Color, MaskedColor };
@@ -67,10 +77,15 @@ class Capturer {
 public:
     enum class Backend {
         Dxgi,
+        // 生成确定的测试画面, 不依赖显卡和窗口系统, 见synthetic_video_capturer.h
+        Synthetic,
     };
     struct Frame {
         void* data;
         int64_t capture_timestamp_us;
+        // 和上一帧相比变化了的区域, 和data一样在doneWithFrame()之前有效.
+        // nullptr表示不知道(当作整帧都变了), 空表示画面没有变化
+        const std::vector<DirtyRect>* dirty_rects = nullptr;
     };
 
 public:
@@ -0,0 +1,173 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "bandwidth_prober.h"
+
+#include <algorithm>
+
+namespace {
+
+// 接收速率低于发送速率的这个比例就认为到了瓶颈
+constexpr double kSaturationRatio = 0.9;
+// 一档至少要有这么多确认才能算速率
+constexpr size_t kMinAckedProbes = 3;
+// 确认少于这个比例说明在丢包, 同样认为到了瓶颈
+constexpr double kMinAckedRatio = 0.8;
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+BandwidthProber::BandwidthProber(const Params& params)
+    : params_{params} {
+    clusters_.push_back(Cluster{std::min(params_.start_bps, params_.max_bps), {}});
+}
+
+uint32_t BandwidthProber::probeBytesToSend(int64_t now_us) {
+    if (done_) {
+        return 0;
+    }
+    const Cluster& cluster = clusters_.back();
+    if (cluster.probes.size() < params_.probes_per_cluster) {
+        if (now_us < next_wakeup_us_) {
+            return 0;
+        }
+        return static_cast<uint32_t>(static_cast<int64_t>(cluster.target_bps) / 8 *
+                                     params_.probe_interval_us / 1'000'000);
+    }
+    const bool all_acked = std::all_of(cluster.probes.begin(), cluster.probes.end(),
+                                       [](const Probe& p) { return p.recv_time_us.has_value(); });
+    if (!all_acked && now_us < cluster_sent_us_ + params_.ack_timeout_us) {
+        next_wakeup_us_ = cluster_sent_us_ + params_.ack_timeout_us;
+        return 0;
+    }
+    finishCluster();
+    next_wakeup_us_ = now_us;
+    return probeBytesToSend(now_us);
+}
+
+void BandwidthProber::onProbeSent(uint64_t probe_id, uint32_t bytes, int64_t now_us) {
+    if (done_) {
+        return;
+    }
+    Cluster& cluster = clusters_.back();
+    cluster.probes.push_back(Probe{probe_id, bytes, now_us, std::nullopt});
+    if (cluster.probes.size() < params_.probes_per_cluster) {
+        next_wakeup_us_ = now_us + params_.probe_interval_us;
+    }
+    else {
+        cluster_sent_us_ = now_us;
+        next_wakeup_us_ = now_us + params_.ack_timeout_us;
+    }
+}
+
+bool BandwidthProber::onProbeAcked(uint64_t probe_id, int64_t recv_time_us, int64_t now_us) {
+    // 探测包的ID是连续的, 超时的确认也要认出来吞掉
+    for (auto& cluster : clusters_) {
+        for (auto& probe : cluster.probes) {
+            if (probe.id != probe_id) {
+                continue;
+            }
+            probe.recv_time_us = recv_time_us;
+            if (!done_ && &cluster == &clusters_.back() &&
+                cluster.probes.size() >= params_.probes_per_cluster) {
+                // 可能全都确认了, 让调用方马上来检查
+                next_wakeup_us_ = now_us;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void BandwidthProber::finishCluster() {
+    const Cluster& cluster = clusters_.back();
+    auto measurement = measure(cluster);
+    if (measurement.has_value()) {
+        const uint32_t bps = std::min(measurement->send_bps, measurement->recv_bps);
+        estimate_bps_ = std::max(estimate_bps_.value_or(0), bps);
+    }
+    const bool saturated = !measurement.has_value() ||
+                           measurement->recv_bps < measurement->send_bps * kSaturationRatio;
+    if (saturated || cluster.target_bps >= params_.max_bps) {
+        done_ = true;
+        return;
+    }
+    const uint64_t next_bps =
+        static_cast<uint64_t>(cluster.target_bps) * std::max(params_.growth, 2u);
+    clusters_.push_back(
+        Cluster{static_cast<uint32_t>(std::min<uint64_t>(next_bps, params_.max_bps)), {}});
+    cluster_sent_us_ = -1;
+}
+
+std::optional<BandwidthProber::Measurement>
+BandwidthProber::measure(const Cluster& cluster) const {
+    std::vector<const Probe*> acked;
+    for (const auto& probe : cluster.probes) {
+        if (probe.recv_time_us.has_value()) {
+            acked.push_back(&probe);
+        }
+    }
+    if (acked.size() < kMinAckedProbes ||
+        acked.size() < cluster.probes.size() * kMinAckedRatio) {
+        return std::nullopt;
+    }
+    // 第一个包的大小不算在间隔里
+    int64_t send_bytes = 0;
+    for (size_t i = 1; i < cluster.probes.size(); i++) {
+        send_bytes += cluster.probes[i].bytes;
+    }
+    const int64_t send_span_us =
+        cluster.probes.back().send_time_us - cluster.probes.front().send_time_us;
+    std::sort(acked.begin(), acked.end(), [](const Probe* a, const Probe* b) {
+        return a->recv_time_us.value() < b->recv_time_us.value();
+    });
+    int64_t recv_bytes = 0;
+    for (size_t i = 1; i < acked.size(); i++) {
+        recv_bytes += acked[i]->bytes;
+    }
+    const int64_t recv_span_us =
+        acked.back()->recv_time_us.value() - acked.front()->recv_time_us.value();
+    if (send_span_us <= 0 || recv_span_us <= 0) {
+        return std::nullopt;
+    }
+    Measurement measurement{};
+    measurement.send_bps = static_cast<uint32_t>(
+        std::min<int64_t>(send_bytes * 8 * 1'000'000 / send_span_us, UINT32_MAX));
+    measurement.recv_bps = static_cast<uint32_t>(
+        std::min<int64_t>(recv_bytes * 8 * 1'000'000 / recv_span_us, UINT32_MAX));
+    return measurement;
+}
+
+} // namespace video
+
+} // namespace lt
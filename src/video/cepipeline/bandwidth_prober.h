@@ -0,0 +1,108 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace lt {
+
+namespace video {
+
+// 会话开始时的带宽探测. 按start_bps, start_bps*growth, ...逐档发送一组匀速的探测包,
+// 客户端带着到达时间确认每一个包, 用一组包的到达间隔算出接收速率.
+// 某一档的接收速率明显低于发送速率说明已经超过瓶颈带宽, 停止探测, 估计值就是这一档的接收速率.
+// 每一档发完要等确认回来才决定下一档, 所以最多只会比瓶颈带宽多发一档.
+// 本身不加锁, 也不读系统时钟.
+class BandwidthProber {
+public:
+    struct Params {
+        uint32_t start_bps = 2'000'000;
+        uint32_t max_bps = 100'000'000;
+        uint32_t growth = 2;
+        uint32_t probes_per_cluster = 10;
+        int64_t probe_interval_us = 5'000;
+        // 一档发完之后最多等多久的确认
+        int64_t ack_timeout_us = 300'000;
+    };
+
+public:
+    explicit BandwidthProber(const Params& params);
+
+    // 现在应该发送的探测包大小, 不该发送时返回0
+    uint32_t probeBytesToSend(int64_t now_us);
+
+    // 调用方发出了一个探测包, probe_id用来匹配确认
+    void onProbeSent(uint64_t probe_id, uint32_t bytes, int64_t now_us);
+
+    // recv_time_us是客户端的时钟, 只用来算间隔. 返回false表示不是探测包
+    bool onProbeAcked(uint64_t probe_id, int64_t recv_time_us, int64_t now_us);
+
+    // 下一次需要调用probeBytesToSend()的时间, 调用方可以睡到那时
+    int64_t nextWakeupUs() const { return next_wakeup_us_; }
+
+    bool done() const { return done_; }
+
+    // 一个有效的测量都没有时返回nullopt
+    std::optional<uint32_t> estimateBps() const { return estimate_bps_; }
+
+private:
+    struct Probe {
+        uint64_t id;
+        uint32_t bytes;
+        int64_t send_time_us;
+        std::optional<int64_t> recv_time_us;
+    };
+    struct Cluster {
+        uint32_t target_bps;
+        std::vector<Probe> probes;
+    };
+    struct Measurement {
+        uint32_t send_bps;
+        uint32_t recv_bps;
+    };
+
+private:
+    void finishCluster();
+    std::optional<Measurement> measure(const Cluster& cluster) const;
+
+private:
+    const Params params_;
+    std::vector<Cluster> clusters_;
+    // 当前这一档发完的时间, 没发完时为-1
+    int64_t cluster_sent_us_ = -1;
+    int64_t next_wakeup_us_ = 0;
+    bool done_ = false;
+    std::optional<uint32_t> estimate_bps_;
+};
+
+} // namespace video
+
+} // namespace lt
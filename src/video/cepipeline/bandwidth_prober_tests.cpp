@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <optional>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <video/cepipeline/bandwidth_prober.h>
+
+namespace {
+
+using lt::video::BandwidthProber;
+
+constexpr uint32_t kMaxBps = 100'000'000;
+constexpr int64_t kOneWayDelayUs = 10'000;
+constexpr int64_t kMaxQueueDelayUs = 50'000;
+
+// 限速的链路: 按cap_bps串行发出, 排队超过kMaxQueueDelayUs就丢(drop-tail), 再加上固定的单向时延
+class CappedLink {
+public:
+    explicit CappedLink(uint32_t cap_bps)
+        : cap_bps_{cap_bps} {}
+
+    // 返回到达时间, 丢包返回nullopt
+    std::optional<int64_t> send(uint32_t bytes, int64_t now_us) {
+        const int64_t start_us = std::max(now_us, busy_until_us_);
+        if (start_us - now_us > kMaxQueueDelayUs) {
+            return std::nullopt;
+        }
+        busy_until_us_ = start_us + static_cast<int64_t>(bytes) * 8 * 1'000'000 / cap_bps_;
+        return busy_until_us_ + kOneWayDelayUs;
+    }
+
+private:
+    const uint32_t cap_bps_;
+    int64_t busy_until_us_ = 0;
+};
+
+struct Ack {
+    int64_t arrive_us;
+    uint64_t probe_id;
+    int64_t recv_time_us;
+};
+
+struct ProbeResult {
+    std::optional<uint32_t> estimate_bps;
+    int64_t duration_us = 0;
+};
+
+// 虚拟时钟, 确认沿原路返回, 不限速也不丢
+ProbeResult runProbe(uint32_t cap_bps, bool deliver_acks = true) {
+    BandwidthProber::Params params{};
+    params.max_bps = kMaxBps;
+    BandwidthProber prober{params};
+    CappedLink link{cap_bps};
+    std::deque<Ack> acks;
+    uint64_t next_id = 0;
+    int64_t now_us = 0;
+    while (!prober.done() && now_us < 10'000'000) {
+        while (!acks.empty() && acks.front().arrive_us <= now_us) {
+            EXPECT_TRUE(prober.onProbeAcked(acks.front().probe_id, acks.front().recv_time_us,
+                                            now_us));
+            acks.pop_front();
+        }
+        const uint32_t bytes = prober.probeBytesToSend(now_us);
+        if (bytes > 0) {
+            const uint64_t id = next_id++;
+            auto recv_time_us = link.send(bytes, now_us);
+            prober.onProbeSent(id, bytes, now_us);
+            if (recv_time_us.has_value() && deliver_acks) {
+                acks.push_back({recv_time_us.value() + kOneWayDelayUs, id, recv_time_us.value()});
+            }
+        }
+        int64_t next_us = prober.nextWakeupUs();
+        if (!acks.empty()) {
+            next_us = std::min(next_us, acks.front().arrive_us);
+        }
+        now_us = std::max(next_us, now_us + 1);
+    }
+    return {prober.estimateBps(), now_us};
+}
+
+class BandwidthProberTest : public ::testing::TestWithParam<uint32_t> {};
+
+TEST_P(BandwidthProberTest, EstimatesCappedLink) {
+    const uint32_t cap_bps = GetParam();
+    auto result = runProbe(cap_bps);
+    ASSERT_TRUE(result.estimate_bps.has_value());
+    const uint32_t expected = std::min(cap_bps, kMaxBps);
+    std::printf("cap %.1fMbps: estimate %.2fMbps in %lldms\n", cap_bps / 1e6,
+                result.estimate_bps.value() / 1e6,
+                static_cast<long long>(result.duration_us / 1000));
+    EXPECT_GE(result.estimate_bps.value(), expected * 0.85);
+    EXPECT_LE(result.estimate_bps.value(), expected * 1.15);
+    // 一档大概50ms加一个来回, 要在首帧之前结束
+    EXPECT_LT(result.duration_us, 1'000'000);
+}
+
+INSTANTIATE_TEST_SUITE_P(Caps, BandwidthProberTest,
+                         ::testing::Values(1'000'000u, 3'000'000u, 8'000'000u, 20'000'000u,
+                                           50'000'000u, 200'000'000u),
+                         [](const ::testing::TestParamInfo<uint32_t>& info) {
+                             return std::to_string(info.param / 1'000'000) + "Mbps";
+                         });
+
+TEST(BandwidthProberTest, IgnoresUnknownAcks) {
+    BandwidthProber prober{BandwidthProber::Params{}};
+    const uint32_t bytes = prober.probeBytesToSend(0);
+    ASSERT_GT(bytes, 0u);
+    prober.onProbeSent(7, bytes, 0);
+    EXPECT_FALSE(prober.onProbeAcked(6, 100, 100));
+    EXPECT_TRUE(prober.onProbeAcked(7, 100, 100));
+}
+
+TEST(BandwidthProberTest, GivesUpWithoutAcks) {
+    auto result = runProbe(10'000'000, false);
+    EXPECT_FALSE(result.estimate_bps.has_value());
+    // 第一档发完等一个超时就放弃
+    EXPECT_LT(result.duration_us, 500'000);
+}
+
+} // namespace
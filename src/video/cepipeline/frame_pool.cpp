@@ -0,0 +1,139 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "frame_pool.h"
+
+#include <cstring>
+
+namespace lt {
+
+namespace video {
+
+Capturer::Frame FramePool::Slot::frame() const {
+    Capturer::Frame frame{};
+    frame.data = const_cast<uint8_t*>(data.data());
+    frame.capture_timestamp_us = capture_timestamp_us;
+    frame.dirty_rects = dirty_rects_known ? &dirty_rects : nullptr;
+    return frame;
+}
+
+FramePool::FramePool(size_t capacity, size_t frame_size)
+    : frame_size_{frame_size} {
+    for (size_t i = 0; i < capacity; i++) {
+        slots_.push_back(std::make_unique<Slot>());
+        slots_.back()->data.resize(frame_size);
+        free_.push_back(slots_.back().get());
+    }
+}
+
+bool FramePool::push(const Capturer::Frame& frame) {
+    Slot* slot = nullptr;
+    {
+        std::lock_guard lock{mutex_};
+        if (!free_.empty()) {
+            slot = free_.front();
+            free_.pop_front();
+        }
+        else if (!ready_.empty()) {
+            slot = ready_.front();
+            ready_.pop_front();
+            dropped_++;
+            // 被丢的帧里的变化要算到排在它后面的那一帧上
+            if (ready_.empty()) {
+                lost_dirty_rects_ = true;
+            }
+            else {
+                ready_.front()->dirty_rects_known = false;
+            }
+        }
+        else {
+            // 一个在写一个在编, 容量小于2才会走到这里
+            dropped_++;
+            lost_dirty_rects_ = true;
+            return false;
+        }
+    }
+    // 拷贝不持锁, 这个slot现在只属于采集线程
+    std::memcpy(slot->data.data(), frame.data, frame_size_);
+    slot->capture_timestamp_us = frame.capture_timestamp_us;
+    slot->dirty_rects.clear();
+    slot->dirty_rects_known = frame.dirty_rects != nullptr;
+    if (frame.dirty_rects != nullptr) {
+        slot->dirty_rects = *frame.dirty_rects;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        if (lost_dirty_rects_) {
+            slot->dirty_rects_known = false;
+            lost_dirty_rects_ = false;
+        }
+        ready_.push_back(slot);
+    }
+    cv_.notify_one();
+    return true;
+}
+
+FramePool::Slot* FramePool::pop(std::chrono::milliseconds timeout) {
+    std::unique_lock lock{mutex_};
+    cv_.wait_for(lock, timeout, [this]() { return stoped_ || !ready_.empty(); });
+    if (stoped_ || ready_.empty()) {
+        return nullptr;
+    }
+    Slot* slot = ready_.front();
+    ready_.pop_front();
+    return slot;
+}
+
+void FramePool::release(Slot* slot) {
+    std::lock_guard lock{mutex_};
+    free_.push_back(slot);
+}
+
+void FramePool::stop() {
+    {
+        std::lock_guard lock{mutex_};
+        stoped_ = true;
+    }
+    cv_.notify_all();
+}
+
+uint64_t FramePool::dropped() const {
+    std::lock_guard lock{mutex_};
+    return dropped_;
+}
+
+size_t FramePool::pending() const {
+    std::lock_guard lock{mutex_};
+    return ready_.size();
+}
+
+} // namespace video
+
+} // namespace lt
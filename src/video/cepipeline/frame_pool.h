@@ -0,0 +1,87 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <video/capturer/video_capturer.h>
+
+namespace lt {
+
+namespace video {
+
+// 采集线程和编码线程之间的有界帧池. 采集线程把Capturer::Frame拷进一个空闲的slot再交给编码线程,
+// 这样doneWithFrame()可以马上调用, 下一帧的采集和这一帧的编码就能并行.
+// 编码跟不上时丢掉最旧的还没编码的帧, 而不是让采集线程等待.
+class FramePool {
+public:
+    struct Slot {
+        std::vector<uint8_t> data;
+        int64_t capture_timestamp_us = 0;
+        // 和Capturer::Frame::dirty_rects的含义相同, false表示不知道哪里变了
+        bool dirty_rects_known = false;
+        std::vector<DirtyRect> dirty_rects;
+
+        Capturer::Frame frame() const;
+    };
+
+public:
+    FramePool(size_t capacity, size_t frame_size);
+    // 采集线程调用, 把frame拷进池子. 返回false表示没有可用的slot, 这一帧被丢弃
+    bool push(const Capturer::Frame& frame);
+    // 编码线程调用, 取出最旧的待编码帧, 用完必须release()
+    Slot* pop(std::chrono::milliseconds timeout);
+    void release(Slot* slot);
+    // 唤醒阻塞在pop()里的线程, 之后pop()总是返回nullptr
+    void stop();
+    uint64_t dropped() const;
+    size_t pending() const;
+
+private:
+    const size_t frame_size_;
+    std::vector<std::unique_ptr<Slot>> slots_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Slot*> free_;
+    std::deque<Slot*> ready_;
+    uint64_t dropped_ = 0;
+    // 丢帧时后面没有排队的帧, 下一个push进来的帧的dirty rects不再可信
+    bool lost_dirty_rects_ = false;
+    bool stoped_ = false;
+};
+
+} // namespace video
+
+} // namespace lt
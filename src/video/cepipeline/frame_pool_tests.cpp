@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/cepipeline/frame_pool.h>
+
+namespace {
+
+using lt::video::Capturer;
+using lt::video::DirtyRect;
+using lt::video::FramePool;
+
+constexpr size_t kFrameSize = 16;
+constexpr std::chrono::milliseconds kNoWait{0};
+
+Capturer::Frame makeFrame(std::vector<uint8_t>& buffer, uint8_t value, int64_t timestamp,
+                          const std::vector<DirtyRect>* dirty_rects = nullptr) {
+    buffer.assign(kFrameSize, value);
+    Capturer::Frame frame{};
+    frame.data = buffer.data();
+    frame.capture_timestamp_us = timestamp;
+    frame.dirty_rects = dirty_rects;
+    return frame;
+}
+
+TEST(FramePoolTest, PopsInCaptureOrder) {
+    FramePool pool{3, kFrameSize};
+    std::vector<uint8_t> buffer;
+    for (int64_t i = 1; i <= 3; i++) {
+        ASSERT_TRUE(pool.push(makeFrame(buffer, static_cast<uint8_t>(i), i)));
+    }
+    EXPECT_EQ(pool.pending(), 3u);
+    for (int64_t i = 1; i <= 3; i++) {
+        auto slot = pool.pop(kNoWait);
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->capture_timestamp_us, i);
+        EXPECT_EQ(slot->data[0], static_cast<uint8_t>(i));
+        pool.release(slot);
+    }
+    EXPECT_EQ(pool.pop(kNoWait), nullptr);
+    EXPECT_EQ(pool.dropped(), 0u);
+}
+
+TEST(FramePoolTest, DropsOldestWhenFull) {
+    FramePool pool{3, kFrameSize};
+    std::vector<uint8_t> buffer;
+    for (int64_t i = 1; i <= 4; i++) {
+        ASSERT_TRUE(pool.push(makeFrame(buffer, static_cast<uint8_t>(i), i)));
+    }
+    EXPECT_EQ(pool.dropped(), 1u);
+    EXPECT_EQ(pool.pending(), 3u);
+    for (int64_t i = 2; i <= 4; i++) {
+        auto slot = pool.pop(kNoWait);
+        ASSERT_NE(slot, nullptr);
+        EXPECT_EQ(slot->capture_timestamp_us, i);
+        pool.release(slot);
+    }
+}
+
+TEST(FramePoolTest, InFlightSlotIsNotReclaimed) {
+    FramePool pool{2, kFrameSize};
+    std::vector<uint8_t> buffer;
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 1, 1)));
+    auto encoding = pool.pop(kNoWait);
+    ASSERT_NE(encoding, nullptr);
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 2, 2)));
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 3, 3)));
+    EXPECT_EQ(pool.dropped(), 1u);
+    EXPECT_EQ(encoding->data[0], 1);
+    EXPECT_EQ(encoding->capture_timestamp_us, 1);
+    pool.release(encoding);
+    auto slot = pool.pop(kNoWait);
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->capture_timestamp_us, 3);
+    pool.release(slot);
+}
+
+TEST(FramePoolTest, DropInvalidatesDirtyRects) {
+    FramePool pool{2, kFrameSize};
+    std::vector<uint8_t> buffer;
+    const std::vector<DirtyRect> rects{{0, 0, 2, 2}};
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 1, 1, &rects)));
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 2, 2, &rects)));
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 3, 3, &rects)));
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 4, 4, &rects)));
+    EXPECT_EQ(pool.dropped(), 2u);
+
+    // 被丢的帧里的变化没有编码出去, 这一帧只能当作整帧都变了
+    auto slot = pool.pop(kNoWait);
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->capture_timestamp_us, 3);
+    EXPECT_EQ(slot->frame().dirty_rects, nullptr);
+    pool.release(slot);
+
+    slot = pool.pop(kNoWait);
+    ASSERT_NE(slot, nullptr);
+    ASSERT_NE(slot->frame().dirty_rects, nullptr);
+    pool.release(slot);
+
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 5, 5, &rects)));
+    slot = pool.pop(kNoWait);
+    ASSERT_NE(slot, nullptr);
+    auto frame = slot->frame();
+    ASSERT_NE(frame.dirty_rects, nullptr);
+    ASSERT_EQ(frame.dirty_rects->size(), 1u);
+    EXPECT_EQ(frame.dirty_rects->front().width, 2u);
+    pool.release(slot);
+}
+
+TEST(FramePoolTest, CopiesFrameData) {
+    FramePool pool{2, kFrameSize};
+    std::vector<uint8_t> buffer;
+    ASSERT_TRUE(pool.push(makeFrame(buffer, 7, 1)));
+    // 采集端在doneWithFrame()之后会复用自己的缓冲区
+    buffer.assign(kFrameSize, 0);
+    auto slot = pool.pop(kNoWait);
+    ASSERT_NE(slot, nullptr);
+    EXPECT_EQ(slot->data, std::vector<uint8_t>(kFrameSize, 7));
+    EXPECT_NE(slot->frame().data, buffer.data());
+    pool.release(slot);
+}
+
+TEST(FramePoolTest, StopWakesWaitingPop) {
+    FramePool pool{2, kFrameSize};
+    FramePool::Slot* slot = nullptr;
+    std::thread consumer{[&]() { slot = pool.pop(std::chrono::seconds{10}); }};
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    const auto start = std::chrono::steady_clock::now();
+    pool.stop();
+    consumer.join();
+    EXPECT_EQ(slot, nullptr);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds{5});
+
+    std::vector<uint8_t> buffer;
+    pool.push(makeFrame(buffer, 1, 1));
+    EXPECT_EQ(pool.pop(kNoWait), nullptr);
+}
+
+} // namespace
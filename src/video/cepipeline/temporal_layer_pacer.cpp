@@ -0,0 +1,114 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "temporal_layer_pacer.h"
+
+#include <algorithm>
+
+namespace lt {
+
+namespace video {
+
+TemporalLayerPacer::TemporalLayerPacer(const Params& params)
+    : params_{params} {
+    params_.temporal_layers = std::max(params_.temporal_layers, 1u);
+    stat_.dropped_per_layer.resize(params_.temporal_layers);
+}
+
+bool TemporalLayerPacer::admit(uint32_t temporal_id, bool is_keyframe, size_t bytes,
+                               int64_t now_us) {
+    drain(now_us);
+    bool drop = false;
+    if (is_keyframe) {
+        broken_layer_ = std::nullopt;
+    }
+    else if (broken_layer_.has_value() && temporal_id > broken_layer_.value()) {
+        // 参考帧已经丢了, 发过去也解不了
+        drop = true;
+    }
+    else {
+        drop = overBudget(temporal_id);
+        if (drop && temporal_id + 1 < params_.temporal_layers) {
+            broken_layer_ = temporal_id;
+        }
+        else if (!drop) {
+            broken_layer_ = std::nullopt;
+        }
+    }
+    if (drop) {
+        stat_.dropped_frames++;
+        stat_.dropped_bytes += bytes;
+        stat_.dropped_per_layer[std::min(temporal_id, params_.temporal_layers - 1)]++;
+        return false;
+    }
+    queued_bytes_ += static_cast<double>(bytes);
+    stat_.sent_frames++;
+    stat_.sent_bytes += bytes;
+    return true;
+}
+
+void TemporalLayerPacer::setBitrate(uint32_t bps) {
+    params_.bitrate_bps = bps;
+}
+
+int64_t TemporalLayerPacer::queueDelayUs(int64_t now_us) {
+    drain(now_us);
+    if (params_.bitrate_bps == 0) {
+        return 0;
+    }
+    return static_cast<int64_t>(queued_bytes_ * 8 * 1'000'000 / params_.bitrate_bps);
+}
+
+void TemporalLayerPacer::drain(int64_t now_us) {
+    if (last_drain_us_ >= 0 && now_us > last_drain_us_) {
+        const double drained =
+            static_cast<double>(now_us - last_drain_us_) * params_.bitrate_bps / 8 / 1'000'000;
+        queued_bytes_ = std::max(0.0, queued_bytes_ - drained);
+    }
+    if (now_us > last_drain_us_) {
+        last_drain_us_ = now_us;
+    }
+}
+
+bool TemporalLayerPacer::overBudget(uint32_t temporal_id) const {
+    if (temporal_id == 0 || params_.bitrate_bps == 0 || params_.max_queue_delay_us <= 0) {
+        return false;
+    }
+    const double budget_bytes =
+        static_cast<double>(params_.bitrate_bps) / 8 * params_.max_queue_delay_us / 1'000'000;
+    // 超出一倍预算丢最高层, 两倍丢最高的两层, 以此类推, 最多丢到只剩T0
+    const auto over = static_cast<uint32_t>(
+        std::min<double>(queued_bytes_ / budget_bytes, params_.temporal_layers - 1));
+    return over > 0 && temporal_id >= params_.temporal_layers - over;
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,90 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace lt {
+
+namespace video {
+
+// 按时域层丢帧的发送节拍器. 把发送队列近似成一个按目标码率流出的漏桶,
+// 积压超过max_queue_delay_us时从最高层开始丢帧, 积压越多丢的层越多, 关键帧和T0永远不丢.
+// 丢掉一个非最高层的帧(它会被更高层参考)后, 更高层的帧都要跟着丢, 直到这一层或更低层的帧被放行.
+// 客户端根据帧里的时域分层SEI知道缺的不是自己的参考帧, 不需要请求关键帧.
+// 本身不加锁, 也不读系统时钟.
+class TemporalLayerPacer {
+public:
+    struct Params {
+        uint32_t temporal_layers = 1;
+        uint32_t bitrate_bps = 0;
+        int64_t max_queue_delay_us = 100'000;
+    };
+
+    struct Stat {
+        uint64_t sent_frames = 0;
+        uint64_t sent_bytes = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t dropped_bytes = 0;
+        // 下标是temporal_id
+        std::vector<uint64_t> dropped_per_layer;
+    };
+
+public:
+    explicit TemporalLayerPacer(const Params& params);
+
+    // 一帧编码完准备发送时调用, 返回false表示丢掉这一帧
+    bool admit(uint32_t temporal_id, bool is_keyframe, size_t bytes, int64_t now_us);
+
+    void setBitrate(uint32_t bps);
+
+    // 按目标码率发完当前积压的数据要多久
+    int64_t queueDelayUs(int64_t now_us);
+
+    const Stat& stat() const { return stat_; }
+
+private:
+    void drain(int64_t now_us);
+    bool overBudget(uint32_t temporal_id) const;
+
+private:
+    Params params_;
+    double queued_bytes_ = 0;
+    int64_t last_drain_us_ = -1;
+    // 被丢掉的参考帧所在的最低层
+    std::optional<uint32_t> broken_layer_;
+    Stat stat_;
+};
+
+} // namespace video
+
+} // namespace lt
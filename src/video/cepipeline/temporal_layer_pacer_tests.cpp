@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/cepipeline/temporal_layer_pacer.h>
+
+namespace {
+
+using lt::video::TemporalLayerPacer;
+
+constexpr uint32_t kBitrate = 1'000'000;
+constexpr int64_t kMaxQueueDelayUs = 100'000;
+constexpr int64_t kFrameIntervalUs = 33'333;
+// 三层时openh264的时域层顺序
+constexpr uint32_t kLayerPattern[] = {0, 2, 1, 2};
+
+TemporalLayerPacer::Params defaultParams() {
+    TemporalLayerPacer::Params params{};
+    params.temporal_layers = 3;
+    params.bitrate_bps = kBitrate;
+    params.max_queue_delay_us = kMaxQueueDelayUs;
+    return params;
+}
+
+struct RunResult {
+    std::vector<uint64_t> dropped_per_layer;
+    int64_t max_queue_delay_us = 0;
+};
+
+// 30fps, 每帧frame_bytes, 第一帧是关键帧
+RunResult run(TemporalLayerPacer& pacer, size_t frame_bytes, uint32_t frames) {
+    RunResult result;
+    for (uint32_t i = 0; i < frames; i++) {
+        const int64_t now_us = i * kFrameIntervalUs;
+        pacer.admit(kLayerPattern[i % 4], i == 0, frame_bytes, now_us);
+        result.max_queue_delay_us = std::max(result.max_queue_delay_us, pacer.queueDelayUs(now_us));
+    }
+    result.dropped_per_layer = pacer.stat().dropped_per_layer;
+    return result;
+}
+
+TEST(TemporalLayerPacerTest, SendsEverythingUnderBudget) {
+    TemporalLayerPacer pacer{defaultParams()};
+    // 3000 * 8 * 30 = 720kbps
+    auto result = run(pacer, 3000, 300);
+    EXPECT_EQ(pacer.stat().dropped_frames, 0u);
+    EXPECT_EQ(pacer.stat().sent_frames, 300u);
+    EXPECT_LE(result.max_queue_delay_us, kMaxQueueDelayUs);
+}
+
+TEST(TemporalLayerPacerTest, DropsTopLayerUnderMildCongestion) {
+    TemporalLayerPacer pacer{defaultParams()};
+    // 1.5Mbps, 丢掉一半的帧(T2)就够了
+    auto result = run(pacer, 6250, 300);
+    EXPECT_EQ(result.dropped_per_layer[0], 0u);
+    EXPECT_EQ(result.dropped_per_layer[1], 0u);
+    EXPECT_GT(result.dropped_per_layer[2], 0u);
+    EXPECT_LE(result.max_queue_delay_us, 2 * kMaxQueueDelayUs);
+}
+
+TEST(TemporalLayerPacerTest, NeverDropsBaseLayer) {
+    TemporalLayerPacer pacer{defaultParams()};
+    // 4.8Mbps, 只发T0也超了
+    auto result = run(pacer, 20000, 300);
+    EXPECT_EQ(result.dropped_per_layer[0], 0u);
+    EXPECT_GT(result.dropped_per_layer[1], 0u);
+    EXPECT_GT(result.dropped_per_layer[2], 0u);
+    // 开头积压还没满时可能放过一两个高层的帧
+    EXPECT_LE(pacer.stat().sent_frames, 75u + 2);
+}
+
+TEST(TemporalLayerPacerTest, DropsFramesAboveDroppedReference) {
+    TemporalLayerPacer pacer{defaultParams()};
+    // 预算是12500字节, 积压两倍以上时T1也丢
+    EXPECT_TRUE(pacer.admit(0, true, 30000, 0));
+    EXPECT_FALSE(pacer.admit(2, false, 100, 0));
+    EXPECT_FALSE(pacer.admit(1, false, 100, 0));
+    // 积压已经发完, 但是这个T2参考的是刚丢掉的T1
+    EXPECT_FALSE(pacer.admit(2, false, 100, 1'000'000));
+    EXPECT_TRUE(pacer.admit(0, false, 100, 1'000'000));
+    EXPECT_TRUE(pacer.admit(2, false, 100, 1'000'000));
+    EXPECT_EQ(pacer.stat().dropped_per_layer, (std::vector<uint64_t>{0, 1, 2}));
+}
+
+TEST(TemporalLayerPacerTest, KeyframeIsNeverDroppedAndEndsCascade) {
+    TemporalLayerPacer pacer{defaultParams()};
+    EXPECT_TRUE(pacer.admit(0, true, 30000, 0));
+    EXPECT_FALSE(pacer.admit(1, false, 100, 0));
+    EXPECT_TRUE(pacer.admit(0, true, 100000, 0));
+    EXPECT_TRUE(pacer.admit(0, true, 100000, 0));
+    EXPECT_TRUE(pacer.admit(2, false, 100, 10'000'000));
+}
+
+TEST(TemporalLayerPacerTest, LowerBitrateStartsDropping) {
+    TemporalLayerPacer pacer{defaultParams()};
+    run(pacer, 3000, 30);
+    ASSERT_EQ(pacer.stat().dropped_frames, 0u);
+    pacer.setBitrate(kBitrate / 4);
+    for (uint32_t i = 30; i < 60; i++) {
+        pacer.admit(kLayerPattern[i % 4], false, 3000, i * kFrameIntervalUs);
+    }
+    EXPECT_GT(pacer.stat().dropped_frames, 0u);
+    EXPECT_EQ(pacer.stat().dropped_per_layer[0], 0u);
+}
+
+TEST(TemporalLayerPacerTest, SingleLayerNeverDrops) {
+    TemporalLayerPacer::Params params = defaultParams();
+    params.temporal_layers = 1;
+    TemporalLayerPacer pacer{params};
+    for (uint32_t i = 0; i < 100; i++) {
+        EXPECT_TRUE(pacer.admit(0, i == 0, 100000, i * kFrameIntervalUs));
+    }
+}
+
+} // namespace
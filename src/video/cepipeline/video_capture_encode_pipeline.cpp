@@ -30,14 +30,18 @@
 
 #include "video_capture_encode_pipeline.h"
 
-#include <Windows.h>
-#include <winuser.h>
-
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <deque>
 #include <future>
+#include <map>
+#include <optional>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 
 #include <google/protobuf/message_lite.h>
 
@@ -53,11 +57,28 @@
 #include <ltlib/system.h>
 #include <ltlib/threads.h>
 
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/capturer/system_cursor.h>
 #include <video/capturer/video_capturer.h>
+#include <video/cepipeline/bandwidth_prober.h>
+#include <video/cepipeline/frame_pool.h>
+#include <video/cepipeline/temporal_layer_pacer.h>
+#include <video/encoder/h264_bitstream.h>
 #include <video/encoder/video_encoder.h>
 
 namespace {
 
+// 一帧正在采集, 一帧等待编码, 一帧正在编码
+constexpr size_t kFramePoolCapacity = 3;
+// 画面静止时隔多久编一帧保活. 输入和上一帧一样, 编出来几乎全是skip宏块, 只有几十字节
+constexpr int64_t kStaticKeepaliveIntervalUs = 1'000'000;
+// 画面静止多久刷新一个关键帧, 限制画质漂移和丢包花屏的持续时间
+constexpr int64_t kStaticRefreshIntervalUs = 10'000'000;
+// 初始码率只用探测结果的一部分, 给音频, 重传和估计误差留余量
+constexpr double kProbedBitrateRatio = 0.8;
+// 探测出来的码率平摊到每个像素太少时降到30fps, 保证单帧画质
+constexpr double kMinBitsPerPixel = 0.03;
+
 void addHistory(std::deque<int64_t>& history) {
     int64_t now = ltlib::steady_now_us();
     const int64_t kOneSecond = 1'000'000;
@@ -88,6 +109,37 @@ ltproto::client2worker::CursorInfo_CursorDataType toProtobuf(lt::video::CursorFo
     }
 }
 
+std::shared_ptr<ltproto::client2worker::CursorInfo>
+toProtobuf(const lt::video::CursorInfo& info) {
+    auto msg = std::make_shared<ltproto::client2worker::CursorInfo>();
+    msg->set_visible(info.visible);
+    msg->set_x(info.x);
+    msg->set_y(info.y);
+    msg->set_w(ltlib::getScreenWidth());
+    msg->set_h(ltlib::getScreenHeight());
+    if (!info.data.empty()) {
+        msg->set_cursor_w(info.w);
+        msg->set_cursor_h(info.h);
+        msg->set_hot_x(info.hot_x);
+        msg->set_hot_y(info.hot_y);
+        msg->set_pitch(info.pitch);
+        msg->set_type(toProtobuf(info.format));
+        msg->set_data(info.data.data(), info.data.size());
+    }
+    return msg;
+}
+
+size_t memFrameSize(lt::video::CaptureFormat format, uint32_t width, uint32_t height) {
+    switch (format) {
+    case lt::video::CaptureFormat::MEM_I420:
+        return static_cast<size_t>(width) * height * 3 / 2;
+    case lt::video::CaptureFormat::MEM_BGRA:
+        return static_cast<size_t>(width) * height * 4;
+    default:
+        return 0;
+    }
+}
+
 } // namespace
 
 namespace lt {
@@ -147,16 +199,23 @@ private:
     VCEPipeline(const CaptureEncodePipeline::Params& params);
     bool init();
     void mainLoop(const std::function<void()>& i_am_alive, std::promise<bool>& start_promise);
-    void loadSystemCursor();
+    void probeBandwidth(const std::function<void()>& i_am_alive);
+    void startStages();
+    void stopStages();
+    void encodeLoop(const std::function<void()>& i_am_alive);
+    void sendLoop(const std::function<void()>& i_am_alive);
+    void captureToFramePool();
+    void sendMessage(uint32_t type, const std::shared_ptr<google::protobuf::MessageLite>& msg);
+    void sendVideoFrame(const EncodedFrame& frame);
     bool registerHandlers();
     void consumeTasks();
     void captureAndSendCursor();
     void captureAndSendVideoFrame();
     auto resolutionChanged() -> std::optional<ltlib::DisplayOutputDesc>;
     void sendChangeStreamingParams(ltlib::DisplayOutputDesc desc);
-    bool shouldEncodeFrame();
-    auto getDxgiCursorInfo() -> std::shared_ptr<google::protobuf::MessageLite>;
-    auto getWin32CursorInfo() -> std::shared_ptr<google::protobuf::MessageLite>;
+    bool shouldEncodeFrame(const Capturer::Frame& frame);
+    auto getCapturerCursorInfo() -> std::shared_ptr<google::protobuf::MessageLite>;
+    auto getSystemCursorInfo() -> std::shared_ptr<google::protobuf::MessageLite>;
 
     // 从service收到的消息
     void onReconfigure(std::shared_ptr<google::protobuf::MessageLite> msg);
@@ -174,24 +233,56 @@ private:
     ColorMatrix color_matrix_;
     bool full_range_;
     ltlib::Monitor monitor_;
+    Capturer::Backend capture_backend_;
+    SyntheticCapturer::Content synthetic_content_;
+    uint64_t synthetic_seed_;
+    Encoder::SoftBackend soft_backend_;
+    bool pipelined_;
+    uint32_t temporal_layers_;
+    uint32_t soft_threads_;
+    uint32_t max_slice_bytes_;
+    bool probe_bandwidth_;
     std::function<bool(uint32_t, const MessageHandler&)> register_message_handler_;
     std::function<bool(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&)>
         send_message_;
     std::vector<VideoCodecType> client_supported_codecs_;
     std::unique_ptr<ltlib::BlockingThread> thread_;
+    // 以下只在pipelined_时使用
+    std::unique_ptr<FramePool> frame_pool_;
+    std::unique_ptr<ltlib::BlockingThread> encode_thread_;
+    std::unique_ptr<ltlib::BlockingThread> send_thread_;
+    std::mutex send_mutex_;
+    std::condition_variable send_cv_;
+    std::deque<std::pair<uint32_t, std::shared_ptr<google::protobuf::MessageLite>>> send_queue_;
     std::unique_ptr<Capturer> capturer_;
+    std::unique_ptr<SystemCursor> system_cursor_;
     std::unique_ptr<Encoder> encoder_;
+    // 编码器开启了时域分层才有, 和encoder_在同一个线程上使用
+    std::unique_ptr<TemporalLayerPacer> layer_pacer_;
+    // 和encoder_在同一个线程上使用
+    VideoFrameMessagePool frame_messages_;
+    // 探测结束后也留着, 用来认出晚到的探测包确认
+    std::unique_ptr<BandwidthProber> prober_;
     uint64_t frame_no_ = 0;
     std::atomic<bool> stoped_{true};
     std::unique_ptr<std::promise<void>> stop_promise_;
     std::mutex mutex_;
     std::vector<std::function<void()>> tasks_;
     bool manual_bitrate_ = false;
-    std::map<HCURSOR, int32_t> cursors_;
-    bool get_win32_cursor_failed_ = false;
     std::deque<int64_t> capture_history_;
     int64_t last_encode_time_us_ = 0;
-    bool half_fps_ = false;
+    // 上一个编码帧之后画面是否变过, 被帧率控制跳过的帧里的变化也要算上
+    bool content_changed_ = true;
+    // 关键帧和恢复帧请求要求下一帧必须编码, 不能等静止画面的保活.
+    // pipelined_时由编码线程设置, 采集线程读取
+    std::atomic<bool> force_encode_{false};
+    int64_t last_refresh_time_us_ = 0;
+    uint64_t static_skipped_frames_ = 0;
+    // pipelined_时由编码线程修改, 采集线程读取
+    std::atomic<bool> half_fps_{false};
+    // 客户端最近解码成功的帧, 以及上一次从哪一帧开始恢复
+    std::optional<uint64_t> last_acked_picture_id_;
+    std::optional<uint64_t> last_recovery_picture_id_;
     std::map<std::string, int32_t> cursors_map_;
     int32_t latest_cursor_id_ = 0;
 };
@@ -207,6 +298,15 @@ VCEPipeline::VCEPipeline(const CaptureEncodePipeline::Params& params)
     , color_matrix_{params.color_matrix}
     , full_range_{params.full_range}
     , monitor_{params.monitor}
+    , capture_backend_{params.capture_backend}
+    , synthetic_content_{params.synthetic_content}
+    , synthetic_seed_{params.synthetic_seed}
+    , soft_backend_{params.soft_backend}
+    , pipelined_{params.pipelined}
+    , temporal_layers_{params.temporal_layers}
+    , soft_threads_{params.soft_threads}
+    , max_slice_bytes_{params.max_slice_bytes}
+    , probe_bandwidth_{params.probe_bandwidth}
     , register_message_handler_{params.register_message_handler}
     , send_message_{params.send_message}
     , client_supported_codecs_{params.codecs} {}
@@ -228,11 +328,20 @@ VCEPipeline::~VCEPipeline() {
 bool VCEPipeline::init() {
     constexpr uint32_t k144FPS = 144;
     constexpr uint32_t k30FPS = 30;
-    loadSystemCursor();
+    system_cursor_ = SystemCursor::create();
     if (!registerHandlers()) {
         return false;
     }
-    auto capturer = Capturer::create(Capturer::Backend::Dxgi, monitor_);
+    std::unique_ptr<Capturer> capturer;
+    if (capture_backend_ == Capturer::Backend::Synthetic) {
+        auto synthetic_params = SyntheticCapturer::paramsFromMonitor(monitor_);
+        synthetic_params.content = synthetic_content_;
+        synthetic_params.seed = synthetic_seed_;
+        capturer = SyntheticCapturer::create(synthetic_params);
+    }
+    else {
+        capturer = Capturer::create(capture_backend_, monitor_);
+    }
     if (capturer == nullptr) {
         return false;
     }
@@ -260,6 +369,10 @@ bool VCEPipeline::init() {
     encode_params.transfer_func = TransferCharacteristics::BT709;
     encode_params.color_matrix = color_matrix_;
     encode_params.full_range = full_range_;
+    encode_params.soft_backend = soft_backend_;
+    encode_params.temporal_layers = temporal_layers_;
+    encode_params.soft_threads = soft_threads_;
+    encode_params.max_slice_bytes = max_slice_bytes_;
     if (color_matrix_ != ColorMatrix::BT601 && color_matrix_ != ColorMatrix::BT709 &&
         color_matrix_ != ColorMatrix::BT2020_NCL && color_matrix_ != ColorMatrix::BT2020_CL) {
         LOG(WARNING) << "Unsupported color matrix " << static_cast<int32_t>(color_matrix_)
@@ -305,6 +418,21 @@ bool VCEPipeline::init() {
         if (!capturer->setCaptureFormat(encoder->captureFormat())) {
             return false;
         }
+        const size_t frame_size =
+            memFrameSize(encoder->captureFormat(), encoder->width(), encoder->height());
+        if (pipelined_ && frame_size == 0) {
+            LOG(INFO) << "Capture format is not in memory, fallback to serial capture/encode";
+            pipelined_ = false;
+        }
+        if (pipelined_) {
+            frame_pool_ = std::make_unique<FramePool>(kFramePoolCapacity, frame_size);
+        }
+        if (encoder->temporalLayers() > 1) {
+            TemporalLayerPacer::Params pacer_params{};
+            pacer_params.temporal_layers = encoder->temporalLayers();
+            pacer_params.bitrate_bps = encode_params.bitrate_bps;
+            layer_pacer_ = std::make_unique<TemporalLayerPacer>(pacer_params);
+        }
         encoder_ = std::move(encoder);
         capturer_ = std::move(capturer);
         return true;
@@ -352,11 +480,13 @@ bool VCEPipeline::fullRange() const {
 
 void VCEPipeline::mainLoop(const std::function<void()>& i_am_alive,
                            std::promise<bool>& start_promise) {
+#if defined(LT_WINDOWS)
     if (!ltlib::setThreadDesktop()) {
         LOG(ERR) << "VCEPipeline::mainLoop setThreadDesktop failed";
         start_promise.set_value(false);
         return;
     }
+#endif // defined(LT_WINDOWS)
     if (!capturer_->start()) {
         LOG(ERR) << "Start video capturer failed";
         start_promise.set_value(false);
@@ -365,11 +495,19 @@ void VCEPipeline::mainLoop(const std::function<void()>& i_am_alive,
     start_promise.set_value(true);
     stop_promise_ = std::make_unique<std::promise<void>>();
     stoped_ = false;
-    LOG(INFO) << "CaptureEncodePipeline start";
+    if (probe_bandwidth_ && isAVC(encoder_->codecType())) {
+        probeBandwidth(i_am_alive);
+    }
+    if (pipelined_) {
+        startStages();
+    }
+    LOG(INFO) << "CaptureEncodePipeline start, pipelined:" << pipelined_;
     while (!stoped_) {
         i_am_alive();
         // vblank后应该第一时间抓屏还是消费任务？
-        consumeTasks();
+        if (!pipelined_) {
+            consumeTasks();
+        }
         auto resolution = resolutionChanged();
         if (resolution.has_value()) {
             sendChangeStreamingParams(resolution.value());
@@ -377,35 +515,184 @@ void VCEPipeline::mainLoop(const std::function<void()>& i_am_alive,
             break;
         }
         capturer_->waitForVBlank();
-        captureAndSendVideoFrame();
+        if (pipelined_) {
+            captureToFramePool();
+        }
+        else {
+            captureAndSendVideoFrame();
+        }
         captureAndSendCursor();
     }
+    if (pipelined_) {
+        stopStages();
+    }
     stop_promise_->set_value();
-    LOG(INFO) << "CaptureEncodePipeline stoped";
-}
-
-void VCEPipeline::loadSystemCursor() { // 释放?
-    cursors_[LoadCursorA(nullptr, IDC_ARROW)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_Arrow;
-    cursors_[LoadCursorA(nullptr, IDC_IBEAM)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_Ibeam;
-    cursors_[LoadCursorA(nullptr, IDC_WAIT)] = ltproto::client2worker::CursorInfo_PresetCursor_Wait;
-    cursors_[LoadCursorA(nullptr, IDC_CROSS)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_Cross;
-    cursors_[LoadCursorA(nullptr, IDC_SIZENWSE)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_SizeNwse;
-    cursors_[LoadCursorA(nullptr, IDC_SIZENESW)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_SizeNesw;
-    cursors_[LoadCursorA(nullptr, IDC_SIZEWE)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_SizeWe;
-    cursors_[LoadCursorA(nullptr, IDC_SIZENS)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_SizeNs;
-    cursors_[LoadCursorA(nullptr, IDC_SIZEALL)] =
-        ltproto::client2worker::CursorInfo_PresetCursor_SizeAll;
-    cursors_[LoadCursorA(nullptr, IDC_NO)] = ltproto::client2worker::CursorInfo_PresetCursor_No;
-    cursors_[LoadCursorA(nullptr, IDC_HAND)] = ltproto::client2worker::CursorInfo_PresetCursor_Hand;
+    LOG(INFO) << "CaptureEncodePipeline stoped, skipped " << static_skipped_frames_
+              << " static frames";
+    const auto pool_stat = encoder_->outputPoolStat();
+    LOG(INFO) << "Encoder output buffers: " << pool_stat.acquires << " frames, "
+              << pool_stat.allocations << " allocations, " << pool_stat.reserved_bytes_high_water
+              << " bytes reserved. Frame messages allocated " << frame_messages_.allocations()
+              << " times";
+    if (layer_pacer_ != nullptr) {
+        const auto& stat = layer_pacer_->stat();
+        LOG(INFO) << "Temporal layer pacer sent " << stat.sent_frames << " frames, dropped "
+                  << stat.dropped_frames << " frames(" << stat.dropped_bytes << " bytes)";
+    }
+}
+
+// 在第一个关键帧之前跑, 这时还没有编码线程和发送线程, 直接在本线程上收确认和发消息
+void VCEPipeline::probeBandwidth(const std::function<void()>& i_am_alive) {
+    BandwidthProber::Params params{};
+    params.max_bps = max_bps_;
+    prober_ = std::make_unique<BandwidthProber>(params);
+    const int64_t start_us = ltlib::steady_now_us();
+    while (!stoped_ && !prober_->done()) {
+        i_am_alive();
+        consumeTasks();
+        int64_t now_us = ltlib::steady_now_us();
+        const uint32_t bytes = prober_->probeBytesToSend(now_us);
+        if (bytes > 0) {
+            auto probe = std::make_shared<ltproto::client2worker::VideoFrame>();
+            auto data = makeProbeFrame(bytes);
+            probe->set_frame(data.data(), data.size());
+            probe->set_is_keyframe(false);
+            probe->set_picture_id(encoder_->reservePictureID());
+            probe->set_width(encoder_->width());
+            probe->set_height(encoder_->height());
+            probe->set_capture_timestamp_us(now_us);
+            probe->set_start_encode_timestamp_us(now_us);
+            probe->set_end_encode_timestamp_us(now_us);
+            send_message_(ltproto::id(probe), probe);
+            prober_->onProbeSent(static_cast<uint64_t>(probe->picture_id()),
+                                 static_cast<uint32_t>(data.size()), now_us);
+        }
+        // 确认是从别的线程塞进tasks_的, 最多睡1ms
+        now_us = ltlib::steady_now_us();
+        const int64_t sleep_us = std::clamp<int64_t>(prober_->nextWakeupUs() - now_us, 0, 1'000);
+        if (sleep_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds{sleep_us});
+        }
+    }
+    auto estimate = prober_->estimateBps();
+    LOG(INFO) << "Bandwidth probing took " << (ltlib::steady_now_us() - start_us) / 1000
+              << "ms, estimate " << (estimate.has_value() ? estimate.value() : 0) << "bps";
+    if (!estimate.has_value() || manual_bitrate_) {
+        return;
+    }
+    Encoder::ReconfigureParams reconfigure{};
+    const auto bitrate_bps = static_cast<uint32_t>(estimate.value() * kProbedBitrateRatio);
+    reconfigure.bitrate_bps = std::min(bitrate_bps, max_bps_);
+    const double pixels = static_cast<double>(encoder_->width()) * encoder_->height();
+    constexpr uint32_t k30FPS = 30;
+    if (target_fps_ > k30FPS &&
+        reconfigure.bitrate_bps.value() / (pixels * target_fps_) < kMinBitsPerPixel) {
+        target_fps_ = k30FPS;
+        reconfigure.fps = target_fps_;
+    }
+    LOG(INFO) << "Initial bitrate " << reconfigure.bitrate_bps.value() << ", fps " << target_fps_;
+    encoder_->reconfigure(reconfigure);
+    if (layer_pacer_ != nullptr) {
+        layer_pacer_->setBitrate(reconfigure.bitrate_bps.value());
+    }
+}
+
+// 编码线程独占encoder_, 所以service发来的任务也改到编码线程上执行.
+// 所有消息都经过发送线程, 保证send_message_只在一个线程上调用并且顺序不变
+void VCEPipeline::startStages() {
+    encode_thread_ = ltlib::BlockingThread::create(
+        "lt_video_encode",
+        [this](const std::function<void()>& i_am_alive) { encodeLoop(i_am_alive); });
+    send_thread_ = ltlib::BlockingThread::create(
+        "lt_video_send", [this](const std::function<void()>& i_am_alive) { sendLoop(i_am_alive); });
+}
+
+void VCEPipeline::stopStages() {
+    frame_pool_->stop();
+    send_cv_.notify_all();
+    encode_thread_.reset();
+    send_thread_.reset();
+    // 发送线程退出时可能还有没发的消息, 比如分辨率变化通知
+    for (auto& [type, msg] : send_queue_) {
+        send_message_(type, msg);
+    }
+    send_queue_.clear();
+    LOG(INFO) << "Capture/encode stages stoped, dropped " << frame_pool_->dropped() << " frames";
+}
+
+void VCEPipeline::encodeLoop(const std::function<void()>& i_am_alive) {
+    while (!stoped_) {
+        i_am_alive();
+        consumeTasks();
+        FramePool::Slot* slot = frame_pool_->pop(std::chrono::milliseconds{10});
+        if (slot == nullptr) {
+            continue;
+        }
+        auto encoded_frame = encoder_->encode(slot->frame());
+        frame_pool_->release(slot);
+        if (encoded_frame.has_value()) {
+            sendVideoFrame(encoded_frame.value());
+        }
+    }
+}
+
+void VCEPipeline::sendLoop(const std::function<void()>& i_am_alive) {
+    while (!stoped_) {
+        i_am_alive();
+        std::deque<std::pair<uint32_t, std::shared_ptr<google::protobuf::MessageLite>>> messages;
+        {
+            std::unique_lock lock{send_mutex_};
+            send_cv_.wait_for(lock, std::chrono::milliseconds{10},
+                              [this]() { return stoped_ || !send_queue_.empty(); });
+            messages.swap(send_queue_);
+        }
+        for (auto& [type, msg] : messages) {
+            send_message_(type, msg);
+        }
+    }
 }
 
+// 编码器的输出到这里才包装成protobuf
+void VCEPipeline::sendVideoFrame(const EncodedFrame& frame) {
+    if (layer_pacer_ != nullptr) {
+        auto layer = findTemporalLayerSei(frame.data(), frame.size);
+        // 没有SEI的帧不知道谁参考了它, 当作T0
+        const uint32_t temporal_id = layer.has_value() ? layer->temporal_id : 0;
+        if (!layer_pacer_->admit(temporal_id, frame.is_keyframe, frame.size,
+                                 ltlib::steady_now_us())) {
+            return;
+        }
+    }
+    auto msg = frame_messages_.wrap(frame);
+    sendMessage(ltproto::id(msg), msg);
+}
+
+void VCEPipeline::captureToFramePool() {
+    auto captured_frame = capturer_->capture();
+    if (!captured_frame.has_value()) {
+        return;
+    }
+    // 帧率控制放在拷贝之前, 不编码的帧就不用拷了
+    if (shouldEncodeFrame(captured_frame.value()) && !frame_pool_->push(captured_frame.value())) {
+        content_changed_ = true;
+    }
+    capturer_->doneWithFrame();
+}
+
+void VCEPipeline::sendMessage(uint32_t type,
+                              const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+    if (!pipelined_) {
+        send_message_(type, msg);
+        return;
+    }
+    {
+        std::lock_guard lock{send_mutex_};
+        send_queue_.emplace_back(type, msg);
+    }
+    send_cv_.notify_one();
+}
+
+
 bool VCEPipeline::registerHandlers() {
     namespace ltype = ltproto::type;
     namespace ph = std::placeholders;
@@ -434,9 +721,9 @@ void VCEPipeline::consumeTasks() {
 }
 
 void VCEPipeline::captureAndSendCursor() {
-    auto msg = getDxgiCursorInfo();
+    auto msg = getCapturerCursorInfo();
     if (msg == nullptr) {
-        msg = getWin32CursorInfo();
+        msg = getSystemCursorInfo();
     }
     if (msg == nullptr) {
         return;
@@ -455,7 +742,7 @@ void VCEPipeline::captureAndSendCursor() {
         }
     }
 
-    send_message_(ltproto::id(cursor), cursor);
+    sendMessage(ltproto::id(cursor), cursor);
 }
 
 void VCEPipeline::captureAndSendVideoFrame() {
@@ -466,7 +753,7 @@ void VCEPipeline::captureAndSendVideoFrame() {
     if (encoder_->doneFrame1()) {
         capturer_->doneWithFrame();
     }
-    if (!shouldEncodeFrame()) {
+    if (!shouldEncodeFrame(captured_frame.value())) {
         if (encoder_->doneFrame2()) {
             capturer_->doneWithFrame();
         }
@@ -476,14 +763,20 @@ void VCEPipeline::captureAndSendVideoFrame() {
     if (encoder_->doneFrame2()) {
         capturer_->doneWithFrame();
     }
-    if (encoded_frame == nullptr) {
+    if (!encoded_frame.has_value()) {
+        // 这一帧没编出来, 画面不变也要重新编码
+        content_changed_ = true;
         return;
     }
     // TODO: 计算编码完成距离上一次vblank时间
-    send_message_(ltproto::id(encoded_frame), encoded_frame);
+    sendVideoFrame(encoded_frame.value());
 }
 
 std::optional<ltlib::DisplayOutputDesc> VCEPipeline::resolutionChanged() {
+    if (capture_backend_ == Capturer::Backend::Synthetic) {
+        // 合成画面的分辨率是固定的, 和真实显示器无关
+        return std::nullopt;
+    }
     ltlib::DisplayOutputDesc desc = ltlib::getDisplayOutputDesc(monitor_.name);
     if (desc.height != static_cast<int32_t>(height_) ||
         desc.width != static_cast<int32_t>(width_)) {
@@ -502,15 +795,33 @@ void VCEPipeline::sendChangeStreamingParams(ltlib::DisplayOutputDesc desc) {
     params->set_video_height(desc.height);
     params->set_screen_refresh_rate(desc.frequency);
     params->set_rotation(desc.rotation);
-    send_message_(ltproto::id(msg), msg);
+    sendMessage(ltproto::id(msg), msg);
 }
 
-bool VCEPipeline::shouldEncodeFrame() {
+bool VCEPipeline::shouldEncodeFrame(const Capturer::Frame& frame) {
     addHistory(capture_history_);
+    const int64_t now_us = ltlib::steady_now_us();
+    if (frame.dirty_rects == nullptr || !frame.dirty_rects->empty()) {
+        content_changed_ = true;
+    }
+    if (force_encode_.exchange(false)) {
+        content_changed_ = true;
+    }
+    if (!content_changed_) {
+        if (now_us - last_encode_time_us_ < kStaticKeepaliveIntervalUs) {
+            static_skipped_frames_++;
+            return false;
+        }
+        if (now_us - last_refresh_time_us_ >= kStaticRefreshIntervalUs) {
+            encoder_->requestKeyframe();
+            last_refresh_time_us_ = now_us;
+        }
+        last_encode_time_us_ = now_us;
+        return true;
+    }
     const size_t capture_fps = capture_history_.size();
     const uint32_t target_fps = half_fps_ ? (target_fps_ / 2) : target_fps_;
     const uint32_t interval_us = 1'000'000 / target_fps;
-    const int64_t now_us = ltlib::steady_now_us();
     if (capture_fps > target_fps + 2) {
         int64_t last_target_encode_time_us = now_us - now_us % interval_us;
         if (last_encode_time_us_ >= last_target_encode_time_us) {
@@ -518,181 +829,30 @@ bool VCEPipeline::shouldEncodeFrame() {
         }
     }
     last_encode_time_us_ = now_us;
+    last_refresh_time_us_ = now_us;
+    content_changed_ = false;
     return true;
 }
 
-std::shared_ptr<google::protobuf::MessageLite> VCEPipeline::getDxgiCursorInfo() {
+std::shared_ptr<google::protobuf::MessageLite> VCEPipeline::getCapturerCursorInfo() {
     auto info = capturer_->cursorInfo();
     if (!info.has_value()) {
         return nullptr;
     }
-    auto msg = std::make_shared<ltproto::client2worker::CursorInfo>();
-    msg->set_visible(info->visible);
-    msg->set_x(info->x);
-    msg->set_y(info->y);
-    msg->set_w(ltlib::getScreenWidth());
-    msg->set_h(ltlib::getScreenHeight());
-    if (!info->data.empty()) {
-        msg->set_cursor_w(info->w);
-        msg->set_cursor_h(info->h);
-        msg->set_hot_x(info->hot_x);
-        msg->set_hot_y(info->hot_y);
-        msg->set_pitch(info->pitch);
-        msg->set_type(toProtobuf(info->format));
-        msg->set_data(info->data.data(), info->data.size());
-    }
-    return msg;
+    return toProtobuf(info.value());
 }
 
-static CursorFormat getCursorDataFromHcursor(HCURSOR hcursor, std::vector<uint8_t>& cursor_data,
-                                             uint32_t& w, uint32_t& h, uint16_t& hot_x,
-                                             uint16_t& hot_y, uint32_t& pitch) {
-    int32_t color_width = 0;
-    int32_t color_height = 0;
-    int32_t color_bits_pixel = 0;
-    int32_t mask_width = 0;
-    int32_t mask_height = 0;
-    int32_t mask_bits_pixel = 0;
-    std::vector<uint8_t> color_data;
-    std::vector<uint8_t> mask_data;
-    ICONINFO iconinfo{};
-    BOOL ret = GetIconInfo(hcursor, &iconinfo);
-    if (ret != TRUE) {
-        LOG(ERR) << "GetIconInfo failed: 0x" << std::hex << GetLastError();
-        return CursorFormat::Unknown;
-    }
-    hot_x = static_cast<uint16_t>(iconinfo.xHotspot);
-    hot_y = static_cast<uint16_t>(iconinfo.yHotspot);
-    if (iconinfo.hbmColor) {
-        BITMAP bmp{};
-        GetObjectA(iconinfo.hbmColor, sizeof(BITMAP), &bmp);
-        if (!bmp.bmWidthBytes || !bmp.bmHeight) {
-            return CursorFormat::Unknown;
-        }
-
-        color_data.resize(bmp.bmWidthBytes * bmp.bmHeight);
-        if (!GetBitmapBits(iconinfo.hbmColor, bmp.bmWidthBytes * bmp.bmHeight, color_data.data())) {
-            return CursorFormat::Unknown;
-        }
-
-        color_width = bmp.bmWidth;
-        color_height = bmp.bmHeight;
-        color_bits_pixel = bmp.bmBitsPixel;
-    }
-    if (iconinfo.hbmMask) {
-        BITMAP bmp{};
-        GetObjectA(iconinfo.hbmMask, sizeof(BITMAP), &bmp);
-        if (!bmp.bmWidthBytes || !bmp.bmHeight) {
-            return CursorFormat::Unknown;
-        }
-
-        mask_data.resize(bmp.bmWidthBytes * bmp.bmHeight);
-        if (!GetBitmapBits(iconinfo.hbmMask, bmp.bmWidthBytes * bmp.bmHeight, mask_data.data())) {
-            return CursorFormat::Unknown;
-        }
-
-        mask_width = bmp.bmWidth;
-        mask_height = bmp.bmHeight;
-        mask_bits_pixel = bmp.bmBitsPixel;
-    }
-    if (iconinfo.hbmColor) {
-        DeleteObject(iconinfo.hbmColor);
-    }
-    if (iconinfo.hbmMask) {
-        DeleteObject(iconinfo.hbmMask);
-    }
-    if (color_data.empty() && !mask_data.empty() && mask_bits_pixel == 1) {
-        w = mask_width;
-        h = mask_height;
-        pitch = static_cast<uint32_t>(mask_data.size() / h);
-        cursor_data = std::move(mask_data);
-        return CursorFormat::MonoChrome;
-    }
-    else if (!color_data.empty() && !mask_data.empty() && mask_bits_pixel == 32) { // ???
-        w = color_width;
-        h = color_height;
-        pitch = color_width * 4;
-        cursor_data.resize(color_data.size() + mask_data.size());
-        memcpy(cursor_data.data(), color_data.data(), color_data.size());
-        memcpy(cursor_data.data() + color_data.size(), mask_data.data(), mask_data.size());
-        return CursorFormat::MaskedColor;
-    }
-    else if (!color_data.empty()) {
-        w = color_width;
-        h = color_height;
-        pitch = color_width * 4;
-        cursor_data = std::move(color_data);
-        return CursorFormat::Color;
-    }
-    LOG(WARNING) << "getCursorDataFromHcursor failed, color size:" << color_data.size()
-                 << ", mask size:" << mask_data.size() << ", mask_bits_pixel:" << mask_bits_pixel;
-    return CursorFormat::Unknown;
-}
-
-std::shared_ptr<google::protobuf::MessageLite> VCEPipeline::getWin32CursorInfo() {
-    auto msg = std::make_shared<ltproto::client2worker::CursorInfo>();
-    msg->set_w(ltlib::getScreenWidth());
-    msg->set_h(ltlib::getScreenHeight());
-    CURSORINFO pci{};
-    POINT pos{};
-    DWORD error1 = 0;
-    DWORD error2 = 0;
-    pci.cbSize = sizeof(pci);
-    if (GetCursorInfo(&pci)) {
-        get_win32_cursor_failed_ = false;
-        msg->set_x(pci.ptScreenPos.x);
-        msg->set_y(pci.ptScreenPos.y);
-        msg->set_visible(pci.flags != 0);
-        auto iter = cursors_.find(pci.hCursor);
-        if (iter != cursors_.end()) {
-            msg->set_preset(
-                static_cast<ltproto::client2worker::CursorInfo_PresetCursor>(iter->second));
-        }
-        std::vector<uint8_t> cursor_data;
-        uint16_t hot_x = 0, hot_y = 0;
-        uint32_t cursor_w = 0, cursor_h = 0, pitch = 0;
-        CursorFormat format = getCursorDataFromHcursor(pci.hCursor, cursor_data, cursor_w, cursor_h,
-                                                       hot_x, hot_y, pitch);
-        if (format == CursorFormat::Unknown) {
-            // some log
-        }
-        else {
-            msg->set_data(cursor_data.data(), cursor_data.size());
-            msg->set_x(pci.ptScreenPos.x - hot_x);
-            msg->set_y(pci.ptScreenPos.y - hot_y);
-            msg->set_hot_x(hot_x);
-            msg->set_hot_y(hot_y);
-            msg->set_type(toProtobuf(format));
-            msg->set_cursor_h(cursor_h);
-            msg->set_cursor_w(cursor_w);
-            msg->set_pitch(pitch);
-            return msg;
-        }
-    }
-    else {
-        error1 = GetLastError();
-    }
-    ltlib::setThreadDesktop();
-    if (GetCursorPos(&pos)) {
-        get_win32_cursor_failed_ = false;
-        msg->set_preset(ltproto::client2worker::CursorInfo_PresetCursor_Arrow);
-        msg->set_x(pos.x);
-        msg->set_y(pos.y);
-        msg->set_visible(true);
-        // send_message_(ltproto::id(msg), msg);
-        return msg;
-    }
-    else {
-        error2 = GetLastError();
+std::shared_ptr<google::protobuf::MessageLite> VCEPipeline::getSystemCursorInfo() {
+    auto info = system_cursor_->get();
+    if (!info.has_value()) {
+        return nullptr;
     }
-
-    // 这个标志位是为了只打一次这个日志
-    if (!get_win32_cursor_failed_) {
-        // 这么写获取不到错误码，但是要获得错误码的写法很丑
-        LOGF(ERR, "GetCursorInfo=>%u and GetCursorPos=>%u", error1, error2);
+    auto msg = toProtobuf(info->cursor);
+    if (info->preset.has_value()) {
+        msg->set_preset(
+            static_cast<ltproto::client2worker::CursorInfo_PresetCursor>(info->preset.value()));
     }
-    get_win32_cursor_failed_ = true;
-    return nullptr;
+    return msg;
 }
 
 void VCEPipeline::onReconfigure(std::shared_ptr<google::protobuf::MessageLite> _msg) {
@@ -736,13 +896,28 @@ void VCEPipeline::onReconfigure(std::shared_ptr<google::protobuf::MessageLite> _
         if (changed) {
             encoder_->reconfigure(params);
         }
+        if (params.bitrate_bps.has_value() && layer_pacer_ != nullptr) {
+            layer_pacer_->setBitrate(params.bitrate_bps.value());
+        }
     });
 }
 
 void VCEPipeline::onRequestKeyframe(std::shared_ptr<google::protobuf::MessageLite> msg) {
     (void)msg;
     std::lock_guard lock{mutex_};
-    tasks_.push_back([this] { encoder_->requestKeyframe(); });
+    tasks_.push_back([this] {
+        // 客户端丢帧或者解码失败时请求关键帧, 它最后解对的帧还在的话先试试从那里恢复.
+        // 同一个位置第二次请求说明恢复帧也没用上(又丢了或者解码器被重置了), 只能编IDR
+        if (last_acked_picture_id_.has_value() &&
+            last_acked_picture_id_ != last_recovery_picture_id_ &&
+            encoder_->recoverFrom(last_acked_picture_id_.value())) {
+            last_recovery_picture_id_ = last_acked_picture_id_;
+        }
+        else {
+            encoder_->requestKeyframe();
+        }
+        force_encode_ = true;
+    });
 }
 
 void VCEPipeline::onNetworkEvent(std::shared_ptr<google::protobuf::MessageLite> _msg) {
@@ -769,7 +944,16 @@ void VCEPipeline::onVideoFrameAck1(std::shared_ptr<google::protobuf::MessageLite
     std::lock_guard lock{mutex_};
     tasks_.push_back([this, _msg] {
         auto msg = std::static_pointer_cast<ltproto::client2worker::VideoFrameAck1>(_msg);
-        // TODO:
+        const auto picture_id = static_cast<uint64_t>(msg->picture_id());
+        if (prober_ != nullptr &&
+            prober_->onProbeAcked(picture_id, msg->recv_time(), ltlib::steady_now_us())) {
+            return;
+        }
+        if (last_acked_picture_id_.has_value() && picture_id <= last_acked_picture_id_.value()) {
+            return;
+        }
+        last_acked_picture_id_ = picture_id;
+        encoder_->onFrameAcked(picture_id);
     });
 }
 
@@ -37,6 +37,9 @@
 #include <ltlib/system.h>
 #include <message_handler.h>
 #include <transport/transport.h>
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/capturer/video_capturer.h>
+#include <video/encoder/video_encoder.h>
 #include <video/types.h>
 
 namespace lt {
@@ -54,6 +57,24 @@ public:
         ColorMatrix color_matrix;
         bool full_range;
         ltlib::Monitor monitor;
+        // 非Windows平台只有Synthetic可用
+        Capturer::Backend capture_backend = Capturer::Backend::Dxgi;
+        // capture_backend为Synthetic时生成什么画面, 分辨率和帧率跟monitor一致
+        SyntheticCapturer::Content synthetic_content = SyntheticCapturer::Content::StaticDesktop;
+        uint64_t synthetic_seed = 0;
+        // 没有可用的硬编码时用哪个软编码器
+        Encoder::SoftBackend soft_backend = Encoder::SoftBackend::OpenH264;
+        // 采集, 编码, 发送分别在自己的线程上跑. 只对内存里的帧(软编码)生效,
+        // D3D11纹理还是在一个线程上串行处理
+        bool pipelined = true;
+        // 时域分层数, 大于1时网络拥塞会先丢高层的帧而不是让客户端等关键帧. 只有OpenH264支持
+        uint32_t temporal_layers = 1;
+        // 软编码线程数, 0表示自动选择. 只有OpenH264支持
+        uint32_t soft_threads = 0;
+        // 软编码单个slice的字节数上限, 0表示不限制. 只有OpenH264支持
+        uint32_t max_slice_bytes = 0;
+        // 开始推流前先发探测包估计带宽, 用结果设置初始码率和帧率. 只支持H264
+        bool probe_bandwidth = false;
         std::function<bool(uint32_t, const MessageHandler&)> register_message_handler;
         std::function<bool(uint32_t, const std::shared_ptr<google::protobuf::MessageLite>&)>
             send_message;
@@ -75,4 +96,4 @@ protected:
 
 } // namespace video
 
-} // namespace lt
\ No newline at end of file
+} // namespace lt
@@ -0,0 +1,318 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltproto/client2worker/request_keyframe.pb.h>
+#include <ltproto/client2worker/video_frame.pb.h>
+#include <ltproto/ltproto.h>
+
+#include <ltlib/threads.h>
+#include <ltlib/times.h>
+
+#include <video/cepipeline/video_capture_encode_pipeline.h>
+#include <video/decoder/video_decoder.h>
+#include <video/drpipeline/nal_classifier.h>
+
+namespace {
+
+using lt::VideoCodecType;
+using lt::video::CaptureEncodePipeline;
+using Content = lt::video::SyntheticCapturer::Content;
+using VideoFrame = ltproto::client2worker::VideoFrame;
+
+constexpr uint32_t kFrames = 30;
+constexpr int32_t kFps = 30;
+
+// pipeline里的BlockingThread要向ThreadWatcher注册
+class ThreadWatcherEnvironment : public ::testing::Environment {
+public:
+    void SetUp() override { ltlib::ThreadWatcher::init(std::this_thread::get_id()); }
+    void TearDown() override { ltlib::ThreadWatcher::uninit(); }
+};
+
+const auto* const kThreadWatcherEnv =
+    ::testing::AddGlobalTestEnvironment(new ThreadWatcherEnvironment);
+
+struct Resolution {
+    uint32_t width;
+    uint32_t height;
+};
+
+class FrameSink {
+public:
+    bool onMessage(uint32_t type, const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        if (type != ltproto::type::kVideoFrame) {
+            return true;
+        }
+        const int64_t now_us = ltlib::steady_now_us();
+        std::lock_guard lock{mutex_};
+        frames_.push_back(std::static_pointer_cast<VideoFrame>(msg));
+        send_timestamps_us_.push_back(now_us);
+        cv_.notify_all();
+        return true;
+    }
+
+    std::vector<std::shared_ptr<VideoFrame>> wait(size_t count, std::chrono::seconds timeout) {
+        std::unique_lock lock{mutex_};
+        cv_.wait_for(lock, timeout, [this, count]() { return frames_.size() >= count; });
+        return frames_;
+    }
+
+    // 每一帧交给send_message时的时间
+    std::vector<int64_t> sendTimestamps() {
+        std::lock_guard lock{mutex_};
+        return send_timestamps_us_;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<VideoFrame>> frames_;
+    std::vector<int64_t> send_timestamps_us_;
+};
+
+std::unique_ptr<CaptureEncodePipeline>
+createPipeline(const Resolution& res, FrameSink& sink, Content content = Content::MovingWindow,
+               bool pipelined = true, std::map<uint32_t, lt::MessageHandler>* handlers = nullptr) {
+    CaptureEncodePipeline::Params params{};
+    params.codecs = {VideoCodecType::H264_420_SOFT};
+    params.width = res.width;
+    params.height = res.height;
+    params.client_refresh_rate = kFps;
+    params.max_mbps = 10;
+    params.color_matrix = lt::ColorMatrix::BT709;
+    params.full_range = false;
+    params.monitor.width = static_cast<int32_t>(res.width);
+    params.monitor.height = static_cast<int32_t>(res.height);
+    params.monitor.frequency = kFps;
+    params.pipelined = pipelined;
+    params.capture_backend = lt::video::Capturer::Backend::Synthetic;
+    params.synthetic_content = content;
+    params.register_message_handler = [handlers](uint32_t type,
+                                                 const lt::MessageHandler& handler) {
+        if (handlers != nullptr) {
+            (*handlers)[type] = handler;
+        }
+        return true;
+    };
+    params.send_message = [&sink](uint32_t type,
+                                  const std::shared_ptr<google::protobuf::MessageLite>& msg) {
+        return sink.onMessage(type, msg);
+    };
+    return CaptureEncodePipeline::create(params);
+}
+
+class CaptureEncodePipelineTest : public ::testing::TestWithParam<Resolution> {};
+
+TEST_P(CaptureEncodePipelineTest, EncodesDecodableH264) {
+    const Resolution res = GetParam();
+    FrameSink sink;
+    auto pipeline = createPipeline(res, sink);
+    if (pipeline == nullptr) {
+        GTEST_SKIP() << "OpenH264 is not available";
+    }
+    ASSERT_EQ(pipeline->codec(), VideoCodecType::H264_420_SOFT);
+    ASSERT_TRUE(pipeline->start());
+    auto frames = sink.wait(kFrames, std::chrono::seconds{10});
+    pipeline->stop();
+    ASSERT_GE(frames.size(), kFrames);
+    frames.resize(kFrames);
+
+    lt::video::Decoder::Params decode_params{};
+    decode_params.codec_type = VideoCodecType::H264_420_SOFT;
+    decode_params.width = res.width;
+    decode_params.height = res.height;
+    decode_params.va_type = lt::VaType::None;
+    auto decoder = lt::video::Decoder::create(decode_params);
+    ASSERT_NE(decoder, nullptr);
+
+    uint32_t decoded = 0;
+    int64_t encode_us = 0;
+    int64_t max_latency_us = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        const auto& frame = *frames[i];
+        EXPECT_EQ(frame.width(), res.width);
+        EXPECT_EQ(frame.height(), res.height);
+        EXPECT_EQ(frame.picture_id(), i);
+        auto data = reinterpret_cast<const uint8_t*>(frame.frame().data());
+        auto size = static_cast<uint32_t>(frame.frame().size());
+        auto kind = lt::video::classifyFrame(VideoCodecType::H264_420, data, size);
+        if (i == 0) {
+            EXPECT_TRUE(frame.is_keyframe());
+            EXPECT_EQ(kind, lt::video::FrameKind::Keyframe);
+        }
+        else {
+            EXPECT_NE(kind, lt::video::FrameKind::Unknown) << "frame " << i;
+        }
+        auto result = decoder->decode(data, size);
+        ASSERT_TRUE(result.status == lt::video::DecodeStatus::Success2 ||
+                    result.status == lt::video::DecodeStatus::EAgain)
+            << "frame " << i;
+        if (result.status == lt::video::DecodeStatus::Success2) {
+            decoded++;
+        }
+        const auto end_us = static_cast<int64_t>(frame.end_encode_timestamp_us());
+        encode_us += end_us - static_cast<int64_t>(frame.start_encode_timestamp_us());
+        max_latency_us =
+            std::max(max_latency_us, end_us - static_cast<int64_t>(frame.capture_timestamp_us()));
+    }
+    EXPECT_GT(decoded, kFrames / 2);
+
+    const double avg_encode_ms = encode_us / 1000.0 / frames.size();
+    std::printf("%ux%u: %zu frames, encode %.2fms/frame (%.1f fps), "
+                "max capture->encoded %.2fms\n",
+                res.width, res.height, frames.size(), avg_encode_ms,
+                avg_encode_ms > 0 ? 1000.0 / avg_encode_ms : 0.0, max_latency_us / 1000.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Resolutions, CaptureEncodePipelineTest,
+                         ::testing::Values(Resolution{320, 180}, Resolution{640, 360},
+                                           Resolution{1280, 720}),
+                         [](const ::testing::TestParamInfo<Resolution>& info) {
+                             return std::to_string(info.param.width) + "x" +
+                                    std::to_string(info.param.height);
+                         });
+
+struct RunStats {
+    double fps;
+    double avg_latency_ms;
+    double p99_latency_ms;
+};
+
+// 噪声画面编码最慢, 最能体现采集和编码并行的收益
+std::optional<RunStats> runNoise(bool pipelined) {
+    constexpr Resolution kRes{1920, 1080};
+    constexpr size_t kWarmup = 5;
+    FrameSink sink;
+    auto pipeline = createPipeline(kRes, sink, Content::Noise, pipelined);
+    if (pipeline == nullptr || !pipeline->start()) {
+        return std::nullopt;
+    }
+    auto frames = sink.wait(kFrames + kWarmup, std::chrono::seconds{30});
+    pipeline->stop();
+    auto sent_us = sink.sendTimestamps();
+    if (frames.size() < kFrames + kWarmup) {
+        return std::nullopt;
+    }
+    std::vector<double> latencies_ms;
+    for (size_t i = kWarmup; i < kFrames + kWarmup; i++) {
+        latencies_ms.push_back(
+            (sent_us[i] - static_cast<int64_t>(frames[i]->capture_timestamp_us())) / 1000.0);
+    }
+    double sum_ms = 0;
+    for (double ms : latencies_ms) {
+        sum_ms += ms;
+    }
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    const int64_t duration_us = sent_us[kFrames + kWarmup - 1] - sent_us[kWarmup];
+    RunStats stats{};
+    stats.fps = duration_us > 0 ? (kFrames - 1) * 1'000'000.0 / duration_us : 0.0;
+    stats.avg_latency_ms = sum_ms / latencies_ms.size();
+    stats.p99_latency_ms = latencies_ms[latencies_ms.size() * 99 / 100];
+    return stats;
+}
+
+TEST(CaptureEncodePipelineTest, PipelinedVersusSerial) {
+    auto serial = runNoise(false);
+    if (!serial.has_value()) {
+        GTEST_SKIP() << "OpenH264 is not available";
+    }
+    auto pipelined = runNoise(true);
+    ASSERT_TRUE(pipelined.has_value());
+    std::printf("1920x1080 noise serial:    %.1f fps, capture->send avg %.2fms p99 %.2fms\n",
+                serial->fps, serial->avg_latency_ms, serial->p99_latency_ms);
+    std::printf("1920x1080 noise pipelined: %.1f fps, capture->send avg %.2fms p99 %.2fms\n",
+                pipelined->fps, pipelined->avg_latency_ms, pipelined->p99_latency_ms);
+    // 机器负载会影响结果, 只检查流水线没有明显变差
+    EXPECT_GE(pipelined->fps, serial->fps * 0.8);
+}
+
+struct TrafficStats {
+    size_t frames;
+    size_t bytes;
+};
+
+// 采集30fps, 跑满duration, 统计编码出来的帧数和字节数
+std::optional<TrafficStats> runFor(Content content, std::chrono::seconds duration) {
+    FrameSink sink;
+    auto pipeline = createPipeline(Resolution{640, 360}, sink, content);
+    if (pipeline == nullptr || !pipeline->start()) {
+        return std::nullopt;
+    }
+    auto frames = sink.wait(std::numeric_limits<size_t>::max(), duration);
+    pipeline->stop();
+    TrafficStats stats{frames.size(), 0};
+    for (const auto& frame : frames) {
+        stats.bytes += frame->frame().size();
+    }
+    return stats;
+}
+
+TEST(CaptureEncodePipelineTest, IdleDesktopSkipsEncoding) {
+    constexpr std::chrono::seconds kDuration{3};
+    auto idle = runFor(Content::StaticDesktop, kDuration);
+    if (!idle.has_value()) {
+        GTEST_SKIP() << "OpenH264 is not available";
+    }
+    auto typing = runFor(Content::Typing, kDuration);
+    ASSERT_TRUE(typing.has_value());
+    std::printf("640x360 %ds idle:   %zu frames, %zu bytes\n", static_cast<int>(kDuration.count()),
+                idle->frames, idle->bytes);
+    std::printf("640x360 %ds typing: %zu frames, %zu bytes\n", static_cast<int>(kDuration.count()),
+                typing->frames, typing->bytes);
+    // 静止画面只有第一帧和每秒一帧的保活
+    EXPECT_GE(idle->frames, 1u);
+    EXPECT_LE(idle->frames, 1u + static_cast<size_t>(kDuration.count()) + 1);
+    // 打字每6帧(30fps下0.2秒)变一次
+    EXPECT_GT(typing->frames, idle->frames);
+    EXPECT_LT(typing->frames, static_cast<size_t>(kFps * kDuration.count()) / 2);
+}
+
+TEST(CaptureEncodePipelineTest, KeyframeRequestOnStaticScreen) {
+    // 和VCEPipeline里的保活间隔一致
+    constexpr int64_t kStaticKeepaliveIntervalUs = 1'000'000;
+    for (bool pipelined : {true, false}) {
+        FrameSink sink;
+        std::map<uint32_t, lt::MessageHandler> handlers;
+        auto pipeline = createPipeline(Resolution{640, 360}, sink, Content::StaticDesktop,
+                                       pipelined, &handlers);
+        if (pipeline == nullptr) {
+            GTEST_SKIP() << "OpenH264 is not available";
+        }
+        ASSERT_EQ(handlers.count(ltproto::type::kRequestKeyframe), 1u);
+        ASSERT_TRUE(pipeline->start());
+        ASSERT_EQ(sink.wait(1, std::chrono::seconds{5}).size(), 1u);
+        // 进入静止状态, 离下一次保活还远
+        std::this_thread::sleep_for(std::chrono::milliseconds{300});
+        ASSERT_EQ(sink.wait(1, std::chrono::seconds{0}).size(), 1u);
+        const int64_t request_us = ltlib::steady_now_us();
+        handlers[ltproto::type::kRequestKeyframe](
+            std::make_shared<ltproto::client2worker::RequestKeyframe>());
+        auto frames = sink.wait(2, std::chrono::seconds{2});
+        pipeline->stop();
+        ASSERT_GE(frames.size(), 2u) << "pipelined " << pipelined;
+        // 请求之后发出的第一帧就是关键帧
+        EXPECT_TRUE(frames[1]->is_keyframe()) << "pipelined " << pipelined;
+        const auto first_us = static_cast<int64_t>(frames[0]->capture_timestamp_us());
+        const auto capture_us = static_cast<int64_t>(frames[1]->capture_timestamp_us());
+        std::printf("pipelined %d: keyframe captured %.2fms after the request\n", pipelined,
+                    (capture_us - request_us) / 1000.0);
+        // 只比较帧的先后: 关键帧采集于请求之后, 并且排在保活帧之前, 不是等保活顺带出来的
+        EXPECT_GT(capture_us, request_us) << "pipelined " << pipelined;
+        EXPECT_LT(capture_us, first_us + kStaticKeepaliveIntervalUs) << "pipelined " << pipelined;
+    }
+}
+
+} // namespace
@@ -0,0 +1,184 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// ffmpeg头文件的警告
+#include <ltlib/pragma_warning.h>
+WARNING_DISABLE(4244)
+#include "ffmpeg_soft_decoder.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+} // extern "C"
+
+#include <rtc/rtc.h>
+
+#include <ltlib/logging.h>
+
+WARNING_ENABLE(4244)
+
+namespace {
+
+AVCodecID toAVCodecID(lt::VideoCodecType type) {
+    if (lt::isAVC(type)) {
+        return AVCodecID::AV_CODEC_ID_H264;
+    }
+    else if (lt::isHEVC(type)) {
+        return AVCodecID::AV_CODEC_ID_HEVC;
+    }
+    else {
+        return AVCodecID::AV_CODEC_ID_NONE;
+    }
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+FFmpegSoftDecoder::FFmpegSoftDecoder(const Params& params)
+    : Decoder{params} {}
+
+FFmpegSoftDecoder::~FFmpegSoftDecoder() {
+    if (av_packet_ != nullptr) {
+        av_packet_free(reinterpret_cast<AVPacket**>(&av_packet_));
+    }
+    if (av_frame_ != nullptr) {
+        av_frame_free(reinterpret_cast<AVFrame**>(&av_frame_));
+    }
+    if (codec_ctx_ != nullptr) {
+        avcodec_free_context(reinterpret_cast<AVCodecContext**>(&codec_ctx_));
+    }
+}
+
+bool FFmpegSoftDecoder::init() {
+    AVCodecID codec_id = toAVCodecID(codecType());
+    if (codec_id == AVCodecID::AV_CODEC_ID_NONE) {
+        LOG(ERR) << "FFmpegSoftDecoder unsupported VideoCodecType " << toString(codecType());
+        return false;
+    }
+    const AVCodec* codec = avcodec_find_decoder(codec_id);
+    if (codec == nullptr) {
+        LOGF(ERR, "avcodec_find_decoder(%d) failed, maybe built libavcodec with wrong parameters",
+             (int)codec_id);
+        return false;
+    }
+    av_packet_ = av_packet_alloc();
+    av_frame_ = av_frame_alloc();
+    if (av_packet_ == nullptr || av_frame_ == nullptr) {
+        LOG(ERR) << "av_packet_alloc or av_frame_alloc failed";
+        return false;
+    }
+    AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
+    if (codec_ctx == nullptr) {
+        LOGF(ERR, "avcodec_alloc_context3(%s) failed", codec->name);
+        return false;
+    }
+    codec_ctx_ = codec_ctx;
+    codec_ctx->width = width();
+    codec_ctx->height = height();
+    // 帧级多线程会缓存几帧才出图, 这里要求送一帧出一帧
+    codec_ctx->thread_type = FF_THREAD_SLICE;
+    codec_ctx->thread_count = 0;
+    codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    int ret = avcodec_open2(codec_ctx, codec, nullptr);
+    if (ret != 0) {
+        char strbuff[1024] = {0};
+        ret = av_strerror(ret, strbuff, sizeof(strbuff));
+        LOG(ERR) << "avcodec_open2() failed: " << (ret == 0 ? strbuff : "unknown error");
+        return false;
+    }
+    frame_.resize(width() * height() * 3 / 2);
+    LOGF(INFO, "FFmpegSoftDecoder(%s) initialized with w:%u, h:%u", codec->name, width(),
+         height());
+    return true;
+}
+
+DecodedFrame FFmpegSoftDecoder::decode(const uint8_t* data, uint32_t size) {
+    auto ctx = reinterpret_cast<AVCodecContext*>(codec_ctx_);
+    auto packet = reinterpret_cast<AVPacket*>(av_packet_);
+    auto av_frame = reinterpret_cast<AVFrame*>(av_frame_);
+    packet->data = const_cast<uint8_t*>(data);
+    packet->size = static_cast<int>(size);
+    DecodedFrame frame{};
+    int ret = avcodec_send_packet(ctx, packet);
+    if (ret == AVERROR(EAGAIN)) {
+        frame.status = DecodeStatus::EAgain;
+        return frame;
+    }
+    else if (ret != 0) {
+        char strbuff[1024] = {0};
+        ret = av_strerror(ret, strbuff, sizeof(strbuff));
+        LOG(ERR) << "avcodec_send_packet failed: " << (ret == 0 ? strbuff : "unknown error");
+        frame.status = DecodeStatus::Failed;
+        return frame;
+    }
+    ret = avcodec_receive_frame(ctx, av_frame);
+    if (ret == AVERROR(EAGAIN)) {
+        frame.status = DecodeStatus::EAgain;
+        return frame;
+    }
+    else if (ret != 0) {
+        frame.status = DecodeStatus::Failed;
+        return frame;
+    }
+    if (av_frame->format != AVPixelFormat::AV_PIX_FMT_YUV420P &&
+        av_frame->format != AVPixelFormat::AV_PIX_FMT_YUVJ420P) {
+        LOG(ERR) << "FFmpegSoftDecoder unsupported output format " << av_frame->format;
+        frame.status = DecodeStatus::Failed;
+        return frame;
+    }
+    const int w = static_cast<int>(width());
+    const int h = static_cast<int>(height());
+    ret = rtc::I420ToNV12(av_frame->data[0], av_frame->linesize[0], av_frame->data[1],
+                          av_frame->linesize[1], av_frame->data[2], av_frame->linesize[2],
+                          frame_.data(), w, frame_.data() + w * h, w, w, h);
+    av_frame_unref(av_frame);
+    if (ret != 0) {
+        LOG(ERR) << "rtc::I420ToNV12 failed " << ret;
+        frame.status = DecodeStatus::Failed;
+        return frame;
+    }
+    frame.frame = static_cast<int64_t>((uintptr_t)frame_.data());
+    frame.status = DecodeStatus::Success2;
+    return frame;
+}
+
+std::vector<void*> FFmpegSoftDecoder::textures() {
+    return {frame_.data()};
+}
+
+DecodedFormat FFmpegSoftDecoder::decodedFormat() const {
+    return DecodedFormat::MEM_NV12;
+}
+
+} // namespace video
+
+} // namespace lt
@@ -33,6 +33,7 @@
 #include <ltlib/logging.h>
 
 #include "ffmpeg_hard_decoder.h"
+#include "ffmpeg_soft_decoder.h"
 #if defined(LT_WINDOWS)
 #include "openh264_decoder.h"
 #endif // defined(LT_WINDOWS)
@@ -42,7 +43,14 @@ namespace lt {
 namespace video {
 
 std::unique_ptr<Decoder> Decoder::create(const Params& params) {
-    if (isHard(params.codec_type)) {
+    if (params.va_type == VaType::None) {
+        auto decoder = std::make_unique<FFmpegSoftDecoder>(params);
+        if (!decoder->init()) {
+            return nullptr;
+        }
+        return decoder;
+    }
+    else if (isHard(params.codec_type)) {
         auto decoder = std::make_unique<FFmpegHardDecoder>(params);
         if (!decoder->init()) {
             return nullptr;
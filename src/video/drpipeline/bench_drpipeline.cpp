@@ -0,0 +1,428 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// 无头重放录制下来的码流, 测量解码/渲染流水线各阶段的耗时.
+// 用法: bench_drpipeline [--speed=N] [--fps=N] [--pad-4k] [--refresh-rate=N] [--check] [--switch]
+//                        <file.ltvs>...
+//   --speed         按原始采集时间戳的N倍速送帧, 0表示不等待, 默认1
+//   --fps           忽略采集时间戳, 按固定帧率送帧
+//   --pad-4k        在每帧后面补0(Annex B允许的trailing_zero_8bits), 补到4K码流常见的大小:
+//                   关键帧1MB, 其余帧50~400KB. 配合--fps=144测量submit()交接大帧的耗时
+//   --refresh-rate  模拟显示器的刷新率, 默认60
+//   --check         有帧没能解码(解码失败或者积压被丢)时返回非0, 给CI用
+//   --switch        把所有文件当成一路中途换分辨率的流, 分别用重建pipeline和reconfigure()
+//                   两种方式切换, 比较切换后到第一帧显示的耗时. 文件的编码格式要相同
+// 码流文件格式见video_stream_file.h, 可以用testdata/gen_clips.py生成测试码流.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(LT_WINDOWS)
+#include <Windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <google/protobuf/message_lite.h>
+
+#include <ltlib/logging.h>
+#include <ltlib/threads.h>
+#include <ltlib/times.h>
+#include <video/drpipeline/video_decode_render_pipeline.h>
+#include <video/drpipeline/video_stream_file.h>
+
+namespace {
+
+using lt::video::DecodeRenderPipeline;
+
+struct Options {
+    double speed = 1.0;
+    uint32_t fps = 0;
+    bool pad_4k = false;
+    uint32_t refresh_rate = 60;
+    bool check = false;
+    bool switch_resolution = false;
+    std::vector<std::string> files;
+};
+
+struct StderrSink {
+    void write(g3::LogMessageMover message) { fputs(message.get().toString().c_str(), stderr); }
+};
+
+struct Samples {
+    std::vector<int64_t> values;
+
+    void add(int64_t value) { values.push_back(value); }
+
+    void print(const char* name) {
+        if (values.empty()) {
+            printf("    %-16s -\n", name);
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        int64_t sum = 0;
+        for (auto v : values) {
+            sum += v;
+        }
+        auto at = [this](double p) {
+            return values[std::min(values.size() - 1, static_cast<size_t>(values.size() * p))];
+        };
+        printf("    %-16s avg %7.2fms  p50 %7.2fms  p99 %7.2fms  max %7.2fms\n", name,
+               sum / 1000.0 / values.size(), at(0.5) / 1000.0, at(0.99) / 1000.0,
+               values.back() / 1000.0);
+    }
+};
+
+struct Result {
+    std::mutex mutex;
+    size_t submitted = 0;
+    size_t decoded = 0;
+    size_t presented = 0;
+    size_t keyframe_requests = 0;
+    size_t resets = 0;
+    // 调用submit()的耗时, 包括拷贝进缓冲池和入队
+    Samples submit_time;
+    Samples queue_delay;
+    Samples decode_time;
+    Samples smoother_delay;
+    Samples decode_to_present;
+    // --switch: 从开始切换到切换后第一帧显示
+    bool switching = false;
+    int64_t switch_start = -1;
+    Samples first_frame_after_switch;
+};
+
+int64_t peakMemoryBytes() {
+#if defined(LT_WINDOWS)
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return static_cast<int64_t>(counters.PeakWorkingSetSize);
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(LT_MAC)
+    return static_cast<int64_t>(usage.ru_maxrss);
+#else
+    return static_cast<int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--speed=", 0) == 0) {
+            options.speed = std::atof(arg.c_str() + strlen("--speed="));
+        }
+        else if (arg.rfind("--fps=", 0) == 0) {
+            options.fps = std::atoi(arg.c_str() + strlen("--fps="));
+        }
+        else if (arg == "--pad-4k") {
+            options.pad_4k = true;
+        }
+        else if (arg.rfind("--refresh-rate=", 0) == 0) {
+            options.refresh_rate = std::atoi(arg.c_str() + strlen("--refresh-rate="));
+        }
+        else if (arg == "--check") {
+            options.check = true;
+        }
+        else if (arg == "--switch") {
+            options.switch_resolution = true;
+        }
+        else if (arg.rfind("--", 0) == 0) {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+        else {
+            options.files.push_back(arg);
+        }
+    }
+    return !options.files.empty() && options.speed >= 0 && options.refresh_rate > 0;
+}
+
+DecodeRenderPipeline::Params makeParams(const lt::video::VideoStreamReader& reader,
+                                        const Options& options, Result& result) {
+    DecodeRenderPipeline::Params params{
+        reader.codec(),
+        reader.codec(),
+        reader.width(),
+        reader.height(),
+        options.refresh_rate,
+        /*rotation=*/0,
+        /*stretch=*/false,
+        lt::ColorMatrix::BT709,
+        /*full_range=*/false,
+        [](uint32_t, std::shared_ptr<google::protobuf::MessageLite>, bool) {},
+        []() {},
+        [&result]() {
+            std::lock_guard lock{result.mutex};
+            result.resets++;
+        }};
+    params.headless = true;
+    params.absolute_mouse = false;
+    params.show_overlay = false;
+    params.on_frame_timing = [&result](const DecodeRenderPipeline::FrameTiming& timing) {
+        std::lock_guard lock{result.mutex};
+        if (timing.stage == DecodeRenderPipeline::FrameTiming::Stage::Decoded) {
+            result.decoded++;
+            result.queue_delay.add(timing.decode_start_time - timing.submit_time);
+            result.decode_time.add(timing.decode_end_time - timing.decode_start_time);
+        }
+        else {
+            result.presented++;
+            result.smoother_delay.add(timing.render_start_time - timing.decode_end_time);
+            result.decode_to_present.add(timing.present_time - timing.decode_end_time);
+            if (!result.switching && result.switch_start >= 0) {
+                result.first_frame_after_switch.add(timing.present_time - result.switch_start);
+                result.switch_start = -1;
+            }
+        }
+    };
+    return params;
+}
+
+// 按采集时间戳(或者--fps)的节奏送完一个文件里的所有帧
+void submitFrames(DecodeRenderPipeline& pipeline, const lt::video::VideoStreamReader& reader,
+                  const Options& options, Result& result) {
+    constexpr size_t kKeyframeSize = 1024 * 1024;
+    const auto& frames = reader.frames();
+    const int64_t first_capture = frames.front().capture_timestamp_us;
+    std::mt19937 rng{144};
+    std::uniform_int_distribution<size_t> delta_size{50 * 1024, 400 * 1024};
+    std::vector<uint8_t> padded;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < frames.size(); i++) {
+        lt::VideoFrame frame = frames[i];
+        if (options.pad_4k) {
+            // 补0放在计时之外, submit()看到的就是一帧大码流
+            const size_t size =
+                std::max<size_t>(frame.size, frame.is_keyframe ? kKeyframeSize : delta_size(rng));
+            padded.assign(size, 0);
+            memcpy(padded.data(), frame.data, frame.size);
+            frame.data = padded.data();
+            frame.size = static_cast<uint32_t>(size);
+        }
+        if (options.fps > 0) {
+            std::this_thread::sleep_until(start + std::chrono::microseconds{static_cast<int64_t>(
+                                                      i * 1'000'000 / options.fps)});
+        }
+        else if (options.speed > 0) {
+            const auto offset = std::chrono::microseconds{static_cast<int64_t>(
+                (frame.capture_timestamp_us - first_capture) / options.speed)};
+            std::this_thread::sleep_until(start + offset);
+        }
+        const int64_t submit_start = ltlib::steady_now_us();
+        auto action = pipeline.submit(frame);
+        const int64_t submit_end = ltlib::steady_now_us();
+        std::lock_guard lock{result.mutex};
+        result.submit_time.add(submit_end - submit_start);
+        result.submitted++;
+        if (action == DecodeRenderPipeline::Action::REQUEST_KEY_FRAME) {
+            result.keyframe_requests++;
+        }
+    }
+}
+
+void printResult(Result& result) {
+    std::lock_guard lock{result.mutex};
+    printf("    submitted %zu, decoded %zu, presented %zu, keyframe requests %zu, resets %zu\n",
+           result.submitted, result.decoded, result.presented, result.keyframe_requests,
+           result.resets);
+    printf("    dropped before decode %zu, superseded before present %zu\n",
+           result.submitted - result.decoded, result.decoded - result.presented);
+    result.submit_time.print("submit");
+    result.queue_delay.print("queue delay");
+    result.decode_time.print("decode");
+    result.smoother_delay.print("smoother delay");
+    result.decode_to_present.print("decode->present");
+    if (!result.first_frame_after_switch.values.empty()) {
+        result.first_frame_after_switch.print("switch->present");
+    }
+    printf("    peak memory      %.1fMB\n", peakMemoryBytes() / 1024.0 / 1024.0);
+}
+
+// 返回false表示流水线没能跑起来
+bool runOne(const std::string& path, const Options& options, Result& result) {
+    auto reader = lt::video::VideoStreamReader::create(path);
+    if (reader == nullptr || reader->frames().empty()) {
+        fprintf(stderr, "Load %s failed\n", path.c_str());
+        return false;
+    }
+    auto pipeline = DecodeRenderPipeline::create(makeParams(*reader, options, result));
+    if (pipeline == nullptr) {
+        fprintf(stderr, "Create headless pipeline for %s failed\n", path.c_str());
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    submitFrames(*pipeline, *reader, options, result);
+    // 等最后几帧解码渲染完
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+    pipeline.reset();
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("[ bench    ] %s: %s %ux%u%s, %zu frames in %.2fs (speed %.1f, fps %u, %uHz)\n",
+           path.c_str(), lt::toString(reader->codec()), reader->width(), reader->height(),
+           options.pad_4k ? " padded to 4K sizes" : "", reader->frames().size(), seconds,
+           options.speed, options.fps, options.refresh_rate);
+    printResult(result);
+    return true;
+}
+
+// 所有文件当成一路流连续送进同一个pipeline, 文件之间切换分辨率.
+// reconfigure为false时走原来的路径: 销毁旧pipeline再create
+bool runSwitch(bool reconfigure, const Options& options, Result& result) {
+    std::vector<std::unique_ptr<lt::video::VideoStreamReader>> readers;
+    for (const auto& path : options.files) {
+        auto reader = lt::video::VideoStreamReader::create(path);
+        if (reader == nullptr || reader->frames().empty()) {
+            fprintf(stderr, "Load %s failed\n", path.c_str());
+            return false;
+        }
+        readers.push_back(std::move(reader));
+    }
+    std::unique_ptr<DecodeRenderPipeline> pipeline;
+    for (const auto& reader : readers) {
+        auto params = makeParams(*reader, options, result);
+        if (pipeline != nullptr) {
+            {
+                std::lock_guard lock{result.mutex};
+                result.switching = true;
+                result.switch_start = ltlib::steady_now_us();
+            }
+            if (!reconfigure || !pipeline->reconfigure(params)) {
+                pipeline.reset();
+            }
+        }
+        if (pipeline == nullptr) {
+            pipeline = DecodeRenderPipeline::create(params);
+        }
+        {
+            std::lock_guard lock{result.mutex};
+            result.switching = false;
+        }
+        if (pipeline == nullptr) {
+            fprintf(stderr, "Create headless pipeline %ux%u failed\n", reader->width(),
+                    reader->height());
+            return false;
+        }
+        submitFrames(*pipeline, *reader, options, result);
+        // 切换前等已送的帧都解完, 否则--check数不准
+        for (int i = 0; i < 300; i++) {
+            {
+                std::lock_guard lock{result.mutex};
+                if (result.decoded == result.submitted) {
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{300});
+    pipeline.reset();
+
+    printf("[ bench    ] switch by %s:", reconfigure ? "reconfigure()" : "recreating pipeline");
+    for (const auto& reader : readers) {
+        printf(" %ux%u", reader->width(), reader->height());
+    }
+    printf(" (%s, speed %.1f, %uHz)\n", lt::toString(readers.front()->codec()), options.speed,
+           options.refresh_rate);
+    printResult(result);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "Usage: %s [--speed=N] [--fps=N] [--pad-4k] [--refresh-rate=N] [--check] "
+                "[--switch] <file.ltvs>...\n",
+                argv[0]);
+        return 2;
+    }
+    auto log_worker = g3::LogWorker::createLogWorker();
+    log_worker->addSink(std::make_unique<StderrSink>(), &StderrSink::write);
+    g3::log_levels::disable(DEBUG);
+    g3::only_change_at_initialization::addLogLevel(ERR);
+    g3::initializeLogging(log_worker.get());
+    // 解码和渲染线程是BlockingThread, 要向ThreadWatcher注册
+    ltlib::ThreadWatcher::init(std::this_thread::get_id());
+
+    int ret = 0;
+    if (options.switch_resolution) {
+        for (bool reconfigure : {false, true}) {
+            Result result;
+            if (!runSwitch(reconfigure, options, result)) {
+                ret = 1;
+                continue;
+            }
+            const size_t switches = options.files.size() - 1;
+            if (options.check && (result.decoded != result.submitted ||
+                                  result.first_frame_after_switch.values.size() != switches)) {
+                fprintf(stderr, "%zu of %zu frames decoded, %zu of %zu switches presented\n",
+                        result.decoded, result.submitted,
+                        result.first_frame_after_switch.values.size(), switches);
+                ret = 1;
+            }
+        }
+        return ret;
+    }
+    for (const auto& path : options.files) {
+        Result result;
+        if (!runOne(path, options, result)) {
+            ret = 1;
+            continue;
+        }
+        if (options.check && (result.decoded != result.submitted || result.presented == 0)) {
+            fprintf(stderr, "%s: %zu of %zu frames decoded, %zu presented\n", path.c_str(),
+                    result.decoded, result.submitted, result.presented);
+            ret = 1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,191 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "decode_queue.h"
+
+#include <algorithm>
+
+namespace {
+
+// 三层时一个参考帧最多被往后4帧参考, 留足余量
+constexpr size_t kMaxReferenceIDs = 32;
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+DecodeQueue::DecodeQueue(const Params& params)
+    : params_{params} {}
+
+void DecodeQueue::push(Frame frame, int64_t now_us) {
+    if (frame.kind == FrameKind::Unknown) {
+        frame.kind = classifyFrame(params_.codec, frame.data, frame.size);
+    }
+    if (frame.kind == FrameKind::Unknown) {
+        // 解析不出来就相信编码端的标记, 并且保守地认为它会被参考
+        frame.kind = frame.is_keyframe ? FrameKind::Keyframe : FrameKind::Reference;
+    }
+    if (!frame.layer.has_value() && isAVC(params_.codec)) {
+        frame.layer = findTemporalLayerSei(frame.data, frame.size);
+    }
+    stat_.pushed++;
+    const bool gap = last_ltframe_id_.has_value() && frame.ltframe_id > *last_ltframe_id_ + 1;
+    last_ltframe_id_ = frame.ltframe_id;
+    if (frame.kind == FrameKind::Keyframe) {
+        waiting_for_keyframe_ = false;
+        keyframe_wanted_ = false;
+        reference_ids_.clear();
+    }
+    else if (frame.kind == FrameKind::Recovery) {
+        // 恢复帧只参考已经解码过的帧, 中间丢了什么都没关系
+        if (waiting_for_keyframe_) {
+            stat_.recoveries++;
+        }
+        waiting_for_keyframe_ = false;
+        keyframe_wanted_ = false;
+    }
+    else if (missingReference(frame, gap)) {
+        if (frame.kind == FrameKind::NonReference && frame.layer.has_value()) {
+            // 发送端按层丢帧时缺的是它的参考帧, 后面的帧不依赖它.
+            // 没有分层SEI时不知道丢的是哪一帧, 可能是后面的帧要参考的, 只能等关键帧
+            stat_.dropped_missing_reference++;
+            return;
+        }
+        // 丢掉的帧可能被这一帧参考
+        stat_.gaps++;
+        flush();
+        stat_.dropped_waiting_keyframe++;
+        return;
+    }
+    else if (waiting_for_keyframe_) {
+        stat_.dropped_waiting_keyframe++;
+        return;
+    }
+    if (frame.kind != FrameKind::NonReference) {
+        reference_ids_.push_back(frame.ltframe_id);
+        if (reference_ids_.size() > kMaxReferenceIDs) {
+            reference_ids_.pop_front();
+        }
+    }
+    frame.enqueue_time_us = now_us;
+    frames_.push_back(std::move(frame));
+    enforceBudget(now_us);
+}
+
+std::optional<DecodeQueue::Frame> DecodeQueue::pop(int64_t now_us) {
+    enforceBudget(now_us);
+    if (frames_.empty()) {
+        return std::nullopt;
+    }
+    Frame frame = std::move(frames_.front());
+    frames_.pop_front();
+    stat_.popped++;
+    return frame;
+}
+
+void DecodeQueue::onDecodeFailed() {
+    flush();
+}
+
+bool DecodeQueue::needKeyframe(int64_t now_us) {
+    if (!keyframe_wanted_) {
+        return false;
+    }
+    if (last_keyframe_request_us_ >= 0 &&
+        now_us - last_keyframe_request_us_ < params_.keyframe_request_interval_us) {
+        return false;
+    }
+    last_keyframe_request_us_ = now_us;
+    stat_.keyframe_requests++;
+    return true;
+}
+
+void DecodeQueue::clear() {
+    frames_.clear();
+    last_ltframe_id_ = std::nullopt;
+    reference_ids_.clear();
+    waiting_for_keyframe_ = false;
+    keyframe_wanted_ = false;
+}
+
+void DecodeQueue::enforceBudget(int64_t now_us) {
+    if (frames_.empty() || now_us - frames_.front().enqueue_time_us <= params_.latency_budget_us) {
+        return;
+    }
+    // 先丢不被参考的帧, 它们不影响后续解码
+    const size_t before = frames_.size();
+    frames_.erase(std::remove_if(frames_.begin(), frames_.end(),
+                                 [](const Frame& f) { return f.kind == FrameKind::NonReference; }),
+                  frames_.end());
+    stat_.dropped_non_reference += before - frames_.size();
+    // 队列里有关键帧的话, 它之前的帧都没用了
+    auto keyframe = std::find_if(frames_.rbegin(), frames_.rend(),
+                                 [](const Frame& f) { return f.kind == FrameKind::Keyframe; });
+    if (keyframe != frames_.rend()) {
+        auto first_kept = keyframe.base() - 1;
+        stat_.dropped_before_keyframe += static_cast<uint64_t>(first_kept - frames_.begin());
+        frames_.erase(frames_.begin(), first_kept);
+    }
+    if (!frames_.empty() && now_us - frames_.front().enqueue_time_us > params_.max_latency_us) {
+        // 剩下的帧互相参考, 只能全部丢掉等下一个关键帧
+        flush();
+    }
+}
+
+void DecodeQueue::flush() {
+    stat_.dropped_waiting_keyframe += frames_.size();
+    stat_.flushes++;
+    frames_.clear();
+    reference_ids_.clear();
+    waiting_for_keyframe_ = true;
+    keyframe_wanted_ = true;
+}
+
+bool DecodeQueue::missingReference(const Frame& frame, bool gap) const {
+    if (!frame.layer.has_value()) {
+        return gap;
+    }
+    if (waiting_for_keyframe_) {
+        // 参考帧都清掉了, 交给后面的等待关键帧逻辑, 不要每一帧都重新flush
+        return false;
+    }
+    if (frame.layer->ref_distance == 0 || frame.layer->ref_distance > frame.ltframe_id) {
+        // 不参考其他帧, 或者SEI不对, 后者交给解码器去判断
+        return false;
+    }
+    const uint64_t ref = frame.ltframe_id - frame.layer->ref_distance;
+    return std::find(reference_ids_.begin(), reference_ids_.end(), ref) == reference_ids_.end();
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,136 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include <transport/transport.h>
+#include <video/drpipeline/nal_classifier.h>
+#include <video/encoder/h264_bitstream.h>
+
+namespace lt {
+
+namespace video {
+
+// 待解码队列及其丢帧策略:
+// 1. 队首的帧等待超过latency_budget_us时, 先丢掉不被参考的帧, 再丢掉队列里最后一个关键帧之前的帧;
+//    仍然超过max_latency_us就清空队列, 等下一个关键帧.
+// 2. 解码失败或者帧号不连续(网络上丢了帧)后丢弃所有非关键帧, 直到收到关键帧或恢复帧.
+//    等待期间按keyframe_request_interval_us限频请求关键帧.
+//    带时域分层SEI的帧按SEI里的参考帧判断: 缺的只是别的层的帧时不算丢帧.
+// 本身不加锁, 也不读系统时钟, 所有时间由调用方传入(单位us).
+class DecodeQueue {
+public:
+    struct Params {
+        lt::VideoCodecType codec = lt::VideoCodecType::Unknown;
+        int64_t latency_budget_us = 50'000;
+        int64_t max_latency_us = 150'000;
+        int64_t keyframe_request_interval_us = 500'000;
+    };
+
+    struct Frame : lt::VideoFrame {
+        // 持有data指向的内存
+        std::shared_ptr<const void> holder;
+        FrameKind kind = FrameKind::Unknown;
+        // H264码流里的时域分层SEI, push()时解析
+        std::optional<TemporalLayerInfo> layer;
+        int64_t enqueue_time_us = 0;
+        // 到达客户端的时间, 调用方填. 被音视频同步压住的帧进队列时已经到了一段时间
+        int64_t receive_time_us = 0;
+    };
+
+    struct Stat {
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        uint64_t dropped_non_reference = 0;
+        uint64_t dropped_before_keyframe = 0;
+        uint64_t dropped_waiting_keyframe = 0;
+        // 参考帧没收到的不被参考的帧, 丢掉它不需要等关键帧
+        uint64_t dropped_missing_reference = 0;
+        uint64_t flushes = 0;
+        uint64_t keyframe_requests = 0;
+        // 帧号不连续的次数
+        uint64_t gaps = 0;
+        // 等待关键帧时被恢复帧提前结束的次数
+        uint64_t recoveries = 0;
+        uint64_t dropped() const {
+            return dropped_non_reference + dropped_before_keyframe + dropped_waiting_keyframe +
+                   dropped_missing_reference;
+        }
+    };
+
+public:
+    explicit DecodeQueue(const Params& params);
+
+    // frame.kind为Unknown时会自己解析码流
+    void push(Frame frame, int64_t now_us);
+
+    std::optional<Frame> pop(int64_t now_us);
+
+    // 之后的非关键帧都不能再解码
+    void onDecodeFailed();
+
+    // 现在是否应该向远端请求关键帧, 返回true即视为已经请求
+    bool needKeyframe(int64_t now_us);
+
+    bool waitingForKeyframe() const { return waiting_for_keyframe_; }
+
+    size_t size() const { return frames_.size(); }
+
+    bool empty() const { return frames_.empty(); }
+
+    void clear();
+
+    const Stat& stat() const { return stat_; }
+
+private:
+    void enforceBudget(int64_t now_us);
+    void flush();
+    bool missingReference(const Frame& frame, bool gap) const;
+
+private:
+    const Params params_;
+    std::deque<Frame> frames_;
+    bool waiting_for_keyframe_ = false;
+    bool keyframe_wanted_ = false;
+    int64_t last_keyframe_request_us_ = -1;
+    std::optional<uint64_t> last_ltframe_id_;
+    // 最近收下的会被参考的帧, 只在有时域分层SEI时使用
+    std::deque<uint64_t> reference_ids_;
+    Stat stat_;
+};
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,400 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <iterator>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/drpipeline/decode_queue.h>
+
+using lt::video::DecodeQueue;
+using lt::video::FrameKind;
+
+namespace {
+
+constexpr int64_t kBudgetUs = 50'000;
+constexpr int64_t kMaxLatencyUs = 150'000;
+constexpr int64_t kKeyframeIntervalUs = 500'000;
+
+DecodeQueue::Params defaultParams() {
+    DecodeQueue::Params params;
+    params.codec = lt::VideoCodecType::H264_420;
+    params.latency_budget_us = kBudgetUs;
+    params.max_latency_us = kMaxLatencyUs;
+    params.keyframe_request_interval_us = kKeyframeIntervalUs;
+    return params;
+}
+
+DecodeQueue::Frame makeFrame(uint64_t id, FrameKind kind) {
+    DecodeQueue::Frame frame{};
+    frame.ltframe_id = id;
+    frame.kind = kind;
+    frame.is_keyframe = kind == FrameKind::Keyframe;
+    return frame;
+}
+
+// 带时域分层SEI的帧, ref_distance为0表示不参考其他帧
+DecodeQueue::Frame makeLayerFrame(uint64_t id, FrameKind kind, uint32_t temporal_id,
+                                  uint32_t ref_distance) {
+    DecodeQueue::Frame frame = makeFrame(id, kind);
+    frame.layer = lt::video::TemporalLayerInfo{temporal_id, ref_distance};
+    return frame;
+}
+
+std::vector<uint64_t> drain(DecodeQueue& queue, int64_t now_us) {
+    std::vector<uint64_t> ids;
+    while (auto frame = queue.pop(now_us)) {
+        ids.push_back(frame->ltframe_id);
+    }
+    return ids;
+}
+
+// 虚拟时钟下模拟 编码端 -> 网络 -> 解码队列 -> 解码器, 1ms一步
+struct SimConfig {
+    int64_t frame_interval_us = 16'667;
+    int64_t one_way_delay_us = 30'000;
+    int64_t decode_cost_us = 5'000;
+    uint64_t fail_at_frame = UINT64_MAX;
+    bool lose_first_request = false;
+    // 每两帧中有一帧不被参考
+    bool alternate_non_reference = false;
+    int64_t duration_us = 3'000'000;
+};
+
+struct SimResult {
+    int64_t recovery_us = -1;
+    uint64_t deltas_decoded_while_broken = 0;
+    uint64_t keyframe_requests = 0;
+    uint64_t decoded = 0;
+    int64_t max_wait_us = 0;
+    DecodeQueue::Stat stat;
+};
+
+SimResult simulate(const SimConfig& config) {
+    constexpr int64_t kStepUs = 1'000;
+    struct InFlight {
+        int64_t arrive_at;
+        DecodeQueue::Frame frame;
+    };
+    DecodeQueue queue{defaultParams()};
+    SimResult result;
+    std::deque<InFlight> network;
+    uint64_t next_id = 0;
+    int64_t next_capture_us = 0;
+    int64_t request_arrives_at = -1;
+    int64_t decoder_free_at = 0;
+    int64_t failed_at = -1;
+    bool broken = false;
+    for (int64_t now = 0; now < config.duration_us; now += kStepUs) {
+        if (now >= next_capture_us) {
+            next_capture_us += config.frame_interval_us;
+            FrameKind kind = FrameKind::Reference;
+            if (next_id == 0 || (request_arrives_at >= 0 && request_arrives_at <= now)) {
+                kind = FrameKind::Keyframe;
+                request_arrives_at = -1;
+            }
+            else if (config.alternate_non_reference && next_id % 2 == 1) {
+                kind = FrameKind::NonReference;
+            }
+            network.push_back({now + config.one_way_delay_us, makeFrame(next_id++, kind)});
+        }
+        while (!network.empty() && network.front().arrive_at <= now) {
+            queue.push(std::move(network.front().frame), now);
+            network.pop_front();
+            if (queue.needKeyframe(now)) {
+                result.keyframe_requests++;
+                if (!(config.lose_first_request && result.keyframe_requests == 1)) {
+                    request_arrives_at = now + config.one_way_delay_us;
+                }
+            }
+        }
+        if (now < decoder_free_at) {
+            continue;
+        }
+        auto frame = queue.pop(now);
+        if (!frame.has_value()) {
+            continue;
+        }
+        decoder_free_at = now + config.decode_cost_us;
+        result.max_wait_us = std::max(result.max_wait_us, now - frame->enqueue_time_us);
+        if (frame->ltframe_id == config.fail_at_frame) {
+            queue.onDecodeFailed();
+            broken = true;
+            failed_at = now;
+            continue;
+        }
+        if (broken) {
+            if (frame->kind != FrameKind::Keyframe) {
+                result.deltas_decoded_while_broken++;
+                continue;
+            }
+            broken = false;
+            result.recovery_us = decoder_free_at - failed_at;
+        }
+        result.decoded++;
+    }
+    result.stat = queue.stat();
+    return result;
+}
+
+} // namespace
+
+TEST(DecodeQueueTest, PassesThroughUnderBudget) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Keyframe), 0);
+    queue.push(makeFrame(1, FrameKind::NonReference), 10'000);
+    queue.push(makeFrame(2, FrameKind::Reference), 20'000);
+    EXPECT_EQ(drain(queue, kBudgetUs), (std::vector<uint64_t>{0, 1, 2}));
+    EXPECT_EQ(queue.stat().dropped(), 0u);
+    EXPECT_FALSE(queue.needKeyframe(kBudgetUs));
+}
+
+TEST(DecodeQueueTest, DropsNonReferenceFramesOverBudget) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Reference), 0);
+    queue.push(makeFrame(1, FrameKind::NonReference), 10'000);
+    queue.push(makeFrame(2, FrameKind::Reference), 20'000);
+    queue.push(makeFrame(3, FrameKind::NonReference), 30'000);
+    EXPECT_EQ(drain(queue, kBudgetUs + 1), (std::vector<uint64_t>{0, 2}));
+    EXPECT_EQ(queue.stat().dropped_non_reference, 2u);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+}
+
+TEST(DecodeQueueTest, SkipsToLatestKeyframeOverBudget) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Reference), 0);
+    queue.push(makeFrame(1, FrameKind::Keyframe), 10'000);
+    queue.push(makeFrame(2, FrameKind::Reference), 20'000);
+    queue.push(makeFrame(3, FrameKind::Keyframe), 30'000);
+    queue.push(makeFrame(4, FrameKind::Reference), 40'000);
+    EXPECT_EQ(drain(queue, kBudgetUs + 1), (std::vector<uint64_t>{3, 4}));
+    EXPECT_EQ(queue.stat().dropped_before_keyframe, 3u);
+}
+
+TEST(DecodeQueueTest, FlushesAndWaitsForKeyframeOverMaxLatency) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Reference), 0);
+    queue.push(makeFrame(1, FrameKind::Reference), 10'000);
+    EXPECT_FALSE(queue.pop(kMaxLatencyUs + 1).has_value());
+    EXPECT_TRUE(queue.waitingForKeyframe());
+    EXPECT_TRUE(queue.needKeyframe(kMaxLatencyUs + 1));
+    queue.push(makeFrame(2, FrameKind::Reference), kMaxLatencyUs + 2);
+    EXPECT_TRUE(queue.empty());
+    queue.push(makeFrame(3, FrameKind::Keyframe), kMaxLatencyUs + 3);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+    EXPECT_EQ(drain(queue, kMaxLatencyUs + 4), (std::vector<uint64_t>{3}));
+    EXPECT_EQ(queue.stat().flushes, 1u);
+    EXPECT_EQ(queue.stat().dropped_waiting_keyframe, 3u);
+}
+
+TEST(DecodeQueueTest, DropsDeltasAfterFailureUntilKeyframe) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Keyframe), 0);
+    queue.push(makeFrame(1, FrameKind::Reference), 1'000);
+    queue.push(makeFrame(2, FrameKind::Reference), 2'000);
+    ASSERT_TRUE(queue.pop(3'000).has_value());
+    queue.onDecodeFailed();
+    EXPECT_TRUE(queue.empty());
+    queue.push(makeFrame(3, FrameKind::NonReference), 4'000);
+    queue.push(makeFrame(4, FrameKind::Reference), 5'000);
+    EXPECT_TRUE(queue.empty());
+    queue.push(makeFrame(5, FrameKind::Keyframe), 6'000);
+    queue.push(makeFrame(6, FrameKind::Reference), 7'000);
+    EXPECT_EQ(drain(queue, 8'000), (std::vector<uint64_t>{5, 6}));
+}
+
+TEST(DecodeQueueTest, WaitsForKeyframeAfterLostFrame) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Keyframe), 0);
+    queue.push(makeFrame(1, FrameKind::Reference), 1'000);
+    queue.push(makeFrame(3, FrameKind::Reference), 3'000);
+    queue.push(makeFrame(4, FrameKind::NonReference), 4'000);
+    EXPECT_TRUE(queue.waitingForKeyframe());
+    EXPECT_TRUE(queue.needKeyframe(4'000));
+    EXPECT_EQ(queue.stat().gaps, 1u);
+    queue.push(makeFrame(6, FrameKind::Keyframe), 6'000);
+    queue.push(makeFrame(7, FrameKind::Reference), 7'000);
+    EXPECT_EQ(drain(queue, 8'000), (std::vector<uint64_t>{6, 7}));
+}
+
+TEST(DecodeQueueTest, NonReferenceFrameAfterLostFrameStillWaitsForKeyframe) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(1, FrameKind::Keyframe), 1'000);
+    queue.push(makeFrame(2, FrameKind::Reference), 2'000);
+    // 3号丢了, 没有分层SEI的话不知道它会不会被后面的帧参考
+    queue.push(makeFrame(4, FrameKind::NonReference), 4'000);
+    queue.push(makeFrame(5, FrameKind::Reference), 5'000);
+    EXPECT_TRUE(queue.waitingForKeyframe());
+    EXPECT_TRUE(queue.needKeyframe(5'000));
+    EXPECT_EQ(queue.stat().gaps, 1u);
+    EXPECT_EQ(drain(queue, 6'000), (std::vector<uint64_t>{}));
+    queue.push(makeFrame(7, FrameKind::Keyframe), 7'000);
+    queue.push(makeFrame(8, FrameKind::Reference), 8'000);
+    EXPECT_EQ(drain(queue, 9'000), (std::vector<uint64_t>{7, 8}));
+}
+
+TEST(DecodeQueueTest, RecoveryFrameEndsWaitingForKeyframe) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeFrame(0, FrameKind::Keyframe), 0);
+    ASSERT_TRUE(queue.pop(0).has_value());
+    queue.push(makeFrame(2, FrameKind::Reference), 2'000);
+    ASSERT_TRUE(queue.waitingForKeyframe());
+    ASSERT_TRUE(queue.needKeyframe(2'000));
+    queue.push(makeFrame(3, FrameKind::Reference), 3'000);
+    // 恢复帧只参考客户端已经解码的帧, 不需要等关键帧
+    queue.push(makeFrame(5, FrameKind::Recovery), 5'000);
+    queue.push(makeFrame(6, FrameKind::Reference), 6'000);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+    EXPECT_FALSE(queue.needKeyframe(kKeyframeIntervalUs * 2));
+    EXPECT_EQ(drain(queue, 7'000), (std::vector<uint64_t>{5, 6}));
+    EXPECT_EQ(queue.stat().recoveries, 1u);
+    EXPECT_EQ(queue.stat().dropped_waiting_keyframe, 2u);
+}
+
+TEST(DecodeQueueTest, SenderDroppedTopLayerIsNotALoss) {
+    DecodeQueue queue{defaultParams()};
+    // 三层: T0 T2 T1 T2 T0 ..., 发送端丢掉了所有T2
+    queue.push(makeLayerFrame(0, FrameKind::Keyframe, 0, 0), 0);
+    queue.push(makeLayerFrame(2, FrameKind::Reference, 1, 2), 2'000);
+    queue.push(makeLayerFrame(4, FrameKind::Reference, 0, 4), 4'000);
+    queue.push(makeLayerFrame(6, FrameKind::Reference, 1, 2), 6'000);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+    EXPECT_FALSE(queue.needKeyframe(6'000));
+    EXPECT_EQ(drain(queue, 7'000), (std::vector<uint64_t>{0, 2, 4, 6}));
+    EXPECT_EQ(queue.stat().gaps, 0u);
+}
+
+TEST(DecodeQueueTest, DropsFramesWhoseReferenceWasDropped) {
+    DecodeQueue queue{defaultParams()};
+    queue.push(makeLayerFrame(0, FrameKind::Keyframe, 0, 0), 0);
+    queue.push(makeLayerFrame(1, FrameKind::NonReference, 2, 1), 1'000);
+    // 丢了T1(2号), 参考它的T2(3号)也解不了, 但是不影响下一个T0
+    queue.push(makeLayerFrame(3, FrameKind::NonReference, 2, 1), 3'000);
+    queue.push(makeLayerFrame(4, FrameKind::Reference, 0, 4), 4'000);
+    queue.push(makeLayerFrame(5, FrameKind::NonReference, 2, 1), 5'000);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+    EXPECT_EQ(drain(queue, 6'000), (std::vector<uint64_t>{0, 1, 4, 5}));
+    EXPECT_EQ(queue.stat().dropped_missing_reference, 1u);
+
+    // 丢了T0, 后面的帧都依赖它, 只能等关键帧
+    queue.push(makeLayerFrame(10, FrameKind::Reference, 1, 2), 10'000);
+    EXPECT_TRUE(queue.waitingForKeyframe());
+    EXPECT_TRUE(queue.needKeyframe(10'000));
+    queue.push(makeLayerFrame(11, FrameKind::NonReference, 2, 1), 11'000);
+    queue.push(makeLayerFrame(12, FrameKind::Reference, 0, 4), 12'000);
+    EXPECT_EQ(queue.stat().gaps, 1u);
+    EXPECT_EQ(queue.stat().flushes, 1u);
+    queue.push(makeLayerFrame(16, FrameKind::Keyframe, 0, 0), 16'000);
+    queue.push(makeLayerFrame(17, FrameKind::NonReference, 2, 1), 17'000);
+    EXPECT_EQ(drain(queue, 18'000), (std::vector<uint64_t>{16, 17}));
+}
+
+TEST(DecodeQueueTest, ParsesTemporalLayerSei) {
+    DecodeQueue queue{defaultParams()};
+    std::vector<uint8_t> frame_data =
+        lt::video::makeTemporalLayerSei(lt::video::TemporalLayerInfo{2, 3});
+    const uint8_t slice[] = {0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x43};
+    frame_data.insert(frame_data.end(), std::begin(slice), std::end(slice));
+    queue.push(makeLayerFrame(0, FrameKind::Keyframe, 0, 0), 0);
+    queue.push(makeFrame(1, FrameKind::Reference), 1'000);
+    DecodeQueue::Frame frame{};
+    frame.ltframe_id = 4;
+    frame.data = frame_data.data();
+    frame.size = static_cast<uint32_t>(frame_data.size());
+    queue.push(frame, 4'000);
+    EXPECT_FALSE(queue.waitingForKeyframe());
+    ASSERT_EQ(queue.size(), 3u);
+    queue.pop(5'000);
+    queue.pop(5'000);
+    auto parsed = queue.pop(5'000);
+    EXPECT_EQ(parsed->kind, FrameKind::NonReference);
+    ASSERT_TRUE(parsed->layer.has_value());
+    EXPECT_EQ(parsed->layer->temporal_id, 2u);
+    EXPECT_EQ(parsed->layer->ref_distance, 3u);
+}
+
+TEST(DecodeQueueTest, RateLimitsKeyframeRequests) {
+    DecodeQueue queue{defaultParams()};
+    queue.onDecodeFailed();
+    EXPECT_TRUE(queue.needKeyframe(0));
+    EXPECT_FALSE(queue.needKeyframe(1'000));
+    EXPECT_FALSE(queue.needKeyframe(kKeyframeIntervalUs - 1));
+    EXPECT_TRUE(queue.needKeyframe(kKeyframeIntervalUs));
+    queue.push(makeFrame(0, FrameKind::Keyframe), kKeyframeIntervalUs + 1);
+    EXPECT_FALSE(queue.needKeyframe(kKeyframeIntervalUs * 3));
+    EXPECT_EQ(queue.stat().keyframe_requests, 2u);
+}
+
+TEST(DecodeQueueTest, ClassifiesFromBitstream) {
+    DecodeQueue queue{defaultParams()};
+    const uint8_t idr[] = {0x00, 0x00, 0x00, 0x01, 0x65, 0x88, 0x84};
+    const uint8_t non_ref[] = {0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x43};
+    DecodeQueue::Frame frame{};
+    frame.data = idr;
+    frame.size = sizeof(idr);
+    queue.push(frame, 0);
+    frame.data = non_ref;
+    frame.size = sizeof(non_ref);
+    queue.push(frame, 0);
+    // 没有数据时相信编码端的is_keyframe
+    frame.data = nullptr;
+    frame.size = 0;
+    frame.is_keyframe = true;
+    queue.push(frame, 0);
+    EXPECT_EQ(queue.pop(0)->kind, FrameKind::Keyframe);
+    EXPECT_EQ(queue.pop(0)->kind, FrameKind::NonReference);
+    EXPECT_EQ(queue.pop(0)->kind, FrameKind::Keyframe);
+}
+
+TEST(DecodeQueueTest, RecoversFromDecodeFailureWithinOneRoundTrip) {
+    SimConfig config;
+    config.fail_at_frame = 60;
+    SimResult result = simulate(config);
+    ASSERT_GE(result.recovery_us, 0);
+    // 最多等一帧才发出请求, 请求到达后最多再等一帧才编出关键帧
+    const int64_t bound = 2 * config.one_way_delay_us + 2 * config.frame_interval_us +
+                          config.decode_cost_us + 2'000;
+    std::printf("[ recovery ] %.1fms (bound %.1fms), %llu frames dropped\n",
+                result.recovery_us / 1000.0, bound / 1000.0,
+                static_cast<unsigned long long>(result.stat.dropped()));
+    EXPECT_LE(result.recovery_us, bound);
+    EXPECT_EQ(result.deltas_decoded_while_broken, 0u);
+    EXPECT_EQ(result.keyframe_requests, 1u);
+}
+
+TEST(DecodeQueueTest, RetriesLostKeyframeRequest) {
+    SimConfig config;
+    config.fail_at_frame = 60;
+    config.lose_first_request = true;
+    SimResult result = simulate(config);
+    ASSERT_GE(result.recovery_us, 0);
+    EXPECT_GT(result.recovery_us, kKeyframeIntervalUs);
+    EXPECT_LE(result.recovery_us, kKeyframeIntervalUs + 2 * config.one_way_delay_us +
+                                      2 * config.frame_interval_us + config.decode_cost_us +
+                                      2'000);
+    EXPECT_EQ(result.deltas_decoded_while_broken, 0u);
+    EXPECT_EQ(result.keyframe_requests, 2u);
+}
+
+TEST(DecodeQueueTest, SlowDecoderStaysWithinBudgetByDroppingNonReference) {
+    SimConfig config;
+    config.decode_cost_us = 25'000;
+    config.alternate_non_reference = true;
+    SimResult result = simulate(config);
+    EXPECT_LE(result.max_wait_us, kBudgetUs + config.decode_cost_us);
+    EXPECT_GT(result.stat.dropped_non_reference, 0u);
+    EXPECT_EQ(result.stat.flushes, 0u);
+    EXPECT_EQ(result.keyframe_requests, 0u);
+}
+
+TEST(DecodeQueueTest, SlowDecoderWithoutDroppableFramesIsBounded) {
+    SimConfig config;
+    config.decode_cost_us = 25'000;
+    SimResult result = simulate(config);
+    EXPECT_LE(result.max_wait_us, kMaxLatencyUs + config.decode_cost_us);
+    EXPECT_GT(result.stat.flushes, 0u);
+    EXPECT_GT(result.keyframe_requests, 0u);
+    EXPECT_GT(result.decoded, 0u);
+}
@@ -0,0 +1,165 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "nal_classifier.h"
+
+#include <video/encoder/h264_bitstream.h>
+
+namespace {
+
+// 返回[pos, size)中下一个NAL头的位置(起始码之后), 找不到返回size
+uint32_t nextNal(const uint8_t* data, uint32_t size, uint32_t pos) {
+    while (pos + 3 <= size) {
+        if (data[pos + 2] > 1) {
+            pos += 3;
+        }
+        else if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+            return pos + 3;
+        }
+        else {
+            pos += 1;
+        }
+    }
+    return size;
+}
+
+struct VclSummary {
+    bool has_vcl = false;
+    bool has_keyframe = false;
+    bool has_reference = false;
+    bool has_recovery_sei = false;
+};
+
+VclSummary scanAvc(const uint8_t* data, uint32_t size) {
+    VclSummary summary;
+    for (uint32_t pos = nextNal(data, size, 0); pos < size; pos = nextNal(data, size, pos)) {
+        const uint8_t header = data[pos];
+        const uint8_t nal_ref_idc = (header >> 5) & 0x03;
+        const uint8_t nal_type = header & 0x1f;
+        switch (nal_type) {
+        case 5: // IDR slice
+            summary.has_vcl = true;
+            summary.has_keyframe = true;
+            summary.has_reference = true;
+            break;
+        case 1: // non-IDR slice
+        case 2: // slice data partition A
+        case 3:
+        case 4:
+            summary.has_vcl = true;
+            if (nal_ref_idc != 0) {
+                summary.has_reference = true;
+            }
+            break;
+        case 6: // SEI
+            if (lt::video::isRecoverySei(data + pos, size - pos)) {
+                summary.has_recovery_sei = true;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    return summary;
+}
+
+VclSummary scanHevc(const uint8_t* data, uint32_t size) {
+    VclSummary summary;
+    for (uint32_t pos = nextNal(data, size, 0); pos + 1 < size; pos = nextNal(data, size, pos)) {
+        const uint8_t nal_type = (data[pos] >> 1) & 0x3f;
+        if (nal_type > 31) {
+            // VPS/SPS/PPS/SEI等非VCL
+            continue;
+        }
+        summary.has_vcl = true;
+        if (nal_type >= 16 && nal_type <= 23) {
+            // BLA_W_LP ... RSV_IRAP_VCL23
+            summary.has_keyframe = true;
+            summary.has_reference = true;
+        }
+        else if (nal_type > 14 || nal_type % 2 == 1) {
+            // TRAIL_R, TSA_R, STSA_R, RADL_R, RASL_R, 保留的*_R
+            summary.has_reference = true;
+        }
+    }
+    return summary;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+FrameKind classifyFrame(lt::VideoCodecType codec, const uint8_t* data, uint32_t size) {
+    if (data == nullptr || size == 0) {
+        return FrameKind::Unknown;
+    }
+    VclSummary summary;
+    if (isAVC(codec)) {
+        summary = scanAvc(data, size);
+    }
+    else if (isHEVC(codec)) {
+        summary = scanHevc(data, size);
+    }
+    else {
+        return FrameKind::Unknown;
+    }
+    if (!summary.has_vcl) {
+        return FrameKind::Unknown;
+    }
+    if (summary.has_keyframe) {
+        return FrameKind::Keyframe;
+    }
+    if (summary.has_recovery_sei && summary.has_reference) {
+        return FrameKind::Recovery;
+    }
+    return summary.has_reference ? FrameKind::Reference : FrameKind::NonReference;
+}
+
+const char* toString(FrameKind kind) {
+    switch (kind) {
+    case FrameKind::Keyframe:
+        return "Keyframe";
+    case FrameKind::Reference:
+        return "Reference";
+    case FrameKind::NonReference:
+        return "NonReference";
+    case FrameKind::Recovery:
+        return "Recovery";
+    case FrameKind::Unknown:
+    default:
+        return "Unknown";
+    }
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,64 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <transport/transport.h>
+
+namespace lt {
+
+namespace video {
+
+enum class FrameKind {
+    Unknown,
+    // H264的IDR, HEVC的IRAP(IDR/CRA/BLA), 解码器可以从这里重新开始
+    Keyframe,
+    // 会被后续帧参考
+    Reference,
+    // 不会被任何帧参考, 丢掉它不影响后续解码
+    NonReference,
+    // H264的恢复帧, 带编码端插入的恢复SEI, 只参考客户端确认解码过的帧.
+    // 丢帧之后可以从这里继续解码, 后续帧会参考它
+    Recovery,
+};
+
+// 解析一个Annex-B格式的access unit(起始码 + NAL), 根据里面的VCL NAL判断这一帧能不能丢.
+// 只看NAL头, 不解析slice header. HEVC的sub-layer non-reference(TRAIL_N等)被当作NonReference,
+// 这在只有一个时域层的码流上是准确的.
+// 不认识的codec或者找不到VCL NAL时返回Unknown, 调用方应当把它当成Reference.
+FrameKind classifyFrame(lt::VideoCodecType codec, const uint8_t* data, uint32_t size);
+
+const char* toString(FrameKind kind);
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/drpipeline/nal_classifier.h>
+#include <video/encoder/h264_bitstream.h>
+
+using lt::VideoCodecType;
+using lt::video::classifyFrame;
+using lt::video::FrameKind;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+Bytes concat(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const auto& p : parts) {
+        out.insert(out.end(), p.begin(), p.end());
+    }
+    return out;
+}
+
+FrameKind classify(VideoCodecType codec, const Bytes& au) {
+    return classifyFrame(codec, au.data(), static_cast<uint32_t>(au.size()));
+}
+
+// H264, 取自OpenH264输出的码流, slice数据被截断
+const Bytes kAvcAud = {0x00, 0x00, 0x00, 0x01, 0x09, 0xf0};
+const Bytes kAvcSps = {0x00, 0x00, 0x00, 0x01, 0x67, 0x42, 0xc0, 0x1f, 0x8c, 0x8d, 0x40, 0x50,
+                       0x1e, 0xd0, 0x0f, 0x08, 0x84, 0x6a, 0x00, 0x00, 0x03, 0x00, 0x02};
+const Bytes kAvcPps = {0x00, 0x00, 0x00, 0x01, 0x68, 0xce, 0x3c, 0x80};
+const Bytes kAvcSei = {0x00, 0x00, 0x01, 0x06, 0x05, 0x10, 0xb9, 0xed, 0xb9, 0x30, 0x80};
+const Bytes kAvcIdr = {0x00, 0x00, 0x01, 0x65, 0x88, 0x84, 0x00, 0x00, 0x03, 0x01, 0xff, 0xf0};
+const Bytes kAvcRefP = {0x00, 0x00, 0x00, 0x01, 0x41, 0x9a, 0x24, 0x6c, 0x42, 0x00, 0x00, 0x03};
+const Bytes kAvcNonRefP = {0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x43, 0x79, 0x00, 0x00, 0x03};
+
+// HEVC, NAL头两个字节: forbidden_zero(1) | nal_unit_type(6) | layer_id(6) | temporal_id_plus1(3)
+Bytes hevcNal(uint8_t nal_type, uint8_t temporal_id = 0) {
+    const uint8_t h0 = static_cast<uint8_t>(nal_type << 1);
+    const uint8_t h1 = static_cast<uint8_t>(temporal_id + 1);
+    return {0x00, 0x00, 0x00, 0x01, h0, h1, 0xaf, 0x1e, 0x00, 0x00, 0x03};
+}
+const Bytes kHevcVps = hevcNal(32);
+const Bytes kHevcSps = hevcNal(33);
+const Bytes kHevcPps = hevcNal(34);
+const Bytes kHevcSei = hevcNal(39);
+
+} // namespace
+
+TEST(NalClassifierTest, AvcIdrAccessUnit) {
+    EXPECT_EQ(classify(VideoCodecType::H264_420, concat({kAvcAud, kAvcSps, kAvcPps, kAvcIdr})),
+              FrameKind::Keyframe);
+    EXPECT_EQ(classify(VideoCodecType::H264_420_SOFT, concat({kAvcSps, kAvcPps, kAvcIdr})),
+              FrameKind::Keyframe);
+}
+
+TEST(NalClassifierTest, AvcReferenceAndNonReference) {
+    EXPECT_EQ(classify(VideoCodecType::H264_444, concat({kAvcAud, kAvcRefP})),
+              FrameKind::Reference);
+    EXPECT_EQ(classify(VideoCodecType::H264_420, concat({kAvcAud, kAvcSei, kAvcNonRefP})),
+              FrameKind::NonReference);
+}
+
+TEST(NalClassifierTest, AvcAnyReferenceSliceMakesFrameReference) {
+    EXPECT_EQ(classify(VideoCodecType::H264_420, concat({kAvcNonRefP, kAvcRefP, kAvcNonRefP})),
+              FrameKind::Reference);
+    EXPECT_EQ(classify(VideoCodecType::H264_420, concat({kAvcNonRefP, kAvcNonRefP})),
+              FrameKind::NonReference);
+}
+
+TEST(NalClassifierTest, AvcRecoveryFrame) {
+    const Bytes recovery_sei = lt::video::makeRecoverySei(42);
+    EXPECT_EQ(classify(VideoCodecType::H264_420_SOFT, concat({recovery_sei, kAvcRefP})),
+              FrameKind::Recovery);
+    // 其他SEI不算
+    EXPECT_EQ(classify(VideoCodecType::H264_420_SOFT, concat({kAvcSei, kAvcRefP})),
+              FrameKind::Reference);
+    EXPECT_EQ(classify(VideoCodecType::H264_420_SOFT, concat({recovery_sei, kAvcIdr})),
+              FrameKind::Keyframe);
+    EXPECT_EQ(classify(VideoCodecType::H264_420_SOFT, recovery_sei), FrameKind::Unknown);
+}
+
+TEST(NalClassifierTest, EmulationPreventionIsNotStartCode) {
+    // 00 00 03 01 不是起始码, 后面的0x65不能被当作IDR
+    const Bytes au = {0x00, 0x00, 0x00, 0x01, 0x01, 0x9e, 0x00, 0x00, 0x03, 0x01, 0x65, 0x00};
+    EXPECT_EQ(classify(VideoCodecType::H264_420, au), FrameKind::NonReference);
+}
+
+TEST(NalClassifierTest, NoVclIsUnknown) {
+    EXPECT_EQ(classify(VideoCodecType::H264_420, concat({kAvcAud, kAvcSps, kAvcPps, kAvcSei})),
+              FrameKind::Unknown);
+    EXPECT_EQ(classify(VideoCodecType::H265_420, concat({kHevcVps, kHevcSps, kHevcPps})),
+              FrameKind::Unknown);
+    EXPECT_EQ(classify(VideoCodecType::H264_420, {}), FrameKind::Unknown);
+    EXPECT_EQ(classify(VideoCodecType::H264_420, {0x65, 0x88, 0x84}), FrameKind::Unknown);
+}
+
+TEST(NalClassifierTest, UnsupportedCodecIsUnknown) {
+    EXPECT_EQ(classify(VideoCodecType::AV1, concat({kAvcSps, kAvcPps, kAvcIdr})),
+              FrameKind::Unknown);
+}
+
+TEST(NalClassifierTest, HevcIrapAccessUnits) {
+    for (uint8_t type : {16, 17, 18, 19, 20, 21}) {
+        EXPECT_EQ(classify(VideoCodecType::H265_420,
+                           concat({kHevcVps, kHevcSps, kHevcPps, kHevcSei, hevcNal(type)})),
+                  FrameKind::Keyframe)
+            << "nal_unit_type " << static_cast<int>(type);
+    }
+}
+
+TEST(NalClassifierTest, HevcReferenceAndNonReference) {
+    // TRAIL_R, TSA_R, STSA_R, RADL_R, RASL_R
+    for (uint8_t type : {1, 3, 5, 7, 9}) {
+        EXPECT_EQ(classify(VideoCodecType::H265_444, hevcNal(type)), FrameKind::Reference)
+            << "nal_unit_type " << static_cast<int>(type);
+    }
+    // TRAIL_N, TSA_N, STSA_N, RADL_N, RASL_N
+    for (uint8_t type : {0, 2, 4, 6, 8}) {
+        EXPECT_EQ(classify(VideoCodecType::H265_420, concat({kHevcSei, hevcNal(type, 1)})),
+                  FrameKind::NonReference)
+            << "nal_unit_type " << static_cast<int>(type);
+    }
+}
+
+TEST(NalClassifierTest, HevcMixedSlices) {
+    EXPECT_EQ(classify(VideoCodecType::H265_420, concat({hevcNal(0), hevcNal(1)})),
+              FrameKind::Reference);
+    EXPECT_EQ(classify(VideoCodecType::H265_420, concat({hevcNal(1), hevcNal(19)})),
+              FrameKind::Keyframe);
+}
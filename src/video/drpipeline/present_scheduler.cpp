@@ -0,0 +1,222 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "present_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int64_t kOneSecondUs = 1'000'000;
+constexpr int64_t kMinIntervalUs = kOneSecondUs / 360;
+constexpr int64_t kMaxIntervalUs = kOneSecondUs / 24;
+constexpr size_t kMaxDeltas = 64;
+constexpr size_t kMinDeltas = 8;
+constexpr size_t kMaxCosts = 32;
+constexpr int64_t kMaxMultiple = 4;
+// 渲染耗时预测之外再多留一点余量, 防止错过vblank
+constexpr int64_t kSafetyMarginUs = 1'000;
+
+int64_t clampInterval(int64_t interval_us) {
+    return std::clamp(interval_us, kMinIntervalUs, kMaxIntervalUs);
+}
+
+// 向下取整的除法, 处理负数
+int64_t floorDiv(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0))) {
+        q -= 1;
+    }
+    return q;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+PresentScheduler::PresentScheduler(uint32_t refresh_rate_hint)
+    : default_interval_us_{clampInterval(
+          refresh_rate_hint == 0 ? kOneSecondUs / 60 : kOneSecondUs / refresh_rate_hint)}
+    , interval_us_{default_interval_us_} {}
+
+void PresentScheduler::onPresented(int64_t present_time_us) {
+    if (last_present_us_ >= 0) {
+        int64_t delta = present_time_us - last_present_us_;
+        // 太长的间隔说明中间没有画面要渲染, 不能用来估计刷新率
+        if (delta > 0 && delta <= kMaxIntervalUs * 4) {
+            present_deltas_.push_back(delta);
+            while (present_deltas_.size() > kMaxDeltas) {
+                present_deltas_.pop_front();
+            }
+            updateInterval();
+        }
+    }
+    last_present_us_ = present_time_us;
+    if (vsync_anchor_us_ < 0) {
+        vsync_anchor_us_ = present_time_us;
+        return;
+    }
+    // 时间戳应当是画面真正显示的时间(vblank), 按最近的vblank修正相位
+    const int64_t n = floorDiv(present_time_us - vsync_anchor_us_ + interval_us_ / 2, interval_us_);
+    const int64_t predicted = vsync_anchor_us_ + n * interval_us_;
+    vsync_anchor_us_ = predicted + (present_time_us - predicted) / 8;
+}
+
+void PresentScheduler::onRenderCost(int64_t cost_us) {
+    render_costs_.push_back(std::max<int64_t>(cost_us, 0));
+    while (render_costs_.size() > kMaxCosts) {
+        render_costs_.pop_front();
+    }
+    std::vector<int64_t> costs{render_costs_.begin(), render_costs_.end()};
+    // 取P90, 偶尔一次的抖动不至于让我们错过vblank
+    const size_t index = costs.size() * 9 / 10;
+    std::nth_element(costs.begin(), costs.begin() + index, costs.end());
+    predicted_cost_us_ = costs[index];
+}
+
+void PresentScheduler::reset() {
+    interval_us_ = default_interval_us_;
+    confident_ = false;
+    vsync_anchor_us_ = -1;
+    last_present_us_ = -1;
+    present_deltas_.clear();
+    render_costs_.clear();
+    predicted_cost_us_ = 0;
+}
+
+int64_t PresentScheduler::presentInterval() const {
+    return interval_us_;
+}
+
+int64_t PresentScheduler::predictedRenderCost() const {
+    return predicted_cost_us_;
+}
+
+int64_t PresentScheduler::nextVsync(int64_t now_us) const {
+    if (vsync_anchor_us_ < 0) {
+        return now_us;
+    }
+    const int64_t n = floorDiv(now_us - vsync_anchor_us_, interval_us_) + 1;
+    return vsync_anchor_us_ + n * interval_us_;
+}
+
+int64_t PresentScheduler::targetVsync(int64_t now_us) const {
+    const int64_t lead = predicted_cost_us_ + kSafetyMarginUs;
+    if (vsync_anchor_us_ < 0) {
+        return now_us + lead;
+    }
+    int64_t vsync = nextVsync(now_us);
+    // 来不及赶上这个vblank, 与其现在渲染然后在下一个vblank才显示, 不如等等, 用更新的画面
+    while (vsync - lead < now_us) {
+        vsync += interval_us_;
+    }
+    return vsync;
+}
+
+int64_t PresentScheduler::renderDeadline(int64_t now_us) const {
+    if (vsync_anchor_us_ < 0 || !confident_) {
+        return now_us;
+    }
+    const int64_t lead = predicted_cost_us_ + kSafetyMarginUs;
+    return std::max(now_us, targetVsync(now_us) - lead);
+}
+
+void PresentScheduler::updateInterval() {
+    if (present_deltas_.size() < kMinDeltas) {
+        return;
+    }
+    std::vector<int64_t> deltas{present_deltas_.begin(), present_deltas_.end()};
+    std::sort(deltas.begin(), deltas.end());
+    auto near_multiple = [](int64_t delta, int64_t period) {
+        const int64_t k = (delta + period / 2) / period;
+        return k >= 1 && k <= kMaxMultiple && std::abs(delta - k * period) * 4 <= period;
+    };
+    auto explains_most = [&](int64_t period) {
+        const auto explained = std::count_if(deltas.begin(), deltas.end(), [&](int64_t delta) {
+            return near_multiple(delta, period);
+        });
+        return static_cast<size_t>(explained) * 10 >= deltas.size() * 9;
+    };
+    // 两次present之间至少隔一个vblank, 所以较小的分位数接近一个刷新周期的整数倍.
+    // 如果一直隔一个vblank才present, 这个分位数会是周期的两倍, 所以要找能解释绝大部分
+    // 间隔的最大周期. 已经学到的周期能解释的话就沿用, 否则按我们自己的调度present,
+    // 间隔永远是它的整数倍, 会被误认为更长的周期.
+    int64_t estimate = 0;
+    if (confident_ && explains_most(interval_us_)) {
+        estimate = interval_us_;
+    }
+    else {
+        const int64_t base = clampInterval(deltas[deltas.size() / 10]);
+        for (int64_t divisor = 1; divisor <= kMaxMultiple; divisor++) {
+            const int64_t candidate = base / divisor;
+            if (candidate < kMinIntervalUs) {
+                break;
+            }
+            if (explains_most(candidate)) {
+                estimate = candidate;
+                break;
+            }
+        }
+    }
+    if (estimate == 0) {
+        return;
+    }
+    for (int iteration = 0; iteration < 3; iteration++) {
+        double sum = 0;
+        size_t count = 0;
+        for (int64_t delta : deltas) {
+            if (!near_multiple(delta, estimate)) {
+                continue;
+            }
+            sum += static_cast<double>(delta) / ((delta + estimate / 2) / estimate);
+            count++;
+        }
+        if (count < kMinDeltas / 2) {
+            return;
+        }
+        estimate = clampInterval(static_cast<int64_t>(std::lround(sum / count)));
+    }
+    interval_us_ = estimate;
+    if (!confident_) {
+        // 见到足够多相邻vblank上的present, 才相信这个周期, 开始按vblank调度
+        const auto adjacent = std::count_if(deltas.begin(), deltas.end(), [&](int64_t delta) {
+            return std::abs(delta - estimate) * 4 <= estimate;
+        });
+        confident_ = static_cast<size_t>(adjacent) * 4 >= deltas.size();
+    }
+}
+
+} // namespace video
+
+} // namespace lt
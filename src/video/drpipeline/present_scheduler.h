@@ -0,0 +1,86 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+namespace lt {
+
+namespace video {
+
+// 根据present时间戳学习显示器的刷新间隔, 并结合渲染耗时预测下一次该开始渲染的时间点,
+// 使得渲染线程在vblank之前刚好醒来, 而不是固定16ms轮询.
+// 本身不加锁, 也不读系统时钟, 所有时间由调用方传入(单位us), 方便用虚拟时钟测试.
+class PresentScheduler {
+public:
+    explicit PresentScheduler(uint32_t refresh_rate_hint);
+
+    // 一帧画面实际显示出来的时间, 由渲染器从交换链的统计信息里取, 而不是present()返回的时间:
+    // present()本身不一定阻塞到vblank
+    void onPresented(int64_t present_time_us);
+
+    // 从开始渲染到调用present之前的耗时
+    void onRenderCost(int64_t cost_us);
+
+    void reset();
+
+    int64_t presentInterval() const;
+
+    int64_t predictedRenderCost() const;
+
+    // 严格晚于now_us的下一次vblank
+    int64_t nextVsync(int64_t now_us) const;
+
+    // 为了赶上下一个来得及的vblank, 最晚应在什么时候开始渲染. 返回值不早于now_us.
+    // 刷新周期还没学出来之前总是返回now_us, 即收到就渲染
+    int64_t renderDeadline(int64_t now_us) const;
+
+    // renderDeadline()瞄准的vblank
+    int64_t targetVsync(int64_t now_us) const;
+
+private:
+    void updateInterval();
+
+private:
+    const int64_t default_interval_us_;
+    int64_t interval_us_;
+    bool confident_ = false;
+    int64_t vsync_anchor_us_ = -1;
+    int64_t last_present_us_ = -1;
+    std::deque<int64_t> present_deltas_;
+    std::deque<int64_t> render_costs_;
+    int64_t predicted_cost_us_ = 0;
+};
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,155 @@
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/drpipeline/present_scheduler.h>
+
+namespace {
+
+// 虚拟时钟下模拟一块刷新间隔为interval_us的显示器, 画面在渲染完成后的下一个vblank显示
+struct SimResult {
+    int64_t learned_interval_us = 0;
+    size_t frames = 0;
+    size_t hit_target = 0;
+    int64_t max_arrival_to_present_us = 0;
+};
+
+SimResult simulate(int64_t interval_us, uint32_t refresh_rate_hint, uint32_t seed) {
+    constexpr int64_t kPhaseUs = 1'234;
+    constexpr size_t kWarmupFrames = 60;
+    constexpr size_t kTotalFrames = 600;
+    std::mt19937 rng{seed};
+    // 帧到达间隔在一个周期上下30%抖动
+    std::uniform_int_distribution<int64_t> arrival_jitter{-interval_us * 3 / 10,
+                                                          interval_us * 3 / 10};
+    std::uniform_int_distribution<int64_t> render_cost{1'000, 2'000};
+    std::uniform_int_distribution<int64_t> present_jitter{-100, 100};
+
+    auto vsync_at_or_after = [&](int64_t t) {
+        int64_t n = (t - kPhaseUs + interval_us - 1) / interval_us;
+        return kPhaseUs + n * interval_us;
+    };
+
+    std::vector<int64_t> arrivals(kTotalFrames);
+    int64_t arrival = 100'000;
+    for (auto& t : arrivals) {
+        arrival += interval_us + arrival_jitter(rng);
+        t = arrival;
+    }
+
+    lt::video::PresentScheduler scheduler{refresh_rate_hint};
+    SimResult result;
+    int64_t renderer_free_at = 0;
+    size_t next = 0;
+    size_t rendered = 0;
+    while (next < arrivals.size()) {
+        // 和CTSmoother一样, 只渲染开始渲染时已经到达的最新一帧
+        const int64_t now = std::max(arrivals[next], renderer_free_at);
+        const int64_t target = scheduler.targetVsync(now);
+        const int64_t start = scheduler.renderDeadline(now);
+        EXPECT_GE(start, now);
+        while (next + 1 < arrivals.size() && arrivals[next + 1] <= start) {
+            next++;
+        }
+        const int64_t cost = render_cost(rng);
+        const int64_t vsync = vsync_at_or_after(start + cost);
+        const int64_t presented = vsync + present_jitter(rng);
+        scheduler.onRenderCost(cost);
+        scheduler.onPresented(presented);
+        renderer_free_at = presented;
+        const int64_t frame_arrival = arrivals[next];
+        next++;
+        if (rendered++ < kWarmupFrames) {
+            continue;
+        }
+        result.frames++;
+        if (std::abs(vsync - target) < interval_us / 2) {
+            result.hit_target++;
+        }
+        result.max_arrival_to_present_us =
+            std::max(result.max_arrival_to_present_us, vsync - frame_arrival);
+    }
+    result.learned_interval_us = scheduler.presentInterval();
+    return result;
+}
+
+void expectGoodSchedule(int64_t interval_us, uint32_t refresh_rate_hint) {
+    for (uint32_t seed : {1u, 7u, 42u}) {
+        SimResult result = simulate(interval_us, refresh_rate_hint, seed);
+        EXPECT_NEAR(result.learned_interval_us, interval_us, interval_us / 100) << "seed " << seed;
+        EXPECT_GE(result.hit_target * 100, result.frames * 95) << "seed " << seed;
+        // 一帧从到达到显示, 最多等一个周期加上渲染耗时和余量
+        EXPECT_LE(result.max_arrival_to_present_us, interval_us * 2 + 3'000) << "seed " << seed;
+    }
+}
+
+TEST(PresentSchedulerTest, RendersImmediatelyWithoutHistory) {
+    lt::video::PresentScheduler scheduler{60};
+    EXPECT_EQ(scheduler.renderDeadline(5'000), 5'000);
+    EXPECT_EQ(scheduler.presentInterval(), 16'666);
+}
+
+TEST(PresentSchedulerTest, ZeroHintFallsBackTo60Hz) {
+    lt::video::PresentScheduler scheduler{0};
+    EXPECT_EQ(scheduler.presentInterval(), 16'666);
+}
+
+TEST(PresentSchedulerTest, DeadlineLeavesRoomForRenderCost) {
+    lt::video::PresentScheduler scheduler{60};
+    constexpr int64_t kInterval = 16'666;
+    for (int64_t i = 0; i < 20; i++) {
+        scheduler.onRenderCost(5'000);
+        scheduler.onPresented(i * kInterval);
+    }
+    EXPECT_EQ(scheduler.predictedRenderCost(), 5'000);
+    const int64_t last = 19 * kInterval;
+    // 离下一个vblank还早, 等到vblank前再开始渲染
+    const int64_t now = last + 1'000;
+    EXPECT_EQ(scheduler.targetVsync(now), last + kInterval);
+    EXPECT_LE(scheduler.renderDeadline(now), last + kInterval - 5'000);
+    EXPECT_GT(scheduler.renderDeadline(now), now);
+    // 已经来不及赶上下一个vblank, 瞄准再下一个
+    const int64_t late = last + kInterval - 3'000;
+    EXPECT_EQ(scheduler.targetVsync(late), last + 2 * kInterval);
+    EXPECT_GE(scheduler.renderDeadline(late), late);
+}
+
+TEST(PresentSchedulerTest, LongGapsAreNotTakenAsInterval) {
+    lt::video::PresentScheduler scheduler{60};
+    for (int64_t i = 0; i < 20; i++) {
+        scheduler.onPresented(i * 1'000'000);
+    }
+    EXPECT_EQ(scheduler.presentInterval(), 16'666);
+}
+
+TEST(PresentSchedulerTest, ResetRestoresHint) {
+    lt::video::PresentScheduler scheduler{60};
+    for (int64_t i = 0; i < 20; i++) {
+        scheduler.onPresented(i * 6'944);
+    }
+    EXPECT_NEAR(scheduler.presentInterval(), 6'944, 10);
+    scheduler.reset();
+    EXPECT_EQ(scheduler.presentInterval(), 16'666);
+    EXPECT_EQ(scheduler.renderDeadline(123), 123);
+}
+
+TEST(PresentSchedulerTest, Schedules60HzWithJitteryArrivals) {
+    expectGoodSchedule(16'667, 60);
+}
+
+TEST(PresentSchedulerTest, Schedules120HzWithJitteryArrivals) {
+    expectGoodSchedule(8'333, 60);
+}
+
+TEST(PresentSchedulerTest, Schedules144HzWithJitteryArrivals) {
+    expectGoodSchedule(6'944, 60);
+}
+
+TEST(PresentSchedulerTest, LearnsSlowerDisplayThanHint) {
+    expectGoodSchedule(16'667, 144);
+}
+
+} // namespace
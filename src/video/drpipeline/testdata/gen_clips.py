@@ -0,0 +1,550 @@
+#!/usr/bin/env python3
+# 生成bench_drpipeline用的测试码流, 不依赖任何编码器:
+# 关键帧全部用PCM宏块/CU, P帧只把变化的块编成PCM, 其它块skip.
+# 码流很大, 压缩率没有意义, 只是为了在CI里有一个合法的, 内容确定的H264/HEVC码流.
+#
+# 用法: python3 gen_clips.py <输出目录>
+
+import os
+import struct
+import sys
+
+CODEC_H264_420 = 0b0000_0001
+CODEC_H265_420 = 0b0000_0010
+
+
+class BitWriter:
+    def __init__(self):
+        self.bits = []
+
+    def u(self, n, value):
+        for i in range(n - 1, -1, -1):
+            self.bits.append((value >> i) & 1)
+
+    def ue(self, value):
+        value += 1
+        n = value.bit_length()
+        self.u(n - 1, 0)
+        self.u(n, value)
+
+    def se(self, value):
+        self.ue(2 * value - 1 if value > 0 else -2 * value)
+
+    def aligned(self):
+        return len(self.bits) % 8 == 0
+
+    def align_zero(self):
+        while not self.aligned():
+            self.bits.append(0)
+
+    def trailing(self):
+        self.bits.append(1)
+        self.align_zero()
+
+    def bytes(self):
+        assert self.aligned()
+        out = bytearray()
+        for i in range(0, len(self.bits), 8):
+            b = 0
+            for bit in self.bits[i:i + 8]:
+                b = (b << 1) | bit
+            out.append(b)
+        return bytes(out)
+
+
+def escape(rbsp):
+    out = bytearray()
+    zeros = 0
+    for b in rbsp:
+        if zeros >= 2 and b <= 3:
+            out.append(3)
+            zeros = 0
+        out.append(b)
+        zeros = zeros + 1 if b == 0 else 0
+    return bytes(out)
+
+
+def nal(header, rbsp):
+    return b"\x00\x00\x00\x01" + bytes(header) + escape(rbsp)
+
+
+class Scene:
+    """灰度渐变背景上一个每帧右移一格的亮块, 块的大小等于宏块/CU"""
+
+    def __init__(self, width, height, block):
+        self.width = width
+        self.height = height
+        self.block = block
+        self.cols = width // block
+        self.rows = height // block
+
+    def box_at(self, index):
+        pos = index % (self.cols * self.rows)
+        return pos % self.cols, pos // self.cols
+
+    def luma(self, index, bx, by):
+        b = self.block
+        if (bx, by) == self.box_at(index):
+            return [235] * (b * b)
+        out = []
+        for y in range(b):
+            for x in range(b):
+                px = bx * b + x
+                py = by * b + y
+                out.append(16 + (px * 3 + py * 2) % 200)
+        return out
+
+    def changed(self, ref_index, index):
+        if ref_index is None:
+            return set((x, y) for y in range(self.rows) for x in range(self.cols))
+        if self.box_at(ref_index) == self.box_at(index):
+            return set()
+        return {self.box_at(ref_index), self.box_at(index)}
+
+
+# ---------------------------------------------------------------- H264
+
+def h264_sps(width, height):
+    w = BitWriter()
+    w.u(8, 66)  # profile_idc baseline
+    w.u(8, 0b0100_0000)  # constraint_set1_flag
+    w.u(8, 30)  # level_idc
+    w.ue(0)  # seq_parameter_set_id
+    w.ue(4)  # log2_max_frame_num_minus4
+    w.ue(2)  # pic_order_cnt_type
+    w.ue(1)  # max_num_ref_frames
+    w.u(1, 0)  # gaps_in_frame_num_value_allowed_flag
+    w.ue(width // 16 - 1)
+    w.ue(height // 16 - 1)
+    w.u(1, 1)  # frame_mbs_only_flag
+    w.u(1, 1)  # direct_8x8_inference_flag
+    w.u(1, 0)  # frame_cropping_flag
+    w.u(1, 0)  # vui_parameters_present_flag
+    w.trailing()
+    return nal([0x67], w.bytes())
+
+
+def h264_pps():
+    w = BitWriter()
+    w.ue(0)  # pic_parameter_set_id
+    w.ue(0)  # seq_parameter_set_id
+    w.u(1, 0)  # entropy_coding_mode_flag
+    w.u(1, 0)  # bottom_field_pic_order_in_frame_present_flag
+    w.ue(0)  # num_slice_groups_minus1
+    w.ue(0)  # num_ref_idx_l0_default_active_minus1
+    w.ue(0)  # num_ref_idx_l1_default_active_minus1
+    w.u(1, 0)  # weighted_pred_flag
+    w.u(2, 0)  # weighted_bipred_idc
+    w.se(0)  # pic_init_qp_minus26
+    w.se(0)  # pic_init_qs_minus26
+    w.se(0)  # chroma_qp_index_offset
+    w.u(1, 1)  # deblocking_filter_control_present_flag
+    w.u(1, 0)  # constrained_intra_pred_flag
+    w.u(1, 0)  # redundant_pic_cnt_present_flag
+    w.trailing()
+    return nal([0x68], w.bytes())
+
+
+def h264_pcm(w, scene, index, bx, by):
+    w.align_zero()  # pcm_alignment_zero_bit
+    for v in scene.luma(index, bx, by):
+        w.u(8, v)
+    for _ in range(128):
+        w.u(8, 128)
+
+
+def h264_frame(scene, index, ref_index, frame_num, idr_pic_id, is_ref):
+    idr = ref_index is None
+    w = BitWriter()
+    w.ue(0)  # first_mb_in_slice
+    w.ue(7 if idr else 5)  # slice_type: I / P
+    w.ue(0)  # pic_parameter_set_id
+    w.u(8, frame_num)
+    if idr:
+        w.ue(idr_pic_id)
+    else:
+        w.u(1, 0)  # num_ref_idx_active_override_flag
+        w.u(1, 0)  # ref_pic_list_modification_flag_l0
+    if is_ref:
+        w.u(1, 0)  # no_output_of_prior_pics_flag / adaptive_ref_pic_marking_mode_flag
+        if idr:
+            w.u(1, 0)  # long_term_reference_flag
+    w.se(0)  # slice_qp_delta
+    w.ue(1)  # disable_deblocking_filter_idc
+    changed = scene.changed(ref_index, index)
+    skip_run = 0
+    for by in range(scene.rows):
+        for bx in range(scene.cols):
+            if (bx, by) not in changed:
+                skip_run += 1
+                continue
+            if not idr:
+                w.ue(skip_run)
+                skip_run = 0
+                w.ue(30)  # mb_type I_PCM in P slice
+            else:
+                w.ue(25)  # mb_type I_PCM
+            h264_pcm(w, scene, index, bx, by)
+    if skip_run > 0:
+        w.ue(skip_run)
+    w.trailing()
+    header = (3 if idr else (2 if is_ref else 0)) << 5 | (5 if idr else 1)
+    au = nal([0x09], bytes([0xf0]))  # access unit delimiter, primary_pic_type 7
+    if idr:
+        au += h264_sps(scene.width, scene.height) + h264_pps()
+    return au + nal([header], w.bytes())
+
+
+def h264_stream(scene, frames, gop, non_ref_every):
+    out = []
+    ref_index = None
+    frame_num = 0
+    idr_pic_id = 0
+    for i in range(frames):
+        idr = i % gop == 0
+        is_ref = idr or non_ref_every == 0 or i % non_ref_every != 0
+        if idr:
+            ref_index = None
+            frame_num = 0
+        data = h264_frame(scene, i, ref_index, frame_num % 256, idr_pic_id, is_ref)
+        if idr:
+            idr_pic_id = (idr_pic_id + 1) % 16
+        if is_ref:
+            ref_index = i
+            frame_num += 1
+        out.append((idr, data))
+    return out
+
+
+# ---------------------------------------------------------------- HEVC
+
+RANGE_TAB_LPS = [
+    [128, 176, 208, 240], [128, 167, 197, 227], [128, 158, 187, 216], [123, 150, 178, 205],
+    [116, 142, 169, 195], [111, 135, 160, 185], [105, 128, 152, 175], [100, 122, 144, 166],
+    [95, 116, 137, 158], [90, 110, 130, 150], [85, 104, 123, 142], [81, 99, 117, 135],
+    [77, 94, 111, 128], [73, 89, 105, 122], [69, 85, 100, 116], [66, 80, 95, 110],
+    [62, 76, 90, 104], [59, 72, 86, 99], [56, 69, 81, 94], [53, 65, 77, 89],
+    [51, 62, 73, 85], [48, 59, 69, 80], [46, 56, 66, 76], [43, 53, 63, 72],
+    [41, 50, 59, 69], [39, 48, 56, 65], [37, 45, 54, 62], [35, 43, 51, 59],
+    [33, 41, 48, 56], [32, 39, 46, 53], [30, 37, 43, 50], [29, 35, 41, 48],
+    [27, 33, 39, 45], [26, 31, 37, 43], [24, 30, 35, 41], [23, 28, 33, 39],
+    [22, 27, 32, 37], [21, 26, 30, 35], [20, 24, 29, 33], [19, 23, 27, 31],
+    [18, 22, 26, 30], [17, 21, 25, 28], [16, 20, 23, 27], [15, 19, 22, 25],
+    [14, 18, 21, 24], [14, 17, 20, 23], [13, 16, 19, 22], [12, 15, 18, 21],
+    [12, 14, 17, 20], [11, 14, 16, 19], [11, 13, 15, 18], [10, 12, 15, 17],
+    [10, 12, 14, 16], [9, 11, 13, 15], [9, 11, 12, 14], [8, 10, 12, 14],
+    [8, 9, 11, 13], [7, 9, 11, 12], [7, 9, 10, 12], [7, 8, 10, 11],
+    [6, 8, 9, 11], [6, 7, 9, 10], [6, 7, 8, 9], [2, 2, 2, 2],
+]
+TRANS_IDX_LPS = [
+    0, 0, 1, 2, 2, 4, 4, 5, 6, 7, 8, 9, 9, 11, 11, 12, 13, 13, 15, 15, 16, 16, 18, 18, 19, 19,
+    21, 21, 22, 22, 23, 24, 24, 25, 26, 26, 27, 27, 28, 29, 29, 30, 30, 30, 31, 32, 32, 33, 33,
+    33, 34, 34, 35, 35, 35, 36, 36, 36, 37, 37, 37, 38, 38, 63,
+]
+
+
+class Context:
+    def __init__(self, init_value, qp=26):
+        slope = init_value >> 4
+        offset = init_value & 15
+        m = slope * 5 - 45
+        n = (offset << 3) - 16
+        state = min(max(((m * min(max(qp, 0), 51)) >> 4) + n, 1), 126)
+        self.mps = 0 if state <= 63 else 1
+        self.state = (state - 64) if self.mps else (63 - state)
+
+
+class CabacWriter:
+    def __init__(self, w):
+        self.w = w
+        self.reset()
+
+    def reset(self):
+        self.low = 0
+        self.range = 510
+        self.first_bit = True
+        self.outstanding = 0
+
+    def put_bit(self, b):
+        if self.first_bit:
+            self.first_bit = False
+        else:
+            self.w.u(1, b)
+        while self.outstanding > 0:
+            self.w.u(1, 1 - b)
+            self.outstanding -= 1
+
+    def renorm(self):
+        while self.range < 256:
+            if self.low < 256:
+                self.put_bit(0)
+            elif self.low >= 512:
+                self.low -= 512
+                self.put_bit(1)
+            else:
+                self.low -= 256
+                self.outstanding += 1
+            self.range <<= 1
+            self.low <<= 1
+
+    def decision(self, ctx, b):
+        lps = RANGE_TAB_LPS[ctx.state][(self.range >> 6) & 3]
+        self.range -= lps
+        if b != ctx.mps:
+            self.low += self.range
+            self.range = lps
+            if ctx.state == 0:
+                ctx.mps = 1 - ctx.mps
+            ctx.state = TRANS_IDX_LPS[ctx.state]
+        else:
+            ctx.state = min(ctx.state + 1, 62)
+        self.renorm()
+
+    def terminate(self, b):
+        self.range -= 2
+        if b:
+            self.low += self.range
+            # EncodeFlush, 最后写出的1就是rbsp_stop_one_bit或者pcm前的那个1
+            self.range = 2
+            self.renorm()
+            self.put_bit((self.low >> 9) & 1)
+            self.w.u(2, ((self.low >> 7) & 3) | 1)
+        else:
+            self.renorm()
+
+
+def hevc_nal(nal_type, rbsp):
+    return nal([nal_type << 1, 1], rbsp)
+
+
+def hevc_profile_tier_level(w):
+    w.u(2, 0)  # general_profile_space
+    w.u(1, 0)  # general_tier_flag
+    w.u(5, 1)  # general_profile_idc Main
+    w.u(32, 0x6000_0000)  # general_profile_compatibility_flag[1..2]
+    w.u(1, 1)  # general_progressive_source_flag
+    w.u(1, 0)  # general_interlaced_source_flag
+    w.u(1, 0)  # general_non_packed_constraint_flag
+    w.u(1, 1)  # general_frame_only_constraint_flag
+    w.u(44, 0)
+    w.u(8, 93)  # general_level_idc 3.1
+
+
+def hevc_vps():
+    w = BitWriter()
+    w.u(4, 0)  # vps_video_parameter_set_id
+    w.u(1, 1)  # vps_base_layer_internal_flag
+    w.u(1, 1)  # vps_base_layer_available_flag
+    w.u(6, 0)  # vps_max_layers_minus1
+    w.u(3, 0)  # vps_max_sub_layers_minus1
+    w.u(1, 1)  # vps_temporal_id_nesting_flag
+    w.u(16, 0xffff)
+    hevc_profile_tier_level(w)
+    w.u(1, 1)  # vps_sub_layer_ordering_info_present_flag
+    w.ue(1)  # vps_max_dec_pic_buffering_minus1
+    w.ue(0)  # vps_max_num_reorder_pics
+    w.ue(0)  # vps_max_latency_increase_plus1
+    w.u(6, 0)  # vps_max_layer_id
+    w.ue(0)  # vps_num_layer_sets_minus1
+    w.u(1, 0)  # vps_timing_info_present_flag
+    w.u(1, 0)  # vps_extension_flag
+    w.trailing()
+    return hevc_nal(32, w.bytes())
+
+
+def hevc_sps(width, height):
+    w = BitWriter()
+    w.u(4, 0)  # sps_video_parameter_set_id
+    w.u(3, 0)  # sps_max_sub_layers_minus1
+    w.u(1, 1)  # sps_temporal_id_nesting_flag
+    hevc_profile_tier_level(w)
+    w.ue(0)  # sps_seq_parameter_set_id
+    w.ue(1)  # chroma_format_idc 4:2:0
+    w.ue(width)
+    w.ue(height)
+    w.u(1, 0)  # conformance_window_flag
+    w.ue(0)  # bit_depth_luma_minus8
+    w.ue(0)  # bit_depth_chroma_minus8
+    w.ue(4)  # log2_max_pic_order_cnt_lsb_minus4
+    w.u(1, 1)  # sps_sub_layer_ordering_info_present_flag
+    w.ue(1)  # sps_max_dec_pic_buffering_minus1
+    w.ue(0)  # sps_max_num_reorder_pics
+    w.ue(0)  # sps_max_latency_increase_plus1
+    w.ue(1)  # log2_min_luma_coding_block_size_minus3, 16x16
+    w.ue(0)  # log2_diff_max_min_luma_coding_block_size, CTB 16x16
+    w.ue(0)  # log2_min_luma_transform_block_size_minus2
+    w.ue(2)  # log2_diff_max_min_luma_transform_block_size
+    w.ue(0)  # max_transform_hierarchy_depth_inter
+    w.ue(0)  # max_transform_hierarchy_depth_intra
+    w.u(1, 0)  # scaling_list_enabled_flag
+    w.u(1, 0)  # amp_enabled_flag
+    w.u(1, 0)  # sample_adaptive_offset_enabled_flag
+    w.u(1, 1)  # pcm_enabled_flag
+    w.u(4, 7)  # pcm_sample_bit_depth_luma_minus1
+    w.u(4, 7)  # pcm_sample_bit_depth_chroma_minus1
+    w.ue(1)  # log2_min_pcm_luma_coding_block_size_minus3
+    w.ue(0)  # log2_diff_max_min_pcm_luma_coding_block_size
+    w.u(1, 1)  # pcm_loop_filter_disabled_flag
+    w.ue(2)  # num_short_term_ref_pic_sets
+    for delta in (1, 2):  # 参考前一帧 / 跳过一个不参考的帧
+        if delta != 1:
+            w.u(1, 0)  # inter_ref_pic_set_prediction_flag
+        w.ue(1)  # num_negative_pics
+        w.ue(0)  # num_positive_pics
+        w.ue(delta - 1)  # delta_poc_s0_minus1
+        w.u(1, 1)  # used_by_curr_pic_s0_flag
+    w.u(1, 0)  # long_term_ref_pics_present_flag
+    w.u(1, 0)  # sps_temporal_mvp_enabled_flag
+    w.u(1, 0)  # strong_intra_smoothing_enabled_flag
+    w.u(1, 0)  # vui_parameters_present_flag
+    w.u(1, 0)  # sps_extension_present_flag
+    w.trailing()
+    return hevc_nal(33, w.bytes())
+
+
+def hevc_pps():
+    w = BitWriter()
+    w.ue(0)  # pps_pic_parameter_set_id
+    w.ue(0)  # pps_seq_parameter_set_id
+    w.u(1, 0)  # dependent_slice_segments_enabled_flag
+    w.u(1, 0)  # output_flag_present_flag
+    w.u(3, 0)  # num_extra_slice_header_bits
+    w.u(1, 0)  # sign_data_hiding_enabled_flag
+    w.u(1, 0)  # cabac_init_present_flag
+    w.ue(0)  # num_ref_idx_l0_default_active_minus1
+    w.ue(0)  # num_ref_idx_l1_default_active_minus1
+    w.se(0)  # init_qp_minus26
+    w.u(1, 0)  # constrained_intra_pred_flag
+    w.u(1, 0)  # transform_skip_enabled_flag
+    w.u(1, 0)  # cu_qp_delta_enabled_flag
+    w.se(0)  # pps_cb_qp_offset
+    w.se(0)  # pps_cr_qp_offset
+    w.u(1, 0)  # pps_slice_chroma_qp_offsets_present_flag
+    w.u(1, 0)  # weighted_pred_flag
+    w.u(1, 0)  # weighted_bipred_flag
+    w.u(1, 0)  # transquant_bypass_enabled_flag
+    w.u(1, 0)  # tiles_enabled_flag
+    w.u(1, 0)  # entropy_coding_sync_enabled_flag
+    w.u(1, 0)  # pps_loop_filter_across_slices_enabled_flag
+    w.u(1, 1)  # deblocking_filter_control_present_flag
+    w.u(1, 0)  # deblocking_filter_override_enabled_flag
+    w.u(1, 1)  # pps_deblocking_filter_disabled_flag
+    w.u(1, 0)  # pps_scaling_list_data_present_flag
+    w.u(1, 0)  # lists_modification_present_flag
+    w.ue(0)  # log2_parallel_merge_level_minus2
+    w.u(1, 0)  # slice_segment_header_extension_present_flag
+    w.u(1, 0)  # pps_extension_present_flag
+    w.trailing()
+    return hevc_nal(34, w.bytes())
+
+
+def hevc_frame(scene, index, ref_index, poc, rps_idx, nal_type):
+    idr = ref_index is None
+    w = BitWriter()
+    w.u(1, 1)  # first_slice_segment_in_pic_flag
+    if idr:
+        w.u(1, 0)  # no_output_of_prior_pics_flag
+    w.ue(0)  # slice_pic_parameter_set_id
+    w.ue(2 if idr else 1)  # slice_type: I / P
+    if not idr:
+        w.u(8, poc % 256)  # slice_pic_order_cnt_lsb
+        w.u(1, 1)  # short_term_ref_pic_set_sps_flag
+        w.u(1, rps_idx)  # short_term_ref_pic_set_idx
+        w.u(1, 0)  # num_ref_idx_active_override_flag
+        w.ue(4)  # five_minus_max_num_merge_cand
+    w.se(0)  # slice_qp_delta
+    w.u(1, 1)  # byte_alignment
+    w.align_zero()
+
+    cabac = CabacWriter(w)
+    skip_ctx = [Context(v) for v in (197, 185, 201)]
+    pred_mode_ctx = Context(149)
+    part_mode_ctx = Context(184 if idr else 154)
+    changed = scene.changed(ref_index, index)
+    skipped = set()
+    for by in range(scene.rows):
+        for bx in range(scene.cols):
+            pcm = (bx, by) in changed
+            if not idr:
+                ctx_inc = int((bx - 1, by) in skipped) + int((bx, by - 1) in skipped)
+                cabac.decision(skip_ctx[ctx_inc], 0 if pcm else 1)  # cu_skip_flag
+                if not pcm:
+                    skipped.add((bx, by))
+                else:
+                    cabac.decision(pred_mode_ctx, 1)  # pred_mode_flag MODE_INTRA
+            if pcm:
+                cabac.decision(part_mode_ctx, 1)  # part_mode PART_2Nx2N
+                cabac.terminate(1)  # pcm_flag
+                w.align_zero()  # pcm_alignment_zero_bit
+                for v in scene.luma(index, bx, by):
+                    w.u(8, v)
+                for _ in range(128):
+                    w.u(8, 128)
+                cabac.reset()
+            last = bx == scene.cols - 1 and by == scene.rows - 1
+            cabac.terminate(1 if last else 0)  # end_of_slice_segment_flag
+    w.align_zero()
+    aud = BitWriter()
+    aud.u(3, 0 if idr else 1)  # pic_type
+    aud.trailing()
+    au = hevc_nal(35, aud.bytes())
+    if idr:
+        au += hevc_vps() + hevc_sps(scene.width, scene.height) + hevc_pps()
+    return au + hevc_nal(nal_type, w.bytes())
+
+
+def hevc_stream(scene, frames, gop, non_ref_every):
+    out = []
+    ref_index = None
+    idr_index = 0
+    for i in range(frames):
+        idr = i % gop == 0
+        is_ref = idr or non_ref_every == 0 or i % non_ref_every != 0
+        if idr:
+            ref_index = None
+            idr_index = i
+            nal_type = 19  # IDR_W_RADL
+        else:
+            nal_type = 1 if is_ref else 0  # TRAIL_R / TRAIL_N
+        rps_idx = 0 if ref_index is None or ref_index == i - 1 else 1
+        out.append((idr, hevc_frame(scene, i, ref_index, i - idr_index, rps_idx, nal_type)))
+        if is_ref:
+            ref_index = i
+    return out
+
+
+# ---------------------------------------------------------------- 文件格式, 见video_stream_file.h
+
+def write_ltvs(path, codec, width, height, fps, frames):
+    interval_us = 1_000_000 // fps
+    with open(path, "wb") as f:
+        f.write(b"LTVS")
+        f.write(struct.pack("<IIII", 1, codec, width, height))
+        for i, (keyframe, data) in enumerate(frames):
+            capture = i * interval_us
+            # 假装编码耗时2ms
+            f.write(struct.pack("<QqqqII", i, capture, capture + 500, capture + 2500,
+                                1 if keyframe else 0, len(data)))
+            f.write(data)
+
+
+def main():
+    out_dir = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    scene = Scene(160, 96, 16)
+    # 换分辨率之后的码流, 测bench_drpipeline --switch
+    scene2 = Scene(256, 144, 16)
+    clips = [
+        ("h264_160x96_moving_box.ltvs", CODEC_H264_420, scene, h264_stream(scene, 120, 60, 0)),
+        ("h264_160x96_non_ref.ltvs", CODEC_H264_420, scene, h264_stream(scene, 120, 60, 2)),
+        ("h264_256x144_moving_box.ltvs", CODEC_H264_420, scene2, h264_stream(scene2, 60, 60, 0)),
+        ("hevc_160x96_moving_box.ltvs", CODEC_H265_420, scene, hevc_stream(scene, 120, 60, 0)),
+        ("hevc_160x96_non_ref.ltvs", CODEC_H265_420, scene, hevc_stream(scene, 120, 60, 2)),
+        ("hevc_256x144_moving_box.ltvs", CODEC_H265_420, scene2, hevc_stream(scene2, 60, 60, 0)),
+    ]
+    for name, codec, s, frames in clips:
+        path = os.path.join(out_dir, name)
+        write_ltvs(path, codec, s.width, s.height, 60, frames)
+        print("%s: %d frames, %d bytes" % (name, len(frames), os.path.getsize(path)))
+
+if __name__ == "__main__":
+    main()
@@ -30,10 +30,13 @@
 
 #include "video_decode_render_pipeline.h"
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <mutex>
+#include <thread>
 #include <tuple>
 
 #include <ltlib/logging.h>
@@ -51,12 +54,18 @@
 #include <ltproto/ltproto.h>
 #include <ltproto/worker2service/reconfigure_video_encoder.pb.h>
 
+#include <ltlib/buffer_pool.h>
 #include <ltlib/threads.h>
 #include <ltlib/times.h>
 
 #include <video/decoder/video_decoder.h>
 #include <video/drpipeline/ct_smoother.h>
+#include <video/drpipeline/decode_queue.h>
+#include <video/drpipeline/present_scheduler.h>
 #include <video/drpipeline/video_statistics.h>
+#include <video/drpipeline/video_stream_file.h>
+#include <video/encoder/h264_bitstream.h>
+#include <video/renderer/null_renderer.h>
 #include <video/renderer/video_renderer.h>
 #include <video/widgets/widgets_manager.h>
 
@@ -83,20 +92,28 @@ namespace video {
 
 using namespace std::chrono_literals;
 
+// 解码器或渲染器重建失败后, 解码和渲染线程隔多久再看一次
+constexpr auto kNoMediaSleep = 10ms;
+
 class VDRPipeline2 : public DecodeRenderPipeline {
 public:
     static std::unique_ptr<VDRPipeline2> create(const DecodeRenderPipeline::Params& params);
     ~VDRPipeline2() override;
     DecodeRenderPipeline::Action submit(const lt::VideoFrame& frame) override;
+    DecodeRenderPipeline::Action submit(const lt::VideoFrame& frame,
+                                        std::shared_ptr<const void> holder) override;
     void setTimeDiff(int64_t diff_us) override;
     void setRTT(int64_t rtt_us) override;
     void setBWE(uint32_t bps) override;
     void setNack(uint32_t nack) override;
     void setLossRate(float rate) override;
+    void setInputLatency(const std::string& name, uint32_t samples, int64_t p50_us,
+                         int64_t p95_us, int64_t p99_us) override;
     void resetRenderTarget() override;
     void setCursorInfo(const ::lt::CursorInfo& info) override;
     void switchMouseMode(bool absolute) override;
     void switchStretchMode(bool stretch) override;
+    bool reconfigure(const Params& params) override;
 
 protected:
     VDRPipeline2();
@@ -107,15 +124,23 @@ VDRPipeline2::~VDRPipeline2() = default;
 DecodeRenderPipeline::Action VDRPipeline2::submit(const lt::VideoFrame&) {
     return DecodeRenderPipeline::Action::NONE;
 }
+DecodeRenderPipeline::Action VDRPipeline2::submit(const lt::VideoFrame&,
+                                                  std::shared_ptr<const void>) {
+    return DecodeRenderPipeline::Action::NONE;
+}
 void VDRPipeline2::setTimeDiff(int64_t) {}
 void VDRPipeline2::setRTT(int64_t) {}
 void VDRPipeline2::setBWE(uint32_t) {}
 void VDRPipeline2::setNack(uint32_t) {}
 void VDRPipeline2::setLossRate(float) {}
+void VDRPipeline2::setInputLatency(const std::string&, uint32_t, int64_t, int64_t, int64_t) {}
 void VDRPipeline2::resetRenderTarget() {}
 void VDRPipeline2::setCursorInfo(const ::lt::CursorInfo&) {}
 void VDRPipeline2::switchMouseMode(bool) {}
 void VDRPipeline2::switchStretchMode(bool) {}
+bool VDRPipeline2::reconfigure(const DecodeRenderPipeline::Params&) {
+    return false;
+}
 // #if !defined(LT_WINDOWS)
 std::unique_ptr<VDRPipeline2> VDRPipeline2::create(const DecodeRenderPipeline::Params&) {
     return nullptr;
@@ -123,34 +148,45 @@ std::unique_ptr<VDRPipeline2> VDRPipeline2::create(const DecodeRenderPipeline::P
 // #endif // LT_WINDOWS
 
 class VDRPipeline : public DecodeRenderPipeline {
-public:
-    struct VideoFrameInternal : lt::VideoFrame {
-        std::shared_ptr<uint8_t[]> data_internal;
-    };
-
 public:
     static std::unique_ptr<VDRPipeline> create(const DecodeRenderPipeline::Params& params);
     ~VDRPipeline() override;
     DecodeRenderPipeline::Action submit(const lt::VideoFrame& frame) override;
+    DecodeRenderPipeline::Action submit(const lt::VideoFrame& frame,
+                                        std::shared_ptr<const void> holder) override;
     void setTimeDiff(int64_t diff_us) override;
     void setRTT(int64_t rtt_us) override;
     void setBWE(uint32_t bps) override;
     void setNack(uint32_t nack) override;
     void setLossRate(float rate) override;
+    void setInputLatency(const std::string& name, uint32_t samples, int64_t p50_us,
+                         int64_t p95_us, int64_t p99_us) override;
     void resetRenderTarget() override;
     void setCursorInfo(const ::lt::CursorInfo& info) override;
     void switchMouseMode(bool absolute) override;
     void switchStretchMode(bool stretch) override;
+    bool reconfigure(const DecodeRenderPipeline::Params& params) override;
 
 private:
     VDRPipeline(const DecodeRenderPipeline::Params& params);
     bool init();
+    bool createRenderer();
+    bool createDecoder();
+    bool bindDecoderToRenderer(bool set_decoded_format);
+    bool createWidgets();
+    uint32_t videoWidth() const;
+    uint32_t videoHeight() const;
     void decodeLoop(const std::function<void()>& i_am_alive);
     void renderLoop(const std::function<void()>& i_am_alive);
 
-    bool waitForDecode(std::vector<VideoFrameInternal>& frames,
-                       std::chrono::microseconds max_delay);
+    DecodeRenderPipeline::Action submitInternal(const lt::VideoFrame& frame,
+                                                std::shared_ptr<const void> holder);
+    std::optional<DecodeQueue::Frame> waitForDecode(std::chrono::microseconds max_delay);
+    void pushToDecodeQueue(DecodeQueue::Frame frame, int64_t now_us);
+    void releaseHeldFrames(int64_t now_us);
+    void sendFrameAck(const DecodeQueue::Frame& frame);
     bool waitForRender(std::chrono::microseconds ms);
+    void waitUntil(int64_t deadline_us);
     void onStat();
     void onUserSetBitrate(uint32_t bps);
     void onUserSwitchMonitor();
@@ -160,21 +196,31 @@ private:
 
 private:
     const bool for_test_;
-    const uint32_t width_;
-    const uint32_t height_;
+    const bool headless_;
+    uint32_t width_;
+    uint32_t height_;
     const uint32_t screen_refresh_rate_;
-    const uint32_t rotation_;
+    uint32_t rotation_;
     const lt::VideoCodecType encode_codec_type_;
     const lt::VideoCodecType decode_codec_type_;
     std::function<void(uint32_t, std::shared_ptr<google::protobuf::MessageLite>, bool)>
         send_message_to_host_;
     std::function<void()> switch_stretch_;
     std::function<void()> reset_pipeline_;
+    std::function<void(const FrameTiming&)> on_frame_timing_;
+    std::shared_ptr<ltlib::AVSync> av_sync_;
     lt::plat::PcSdl* sdl_;
     void* window_;
 
-    std::atomic<bool> request_i_frame_ = false;
-    std::vector<VideoFrameInternal> encoded_frames_;
+    DecodeQueue decode_queue_;
+    // 为了和声音对齐而压着的帧, 到时间再进decode_queue_, 不占它的延迟预算.
+    // 解码器输出的是同一块缓冲, 只能在解码前等, 不能解码后再等
+    struct HeldFrame {
+        int64_t release_time_us;
+        DecodeQueue::Frame frame;
+    };
+    std::deque<HeldFrame> sync_hold_;
+    ltlib::BufferPool frame_pool_;
 
     bool decode_signal_ = false;
     std::mutex decode_mtx_;
@@ -184,9 +230,20 @@ private:
     std::mutex render_mtx_;
     std::condition_variable waiting_for_render_;
 
+    // reconfigure()会替换解码器和渲染器. 解码线程持有decoder_mtx_时才访问video_decoder_,
+    // 渲染线程持有renderer_mtx_时才访问video_renderer_, widgets_和rendering_frame_.
+    // 渲染线程不持有renderer_mtx_去等swap chain, 而是持有renderer_wait_mtx_,
+    // 替换渲染器前也要拿到它, 保证等待期间渲染器不会被销毁
+    std::atomic<bool> reconfiguring_{false};
+    std::mutex decoder_mtx_;
+    std::mutex renderer_mtx_;
+    std::mutex renderer_wait_mtx_;
     std::unique_ptr<Renderer> video_renderer_;
     std::unique_ptr<Decoder> video_decoder_;
+    std::optional<CTSmoother::Frame> rendering_frame_;
     CTSmoother smoother_;
+    PresentScheduler present_scheduler_;
+    int64_t last_present_time_ = -1;
     std::atomic<bool> stoped_{true};
     std::unique_ptr<ltlib::BlockingThread> decode_thread_;
     std::unique_ptr<ltlib::BlockingThread> render_thread_;
@@ -215,6 +272,7 @@ private:
 
 VDRPipeline::VDRPipeline(const DecodeRenderPipeline::Params& params)
     : for_test_{params.for_test}
+    , headless_{params.headless}
     , width_{params.width}
     , height_{params.height}
     , screen_refresh_rate_{params.screen_refresh_rate}
@@ -224,7 +282,11 @@ VDRPipeline::VDRPipeline(const DecodeRenderPipeline::Params& params)
     , send_message_to_host_{params.send_message_to_host}
     , switch_stretch_{params.switch_stretch}
     , reset_pipeline_{params.reset_pipeline}
+    , on_frame_timing_{params.on_frame_timing}
+    , av_sync_{params.av_sync}
     , sdl_{params.sdl}
+    , decode_queue_{DecodeQueue::Params{params.decode_codec}}
+    , present_scheduler_{params.screen_refresh_rate}
     , statistics_{new VideoStatistics}
     , absolute_mouse_{params.absolute_mouse}
     , is_stretch_{params.stretch}
@@ -234,7 +296,7 @@ VDRPipeline::VDRPipeline(const DecodeRenderPipeline::Params& params)
     , show_overlay_{params.show_overlay}
     , color_matrix_{params.color_matrix}
     , full_range_{params.full_range} {
-    window_ = params.sdl->window();
+    window_ = params.sdl == nullptr ? nullptr : params.sdl->window();
 }
 
 std::unique_ptr<VDRPipeline> VDRPipeline::create(const DecodeRenderPipeline::Params& params) {
@@ -253,6 +315,10 @@ VDRPipeline::~VDRPipeline() {
     render_thread_.reset();
     video_decoder_.reset();
     video_renderer_.reset();
+    const auto pool_stat = frame_pool_.stat();
+    LOG(INFO) << "Received frame buffers: " << pool_stat.acquires << " frames, "
+              << pool_stat.allocations << " allocations, " << pool_stat.reserved_bytes_high_water
+              << " bytes reserved";
 }
 
 bool VDRPipeline::init() {
@@ -264,18 +330,43 @@ bool VDRPipeline::init() {
     LOGF(INFO, "VDRPipeline w:%u, h:%u, r:%u codec:%s, color_matrix:%s, full_range:%d", width_,
          height_, rotation_, toString(decode_codec_type_), toString(color_matrix_).c_str(),
          full_range_);
-    Renderer::Params render_params{};
-    uint32_t video_width = width_;
-    uint32_t video_height = height_;
-    if (rotation_ == 90 || rotation_ == 270) {
-        video_width = height_;
-        video_height = width_;
+    if (!createRenderer() || !createDecoder()) {
+        return false;
     }
+    if (!video_renderer_->setDecodedFormat(video_decoder_->decodedFormat())) {
+        LOG(ERR) << "setdecodedformat failed";
+
+        return false;
+    }
+    if (for_test_) {
+        return true;
+    }
+    if (!bindDecoderToRenderer(/*set_decoded_format=*/false)) {
+        return false;
+    }
+    if (!headless_ && !createWidgets()) {
+        return false;
+    }
+    smoother_.clear();
+    stoped_ = false;
+    decode_thread_ = ltlib::BlockingThread::create(
+        "lt_video_decode",
+        [this](const std::function<void()>& i_am_alive) { decodeLoop(i_am_alive); });
+    render_thread_ = ltlib::BlockingThread::create(
+        "lt_video_render",
+        [this](const std::function<void()>& i_am_alive) { renderLoop(i_am_alive); });
+    stat_thread_ = ltlib::TaskThread::create("lt_stat_task");
+    stat_thread_->post_delay(ltlib::TimeDelta{1'000'00}, std::bind(&VDRPipeline::onStat, this));
+    return true;
+}
+
+bool VDRPipeline::createRenderer() {
+    Renderer::Params render_params{};
     render_params.window = window_;
     render_params.device = device_;
     render_params.context = context_;
-    render_params.video_width = video_width;
-    render_params.video_height = video_height;
+    render_params.video_width = videoWidth();
+    render_params.video_height = videoHeight();
     render_params.rotation = rotation_;
     render_params.stretch = is_stretch_;
     render_params.absolute_mouse = absolute_mouse_;
@@ -283,11 +374,20 @@ bool VDRPipeline::init() {
     render_params.full_range = full_range_;
     render_params.align = Decoder::align(decode_codec_type_);
 
-    video_renderer_ = Renderer::create(render_params);
+    if (headless_) {
+        video_renderer_ = std::make_unique<NullRenderer>(render_params, screen_refresh_rate_);
+    }
+    else {
+        video_renderer_ = Renderer::create(render_params);
+    }
     if (video_renderer_ == nullptr) {
         LOG(ERR) << "create renderer failed";
         return false;
     }
+    return true;
+}
+
+bool VDRPipeline::createDecoder() {
     Decoder::Params decode_params{};
     decode_params.codec_type = decode_codec_type_;
     decode_params.hw_device = video_renderer_->hwDevice();
@@ -301,8 +401,11 @@ bool VDRPipeline::init() {
 #else
 #error unknown platform
 #endif
-    decode_params.width = video_width;
-    decode_params.height = video_height;
+    if (headless_) {
+        decode_params.va_type = VaType::None;
+    }
+    decode_params.width = videoWidth();
+    decode_params.height = videoHeight();
 
     video_decoder_ = Decoder::create(decode_params);
     if (video_decoder_ == nullptr) {
@@ -310,19 +413,83 @@ bool VDRPipeline::init() {
 
         return false;
     }
-    if (!video_renderer_->setDecodedFormat(video_decoder_->decodedFormat())) {
+    return true;
+}
+
+bool VDRPipeline::bindDecoderToRenderer(bool set_decoded_format) {
+    if (set_decoded_format && !video_renderer_->setDecodedFormat(video_decoder_->decodedFormat())) {
         LOG(ERR) << "setdecodedformat failed";
 
         return false;
     }
-    if (for_test_) {
-        return true;
-    }
     if (!video_renderer_->bindTextures(video_decoder_->textures())) {
         LOG(ERR) << "bind texture failed";
 
         return false;
     }
+    return true;
+}
+
+uint32_t VDRPipeline::videoWidth() const {
+    return rotation_ == 90 || rotation_ == 270 ? height_ : width_;
+}
+
+uint32_t VDRPipeline::videoHeight() const {
+    return rotation_ == 90 || rotation_ == 270 ? width_ : height_;
+}
+
+bool VDRPipeline::reconfigure(const DecodeRenderPipeline::Params& params) {
+    if (for_test_ || params.headless != headless_ || params.encode_codec != encode_codec_type_ ||
+        params.decode_codec != decode_codec_type_) {
+        LOG(INFO) << "VDRPipeline can't be reconfigured in place";
+        return false;
+    }
+    LOGF(INFO, "VDRPipeline reconfigure w:%u->%u, h:%u->%u, r:%u->%u", width_, params.width,
+         height_, params.height, rotation_, params.rotation);
+    // 让解码线程和渲染线程停在锁外面, 窗口/widgets/统计/线程都保留, 只换解码器(和必要时的渲染器)
+    reconfiguring_ = true;
+    AutoGuard resume{[this]() { reconfiguring_ = false; }};
+    std::scoped_lock lock{decoder_mtx_, renderer_mtx_, renderer_wait_mtx_};
+    const bool same_rotation = rotation_ == params.rotation;
+    width_ = params.width;
+    height_ = params.height;
+    rotation_ = params.rotation;
+    {
+        std::lock_guard lk{decode_mtx_};
+        decode_queue_.clear();
+        sync_hold_.clear();
+    }
+    {
+        std::lock_guard lk{render_mtx_};
+        smoother_.clear();
+    }
+    rendering_frame_.reset();
+    // 渲染器可能还引用着旧解码器的纹理, 先释放解码器
+    video_decoder_.reset();
+    bool renderer_recreated = false;
+    if (!same_rotation || !video_renderer_->resetVideoSize(videoWidth(), videoHeight())) {
+        // widgets用的设备如果是渲染器自己创建的, 会跟着渲染器一起销毁, 只能一起重建
+        const bool external_device = device_ != nullptr && video_renderer_->hwDevice() == device_ &&
+                                     video_renderer_->hwContext() == context_;
+        if (!external_device) {
+            widgets_.reset();
+        }
+        video_renderer_.reset();
+        if (!createRenderer()) {
+            return false;
+        }
+        renderer_recreated = true;
+    }
+    if (!createDecoder() || !bindDecoderToRenderer(renderer_recreated)) {
+        return false;
+    }
+    if (!headless_ && widgets_ == nullptr && !createWidgets()) {
+        return false;
+    }
+    return true;
+}
+
+bool VDRPipeline::createWidgets() {
     WidgetsManager::Params widgets_params{};
     widgets_params.dev = video_renderer_->hwDevice();
     widgets_params.ctx = video_renderer_->hwContext();
@@ -342,28 +509,42 @@ bool VDRPipeline::init() {
 
         return false;
     }
-    smoother_.clear();
-    stoped_ = false;
-    decode_thread_ = ltlib::BlockingThread::create(
-        "lt_video_decode",
-        [this](const std::function<void()>& i_am_alive) { decodeLoop(i_am_alive); });
-    render_thread_ = ltlib::BlockingThread::create(
-        "lt_video_render",
-        [this](const std::function<void()>& i_am_alive) { renderLoop(i_am_alive); });
-    stat_thread_ = ltlib::TaskThread::create("lt_stat_task");
-    stat_thread_->post_delay(ltlib::TimeDelta{1'000'00}, std::bind(&VDRPipeline::onStat, this));
     return true;
 }
 
 DecodeRenderPipeline::Action VDRPipeline::submit(const lt::VideoFrame& _frame) {
-    // static std::fstream stream{"./vidoe_stream",
-    //                            std::ios::out | std::ios::binary | std::ios::trunc};
-    // stream.write(reinterpret_cast<const char*>(_frame.data), _frame.size);
-    // stream.flush();
+    // _frame.data只在回调期间有效, 拷贝到池子里的缓冲区
+    std::shared_ptr<uint8_t[]> data = frame_pool_.acquire(_frame.size);
+    memcpy(data.get(), _frame.data, _frame.size);
+    lt::VideoFrame frame = _frame;
+    frame.data = data.get();
+    return submitInternal(frame, std::move(data));
+}
+
+DecodeRenderPipeline::Action VDRPipeline::submit(const lt::VideoFrame& frame,
+                                                 std::shared_ptr<const void> holder) {
+    return submitInternal(frame, std::move(holder));
+}
+
+DecodeRenderPipeline::Action VDRPipeline::submitInternal(const lt::VideoFrame& _frame,
+                                                         std::shared_ptr<const void> holder) {
+    // 录下来的码流可以用bench_drpipeline重放
+    // static auto writer =
+    //     VideoStreamWriter::create("./video_stream.ltvs", decode_codec_type_, width_, height_);
+    // writer->write(_frame);
     LOGF(DEBUG, "capture:%" PRId64 ", start_enc:% " PRId64 ", end_enc:%" PRId64,
          _frame.capture_timestamp_us, _frame.start_encode_timestamp_us,
          _frame.end_encode_timestamp_us);
     int64_t now_us = ltlib::steady_now_us();
+    if (isAVC(decode_codec_type_) && isProbeFrame(_frame.data, _frame.size)) {
+        // 带宽探测包不解码也不计入统计, 编码端要的只是到达时间
+        DecodeQueue::Frame probe{};
+        probe.ltframe_id = _frame.ltframe_id;
+        probe.enqueue_time_us = now_us;
+        probe.receive_time_us = now_us;
+        sendFrameAck(probe);
+        return DecodeRenderPipeline::Action::NONE;
+    }
     statistics_->addEncode();
     statistics_->updateVideoBW(_frame.size);
     statistics_->updateEncodeTime(_frame.end_encode_timestamp_us -
@@ -371,10 +552,7 @@ DecodeRenderPipeline::Action VDRPipeline::submit(const lt::VideoFrame& _frame) {
     if (time_diff_ != 0) {
         statistics_->updateNetDelay(now_us - _frame.end_encode_timestamp_us - time_diff_);
     }
-    auto ack = std::make_shared<ltproto::client2worker::VideoFrameAck1>();
-    ack->set_picture_id(static_cast<int64_t>(_frame.ltframe_id));
-    ack->set_recv_time(now_us);
-    VideoFrameInternal frame{};
+    DecodeQueue::Frame frame{};
     frame.is_keyframe = _frame.is_keyframe;
     frame.ltframe_id = _frame.ltframe_id;
     frame.size = _frame.size;
@@ -383,19 +561,29 @@ DecodeRenderPipeline::Action VDRPipeline::submit(const lt::VideoFrame& _frame) {
     frame.capture_timestamp_us = _frame.capture_timestamp_us;
     frame.start_encode_timestamp_us = _frame.start_encode_timestamp_us;
     frame.end_encode_timestamp_us = _frame.end_encode_timestamp_us;
-    frame.data_internal = std::shared_ptr<uint8_t[]>(new uint8_t[_frame.size]);
-    memcpy(frame.data_internal.get(), _frame.data, _frame.size);
-    frame.data = frame.data_internal.get();
+    frame.data = _frame.data;
+    frame.holder = std::move(holder);
+    frame.receive_time_us = now_us;
+    const int64_t hold_us = av_sync_ == nullptr ? 0 : av_sync_->videoExtraDelayUs();
+    bool request_i_frame = false;
     {
         std::unique_lock<std::mutex> lock(decode_mtx_);
-        // FIXME: 这个undecoded_num是不准的
-        ack->set_undecoded_num(static_cast<int32_t>(encoded_frames_.size()));
-        encoded_frames_.emplace_back(frame);
+        if (hold_us > 0 || !sync_hold_.empty()) {
+            // 额外延迟变小时也不能让后来的帧先出去
+            int64_t release_time_us = now_us + hold_us;
+            if (!sync_hold_.empty()) {
+                release_time_us = std::max(release_time_us, sync_hold_.back().release_time_us);
+            }
+            sync_hold_.push_back({release_time_us, std::move(frame)});
+            releaseHeldFrames(now_us);
+        }
+        else {
+            pushToDecodeQueue(std::move(frame), now_us);
+        }
+        request_i_frame = decode_queue_.needKeyframe(now_us);
         decode_signal_ = true;
     }
     waiting_for_decode_.notify_one();
-    send_message_to_host_(ltproto::id(ack), ack, true);
-    bool request_i_frame = request_i_frame_.exchange(false);
     return request_i_frame ? DecodeRenderPipeline::Action::REQUEST_KEY_FRAME
                            : DecodeRenderPipeline::Action::NONE;
 }
@@ -422,7 +610,13 @@ void VDRPipeline::setLossRate(float rate) {
     loss_rate_ = rate;
 }
 
+void VDRPipeline::setInputLatency(const std::string& name, uint32_t samples, int64_t p50_us,
+                                  int64_t p95_us, int64_t p99_us) {
+    statistics_->updateInputLatency({name, samples, p50_us, p95_us, p99_us});
+}
+
 void VDRPipeline::resetRenderTarget() {
+    // 和reconfigure()一样由调用方串行调用, 不会碰上video_renderer_被替换
     video_renderer_->resetRenderTarget();
 }
 
@@ -444,61 +638,114 @@ void VDRPipeline::switchStretchMode(bool stretch) {
     is_stretch_ = stretch;
 }
 
-bool VDRPipeline::waitForDecode(std::vector<VideoFrameInternal>& frames,
-                                std::chrono::microseconds max_delay) {
+std::optional<DecodeQueue::Frame>
+VDRPipeline::waitForDecode(std::chrono::microseconds max_delay) {
     std::unique_lock<std::mutex> lock(decode_mtx_);
-    if (encoded_frames_.empty()) {
+    releaseHeldFrames(ltlib::steady_now_us());
+    if (decode_queue_.empty()) {
+        if (!sync_hold_.empty()) {
+            const auto until_release = std::chrono::microseconds{
+                sync_hold_.front().release_time_us - ltlib::steady_now_us()};
+            max_delay = std::max(0us, std::min(max_delay, until_release));
+        }
         waiting_for_decode_.wait_for(lock, max_delay, [this]() { return decode_signal_; });
         decode_signal_ = false;
+        releaseHeldFrames(ltlib::steady_now_us());
+    }
+    return decode_queue_.pop(ltlib::steady_now_us());
+}
+
+void VDRPipeline::pushToDecodeQueue(DecodeQueue::Frame frame, int64_t now_us) {
+    const uint64_t dropped = decode_queue_.stat().dropped();
+    decode_queue_.push(std::move(frame), now_us);
+    if (decode_queue_.stat().dropped() != dropped) {
+        LOG(DEBUG) << "Decode queue dropped " << decode_queue_.stat().dropped() - dropped
+                   << " frames, waiting for keyframe " << decode_queue_.waitingForKeyframe();
+    }
+}
+
+void VDRPipeline::releaseHeldFrames(int64_t now_us) {
+    while (!sync_hold_.empty() && sync_hold_.front().release_time_us <= now_us) {
+        pushToDecodeQueue(std::move(sync_hold_.front().frame), now_us);
+        sync_hold_.pop_front();
     }
-    frames.swap(encoded_frames_);
-    return !frames.empty();
 }
 
 void VDRPipeline::decodeLoop(const std::function<void()>& i_am_alive) {
     while (!stoped_) {
         i_am_alive();
-        std::vector<VideoFrameInternal> frames;
-        waitForDecode(frames, 5ms);
-        if (frames.empty()) {
+        if (reconfiguring_) {
+            std::this_thread::sleep_for(1ms);
             continue;
         }
-        for (auto& frame : frames) {
-            auto start = ltlib::steady_now_us();
-            DecodedFrame decoded_frame = video_decoder_->decode(frame.data, frame.size);
-            auto end = ltlib::steady_now_us();
-            if (decoded_frame.status == DecodeStatus::Failed) {
-                LOG(ERR) << "Failed to call decode(), reqesut i frame";
-                // TODO: send decode failed
-                request_i_frame_ = true;
-                break;
-            }
-            else if (decoded_frame.status == DecodeStatus::EAgain) {
-                LOG(ERR) << "Decode return EAgain(should not be reach here), try reset pipeline";
-                reset_pipeline_();
-            }
-            else if (decoded_frame.status == DecodeStatus::NeedReset) {
-                LOG(ERR) << "Decode return NeedReset, reset pipeline";
-                reset_pipeline_();
+        // 取帧和解码都在锁内, 保证不会把旧分辨率的帧送进新的解码器
+        std::unique_lock media_lock{decoder_mtx_};
+        if (video_decoder_ == nullptr) {
+            // reconfigure()失败了, 等下一次重置. 不能拿着锁空转
+            media_lock.unlock();
+            std::this_thread::sleep_for(kNoMediaSleep);
+            continue;
+        }
+        std::optional<DecodeQueue::Frame> frame = waitForDecode(5ms);
+        if (!frame.has_value()) {
+            continue;
+        }
+        auto start = ltlib::steady_now_us();
+        DecodedFrame decoded_frame = video_decoder_->decode(frame->data, frame->size);
+        auto end = ltlib::steady_now_us();
+        if (decoded_frame.status == DecodeStatus::Failed) {
+            LOG(ERR) << "Failed to call decode(), drop frames until next keyframe";
+            // TODO: send decode failed
+            std::lock_guard<std::mutex> lock(decode_mtx_);
+            decode_queue_.onDecodeFailed();
+        }
+        else if (decoded_frame.status == DecodeStatus::EAgain) {
+            LOG(ERR) << "Decode return EAgain(should not be reach here), try reset pipeline";
+            reset_pipeline_();
+        }
+        else if (decoded_frame.status == DecodeStatus::NeedReset) {
+            LOG(ERR) << "Decode return NeedReset, reset pipeline";
+            reset_pipeline_();
+        }
+        else {
+            LOG(DEBUG) << "CAPTURE-AFTER_DECODE "
+                       << ltlib::steady_now_us() - frame->capture_timestamp_us - time_diff_;
+            statistics_->updateDecodeTime(end - start);
+            sendFrameAck(*frame);
+            if (on_frame_timing_) {
+                FrameTiming timing{};
+                timing.stage = FrameTiming::Stage::Decoded;
+                timing.ltframe_id = frame->ltframe_id;
+                timing.submit_time = frame->receive_time_us;
+                timing.decode_start_time = start;
+                timing.decode_end_time = end;
+                on_frame_timing_(timing);
             }
-            else {
-                LOG(DEBUG) << "CAPTURE-AFTER_DECODE "
-                           << ltlib::steady_now_us() - frame.capture_timestamp_us - time_diff_;
-                statistics_->updateDecodeTime(end - start);
-                CTSmoother::Frame f;
-                f.no = decoded_frame.frame;
-                f.capture_time = frame.capture_timestamp_us;
-                f.at_time = ltlib::steady_now_us();
-                {
-                    std::unique_lock<std::mutex> lock(render_mtx_);
-                    smoother_.push(f);
-                }
-                waiting_for_render_.notify_one();
+            CTSmoother::Frame f;
+            f.no = decoded_frame.frame;
+            f.capture_time = frame->capture_timestamp_us;
+            f.at_time = ltlib::steady_now_us();
+            {
+                std::unique_lock<std::mutex> lock(render_mtx_);
+                smoother_.push(f);
             }
+            waiting_for_render_.notify_one();
         }
     }
 }
 
+void VDRPipeline::sendFrameAck(const DecodeQueue::Frame& frame) {
+    // 解码成功之后才确认, 编码端把最近确认的帧当作丢帧恢复时的参考
+    auto ack = std::make_shared<ltproto::client2worker::VideoFrameAck1>();
+    ack->set_picture_id(static_cast<int64_t>(frame.ltframe_id));
+    ack->set_recv_time(frame.receive_time_us);
+    {
+        std::lock_guard<std::mutex> lock(decode_mtx_);
+        ack->set_undecoded_num(static_cast<int32_t>(decode_queue_.size()));
+    }
+    send_message_to_host_(ltproto::id(ack), ack, true);
+}
+
 bool VDRPipeline::waitForRender(std::chrono::microseconds ms) {
     std::unique_lock<std::mutex> lock(render_mtx_);
     bool ret = waiting_for_render_.wait_for(
@@ -508,11 +755,15 @@ bool VDRPipeline::waitForRender(std::chrono::microseconds ms) {
 
 void VDRPipeline::onStat() {
     auto stat = statistics_->getStat();
-    if (show_statistics_) {
-        widgets_->updateStatistics(stat);
-    }
-    if (show_statistics_) {
-        widgets_->updateStatus((uint32_t)rtt_ / 1000, (uint32_t)stat.render_video_fps, loss_rate_);
+    {
+        std::lock_guard media_lock{renderer_mtx_};
+        if (show_statistics_ && widgets_ != nullptr) {
+            widgets_->updateStatistics(stat);
+        }
+        if (show_statistics_ && widgets_ != nullptr) {
+            widgets_->updateStatus((uint32_t)rtt_ / 1000, (uint32_t)stat.render_video_fps,
+                                   loss_rate_);
+        }
     }
     stat_thread_->post_delay(ltlib::TimeDelta{1'000'00}, std::bind(&VDRPipeline::onStat, this));
 }
@@ -549,13 +800,55 @@ bool VDRPipeline::isStretchMode() {
     return is_stretch_;
 }
 
+void VDRPipeline::waitUntil(int64_t deadline_us) {
+    int64_t now_us = ltlib::steady_now_us();
+    if (deadline_us <= now_us) {
+        return;
+    }
+    std::unique_lock<std::mutex> lock(render_mtx_);
+    waiting_for_render_.wait_for(lock, std::chrono::microseconds{deadline_us - now_us},
+                                 [this]() { return stoped_.load(); });
+}
+
 void VDRPipeline::renderLoop(const std::function<void()>& i_am_alive) {
-    std::optional<CTSmoother::Frame> frame;
+    // 没有新画面时也要定期重绘, 让widgets能够刷新
+    constexpr auto kIdleRedrawInterval = 16ms;
     while (!stoped_) {
         i_am_alive();
-        ltlib::Timestamp cur_time = ltlib::Timestamp::now();
-        if (video_renderer_->waitForPipeline(16)) {
-            waitForRender(16ms);
+        if (reconfiguring_) {
+            std::this_thread::sleep_for(1ms);
+            continue;
+        }
+        const int64_t interval_ms =
+            std::max<int64_t>(1, present_scheduler_.presentInterval() / 1000);
+        Renderer* renderer = nullptr;
+        bool pipeline_ready = false;
+        {
+            // 下面几处等待都不持有renderer_mtx_, 免得reconfigure()和更新widgets被卡住
+            std::lock_guard wait_lock{renderer_wait_mtx_};
+            {
+                std::lock_guard media_lock{renderer_mtx_};
+                renderer = video_renderer_.get();
+            }
+            pipeline_ready = renderer != nullptr && renderer->waitForPipeline(interval_ms);
+        }
+        if (renderer == nullptr) {
+            std::this_thread::sleep_for(kNoMediaSleep);
+            continue;
+        }
+        if (pipeline_ready) {
+            if (waitForRender(kIdleRedrawInterval)) {
+                // 不是一拿到帧就渲染, 而是等到下一个来得及的vblank之前, 这期间如果有更新的帧到达,
+                // 就直接渲染更新的那帧
+                waitUntil(present_scheduler_.renderDeadline(ltlib::steady_now_us()));
+            }
+            std::lock_guard media_lock{renderer_mtx_};
+            // 等待期间可能发生了reconfigure(), 换掉的渲染器要重新等swap chain
+            if (reconfiguring_ || video_renderer_.get() != renderer) {
+                continue;
+            }
+            std::optional<CTSmoother::Frame>& frame = rendering_frame_;
+            ltlib::Timestamp cur_time = ltlib::Timestamp::now();
             auto new_frame = smoother_.get(cur_time.microseconds());
             smoother_.pop();
             if (new_frame.has_value()) {
@@ -586,7 +879,11 @@ void VDRPipeline::renderLoop(const std::function<void()>& i_am_alive) {
                 LOG(ERR) << "Render failed, exit render loop";
                 return;
             case Renderer::RenderResult::Reset:
-                widgets_->reset();
+                if (widgets_ != nullptr) {
+                    widgets_->reset();
+                }
+                present_scheduler_.reset();
+                last_present_time_ = -1;
                 break;
             case Renderer::RenderResult::Success2:
             default:
@@ -596,7 +893,7 @@ void VDRPipeline::renderLoop(const std::function<void()>& i_am_alive) {
             video_renderer_->attachRenderContext();
             AutoGuard auto_detach{[this]() { video_renderer_->detachRenderContext(); }};
             auto t2 = ltlib::steady_now_us();
-            if (show_overlay_) {
+            if (show_overlay_ && widgets_ != nullptr) {
                 widgets_->render();
             }
             auto t3 = ltlib::steady_now_us();
@@ -605,6 +902,29 @@ void VDRPipeline::renderLoop(const std::function<void()>& i_am_alive) {
             statistics_->addPresent();
             statistics_->updateRenderWidgetsTime(t3 - t2);
             statistics_->updatePresentTime(t4 - t3);
+            present_scheduler_.onRenderCost(t3 - t0);
+            int64_t present_time = video_renderer_->lastPresentTime();
+            if (present_time > 0 && present_time != last_present_time_) {
+                last_present_time_ = present_time;
+                present_scheduler_.onPresented(present_time);
+            }
+            if (new_frame.has_value()) {
+                // 拿不到真正的显示时间时, 用present()返回的时间近似
+                const int64_t presented_at = present_time > t0 ? present_time : t4;
+                statistics_->updateDecodeToPresent(presented_at - frame->at_time);
+                if (av_sync_ != nullptr) {
+                    av_sync_->onVideoPresented(frame->capture_time, presented_at);
+                }
+                LOG(DEBUG) << "DECODE-PRESENT " << presented_at - frame->at_time;
+                if (on_frame_timing_) {
+                    FrameTiming timing{};
+                    timing.stage = FrameTiming::Stage::Presented;
+                    timing.decode_end_time = frame->at_time;
+                    timing.render_start_time = t0;
+                    timing.present_time = presented_at;
+                    on_frame_timing_(timing);
+                }
+            }
         }
     }
 }
@@ -633,7 +953,7 @@ DecodeRenderPipeline::Params::Params(
 
 bool DecodeRenderPipeline::Params::validate() const {
     if (encode_codec == lt::VideoCodecType::Unknown ||
-        decode_codec == lt::VideoCodecType::Unknown || sdl == nullptr ||
+        decode_codec == lt::VideoCodecType::Unknown || (sdl == nullptr && !headless) ||
         send_message_to_host == nullptr) {
         return false;
     }
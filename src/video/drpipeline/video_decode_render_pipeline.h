@@ -32,9 +32,12 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 
 #include <google/protobuf/message_lite.h>
 
+#include <ltlib/av_sync.h>
+
 #include <cursor_info.h>
 #include <plat/pc_sdl.h>
 #include <transport/transport.h>
@@ -46,6 +49,20 @@ namespace video {
 
 class DecodeRenderPipeline {
 public:
+    // 单帧在各阶段的时间点, steady clock, us. 没有经过的阶段为-1
+    struct FrameTiming {
+        enum class Stage { Decoded, Presented };
+        Stage stage;
+        // 只在Decoded阶段有效
+        uint64_t ltframe_id = 0;
+        int64_t submit_time = -1;
+        int64_t decode_start_time = -1;
+        int64_t decode_end_time = -1;
+        // 只在Presented阶段有效
+        int64_t render_start_time = -1;
+        int64_t present_time = -1;
+    };
+
     struct Params {
         Params(lt::VideoCodecType encode, lt::VideoCodecType decode, uint32_t _width,
                uint32_t _height, uint32_t _screen_refresh_rate, uint32_t _rotation, bool _stretch,
@@ -56,6 +73,8 @@ public:
         bool validate() const;
 
         bool for_test = false;
+        // 不需要窗口和GPU: 软解, 不渲染, 没有widgets. 给bench_drpipeline用
+        bool headless = false;
         lt::VideoCodecType encode_codec;
         lt::VideoCodecType decode_codec;
         uint32_t width;
@@ -75,6 +94,10 @@ public:
             send_message_to_host;
         std::function<void()> switch_stretch;
         std::function<void()> reset_pipeline;
+        // 可选, 解码线程和渲染线程里回调
+        std::function<void(const FrameTiming&)> on_frame_timing;
+        // 可选, 和声音共用. 汇报画面的显示进度, 按它的要求晚一点解码
+        std::shared_ptr<ltlib::AVSync> av_sync;
     };
 
     enum class Action {
@@ -86,15 +109,23 @@ public:
     static std::unique_ptr<DecodeRenderPipeline> create(const Params& params);
     virtual ~DecodeRenderPipeline() = default;
     virtual Action submit(const lt::VideoFrame& frame) = 0;
+    // frame.data指向的内存由holder持有, pipeline直接引用它, 不再拷贝
+    virtual Action submit(const lt::VideoFrame& frame, std::shared_ptr<const void> holder) = 0;
     virtual void resetRenderTarget() = 0;
     virtual void setTimeDiff(int64_t diff_us) = 0;
     virtual void setRTT(int64_t rtt_us) = 0;
     virtual void setBWE(uint32_t bps) = 0;
     virtual void setNack(uint32_t nack) = 0;
     virtual void setLossRate(float rate) = 0;
+    // 主机统计的一类输入的端到端延迟, 显示在统计面板上
+    virtual void setInputLatency(const std::string& name, uint32_t samples, int64_t p50_us,
+                                 int64_t p95_us, int64_t p99_us) = 0;
     virtual void setCursorInfo(const ::lt::CursorInfo& info) = 0;
     virtual void switchMouseMode(bool absolute) = 0;
     virtual void switchStretchMode(bool stretch) = 0;
+    // 原地切换分辨率/旋转: 窗口, widgets, 统计和线程都保留, 只重建解码器和必要的渲染器资源.
+    // 编解码类型变了等不支持的情况返回false, 失败后这个pipeline不能再用, 调用方应该重新create
+    virtual bool reconfigure(const Params& params) = 0;
 
 protected:
     DecodeRenderPipeline() = default;
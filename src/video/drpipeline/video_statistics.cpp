@@ -84,6 +84,7 @@ VideoStatistics::Stat VideoStatistics::getStat() {
     stat.present_time = present_time_;
     stat.net_delay = net_delay_;
     stat.decode_time = decode_time_;
+    stat.decode_to_present = decode_to_present_;
     stat.video_bw = video_bw_;
     stat.loss_rate = loss_rate_;
     stat.bwe = bwe_;
@@ -92,6 +93,7 @@ VideoStatistics::Stat VideoStatistics::getStat() {
     stat.present_fps = present_history_.size();
     stat.encode_fps = encode_history_.size();
     stat.capture_fps = capture_history_.size();
+    stat.input_latency = input_latency_;
 
     return stat;
 }
@@ -141,6 +143,11 @@ void VideoStatistics::updateDecodeTime(int64_t duration) {
     updateHistory(decode_time_, static_cast<double>(duration));
 }
 
+void VideoStatistics::updateDecodeToPresent(int64_t duration) {
+    std::lock_guard lock{mutex_};
+    updateHistory(decode_to_present_, static_cast<double>(duration));
+}
+
 void VideoStatistics::updateVideoBW(int64_t bytes) {
     const int64_t kOneSecond = 1'000'000;
     int64_t now = ltlib::steady_now_us();
@@ -176,6 +183,17 @@ void VideoStatistics::updateBWE(uint32_t bps) {
     updateHistory(bwe_, static_cast<double>(bps / 1000));
 }
 
+void VideoStatistics::updateInputLatency(const InputLatency& latency) {
+    std::lock_guard lock{mutex_};
+    for (auto& entry : input_latency_) {
+        if (entry.name == latency.name) {
+            entry = latency;
+            return;
+        }
+    }
+    input_latency_.push_back(latency);
+}
+
 } // namespace video
 
 } // namespace lt
\ No newline at end of file
@@ -33,6 +33,7 @@
 #include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace lt {
@@ -48,6 +49,14 @@ public:
         double min = 0;
         double avg = 0;
     };
+    struct InputLatency {
+        std::string name;
+        uint32_t samples = 0;
+        // 客户端产生输入到主机注入完成, 微秒
+        int64_t p50 = 0;
+        int64_t p95 = 0;
+        int64_t p99 = 0;
+    };
     struct Stat {
         History encode_time;
         History render_video_time;
@@ -55,6 +64,7 @@ public:
         History present_time;
         History net_delay;
         History decode_time;
+        History decode_to_present;
         History bwe;
         History video_bw;
         History loss_rate;
@@ -62,6 +72,7 @@ public:
         int64_t present_fps;
         int64_t encode_fps;
         int64_t capture_fps;
+        std::vector<InputLatency> input_latency;
     };
 
 public:
@@ -76,12 +87,14 @@ public:
     void updatePresentTime(int64_t duration);
     void updateNetDelay(int64_t duration);
     void updateDecodeTime(int64_t duration);
+    void updateDecodeToPresent(int64_t duration);
     void updateVideoBW(int64_t bytes); // 特殊处理
 
     // 独立消息
     void updateLossRate(float loss);
     void addCapture(const std::vector<uint32_t>& fps);
     void updateBWE(uint32_t bps);
+    void updateInputLatency(const InputLatency& latency);
 
 private:
     static void addHistory(std::deque<int64_t>& history);
@@ -99,6 +112,7 @@ private:
     History present_time_;
     History net_delay_;
     History decode_time_;
+    History decode_to_present_;
     History bwe_;
     History loss_rate_;
     History video_bw_;
@@ -107,6 +121,7 @@ private:
         int64_t time;
     };
     std::deque<VideoBW> video_bw_history_;
+    std::vector<InputLatency> input_latency_;
 };
 
 } // namespace video
@@ -0,0 +1,150 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "video_stream_file.h"
+
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+
+#include <ltlib/logging.h>
+
+namespace {
+
+constexpr char kMagic[4] = {'L', 'T', 'V', 'S'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 20;
+constexpr size_t kFrameHeaderSize = 40;
+constexpr uint32_t kFlagKeyframe = 1;
+
+template <typename T> void put(std::vector<uint8_t>& buff, T value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const auto ptr = reinterpret_cast<const uint8_t*>(&value);
+    buff.insert(buff.end(), ptr, ptr + sizeof(T));
+}
+
+template <typename T> T get(const uint8_t*& ptr) {
+    T value;
+    memcpy(&value, ptr, sizeof(T));
+    ptr += sizeof(T);
+    return value;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+std::unique_ptr<VideoStreamWriter> VideoStreamWriter::create(const std::string& path,
+                                                             lt::VideoCodecType codec,
+                                                             uint32_t width, uint32_t height) {
+    std::unique_ptr<VideoStreamWriter> writer{new VideoStreamWriter};
+    writer->file_.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!writer->file_.is_open()) {
+        LOG(ERR) << "Open " << path << " for writing failed";
+        return nullptr;
+    }
+    std::vector<uint8_t> header;
+    header.insert(header.end(), std::begin(kMagic), std::end(kMagic));
+    put(header, kVersion);
+    put(header, static_cast<uint32_t>(codec));
+    put(header, width);
+    put(header, height);
+    writer->file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+    return writer;
+}
+
+bool VideoStreamWriter::write(const lt::VideoFrame& frame) {
+    std::vector<uint8_t> header;
+    header.reserve(kFrameHeaderSize);
+    put(header, frame.ltframe_id);
+    put(header, frame.capture_timestamp_us);
+    put(header, frame.start_encode_timestamp_us);
+    put(header, frame.end_encode_timestamp_us);
+    put(header, frame.is_keyframe ? kFlagKeyframe : 0u);
+    put(header, frame.size);
+    file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+    file_.write(reinterpret_cast<const char*>(frame.data), frame.size);
+    return file_.good();
+}
+
+std::unique_ptr<VideoStreamReader> VideoStreamReader::create(const std::string& path) {
+    std::ifstream file{path, std::ios::in | std::ios::binary};
+    if (!file.is_open()) {
+        LOG(ERR) << "Open " << path << " for reading failed";
+        return nullptr;
+    }
+    std::unique_ptr<VideoStreamReader> reader{new VideoStreamReader};
+    reader->content_.assign(std::istreambuf_iterator<char>{file},
+                            std::istreambuf_iterator<char>{});
+    const uint8_t* ptr = reader->content_.data();
+    const uint8_t* end = ptr + reader->content_.size();
+    if (reader->content_.size() < kFileHeaderSize || memcmp(ptr, kMagic, sizeof(kMagic)) != 0) {
+        LOG(ERR) << path << " is not a video stream file";
+        return nullptr;
+    }
+    ptr += sizeof(kMagic);
+    const auto version = get<uint32_t>(ptr);
+    if (version != kVersion) {
+        LOG(ERR) << path << " has unsupported version " << version;
+        return nullptr;
+    }
+    reader->codec_ = static_cast<lt::VideoCodecType>(get<uint32_t>(ptr));
+    reader->width_ = get<uint32_t>(ptr);
+    reader->height_ = get<uint32_t>(ptr);
+    while (ptr != end) {
+        if (static_cast<size_t>(end - ptr) < kFrameHeaderSize) {
+            LOG(ERR) << path << " truncated frame header";
+            return nullptr;
+        }
+        lt::VideoFrame frame{};
+        frame.ltframe_id = get<uint64_t>(ptr);
+        frame.capture_timestamp_us = get<int64_t>(ptr);
+        frame.start_encode_timestamp_us = get<int64_t>(ptr);
+        frame.end_encode_timestamp_us = get<int64_t>(ptr);
+        frame.is_keyframe = (get<uint32_t>(ptr) & kFlagKeyframe) != 0;
+        frame.size = get<uint32_t>(ptr);
+        frame.width = reader->width_;
+        frame.height = reader->height_;
+        if (static_cast<size_t>(end - ptr) < frame.size) {
+            LOG(ERR) << path << " truncated frame data";
+            return nullptr;
+        }
+        frame.data = ptr;
+        ptr += frame.size;
+        reader->frames_.push_back(frame);
+    }
+    return reader;
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,86 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <transport/transport.h>
+
+namespace lt {
+
+namespace video {
+
+// 录制下来的视频码流, 带着原始的采集和编码时间戳, 用来离线重放.
+// 文件格式, 所有整数都是小端:
+//   "LTVS" | u32 version | u32 codec(VideoCodecType) | u32 width | u32 height
+//   每帧: u64 ltframe_id | i64 capture_us | i64 start_encode_us | i64 end_encode_us
+//         | u32 flags(bit0: keyframe) | u32 size | data[size]
+class VideoStreamWriter {
+public:
+    static std::unique_ptr<VideoStreamWriter> create(const std::string& path,
+                                                     lt::VideoCodecType codec, uint32_t width,
+                                                     uint32_t height);
+    bool write(const lt::VideoFrame& frame);
+
+private:
+    VideoStreamWriter() = default;
+
+private:
+    std::ofstream file_;
+};
+
+class VideoStreamReader {
+public:
+    // 整个文件一次读进内存, 重放时不再有磁盘IO
+    static std::unique_ptr<VideoStreamReader> create(const std::string& path);
+    lt::VideoCodecType codec() const { return codec_; }
+    uint32_t width() const { return width_; }
+    uint32_t height() const { return height_; }
+    // 返回的frame.data指向reader内部, 和reader同生命周期
+    const std::vector<lt::VideoFrame>& frames() const { return frames_; }
+
+private:
+    VideoStreamReader() = default;
+
+private:
+    lt::VideoCodecType codec_ = lt::VideoCodecType::Unknown;
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    std::vector<uint8_t> content_;
+    std::vector<lt::VideoFrame> frames_;
+};
+
+} // namespace video
+
+} // namespace lt
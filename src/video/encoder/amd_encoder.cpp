@@ -30,6 +30,8 @@
 
 #include "amd_encoder.h"
 
+#include <cstring>
+
 #include <d3d11.h>
 #include <wrl/client.h>
 
@@ -170,8 +172,8 @@ public:
     VideoCodecType codecType() const;
     uint32_t width() const { return params_.width(); }
     uint32_t height() const { return params_.height(); }
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeOneFrame(void* input_frame,
-                                                                       bool request_iframe);
+    std::optional<EncodedFrame> encodeOneFrame(void* input_frame, bool request_iframe,
+                                               ltlib::BufferPool& pool);
 
 private:
     bool loadAmdApi();
@@ -282,13 +284,13 @@ VideoCodecType AmdEncoderImpl::codecType() const {
     return codec_type_;
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-AmdEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
+std::optional<EncodedFrame>
+AmdEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe, ltlib::BufferPool& pool) {
     amf::AMFSurfacePtr surface = nullptr;
     AMF_RESULT result = context_->CreateSurfaceFromDX11Native(input_frame, &surface, nullptr);
     if (result != AMF_OK) {
         LOG(ERR) << "AMFContext::CreateSurfaceFromDX11Native failed with " << result;
-        return nullptr;
+        return std::nullopt;
     }
     if (request_iframe) {
         if (codec_type_ == lt::VideoCodecType::H264) {
@@ -311,28 +313,30 @@ AmdEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
     result = encoder_->SubmitInput(surface);
     if (result != AMF_OK) {
         if (result == AMF_INVALID_RESOLUTION && last_submit_error_ == AMF_INVALID_RESOLUTION) {
-            return nullptr;
+            return std::nullopt;
         }
         else {
             LOG(ERR) << "AMFComponent::SubmitInput failed with " << result;
             last_submit_error_ = result;
-            return nullptr;
+            return std::nullopt;
         }
     }
     last_submit_error_ = AMF_OK;
     amf::AMFDataPtr outdata = nullptr;
     result = encoder_->QueryOutput(&outdata);
     if (result == AMF_EOF) {
-        return nullptr;
+        return std::nullopt;
     }
     if (outdata == nullptr) {
         LOG(ERR) << "AMFComponent::QueryOutput failed with " << result;
-        return nullptr;
+        return std::nullopt;
     }
     amf::AMFBufferPtr buffer{outdata};
-    auto out_frame = std::make_shared<ltproto::client2worker::VideoFrame>();
-    out_frame->set_is_keyframe(isKeyFrame(outdata));
-    out_frame->set_frame(buffer->GetNative(), static_cast<uint32_t>(buffer->GetSize()));
+    EncodedFrame out_frame{};
+    out_frame.is_keyframe = isKeyFrame(outdata);
+    out_frame.size = static_cast<uint32_t>(buffer->GetSize());
+    out_frame.buffer = pool.acquire(out_frame.size);
+    memcpy(out_frame.buffer.get(), buffer->GetNative(), out_frame.size);
     return out_frame;
 }
 
@@ -610,6 +614,7 @@ std::unique_ptr<AmdEncoder> AmdEncoder::create(const EncodeParamsHelper& params)
         return nullptr;
     }
     encoder->impl_ = impl;
+    encoder->initOutputPool(params.bitrate(), static_cast<uint32_t>(params.fps()));
     return encoder;
 }
 
@@ -633,8 +638,8 @@ uint32_t AmdEncoder::height() const {
     return impl_->height();
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame> AmdEncoder::encodeFrame(void* input_frame) {
-    return impl_->encodeOneFrame(input_frame, needKeyframe());
+std::optional<EncodedFrame> AmdEncoder::encodeFrame(void* input_frame) {
+    return impl_->encodeOneFrame(input_frame, needKeyframe(), outputPool());
 }
 
 bool AmdEncoder::doneFrame1() const {
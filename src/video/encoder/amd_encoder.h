@@ -51,7 +51,7 @@ public:
     VideoCodecType codecType() const override;
     uint32_t width() const override;
     uint32_t height() const override;
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeFrame(void* input_frame) override;
+    std::optional<EncodedFrame> encodeFrame(void* input_frame) override;
     bool doneFrame1() const override;
     bool doneFrame2() const override;
     ColorMatrix colorMatrix() const override;
@@ -0,0 +1,265 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// 测量编码器输出从编码到交给发送的开销: 每帧的堆分配次数和编码线程的CPU时间.
+// 用法: bench_encoder_output [--frames=N] [--bitrate=N] [--content=NAME]
+//   --frames   编码的帧数, 默认300
+//   --bitrate  目标码率, 单位Mbps, 默认8
+//   --content  合成画面内容, 见SyntheticCapturer::contentFromString(), 默认moving_window
+// 比较两种包装protobuf的方式: 复用消息(VideoFrameMessagePool)和每帧new一个消息.
+// 机器上找不到openh264动态库时返回77, ctest把它当成跳过.
+
+#include <time.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <ltlib/logging.h>
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/encoder/encoded_frame.h>
+#include <video/encoder/openh264_encoder.h>
+#include <video/encoder/params_helper.h>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// 统计整个进程的堆分配, 包括OpenH264内部的
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+
+using lt::video::OpenH264Encoder;
+using lt::video::SyntheticCapturer;
+using VideoFrameMessage = ltproto::client2worker::VideoFrame;
+
+constexpr int kSkipped = 77;
+constexpr uint32_t kWidth = 1920;
+constexpr uint32_t kHeight = 1080;
+constexpr uint32_t kFps = 30;
+// 发送线程, worker线程和管道上同时有几帧
+constexpr size_t kFramesInFlight = 3;
+
+struct Options {
+    uint32_t frames = 300;
+    uint32_t bitrate_mbps = 8;
+    SyntheticCapturer::Content content = SyntheticCapturer::Content::MovingWindow;
+};
+
+struct StderrSink {
+    void write(g3::LogMessageMover message) { fputs(message.get().toString().c_str(), stderr); }
+};
+
+struct Result {
+    uint64_t frames = 0;
+    uint64_t encode_allocations = 0;
+    uint64_t wrap_allocations = 0;
+    int64_t encode_cpu_ns = 0;
+    int64_t wrap_cpu_ns = 0;
+    uint64_t pool_allocations = 0;
+};
+
+int64_t threadCpuNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1'000'000'000 + ts.tv_nsec;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--frames=", 0) == 0) {
+            options.frames = std::atoi(arg.c_str() + strlen("--frames="));
+        }
+        else if (arg.rfind("--bitrate=", 0) == 0) {
+            options.bitrate_mbps = std::atoi(arg.c_str() + strlen("--bitrate="));
+        }
+        else if (arg.rfind("--content=", 0) == 0) {
+            auto content = SyntheticCapturer::contentFromString(arg.substr(strlen("--content=")));
+            if (!content.has_value()) {
+                fprintf(stderr, "Unknown content %s\n", arg.c_str());
+                return false;
+            }
+            options.content = content.value();
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.frames > 0 && options.bitrate_mbps > 0;
+}
+
+// 改动之前编码器输出的样子: 每帧一个新的protobuf消息
+std::shared_ptr<VideoFrameMessage> wrapFresh(const lt::video::EncodedFrame& frame) {
+    auto msg = std::make_shared<VideoFrameMessage>();
+    msg->set_frame(frame.data(), frame.size);
+    msg->set_is_keyframe(frame.is_keyframe);
+    msg->set_picture_id(frame.picture_id);
+    msg->set_capture_timestamp_us(frame.capture_timestamp_us);
+    msg->set_start_encode_timestamp_us(frame.start_encode_timestamp_us);
+    msg->set_end_encode_timestamp_us(frame.end_encode_timestamp_us);
+    msg->set_width(frame.width);
+    msg->set_height(frame.height);
+    return msg;
+}
+
+bool runOne(const Options& options, bool reuse_messages, Result& result) {
+    lt::video::EncodeParamsHelper params{nullptr,
+                                         nullptr,
+                                         -1,
+                                         lt::VideoCodecType::H264_420,
+                                         kWidth,
+                                         kHeight,
+                                         kFps,
+                                         options.bitrate_mbps * 1000 * 1000,
+                                         true,
+                                         lt::ColorPrimaries::BT709,
+                                         lt::TransferCharacteristics::BT709,
+                                         lt::ColorMatrix::BT601,
+                                         false};
+    OpenH264Encoder::Options encoder_options{};
+    // 多线程时OpenH264的工作线程也会分配, 算不清楚是谁的
+    encoder_options.threads = 1;
+    auto encoder = OpenH264Encoder::create(params, encoder_options);
+    if (encoder == nullptr) {
+        return false;
+    }
+    SyntheticCapturer::Params capture_params{};
+    capture_params.width = kWidth;
+    capture_params.height = kHeight;
+    capture_params.fps = kFps;
+    capture_params.content = options.content;
+    auto capturer = SyntheticCapturer::create(capture_params);
+    if (capturer == nullptr || !capturer->setCaptureFormat(encoder->captureFormat())) {
+        return false;
+    }
+    lt::video::VideoFrameMessagePool messages;
+    std::deque<std::shared_ptr<VideoFrameMessage>> in_flight;
+    for (uint32_t i = 0; i < options.frames; i++) {
+        auto frame = capturer->capture();
+        if (!frame.has_value()) {
+            return false;
+        }
+        const uint64_t allocations0 = g_allocations.load();
+        const int64_t cpu0 = threadCpuNs();
+        auto encoded = encoder->encode(frame.value());
+        const uint64_t allocations1 = g_allocations.load();
+        const int64_t cpu1 = threadCpuNs();
+        capturer->doneWithFrame();
+        if (!encoded.has_value()) {
+            fprintf(stderr, "Encode frame %u failed\n", i);
+            return false;
+        }
+        auto msg = reuse_messages ? messages.wrap(encoded.value()) : wrapFresh(encoded.value());
+        in_flight.push_back(std::move(msg));
+        const uint64_t allocations2 = g_allocations.load();
+        const int64_t cpu2 = threadCpuNs();
+        // 发送端用完之后释放
+        if (in_flight.size() > kFramesInFlight) {
+            in_flight.pop_front();
+        }
+        result.encode_allocations += allocations1 - allocations0;
+        result.wrap_allocations += allocations2 - allocations1;
+        result.encode_cpu_ns += cpu1 - cpu0;
+        result.wrap_cpu_ns += cpu2 - cpu1;
+        result.frames++;
+    }
+    result.pool_allocations = encoder->outputPoolStat().allocations;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--frames=N] [--bitrate=N] [--content=NAME]\n", argv[0]);
+        return 2;
+    }
+    auto log_worker = g3::LogWorker::createLogWorker();
+    log_worker->addSink(std::make_unique<StderrSink>(), &StderrSink::write);
+    g3::log_levels::disable(DEBUG);
+    g3::log_levels::disable(INFO);
+    g3::only_change_at_initialization::addLogLevel(ERR);
+    g3::initializeLogging(log_worker.get());
+
+    printf("%ux%u content %s, %u frames, %u Mbps\n", kWidth, kHeight,
+           SyntheticCapturer::toString(options.content), options.frames, options.bitrate_mbps);
+    for (bool reuse_messages : {false, true}) {
+        Result result;
+        if (!runOne(options, reuse_messages, result)) {
+            fprintf(stderr, "OpenH264 is not available\n");
+            return kSkipped;
+        }
+        const double frames = static_cast<double>(result.frames);
+        printf("    %-16s encode %5.2f allocs/frame %7.1fus CPU, "
+               "wrap %5.2f allocs/frame %6.1fus CPU, output buffers allocated %llu times\n",
+               reuse_messages ? "reused messages" : "fresh messages",
+               result.encode_allocations / frames, result.encode_cpu_ns / 1000.0 / frames,
+               result.wrap_allocations / frames, result.wrap_cpu_ns / 1000.0 / frames,
+               static_cast<unsigned long long>(result.pool_allocations));
+    }
+    return 0;
+}
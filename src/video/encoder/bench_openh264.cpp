@@ -0,0 +1,218 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// 用合成画面测量OpenH264在不同线程数下的编码速度和码率开销.
+// 用法: bench_openh264 [--frames=N] [--bitrate=N] [--content=NAME] [--max-slice-bytes=N]
+//   --frames           每个配置编码的帧数, 默认120
+//   --bitrate          目标码率, 单位Mbps, 默认20. 给得足够高码控才不会掩盖slice带来的开销
+//   --content          合成画面内容, 见SyntheticCapturer::contentFromString(), 默认scrolling_text
+//   --max-slice-bytes  按大小切slice, 默认0表示每个线程一个slice
+// 机器上找不到openh264动态库时返回77, ctest把它当成跳过.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ltlib/logging.h>
+#include <ltlib/times.h>
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/encoder/openh264_encoder.h>
+#include <video/encoder/params_helper.h>
+
+namespace {
+
+using lt::video::OpenH264Encoder;
+using lt::video::SyntheticCapturer;
+
+constexpr int kSkipped = 77;
+constexpr uint32_t kFps = 30;
+
+struct Options {
+    uint32_t frames = 120;
+    uint32_t bitrate_mbps = 20;
+    SyntheticCapturer::Content content = SyntheticCapturer::Content::ScrollingText;
+    uint32_t max_slice_bytes = 0;
+};
+
+struct StderrSink {
+    void write(g3::LogMessageMover message) { fputs(message.get().toString().c_str(), stderr); }
+};
+
+struct Result {
+    uint32_t threads = 0;
+    size_t frames = 0;
+    size_t bytes = 0;
+    int64_t total_us = 0;
+    int64_t p99_us = 0;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--frames=", 0) == 0) {
+            options.frames = std::atoi(arg.c_str() + strlen("--frames="));
+        }
+        else if (arg.rfind("--bitrate=", 0) == 0) {
+            options.bitrate_mbps = std::atoi(arg.c_str() + strlen("--bitrate="));
+        }
+        else if (arg.rfind("--content=", 0) == 0) {
+            auto content = SyntheticCapturer::contentFromString(arg.substr(strlen("--content=")));
+            if (!content.has_value()) {
+                fprintf(stderr, "Unknown content %s\n", arg.c_str());
+                return false;
+            }
+            options.content = content.value();
+        }
+        else if (arg.rfind("--max-slice-bytes=", 0) == 0) {
+            options.max_slice_bytes = std::atoi(arg.c_str() + strlen("--max-slice-bytes="));
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.frames > 0 && options.bitrate_mbps > 0;
+}
+
+std::unique_ptr<OpenH264Encoder> createEncoder(uint32_t width, uint32_t height, uint32_t threads,
+                                               const Options& options) {
+    lt::video::EncodeParamsHelper params{nullptr,
+                                         nullptr,
+                                         -1,
+                                         lt::VideoCodecType::H264_420,
+                                         width,
+                                         height,
+                                         kFps,
+                                         options.bitrate_mbps * 1000 * 1000,
+                                         true,
+                                         lt::ColorPrimaries::BT709,
+                                         lt::TransferCharacteristics::BT709,
+                                         lt::ColorMatrix::BT601,
+                                         false};
+    OpenH264Encoder::Options encoder_options{};
+    encoder_options.threads = threads;
+    encoder_options.max_slice_bytes = options.max_slice_bytes;
+    return OpenH264Encoder::create(params, encoder_options);
+}
+
+// 每个配置都从同一个种子重新生成画面, 保证不同线程数编的是完全相同的帧
+bool runOne(uint32_t width, uint32_t height, uint32_t threads, const Options& options,
+            Result& result) {
+    auto encoder = createEncoder(width, height, threads, options);
+    if (encoder == nullptr) {
+        return false;
+    }
+    SyntheticCapturer::Params capture_params{};
+    capture_params.width = width;
+    capture_params.height = height;
+    capture_params.fps = kFps;
+    capture_params.content = options.content;
+    auto capturer = SyntheticCapturer::create(capture_params);
+    if (capturer == nullptr || !capturer->setCaptureFormat(encoder->captureFormat())) {
+        return false;
+    }
+    std::vector<int64_t> encode_us;
+    result.threads = encoder->threads();
+    for (uint32_t i = 0; i < options.frames; i++) {
+        auto frame = capturer->capture();
+        if (!frame.has_value()) {
+            return false;
+        }
+        const int64_t start = ltlib::steady_now_us();
+        auto encoded = encoder->encode(frame.value());
+        const int64_t elapsed = ltlib::steady_now_us() - start;
+        capturer->doneWithFrame();
+        if (!encoded.has_value()) {
+            fprintf(stderr, "Encode frame %u failed\n", i);
+            return false;
+        }
+        encode_us.push_back(elapsed);
+        result.total_us += elapsed;
+        result.bytes += encoded->size;
+    }
+    std::sort(encode_us.begin(), encode_us.end());
+    result.frames = encode_us.size();
+    result.p99_us = encode_us[std::min(encode_us.size() - 1,
+                                       static_cast<size_t>(encode_us.size() * 0.99))];
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "Usage: %s [--frames=N] [--bitrate=N] [--content=NAME] [--max-slice-bytes=N]\n",
+                argv[0]);
+        return 2;
+    }
+    auto log_worker = g3::LogWorker::createLogWorker();
+    log_worker->addSink(std::make_unique<StderrSink>(), &StderrSink::write);
+    g3::log_levels::disable(DEBUG);
+    g3::log_levels::disable(INFO);
+    g3::only_change_at_initialization::addLogLevel(ERR);
+    g3::initializeLogging(log_worker.get());
+
+    const std::pair<uint32_t, uint32_t> resolutions[] = {{1920, 1080}, {2560, 1440}};
+    const uint32_t threads_list[] = {1, 2, 4, 8};
+    printf("content %s, %u frames, %u Mbps, max slice bytes %u\n",
+           SyntheticCapturer::toString(options.content), options.frames, options.bitrate_mbps,
+           options.max_slice_bytes);
+    for (const auto& [width, height] : resolutions) {
+        printf("%ux%u\n", width, height);
+        size_t single_thread_bytes = 0;
+        for (uint32_t threads : threads_list) {
+            Result result;
+            if (!runOne(width, height, threads, options, result)) {
+                if (single_thread_bytes == 0) {
+                    fprintf(stderr, "OpenH264 is not available\n");
+                    return kSkipped;
+                }
+                return 1;
+            }
+            if (threads == 1) {
+                single_thread_bytes = result.bytes;
+            }
+            const double avg_ms = result.total_us / 1000.0 / result.frames;
+            const double overhead =
+                (static_cast<double>(result.bytes) / single_thread_bytes - 1.0) * 100.0;
+            printf("    threads %u  %7.1f fps  avg %6.2fms  p99 %6.2fms  "
+                   "%8.1f KB/frame  %+6.2f%%\n",
+                   result.threads, 1000.0 / avg_ms, avg_ms, result.p99_us / 1000.0,
+                   result.bytes / 1024.0 / result.frames, overhead);
+        }
+    }
+    return 0;
+}
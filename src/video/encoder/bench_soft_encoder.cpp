@@ -0,0 +1,280 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// 用合成画面比较各个软编码器的编码耗时, 实际码率和画质(Y分量PSNR).
+// 用法: bench_soft_encoder [--frames=N] [--bitrate=N] [--size=WxH]
+//   --frames   每个配置编码的帧数, 默认120
+//   --bitrate  目标码率, 单位Mbps, 默认6
+//   --size     分辨率, 默认1920x1080
+// 画面内容覆盖桌面(static, scrolling_text)和视频(moving_window, noise)两类.
+// 一个编码器都加载不到时返回77, ctest把它当成跳过.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ltlib/logging.h>
+#include <ltlib/times.h>
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/decoder/video_decoder.h>
+#if LT_HAS_OPENH264
+#include <video/encoder/openh264_encoder.h>
+#endif // LT_HAS_OPENH264
+#include <video/encoder/params_helper.h>
+#include <video/encoder/video_encoder.h>
+#if LT_HAS_X264
+#include <video/encoder/x264_encoder.h>
+#endif // LT_HAS_X264
+
+namespace {
+
+using lt::video::Encoder;
+using lt::video::EncodeParamsHelper;
+using lt::video::SyntheticCapturer;
+
+constexpr int kSkipped = 77;
+constexpr uint32_t kFps = 30;
+
+struct Options {
+    uint32_t frames = 120;
+    uint32_t bitrate_mbps = 6;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+};
+
+struct StderrSink {
+    void write(g3::LogMessageMover message) { fputs(message.get().toString().c_str(), stderr); }
+};
+
+struct Candidate {
+    std::string name;
+    std::function<std::unique_ptr<Encoder>(const EncodeParamsHelper&)> create;
+};
+
+struct Result {
+    size_t frames = 0;
+    size_t bytes = 0;
+    int64_t total_us = 0;
+    int64_t p99_us = 0;
+    size_t psnr_frames = 0;
+    double psnr_sum = 0;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.rfind("--frames=", 0) == 0) {
+            options.frames = std::atoi(arg.c_str() + strlen("--frames="));
+        }
+        else if (arg.rfind("--bitrate=", 0) == 0) {
+            options.bitrate_mbps = std::atoi(arg.c_str() + strlen("--bitrate="));
+        }
+        else if (arg.rfind("--size=", 0) == 0) {
+            if (sscanf(arg.c_str() + strlen("--size="), "%ux%u", &options.width,
+                       &options.height) != 2) {
+                fprintf(stderr, "Invalid size %s\n", arg.c_str());
+                return false;
+            }
+        }
+        else {
+            fprintf(stderr, "Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return options.frames > 0 && options.bitrate_mbps > 0 && options.width % 2 == 0 &&
+           options.height % 2 == 0 && options.width > 0 && options.height > 0;
+}
+
+std::vector<Candidate> candidates() {
+    std::vector<Candidate> result;
+#if LT_HAS_OPENH264
+    result.push_back({"openh264", [](const EncodeParamsHelper& params) {
+                          return lt::video::OpenH264Encoder::create(params);
+                      }});
+#endif // LT_HAS_OPENH264
+#if LT_HAS_X264
+    for (const char* preset : {"ultrafast", "superfast", "veryfast"}) {
+        result.push_back({std::string{"x264 "} + preset,
+                          [preset](const EncodeParamsHelper& params) {
+                              lt::video::X264Encoder::Options options{};
+                              options.preset = preset;
+                              return lt::video::X264Encoder::create(params, options);
+                          }});
+    }
+#endif // LT_HAS_X264
+    return result;
+}
+
+double psnrY(const uint8_t* a, const uint8_t* b, size_t size) {
+    uint64_t sse = 0;
+    for (size_t i = 0; i < size; i++) {
+        const int diff = static_cast<int>(a[i]) - static_cast<int>(b[i]);
+        sse += static_cast<uint64_t>(diff * diff);
+    }
+    if (sse == 0) {
+        return 100.0;
+    }
+    const double mse = static_cast<double>(sse) / size;
+    return std::min(100.0, 10.0 * std::log10(255.0 * 255.0 / mse));
+}
+
+bool runOne(const Candidate& candidate, SyntheticCapturer::Content content,
+            const Options& options, Result& result) {
+    EncodeParamsHelper params{nullptr,
+                              nullptr,
+                              -1,
+                              lt::VideoCodecType::H264_420,
+                              options.width,
+                              options.height,
+                              kFps,
+                              options.bitrate_mbps * 1000 * 1000,
+                              true,
+                              lt::ColorPrimaries::BT709,
+                              lt::TransferCharacteristics::BT709,
+                              lt::ColorMatrix::BT601,
+                              false};
+    auto encoder = candidate.create(params);
+    if (encoder == nullptr) {
+        return false;
+    }
+    SyntheticCapturer::Params capture_params{};
+    capture_params.width = options.width;
+    capture_params.height = options.height;
+    capture_params.fps = kFps;
+    capture_params.content = content;
+    auto capturer = SyntheticCapturer::create(capture_params);
+    if (capturer == nullptr || !capturer->setCaptureFormat(encoder->captureFormat())) {
+        return false;
+    }
+    lt::video::Decoder::Params decode_params{};
+    decode_params.codec_type = lt::VideoCodecType::H264_420;
+    decode_params.width = options.width;
+    decode_params.height = options.height;
+    decode_params.va_type = lt::VaType::None;
+    // 解不了码就只报速度和码率
+    auto decoder = lt::video::Decoder::create(decode_params);
+    const size_t luma_size = static_cast<size_t>(options.width) * options.height;
+    std::vector<int64_t> encode_us;
+    for (uint32_t i = 0; i < options.frames; i++) {
+        auto frame = capturer->capture();
+        if (!frame.has_value()) {
+            return false;
+        }
+        const int64_t start = ltlib::steady_now_us();
+        auto encoded = encoder->encode(frame.value());
+        const int64_t elapsed = ltlib::steady_now_us() - start;
+        if (!encoded.has_value()) {
+            capturer->doneWithFrame();
+            fprintf(stderr, "%s: encode frame %u failed\n", candidate.name.c_str(), i);
+            return false;
+        }
+        encode_us.push_back(elapsed);
+        result.total_us += elapsed;
+        result.bytes += encoded->size;
+        if (decoder != nullptr) {
+            auto decoded = decoder->decode(encoded->data(), encoded->size);
+            if (decoded.status == lt::video::DecodeStatus::Success2) {
+                // MEM_NV12, 开头就是Y分量
+                auto output = reinterpret_cast<const uint8_t*>(decoded.frame);
+                result.psnr_sum += psnrY(reinterpret_cast<const uint8_t*>(frame->data),
+                                         output, luma_size);
+                result.psnr_frames++;
+            }
+        }
+        capturer->doneWithFrame();
+    }
+    std::sort(encode_us.begin(), encode_us.end());
+    result.frames = encode_us.size();
+    result.p99_us = encode_us[std::min(encode_us.size() - 1,
+                                       static_cast<size_t>(encode_us.size() * 0.99))];
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "Usage: %s [--frames=N] [--bitrate=N] [--size=WxH]\n", argv[0]);
+        return 2;
+    }
+    auto log_worker = g3::LogWorker::createLogWorker();
+    log_worker->addSink(std::make_unique<StderrSink>(), &StderrSink::write);
+    g3::log_levels::disable(DEBUG);
+    g3::log_levels::disable(INFO);
+    g3::only_change_at_initialization::addLogLevel(ERR);
+    g3::initializeLogging(log_worker.get());
+
+    const SyntheticCapturer::Content contents[] = {
+        SyntheticCapturer::Content::StaticDesktop, SyntheticCapturer::Content::ScrollingText,
+        SyntheticCapturer::Content::MovingWindow, SyntheticCapturer::Content::Noise};
+    printf("%ux%u@%u, %u frames, %u Mbps\n", options.width, options.height, kFps, options.frames,
+           options.bitrate_mbps);
+    size_t available = 0;
+    int ret = 0;
+    for (const auto& candidate : candidates()) {
+        printf("%s\n", candidate.name.c_str());
+        for (auto content : contents) {
+            Result result;
+            if (!runOne(candidate, content, options, result)) {
+                printf("    %-16s unavailable\n", SyntheticCapturer::toString(content));
+                // 第一个画面就失败说明编码器加载不到, 不用再试其它画面
+                if (content == contents[0]) {
+                    break;
+                }
+                ret = 1;
+                continue;
+            }
+            if (content == contents[0]) {
+                available++;
+            }
+            const double avg_ms = result.total_us / 1000.0 / result.frames;
+            const double kbps = result.bytes * 8.0 * kFps / result.frames / 1000.0;
+            char psnr[16] = "     -";
+            if (result.psnr_frames > 0) {
+                snprintf(psnr, sizeof(psnr), "%6.2f", result.psnr_sum / result.psnr_frames);
+            }
+            printf("    %-16s avg %6.2fms  p99 %6.2fms  %8.0f kbps  PSNR-Y %sdB\n",
+                   SyntheticCapturer::toString(content), avg_ms, result.p99_us / 1000.0, kbps,
+                   psnr);
+        }
+    }
+    if (available == 0) {
+        fprintf(stderr, "No software encoder is available\n");
+        return kSkipped;
+    }
+    return ret;
+}
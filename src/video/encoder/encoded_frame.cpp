@@ -0,0 +1,89 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "encoded_frame.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// 编码, 发送线程, worker线程, 管道上都可能有帧. 超过这个数量的就不进池子
+constexpr size_t kMaxFramesInFlight = 16;
+constexpr size_t kMinPoolBufferSize = 4 * 1024;
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+std::unique_ptr<ltlib::BufferPool> createEncodedFramePool(uint32_t bitrate_bps, uint32_t fps) {
+    ltlib::BufferPool::Params params{};
+    const size_t average_frame_size = fps == 0 ? 0 : bitrate_bps / 8 / fps;
+    params.min_size = std::max(average_frame_size, kMinPoolBufferSize);
+    params.max_buffers_per_class = kMaxFramesInFlight;
+    return std::make_unique<ltlib::BufferPool>(params);
+}
+
+std::shared_ptr<ltproto::client2worker::VideoFrame>
+VideoFrameMessagePool::wrap(const EncodedFrame& frame) {
+    auto msg = acquire();
+    // set_frame()会先构造一个临时的std::string, assign()才能复用已有的容量
+    msg->mutable_frame()->assign(reinterpret_cast<const char*>(frame.data()), frame.size);
+    msg->set_is_keyframe(frame.is_keyframe);
+    msg->set_picture_id(frame.picture_id);
+    msg->set_capture_timestamp_us(frame.capture_timestamp_us);
+    msg->set_start_encode_timestamp_us(frame.start_encode_timestamp_us);
+    msg->set_end_encode_timestamp_us(frame.end_encode_timestamp_us);
+    msg->set_width(frame.width);
+    msg->set_height(frame.height);
+    return msg;
+}
+
+std::shared_ptr<ltproto::client2worker::VideoFrame> VideoFrameMessagePool::acquire() {
+    // 引用计数为1说明只剩池子自己持有, 别的线程已经用完了
+    for (auto& msg : messages_) {
+        if (msg.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return msg;
+        }
+    }
+    allocations_++;
+    auto msg = std::make_shared<ltproto::client2worker::VideoFrame>();
+    if (messages_.size() < kMaxFramesInFlight) {
+        messages_.push_back(msg);
+    }
+    return msg;
+}
+
+} // namespace video
+
+} // namespace lt
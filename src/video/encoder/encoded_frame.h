@@ -0,0 +1,78 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ltproto/client2worker/video_frame.pb.h>
+
+#include <ltlib/buffer_pool.h>
+
+namespace lt {
+
+namespace video {
+
+// 编码器的输出. 码流在BufferPool的缓冲区里, 最后一个引用释放后缓冲区回到池里
+struct EncodedFrame {
+    std::shared_ptr<uint8_t[]> buffer;
+    uint32_t size = 0;
+    bool is_keyframe = false;
+    uint64_t picture_id = 0;
+    int64_t capture_timestamp_us = 0;
+    int64_t start_encode_timestamp_us = 0;
+    int64_t end_encode_timestamp_us = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    const uint8_t* data() const { return buffer.get(); }
+};
+
+// 按码率预算创建编码输出的缓冲区池: 最小一级放得下平均大小的帧, 关键帧落在更大的级别里
+std::unique_ptr<ltlib::BufferPool> createEncodedFramePool(uint32_t bitrate_bps, uint32_t fps);
+
+// 发送时才把EncodedFrame包装成protobuf. 消息被接收方释放后复用, frame字段保留原来的容量,
+// 稳定运行时不再分配内存. 只能在一个线程上调用wrap()
+class VideoFrameMessagePool {
+public:
+    std::shared_ptr<ltproto::client2worker::VideoFrame> wrap(const EncodedFrame& frame);
+    uint64_t allocations() const { return allocations_; }
+
+private:
+    std::shared_ptr<ltproto::client2worker::VideoFrame> acquire();
+
+private:
+    std::vector<std::shared_ptr<ltproto::client2worker::VideoFrame>> messages_;
+    uint64_t allocations_ = 0;
+};
+
+} // namespace video
+
+} // namespace lt
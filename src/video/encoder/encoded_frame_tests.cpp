@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/encoder/encoded_frame.h>
+
+namespace {
+
+using lt::video::EncodedFrame;
+using lt::video::VideoFrameMessagePool;
+
+EncodedFrame makeFrame(ltlib::BufferPool& pool, uint64_t picture_id, uint32_t size) {
+    EncodedFrame frame{};
+    frame.buffer = pool.acquire(size);
+    frame.size = size;
+    std::memset(frame.buffer.get(), static_cast<int>(picture_id), size);
+    frame.picture_id = picture_id;
+    frame.is_keyframe = picture_id == 0;
+    frame.width = 1920;
+    frame.height = 1080;
+    return frame;
+}
+
+TEST(EncodedFramePoolTest, SmallestClassHoldsAverageFrame) {
+    // 4Mbps 30fps, 平均一帧16666字节
+    auto pool = lt::video::createEncodedFramePool(4'000'000, 30);
+    auto buffer = pool->acquire(16'666);
+    auto keyframe = pool->acquire(200'000);
+    EXPECT_EQ(pool->stat().allocations, 2u);
+    EXPECT_GE(pool->stat().reserved_bytes, 16'666u + 200'000u);
+    buffer.reset();
+    keyframe.reset();
+    for (int i = 0; i < 100; i++) {
+        auto frame = pool->acquire(i % 30 == 0 ? 200'000 : 12'000);
+    }
+    EXPECT_EQ(pool->stat().allocations, 2u);
+}
+
+TEST(EncodedFramePoolTest, LowBitrateUsesMinimumSize) {
+    auto pool = lt::video::createEncodedFramePool(100'000, 60);
+    auto small = pool->acquire(10);
+    auto larger = pool->acquire(4096);
+    // 都在最小的一级里
+    EXPECT_EQ(pool->stat().reserved_bytes, 2u * 4096);
+}
+
+TEST(VideoFrameMessagePoolTest, CopiesFrameIntoMessage) {
+    ltlib::BufferPool pool;
+    VideoFrameMessagePool messages;
+    auto frame = makeFrame(pool, 7, 1000);
+    frame.capture_timestamp_us = 1;
+    frame.start_encode_timestamp_us = 2;
+    frame.end_encode_timestamp_us = 3;
+    auto msg = messages.wrap(frame);
+    ASSERT_EQ(msg->frame().size(), 1000u);
+    EXPECT_EQ(std::memcmp(msg->frame().data(), frame.data(), frame.size), 0);
+    EXPECT_EQ(msg->picture_id(), 7u);
+    EXPECT_FALSE(msg->is_keyframe());
+    EXPECT_EQ(msg->capture_timestamp_us(), 1);
+    EXPECT_EQ(msg->start_encode_timestamp_us(), 2);
+    EXPECT_EQ(msg->end_encode_timestamp_us(), 3);
+    EXPECT_EQ(msg->width(), 1920u);
+    EXPECT_EQ(msg->height(), 1080u);
+}
+
+TEST(VideoFrameMessagePoolTest, ReusesReleasedMessages) {
+    ltlib::BufferPool pool;
+    VideoFrameMessagePool messages;
+    // 模拟发送路上最多有3帧
+    std::vector<std::shared_ptr<ltproto::client2worker::VideoFrame>> in_flight;
+    for (uint64_t i = 0; i < 300; i++) {
+        auto frame = makeFrame(pool, i, i % 30 == 0 ? 50'000 : 5'000);
+        in_flight.push_back(messages.wrap(frame));
+        if (in_flight.size() > 3) {
+            in_flight.erase(in_flight.begin());
+        }
+    }
+    EXPECT_LE(messages.allocations(), 4u);
+    EXPECT_LE(pool.stat().allocations, 2u);
+}
+
+TEST(VideoFrameMessagePoolTest, NeverReusesMessagesStillInUse) {
+    ltlib::BufferPool pool;
+    VideoFrameMessagePool messages;
+    auto first = messages.wrap(makeFrame(pool, 1, 100));
+    auto second = messages.wrap(makeFrame(pool, 2, 100));
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first->picture_id(), 1u);
+    EXPECT_EQ(second->picture_id(), 2u);
+}
+
+} // namespace
@@ -0,0 +1,488 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "h264_bitstream.h"
+
+#include <cstring>
+
+namespace {
+
+// 随机生成的, 中间没有连续的0, 写进码流时不需要防竞争字节
+constexpr uint8_t kRecoverySeiUuid[16] = {0x6c, 0x74, 0x2d, 0x72, 0x65, 0x63, 0x6f, 0x76,
+                                          0x9a, 0x3e, 0x41, 0xd7, 0xb2, 0x58, 0x1f, 0xc4};
+constexpr uint8_t kTemporalLayerSeiUuid[16] = {0x6c, 0x74, 0x2d, 0x74, 0x6c, 0x61, 0x79, 0x72,
+                                               0x27, 0xe5, 0x93, 0x0c, 0x6a, 0xd1, 0x48, 0xbf};
+constexpr uint8_t kProbeSeiUuid[16] = {0x6c, 0x74, 0x2d, 0x70, 0x72, 0x6f, 0x62, 0x65,
+                                       0x5d, 0x81, 0xc6, 0x2a, 0xf3, 0x17, 0x94, 0x6e};
+constexpr uint8_t kSeiPayloadUserDataUnregistered = 5;
+constexpr uint8_t kNalFillerData = 12;
+constexpr uint32_t kUuidSize = sizeof(kRecoverySeiUuid);
+
+class BitReader {
+public:
+    BitReader(const std::vector<uint8_t>& data)
+        : data_{data} {}
+
+    uint32_t readBits(uint32_t n) {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            if (pos_ >= data_.size() * 8) {
+                overflow_ = true;
+                return 0;
+            }
+            const uint8_t bit = (data_[pos_ / 8] >> (7 - pos_ % 8)) & 1;
+            value = (value << 1) | bit;
+            pos_++;
+        }
+        return value;
+    }
+
+    bool readFlag() { return readBits(1) != 0; }
+
+    uint32_t readUE() {
+        uint32_t zeros = 0;
+        while (!readFlag()) {
+            if (overflow_ || ++zeros > 31) {
+                overflow_ = true;
+                return 0;
+            }
+        }
+        return (1u << zeros) - 1 + readBits(zeros);
+    }
+
+    int32_t readSE() {
+        const uint32_t value = readUE();
+        return value % 2 == 1 ? static_cast<int32_t>((value + 1) / 2)
+                              : -static_cast<int32_t>(value / 2);
+    }
+
+    bool overflow() const { return overflow_; }
+
+private:
+    const std::vector<uint8_t>& data_;
+    size_t pos_ = 0;
+    bool overflow_ = false;
+};
+
+// 返回[pos, size)中下一个NAL头的位置(起始码之后), 找不到返回size
+uint32_t nextNal(const uint8_t* data, uint32_t size, uint32_t pos) {
+    while (pos + 3 <= size) {
+        if (data[pos + 2] > 1) {
+            pos += 3;
+        }
+        else if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+            return pos + 3;
+        }
+        else {
+            pos += 1;
+        }
+    }
+    return size;
+}
+
+// 去掉NAL头之后的防竞争字节, 到下一个起始码为止
+std::vector<uint8_t> toRbsp(const uint8_t* data, uint32_t size, uint32_t nal_pos) {
+    std::vector<uint8_t> rbsp;
+    uint32_t zeros = 0;
+    for (uint32_t i = nal_pos + 1; i < size; i++) {
+        if (zeros >= 2 && data[i] <= 1) {
+            // 下一个起始码
+            break;
+        }
+        if (zeros >= 2 && data[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        rbsp.push_back(data[i]);
+        zeros = data[i] == 0 ? zeros + 1 : 0;
+    }
+    return rbsp;
+}
+
+void skipScalingList(BitReader& reader, uint32_t size) {
+    int32_t last_scale = 8;
+    int32_t next_scale = 8;
+    for (uint32_t i = 0; i < size; i++) {
+        if (next_scale != 0) {
+            next_scale = (last_scale + reader.readSE() + 256) % 256;
+        }
+        last_scale = next_scale == 0 ? last_scale : next_scale;
+    }
+}
+
+bool isHighProfile(uint32_t profile_idc) {
+    switch (profile_idc) {
+    case 100:
+    case 110:
+    case 122:
+    case 244:
+    case 44:
+    case 83:
+    case 86:
+    case 118:
+    case 128:
+    case 138:
+    case 139:
+    case 134:
+    case 135:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::vector<uint8_t> makeUserDataSei(const uint8_t (&uuid)[kUuidSize],
+                                     const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> rbsp{kSeiPayloadUserDataUnregistered,
+                              static_cast<uint8_t>(kUuidSize + payload.size())};
+    rbsp.insert(rbsp.end(), std::begin(uuid), std::end(uuid));
+    rbsp.insert(rbsp.end(), payload.begin(), payload.end());
+    rbsp.push_back(0x80); // rbsp_trailing_bits
+    std::vector<uint8_t> nal{0, 0, 0, 1, 0x06};
+    uint32_t zeros = 0;
+    for (uint8_t byte : rbsp) {
+        if (zeros >= 2 && byte <= 3) {
+            nal.push_back(3);
+            zeros = 0;
+        }
+        nal.push_back(byte);
+        zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return nal;
+}
+
+// nal指向NAL头, UUID里没有连续的0, 可以直接比较
+bool isUserDataSei(const uint8_t* nal, uint32_t size, const uint8_t (&uuid)[kUuidSize]) {
+    // NAL头, payloadType, payloadSize, UUID
+    constexpr uint32_t kMinSize = 3 + kUuidSize;
+    if (nal == nullptr || size < kMinSize || (nal[0] & 0x1f) != 6) {
+        return false;
+    }
+    return nal[1] == kSeiPayloadUserDataUnregistered && memcmp(nal + 3, uuid, kUuidSize) == 0;
+}
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+std::optional<H264SliceParser::SliceInfo> H264SliceParser::parse(const uint8_t* data,
+                                                                 uint32_t size) {
+    if (data == nullptr) {
+        return std::nullopt;
+    }
+    for (uint32_t pos = nextNal(data, size, 0); pos < size; pos = nextNal(data, size, pos)) {
+        const uint8_t header = data[pos];
+        const uint8_t nal_type = header & 0x1f;
+        switch (nal_type) {
+        case 7:
+            if (!parseSps(toRbsp(data, size, pos))) {
+                return std::nullopt;
+            }
+            break;
+        case 8:
+            if (!parsePps(toRbsp(data, size, pos))) {
+                return std::nullopt;
+            }
+            break;
+        case 1:
+        case 5:
+            // 同一帧的所有slice里这几个字段都一样, 只看第一个
+            return parseSlice(toRbsp(data, size, pos), header);
+        default:
+            break;
+        }
+    }
+    return std::nullopt;
+}
+
+bool H264SliceParser::parseSps(const std::vector<uint8_t>& rbsp) {
+    BitReader reader{rbsp};
+    const uint32_t profile_idc = reader.readBits(8);
+    reader.readBits(16); // constraint_set_flags, level_idc
+    const uint32_t sps_id = reader.readUE();
+    Sps sps;
+    if (isHighProfile(profile_idc)) {
+        const uint32_t chroma_format_idc = reader.readUE();
+        if (chroma_format_idc == 3) {
+            sps.separate_colour_plane = reader.readFlag();
+        }
+        reader.readUE(); // bit_depth_luma_minus8
+        reader.readUE(); // bit_depth_chroma_minus8
+        reader.readFlag(); // qpprime_y_zero_transform_bypass_flag
+        if (reader.readFlag()) {
+            const uint32_t lists = chroma_format_idc == 3 ? 12 : 8;
+            for (uint32_t i = 0; i < lists; i++) {
+                if (reader.readFlag()) {
+                    skipScalingList(reader, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+    sps.log2_max_frame_num = reader.readUE() + 4;
+    sps.poc_type = reader.readUE();
+    if (sps.poc_type == 0) {
+        sps.log2_max_poc_lsb = reader.readUE() + 4;
+    }
+    else if (sps.poc_type == 1) {
+        sps.delta_pic_order_always_zero = reader.readFlag();
+        reader.readSE(); // offset_for_non_ref_pic
+        reader.readSE(); // offset_for_top_to_bottom_field
+        const uint32_t cycle = reader.readUE();
+        for (uint32_t i = 0; i < cycle && !reader.overflow(); i++) {
+            reader.readSE();
+        }
+    }
+    reader.readUE();   // max_num_ref_frames
+    reader.readFlag(); // gaps_in_frame_num_value_allowed_flag
+    reader.readUE();   // pic_width_in_mbs_minus1
+    reader.readUE();   // pic_height_in_map_units_minus1
+    sps.frame_mbs_only = reader.readFlag();
+    if (reader.overflow() || sps.log2_max_frame_num > 16 || sps.log2_max_poc_lsb > 16) {
+        return false;
+    }
+    sps_[sps_id] = sps;
+    return true;
+}
+
+bool H264SliceParser::parsePps(const std::vector<uint8_t>& rbsp) {
+    BitReader reader{rbsp};
+    const uint32_t pps_id = reader.readUE();
+    Pps pps;
+    pps.sps_id = reader.readUE();
+    reader.readFlag(); // entropy_coding_mode_flag
+    pps.bottom_field_pic_order_in_frame_present = reader.readFlag();
+    if (reader.readUE() != 0) {
+        // num_slice_groups_minus1, FMO只在baseline的扩展里有, 不支持
+        return false;
+    }
+    reader.readUE(); // num_ref_idx_l0_default_active_minus1
+    reader.readUE(); // num_ref_idx_l1_default_active_minus1
+    pps.weighted_pred = reader.readFlag();
+    pps.weighted_bipred_idc = reader.readBits(2);
+    reader.readSE();   // pic_init_qp_minus26
+    reader.readSE();   // pic_init_qs_minus26
+    reader.readSE();   // chroma_qp_index_offset
+    reader.readFlag(); // deblocking_filter_control_present_flag
+    reader.readFlag(); // constrained_intra_pred_flag
+    pps.redundant_pic_cnt_present = reader.readFlag();
+    if (reader.overflow()) {
+        return false;
+    }
+    pps_[pps_id] = pps;
+    return true;
+}
+
+std::optional<H264SliceParser::SliceInfo>
+H264SliceParser::parseSlice(const std::vector<uint8_t>& rbsp, uint8_t nal_header) {
+    BitReader reader{rbsp};
+    SliceInfo info;
+    info.idr = (nal_header & 0x1f) == 5;
+    info.reference = (nal_header >> 5) != 0;
+    reader.readUE(); // first_mb_in_slice
+    const uint32_t slice_type = reader.readUE() % 5;
+    const bool is_p = slice_type == 0 || slice_type == 3;
+    const bool is_b = slice_type == 1;
+    const bool is_i = slice_type == 2 || slice_type == 4;
+    auto pps_iter = pps_.find(reader.readUE());
+    if (pps_iter == pps_.end()) {
+        return std::nullopt;
+    }
+    const Pps& pps = pps_iter->second;
+    auto sps_iter = sps_.find(pps.sps_id);
+    if (sps_iter == sps_.end()) {
+        return std::nullopt;
+    }
+    const Sps& sps = sps_iter->second;
+    if (sps.separate_colour_plane) {
+        reader.readBits(2); // colour_plane_id
+    }
+    info.frame_num = reader.readBits(sps.log2_max_frame_num);
+    bool field_pic = false;
+    if (!sps.frame_mbs_only) {
+        field_pic = reader.readFlag();
+        if (field_pic) {
+            reader.readFlag(); // bottom_field_flag
+        }
+    }
+    if (info.idr) {
+        info.idr_pic_id = reader.readUE();
+    }
+    if (sps.poc_type == 0) {
+        reader.readBits(sps.log2_max_poc_lsb);
+        if (pps.bottom_field_pic_order_in_frame_present && !field_pic) {
+            reader.readSE(); // delta_pic_order_cnt_bottom
+        }
+    }
+    else if (sps.poc_type == 1 && !sps.delta_pic_order_always_zero) {
+        reader.readSE();
+        if (pps.bottom_field_pic_order_in_frame_present && !field_pic) {
+            reader.readSE();
+        }
+    }
+    if (pps.redundant_pic_cnt_present) {
+        reader.readUE();
+    }
+    if (is_b) {
+        reader.readFlag(); // direct_spatial_mv_pred_flag
+    }
+    if (is_p || is_b) {
+        if (reader.readFlag()) { // num_ref_idx_active_override_flag
+            reader.readUE();
+            if (is_b) {
+                reader.readUE();
+            }
+        }
+    }
+    // ref_pic_list_modification
+    for (uint32_t list = 0; list < (is_b ? 2u : is_i ? 0u : 1u); list++) {
+        if (!reader.readFlag()) {
+            continue;
+        }
+        uint32_t idc = 0;
+        do {
+            idc = reader.readUE();
+            if (idc <= 2) {
+                reader.readUE(); // abs_diff_pic_num_minus1 / long_term_pic_num
+            }
+        } while (idc != 3 && !reader.overflow());
+    }
+    if ((pps.weighted_pred && is_p) || (pps.weighted_bipred_idc == 1 && is_b)) {
+        return std::nullopt;
+    }
+    // dec_ref_pic_marking
+    if (info.reference) {
+        if (info.idr) {
+            reader.readFlag(); // no_output_of_prior_pics_flag
+            info.long_term = reader.readFlag();
+        }
+        else if (reader.readFlag()) { // adaptive_ref_pic_marking_mode_flag
+            uint32_t mmco = 0;
+            do {
+                mmco = reader.readUE();
+                if (mmco == 1 || mmco == 3) {
+                    reader.readUE(); // difference_of_pic_nums_minus1
+                }
+                if (mmco == 2) {
+                    reader.readUE(); // long_term_pic_num
+                }
+                if (mmco == 3 || mmco == 6) {
+                    reader.readUE(); // long_term_frame_idx
+                }
+                if (mmco == 4) {
+                    reader.readUE(); // max_long_term_frame_idx_plus1
+                }
+                if (mmco == 6) {
+                    // 当前帧标记为长期参考
+                    info.long_term = true;
+                }
+            } while (mmco != 0 && !reader.overflow());
+        }
+    }
+    if (reader.overflow()) {
+        return std::nullopt;
+    }
+    return info;
+}
+
+std::vector<uint8_t> makeRecoverySei(uint64_t last_good_picture_id) {
+    std::vector<uint8_t> payload;
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        payload.push_back(static_cast<uint8_t>(last_good_picture_id >> shift));
+    }
+    return makeUserDataSei(kRecoverySeiUuid, payload);
+}
+
+bool isRecoverySei(const uint8_t* nal, uint32_t size) {
+    return isUserDataSei(nal, size, kRecoverySeiUuid);
+}
+
+std::vector<uint8_t> makeTemporalLayerSei(const TemporalLayerInfo& info) {
+    const std::vector<uint8_t> payload{static_cast<uint8_t>(info.temporal_id),
+                                       static_cast<uint8_t>(info.ref_distance >> 8),
+                                       static_cast<uint8_t>(info.ref_distance)};
+    return makeUserDataSei(kTemporalLayerSeiUuid, payload);
+}
+
+std::optional<TemporalLayerInfo> findTemporalLayerSei(const uint8_t* data, uint32_t size) {
+    if (data == nullptr) {
+        return std::nullopt;
+    }
+    for (uint32_t pos = nextNal(data, size, 0); pos < size; pos = nextNal(data, size, pos)) {
+        const uint8_t nal_type = data[pos] & 0x1f;
+        if (nal_type >= 1 && nal_type <= 5) {
+            // SEI必须在VCL之前
+            return std::nullopt;
+        }
+        if (!isUserDataSei(data + pos, size - pos, kTemporalLayerSeiUuid)) {
+            continue;
+        }
+        // 负载里可能有防竞争字节
+        const std::vector<uint8_t> rbsp = toRbsp(data, size, pos);
+        constexpr size_t kPayloadOffset = 2 + kUuidSize;
+        if (rbsp.size() < kPayloadOffset + 3) {
+            return std::nullopt;
+        }
+        TemporalLayerInfo info;
+        info.temporal_id = rbsp[kPayloadOffset];
+        info.ref_distance = (static_cast<uint32_t>(rbsp[kPayloadOffset + 1]) << 8) |
+                            rbsp[kPayloadOffset + 2];
+        return info;
+    }
+    return std::nullopt;
+}
+
+std::vector<uint8_t> makeProbeFrame(uint32_t size) {
+    std::vector<uint8_t> frame = makeUserDataSei(kProbeSeiUuid, {});
+    // 填充数据NAL: 若干0xff加上rbsp_trailing_bits, 解码器会直接跳过
+    const size_t filler_begin = frame.size();
+    frame.insert(frame.end(), {0, 0, 0, 1, kNalFillerData});
+    if (size > frame.size() + 1) {
+        frame.resize(size - 1, 0xff);
+    }
+    if (frame.size() == filler_begin + 5) {
+        frame.push_back(0xff);
+    }
+    frame.push_back(0x80);
+    return frame;
+}
+
+bool isProbeFrame(const uint8_t* data, uint32_t size) {
+    if (data == nullptr) {
+        return false;
+    }
+    const uint32_t pos = nextNal(data, size, 0);
+    return pos < size && isUserDataSei(data + pos, size - pos, kProbeSeiUuid);
+}
+
+} // namespace video
+
+} // namespace lt
@@ -0,0 +1,113 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+namespace lt {
+
+namespace video {
+
+// 解析H264 slice header里和参考帧管理有关的字段. 编码端用它从自己的输出里拿到
+// frame_num/idr_pic_id, 做长期参考帧(LTR)的确认和恢复.
+// 不支持多slice group和加权预测, 遇到时返回nullopt.
+class H264SliceParser {
+public:
+    struct SliceInfo {
+        bool idr = false;
+        uint32_t idr_pic_id = 0;
+        uint32_t frame_num = 0;
+        // 这一帧被标记成了长期参考帧
+        bool long_term = false;
+        // nal_ref_idc不为0, 后面的帧可能参考它
+        bool reference = false;
+    };
+
+public:
+    // data是一个完整的Annex-B access unit, 里面的SPS/PPS会被记下来给后面的帧用
+    std::optional<SliceInfo> parse(const uint8_t* data, uint32_t size);
+
+private:
+    struct Sps {
+        bool separate_colour_plane = false;
+        uint32_t log2_max_frame_num = 0;
+        uint32_t poc_type = 0;
+        uint32_t log2_max_poc_lsb = 0;
+        bool delta_pic_order_always_zero = false;
+        bool frame_mbs_only = true;
+    };
+    struct Pps {
+        uint32_t sps_id = 0;
+        bool bottom_field_pic_order_in_frame_present = false;
+        bool weighted_pred = false;
+        uint32_t weighted_bipred_idc = 0;
+        bool redundant_pic_cnt_present = false;
+    };
+
+    bool parseSps(const std::vector<uint8_t>& rbsp);
+    bool parsePps(const std::vector<uint8_t>& rbsp);
+    std::optional<SliceInfo> parseSlice(const std::vector<uint8_t>& rbsp, uint8_t nal_header);
+
+private:
+    std::map<uint32_t, Sps> sps_;
+    std::map<uint32_t, Pps> pps_;
+};
+
+// 恢复帧: 编码端收到丢帧反馈后, 只参考客户端确认过的帧编出来的P帧.
+// 编码端在它前面插一个SEI(user_data_unregistered), 客户端看到后不用再等关键帧.
+std::vector<uint8_t> makeRecoverySei(uint64_t last_good_picture_id);
+
+// nal指向NAL头(起始码之后), size到码流结尾为止
+bool isRecoverySei(const uint8_t* nal, uint32_t size);
+
+// 开启时域分层时编码端在每一帧前面插入的SEI.
+// 客户端靠它判断中间缺的帧(被发送端按层丢掉, 或者网络上丢了)是不是这一帧的参考帧
+struct TemporalLayerInfo {
+    uint32_t temporal_id = 0;
+    // 参考帧的picture_id = 这一帧的picture_id - ref_distance, 0表示不参考其他帧
+    uint32_t ref_distance = 0;
+};
+
+std::vector<uint8_t> makeTemporalLayerSei(const TemporalLayerInfo& info);
+
+// data是一个完整的Annex-B access unit, 只看第一个VCL NAL之前的SEI
+std::optional<TemporalLayerInfo> findTemporalLayerSei(const uint8_t* data, uint32_t size);
+
+// 带宽探测包: 探测SEI加上填充数据, 没有VCL NAL. 客户端收到后不解码, 带着到达时间直接确认.
+// 返回的大小等于size, size放不下SEI时取最小的合法长度
+std::vector<uint8_t> makeProbeFrame(uint32_t size);
+
+bool isProbeFrame(const uint8_t* data, uint32_t size);
+
+} // namespace video
+
+} // namespace lt
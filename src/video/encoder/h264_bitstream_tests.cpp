@@ -0,0 +1,368 @@
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <video/encoder/h264_bitstream.h>
+
+using lt::video::H264SliceParser;
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+class BitWriter {
+public:
+    BitWriter& bits(uint32_t value, uint32_t n) {
+        for (uint32_t i = n; i > 0; i--) {
+            bit((value >> (i - 1)) & 1);
+        }
+        return *this;
+    }
+    BitWriter& flag(bool value) { return bits(value ? 1 : 0, 1); }
+    BitWriter& ue(uint32_t value) {
+        const uint64_t code = static_cast<uint64_t>(value) + 1;
+        uint32_t len = 0;
+        while ((code >> len) > 1) {
+            len++;
+        }
+        bits(0, len);
+        return bits(static_cast<uint32_t>(code), len + 1);
+    }
+    BitWriter& se(int32_t value) {
+        return ue(value > 0 ? static_cast<uint32_t>(value) * 2 - 1
+                            : static_cast<uint32_t>(-value) * 2);
+    }
+
+    // 加上rbsp_trailing_bits, 防竞争字节和起始码
+    Bytes nal(uint8_t header) {
+        Bytes rbsp = bytes_;
+        rbsp.push_back(static_cast<uint8_t>(current_ << (8 - bit_count_) | (0x80 >> bit_count_)));
+        Bytes out{0x00, 0x00, 0x00, 0x01, header};
+        uint32_t zeros = 0;
+        for (uint8_t byte : rbsp) {
+            if (zeros >= 2 && byte <= 3) {
+                out.push_back(0x03);
+                zeros = 0;
+            }
+            out.push_back(byte);
+            zeros = byte == 0 ? zeros + 1 : 0;
+        }
+        return out;
+    }
+
+private:
+    void bit(uint32_t b) {
+        current_ = static_cast<uint8_t>(current_ << 1 | b);
+        if (++bit_count_ == 8) {
+            bytes_.push_back(current_);
+            current_ = 0;
+            bit_count_ = 0;
+        }
+    }
+
+private:
+    Bytes bytes_;
+    uint8_t current_ = 0;
+    uint32_t bit_count_ = 0;
+};
+
+Bytes concat(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const auto& p : parts) {
+        out.insert(out.end(), p.begin(), p.end());
+    }
+    return out;
+}
+
+bool containsEscape(const Bytes& nal) {
+    for (size_t i = 4; i + 2 < nal.size(); i++) {
+        if (nal[i] == 0 && nal[i + 1] == 0 && nal[i + 2] == 3) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// OpenH264的baseline配置: poc_type 2, frame_num 4位
+Bytes baselineSps() {
+    return BitWriter{}
+        .bits(66, 8)
+        .bits(0xc0, 8)
+        .bits(31, 8)
+        .ue(0)
+        .ue(0)
+        .ue(2)
+        .ue(3)
+        .flag(false)
+        .ue(39)
+        .ue(22)
+        .flag(true)
+        .flag(true)
+        .flag(false)
+        .flag(false)
+        .nal(0x67);
+}
+
+Bytes pps(bool weighted_pred = false) {
+    return BitWriter{}
+        .ue(0)
+        .ue(0)
+        .flag(false)
+        .flag(false)
+        .ue(0)
+        .ue(0)
+        .ue(0)
+        .flag(weighted_pred)
+        .bits(0, 2)
+        .se(0)
+        .se(0)
+        .se(0)
+        .flag(true)
+        .flag(false)
+        .flag(false)
+        .nal(0x68);
+}
+
+Bytes idrSlice(uint32_t idr_pic_id, bool long_term) {
+    return BitWriter{}
+        .ue(0)
+        .ue(7)
+        .ue(0)
+        .bits(0, 4)
+        .ue(idr_pic_id)
+        .flag(false)
+        .flag(long_term)
+        .ue(12)
+        .nal(0x65);
+}
+
+// mark_long_term: 用MMCO 6把当前帧标记为长期参考帧
+Bytes pSlice(uint32_t frame_num, bool mark_long_term) {
+    BitWriter writer;
+    writer.ue(0).ue(5).ue(0).bits(frame_num, 4);
+    writer.flag(false); // num_ref_idx_active_override_flag
+    writer.flag(false); // ref_pic_list_modification_flag_l0
+    writer.flag(mark_long_term);
+    if (mark_long_term) {
+        writer.ue(6).ue(0).ue(0);
+    }
+    return writer.ue(3).nal(0x41);
+}
+
+std::optional<H264SliceParser::SliceInfo> parse(H264SliceParser& parser, const Bytes& au) {
+    return parser.parse(au.data(), static_cast<uint32_t>(au.size()));
+}
+
+} // namespace
+
+TEST(H264SliceParserTest, ParsesIdr) {
+    H264SliceParser parser;
+    auto info = parse(parser, concat({baselineSps(), pps(), idrSlice(3, true)}));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_TRUE(info->idr);
+    EXPECT_EQ(info->idr_pic_id, 3u);
+    EXPECT_EQ(info->frame_num, 0u);
+    EXPECT_TRUE(info->long_term);
+    EXPECT_TRUE(info->reference);
+
+    info = parse(parser, concat({baselineSps(), pps(), idrSlice(4, false)}));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->idr_pic_id, 4u);
+    EXPECT_FALSE(info->long_term);
+}
+
+TEST(H264SliceParserTest, ParsesPSliceWithLongTermMarking) {
+    H264SliceParser parser;
+    ASSERT_TRUE(parse(parser, concat({baselineSps(), pps(), idrSlice(0, true)})).has_value());
+    // P帧里没有参数集, 用之前记下来的
+    auto info = parse(parser, pSlice(5, false));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_FALSE(info->idr);
+    EXPECT_EQ(info->frame_num, 5u);
+    EXPECT_FALSE(info->long_term);
+
+    info = parse(parser, pSlice(6, true));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->frame_num, 6u);
+    EXPECT_TRUE(info->long_term);
+}
+
+TEST(H264SliceParserTest, ParsesNonReferenceSlice) {
+    H264SliceParser parser;
+    ASSERT_TRUE(parse(parser, concat({baselineSps(), pps(), idrSlice(0, false)})).has_value());
+    // nal_ref_idc为0, 没有dec_ref_pic_marking
+    const Bytes slice =
+        BitWriter{}.ue(0).ue(5).ue(0).bits(2, 4).flag(false).flag(false).ue(3).nal(0x01);
+    auto info = parse(parser, slice);
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->frame_num, 2u);
+    EXPECT_FALSE(info->reference);
+    EXPECT_FALSE(info->long_term);
+}
+
+TEST(H264SliceParserTest, RemovesEmulationPrevention) {
+    H264SliceParser parser;
+    ASSERT_TRUE(parse(parser, concat({baselineSps(), pps(), idrSlice(0, false)})).has_value());
+    // first_mb_in_slice前面有23个0, 编出来是00 00 01, 必须插入防竞争字节
+    const Bytes slice = BitWriter{}
+                            .ue((1u << 23) - 1)
+                            .ue(5)
+                            .ue(0)
+                            .bits(7, 4)
+                            .flag(false)
+                            .flag(false)
+                            .flag(true)
+                            .ue(6)
+                            .ue(0)
+                            .ue(0)
+                            .nal(0x41);
+    ASSERT_TRUE(containsEscape(slice));
+    auto info = parse(parser, slice);
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->frame_num, 7u);
+    EXPECT_TRUE(info->long_term);
+}
+
+TEST(H264SliceParserTest, ParsesHighProfileSps) {
+    // profile 100, 带scaling matrix, poc_type 0
+    BitWriter writer;
+    writer.bits(100, 8).bits(0, 8).bits(40, 8).ue(1);
+    writer.ue(1).ue(0).ue(0).flag(false).flag(true);
+    writer.flag(true);
+    for (int i = 0; i < 16; i++) {
+        writer.se(0);
+    }
+    for (int i = 1; i < 8; i++) {
+        writer.flag(false);
+    }
+    writer.ue(2).ue(0).ue(2).ue(4).flag(false).ue(119).ue(67).flag(true).flag(true).flag(false);
+    writer.flag(false);
+    const Bytes sps = writer.nal(0x67);
+    const Bytes pps1 = BitWriter{}
+                           .ue(1)
+                           .ue(1)
+                           .flag(true)
+                           .flag(false)
+                           .ue(0)
+                           .ue(0)
+                           .ue(0)
+                           .flag(false)
+                           .bits(0, 2)
+                           .se(0)
+                           .se(0)
+                           .se(0)
+                           .flag(true)
+                           .flag(false)
+                           .flag(false)
+                           .nal(0x68);
+    // frame_num 6位, pic_order_cnt_lsb 6位
+    const Bytes slice = BitWriter{}
+                            .ue(0)
+                            .ue(5)
+                            .ue(1)
+                            .bits(33, 6)
+                            .bits(17, 6)
+                            .flag(false)
+                            .flag(false)
+                            .flag(false)
+                            .ue(0)
+                            .nal(0x41);
+    H264SliceParser parser;
+    auto info = parse(parser, concat({sps, pps1, slice}));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->frame_num, 33u);
+    EXPECT_FALSE(info->long_term);
+}
+
+TEST(H264SliceParserTest, RejectsUnknownParameterSetsAndWeightedPrediction) {
+    H264SliceParser parser;
+    EXPECT_FALSE(parse(parser, pSlice(1, false)).has_value());
+    EXPECT_FALSE(parse(parser, concat({baselineSps(), pps(true), pSlice(1, false)})).has_value());
+    EXPECT_FALSE(parser.parse(nullptr, 0).has_value());
+}
+
+TEST(H264RecoverySeiTest, RoundTrip) {
+    for (uint64_t picture_id : {0ull, 0x100ull, 0x0102030405060708ull, ~0ull}) {
+        const Bytes sei = lt::video::makeRecoverySei(picture_id);
+        ASSERT_GT(sei.size(), 4u);
+        EXPECT_EQ(sei[4], 0x06);
+        // 负载里不能出现起始码
+        for (size_t i = 4; i + 2 < sei.size(); i++) {
+            EXPECT_FALSE(sei[i] == 0 && sei[i + 1] == 0 && sei[i + 2] <= 2) << picture_id;
+        }
+        EXPECT_TRUE(
+            lt::video::isRecoverySei(sei.data() + 4, static_cast<uint32_t>(sei.size() - 4)));
+    }
+}
+
+TEST(H264RecoverySeiTest, OtherSeiIsNotRecovery) {
+    const Bytes sei = {0x06, 0x05, 0x10, 0xb9, 0xed, 0xb9, 0x30, 0x80};
+    EXPECT_FALSE(lt::video::isRecoverySei(sei.data(), static_cast<uint32_t>(sei.size())));
+    const Bytes recovery = lt::video::makeRecoverySei(1);
+    EXPECT_FALSE(lt::video::isRecoverySei(recovery.data(), 4));
+    // 同样的负载放在slice里不算
+    Bytes slice{recovery.begin() + 4, recovery.end()};
+    slice[0] = 0x41;
+    EXPECT_FALSE(lt::video::isRecoverySei(slice.data(), static_cast<uint32_t>(slice.size())));
+}
+
+TEST(H264TemporalLayerSeiTest, RoundTrip) {
+    const Bytes slice = pSlice(1, false);
+    for (uint32_t temporal_id : {0u, 1u, 2u}) {
+        for (uint32_t ref_distance : {0u, 1u, 2u, 4u, 0x100u, 0xffffu}) {
+            const Bytes sei = lt::video::makeTemporalLayerSei({temporal_id, ref_distance});
+            const Bytes au = concat({sei, slice});
+            auto info =
+                lt::video::findTemporalLayerSei(au.data(), static_cast<uint32_t>(au.size()));
+            ASSERT_TRUE(info.has_value()) << temporal_id << " " << ref_distance;
+            EXPECT_EQ(info->temporal_id, temporal_id);
+            EXPECT_EQ(info->ref_distance, ref_distance);
+        }
+    }
+}
+
+TEST(H264TemporalLayerSeiTest, FoundAfterOtherSeiAndParameterSets) {
+    const Bytes au = concat({baselineSps(), pps(), lt::video::makeRecoverySei(7),
+                             lt::video::makeTemporalLayerSei({1, 2}), pSlice(1, false)});
+    auto info = lt::video::findTemporalLayerSei(au.data(), static_cast<uint32_t>(au.size()));
+    ASSERT_TRUE(info.has_value());
+    EXPECT_EQ(info->temporal_id, 1u);
+    EXPECT_EQ(info->ref_distance, 2u);
+}
+
+TEST(H264TemporalLayerSeiTest, IgnoresSeiAfterSliceAndMissingSei) {
+    const Bytes slice = pSlice(1, false);
+    const Bytes after = concat({slice, lt::video::makeTemporalLayerSei({1, 2})});
+    EXPECT_FALSE(
+        lt::video::findTemporalLayerSei(after.data(), static_cast<uint32_t>(after.size())));
+    const Bytes recovery = concat({lt::video::makeRecoverySei(1), slice});
+    EXPECT_FALSE(
+        lt::video::findTemporalLayerSei(recovery.data(), static_cast<uint32_t>(recovery.size())));
+    EXPECT_FALSE(lt::video::findTemporalLayerSei(nullptr, 0));
+}
+
+TEST(H264ProbeFrameTest, MakesFramesOfRequestedSize) {
+    for (uint32_t size : {0u, 1u, 64u, 1200u, 65536u}) {
+        const Bytes frame = lt::video::makeProbeFrame(size);
+        if (size >= 64) {
+            EXPECT_EQ(frame.size(), size);
+        }
+        EXPECT_TRUE(lt::video::isProbeFrame(frame.data(), static_cast<uint32_t>(frame.size())));
+        // 不能被当成视频帧
+        H264SliceParser parser;
+        EXPECT_FALSE(parser.parse(frame.data(), static_cast<uint32_t>(frame.size())).has_value());
+        EXPECT_FALSE(
+            lt::video::findTemporalLayerSei(frame.data(), static_cast<uint32_t>(frame.size())));
+    }
+}
+
+TEST(H264ProbeFrameTest, OtherFramesAreNotProbes) {
+    const Bytes au = concat({baselineSps(), pps(), idrSlice(0, false)});
+    EXPECT_FALSE(lt::video::isProbeFrame(au.data(), static_cast<uint32_t>(au.size())));
+    const Bytes recovery = concat({lt::video::makeRecoverySei(1), pSlice(1, false)});
+    EXPECT_FALSE(lt::video::isProbeFrame(recovery.data(), static_cast<uint32_t>(recovery.size())));
+    EXPECT_FALSE(lt::video::isProbeFrame(nullptr, 0));
+}
@@ -32,6 +32,8 @@
 #include "intel_encoder.h"
 #include "intel_allocator.h"
 
+#include <cstring>
+
 #include <d3d11.h>
 #include <wrl/client.h>
 
@@ -249,8 +251,8 @@ public:
     uint32_t width() const { return params_.width(); }
     uint32_t height() const { return params_.height(); }
     VideoCodecType codecType() const;
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeOneFrame(void* input_frame,
-                                                                       bool request_iframe);
+    std::optional<EncodedFrame> encodeOneFrame(void* input_frame, bool request_iframe,
+                                               ltlib::BufferPool& pool);
 
 private:
     bool createMfxSession();
@@ -384,8 +386,8 @@ VideoCodecType IntelEncoderImpl::codecType() const {
     return codec_type_;
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-IntelEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
+std::optional<EncodedFrame>
+IntelEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe, ltlib::BufferPool& pool) {
     mfxSyncPoint sync_point{};
     const uint32_t buffer_size =
         1000 * encode_param_.mfx.BufferSizeInKB * encode_param_.mfx.BRCParamMultiplier;
@@ -424,7 +426,7 @@ IntelEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
         }
         else {
             LOG(INFO) << "MFXVideoENCODE_EncodeFrameAsync failed with " << status;
-            return nullptr;
+            return std::nullopt;
         }
     }
     status = MFX_WRN_IN_EXECUTION;
@@ -435,16 +437,18 @@ IntelEncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
         }
         else if (status < MFX_ERR_NONE) {
             LOG(INFO) << "MFXVideoCORE_SyncOperation failed with " << status;
-            return nullptr;
+            return std::nullopt;
         }
         else {
             std::this_thread::sleep_for(std::chrono::milliseconds{1});
         }
     }
     bool is_keyframe = (bs.FrameType & MFX_FRAMETYPE_I) || (bs.FrameType & MFX_FRAMETYPE_IDR);
-    auto out_frame = std::make_shared<ltproto::client2worker::VideoFrame>();
-    out_frame->set_frame(bitstream_.data(), bs.DataLength);
-    out_frame->set_is_keyframe(is_keyframe);
+    EncodedFrame out_frame{};
+    out_frame.buffer = pool.acquire(bs.DataLength);
+    out_frame.size = bs.DataLength;
+    memcpy(out_frame.buffer.get(), bitstream_.data(), out_frame.size);
+    out_frame.is_keyframe = is_keyframe;
     return out_frame;
 }
 
@@ -643,6 +647,7 @@ std::unique_ptr<IntelEncoder> IntelEncoder::create(const EncodeParamsHelper& par
         return nullptr;
     }
     encoder->impl_ = impl;
+    encoder->initOutputPool(params.bitrate(), static_cast<uint32_t>(params.fps()));
     return encoder;
 }
 
@@ -666,8 +671,8 @@ uint32_t IntelEncoder::height() const {
     return impl_->height();
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame> IntelEncoder::encodeFrame(void* input_frame) {
-    return impl_->encodeOneFrame(input_frame, needKeyframe());
+std::optional<EncodedFrame> IntelEncoder::encodeFrame(void* input_frame) {
+    return impl_->encodeOneFrame(input_frame, needKeyframe(), outputPool());
 }
 
 ColorMatrix IntelEncoder::colorMatrix() const {
@@ -0,0 +1,205 @@
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <optional>
+
+#include <gtest/gtest.h>
+
+#include <ltproto/client2worker/video_frame.pb.h>
+
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/decoder/video_decoder.h>
+#include <video/drpipeline/decode_queue.h>
+#include <video/encoder/openh264_encoder.h>
+
+namespace {
+
+using lt::VideoCodecType;
+using lt::video::DecodeQueue;
+using lt::video::FrameKind;
+using lt::video::OpenH264Encoder;
+using lt::video::SyntheticCapturer;
+
+constexpr uint32_t kWidth = 640;
+constexpr uint32_t kHeight = 360;
+constexpr int kFps = 30;
+constexpr int64_t kFrameIntervalUs = 1'000'000 / kFps;
+// 客户端到编码端的反馈(确认和关键帧请求)晚几帧才到
+constexpr uint64_t kFeedbackDelayFrames = 3;
+// 在第一个LTR被确认之后丢帧
+constexpr uint64_t kLostPictureID = 75;
+constexpr uint64_t kFrames = 150;
+
+struct Feedback {
+    uint64_t arrive_at;
+    std::optional<uint64_t> acked_picture_id;
+    bool request_keyframe;
+};
+
+struct RecoveryResult {
+    // 丢帧之后第一个能解码的帧
+    FrameKind recovery_kind = FrameKind::Unknown;
+    size_t recovery_bytes = 0;
+    // 从丢帧到重新解码出画面经过的帧数
+    int64_t recovery_frames = -1;
+    // 丢帧之后一秒内编出来的总字节数
+    size_t bytes_after_loss = 0;
+    uint64_t decode_failures = 0;
+    uint64_t keyframes = 0;
+};
+
+std::unique_ptr<OpenH264Encoder> createEncoder(bool long_term_reference) {
+    lt::video::EncodeParamsHelper params{nullptr,
+                                         nullptr,
+                                         -1,
+                                         VideoCodecType::H264_420,
+                                         kWidth,
+                                         kHeight,
+                                         kFps,
+                                         2 * 1000 * 1000,
+                                         true,
+                                         lt::ColorPrimaries::BT709,
+                                         lt::TransferCharacteristics::BT709,
+                                         lt::ColorMatrix::BT601,
+                                         false};
+    OpenH264Encoder::Options options{};
+    options.threads = 1;
+    options.long_term_reference = long_term_reference;
+    return OpenH264Encoder::create(params, options);
+}
+
+// 编码端 -> 丢包的网络 -> DecodeQueue -> 解码器, 确认和关键帧请求按VCEPipeline的方式处理
+std::optional<RecoveryResult> runWithLoss(bool long_term_reference) {
+    auto encoder = createEncoder(long_term_reference);
+    if (encoder == nullptr) {
+        return std::nullopt;
+    }
+    SyntheticCapturer::Params capture_params{};
+    capture_params.width = kWidth;
+    capture_params.height = kHeight;
+    capture_params.fps = kFps;
+    capture_params.content = SyntheticCapturer::Content::ScrollingText;
+    auto capturer = SyntheticCapturer::create(capture_params);
+    if (capturer == nullptr || !capturer->setCaptureFormat(encoder->captureFormat())) {
+        return std::nullopt;
+    }
+    lt::video::Decoder::Params decode_params{};
+    decode_params.codec_type = VideoCodecType::H264_420_SOFT;
+    decode_params.width = kWidth;
+    decode_params.height = kHeight;
+    decode_params.va_type = lt::VaType::None;
+    auto decoder = lt::video::Decoder::create(decode_params);
+    if (decoder == nullptr) {
+        return std::nullopt;
+    }
+    DecodeQueue::Params queue_params{};
+    queue_params.codec = VideoCodecType::H264_420_SOFT;
+    DecodeQueue queue{queue_params};
+
+    RecoveryResult result;
+    std::deque<Feedback> feedbacks;
+    std::optional<uint64_t> last_acked;
+    std::optional<uint64_t> last_recovery;
+    bool lost = false;
+    for (uint64_t step = 0; step < kFrames; step++) {
+        const int64_t now_us = static_cast<int64_t>(step) * kFrameIntervalUs;
+        while (!feedbacks.empty() && feedbacks.front().arrive_at <= step) {
+            const Feedback& feedback = feedbacks.front();
+            if (feedback.acked_picture_id.has_value() &&
+                (!last_acked.has_value() || feedback.acked_picture_id > last_acked)) {
+                last_acked = feedback.acked_picture_id;
+                encoder->onFrameAcked(last_acked.value());
+            }
+            if (feedback.request_keyframe) {
+                if (last_acked.has_value() && last_acked != last_recovery &&
+                    encoder->recoverFrom(last_acked.value())) {
+                    last_recovery = last_acked;
+                }
+                else {
+                    encoder->requestKeyframe();
+                }
+            }
+            feedbacks.pop_front();
+        }
+
+        auto captured = capturer->capture();
+        if (!captured.has_value()) {
+            return std::nullopt;
+        }
+        auto encoded = encoder->encode(captured.value());
+        capturer->doneWithFrame();
+        if (!encoded.has_value()) {
+            return std::nullopt;
+        }
+        if (encoded->is_keyframe) {
+            result.keyframes++;
+        }
+        const uint64_t picture_id = encoded->picture_id;
+        if (picture_id >= kLostPictureID && picture_id < kLostPictureID + kFps) {
+            result.bytes_after_loss += encoded->size;
+        }
+        if (picture_id == kLostPictureID) {
+            lost = true;
+            continue;
+        }
+
+        DecodeQueue::Frame frame{};
+        frame.ltframe_id = picture_id;
+        frame.is_keyframe = encoded->is_keyframe;
+        frame.data = encoded->data();
+        frame.size = encoded->size;
+        queue.push(frame, now_us);
+        if (queue.needKeyframe(now_us)) {
+            feedbacks.push_back({step + kFeedbackDelayFrames, std::nullopt, true});
+        }
+        auto to_decode = queue.pop(now_us);
+        if (!to_decode.has_value()) {
+            continue;
+        }
+        auto decoded = decoder->decode(to_decode->data, to_decode->size);
+        if (decoded.status == lt::video::DecodeStatus::Failed) {
+            result.decode_failures++;
+            queue.onDecodeFailed();
+            continue;
+        }
+        if (lost && result.recovery_frames < 0) {
+            result.recovery_kind = to_decode->kind;
+            result.recovery_bytes = to_decode->size;
+            result.recovery_frames = static_cast<int64_t>(picture_id - kLostPictureID);
+        }
+        feedbacks.push_back({step + kFeedbackDelayFrames, picture_id, false});
+    }
+    return result;
+}
+
+TEST(LtrRecoveryTest, RecoversFromLongTermReferenceInsteadOfIdr) {
+    auto idr = runWithLoss(false);
+    if (!idr.has_value()) {
+        GTEST_SKIP() << "OpenH264 or ffmpeg is not available";
+    }
+    auto ltr = runWithLoss(true);
+    ASSERT_TRUE(ltr.has_value());
+    std::printf("IDR recovery: %lld frames, recovery frame %zu bytes, %zu bytes in 1s after loss\n",
+                static_cast<long long>(idr->recovery_frames), idr->recovery_bytes,
+                idr->bytes_after_loss);
+    std::printf("LTR recovery: %lld frames, recovery frame %zu bytes, %zu bytes in 1s after loss\n",
+                static_cast<long long>(ltr->recovery_frames), ltr->recovery_bytes,
+                ltr->bytes_after_loss);
+
+    ASSERT_GE(idr->recovery_frames, 0);
+    EXPECT_EQ(idr->recovery_kind, FrameKind::Keyframe);
+    EXPECT_EQ(idr->keyframes, 2u);
+
+    ASSERT_GE(ltr->recovery_frames, 0);
+    EXPECT_EQ(ltr->recovery_kind, FrameKind::Recovery);
+    // 只有开头的IDR
+    EXPECT_EQ(ltr->keyframes, 1u);
+    EXPECT_EQ(ltr->decode_failures, 0u);
+    // 都是一个来回就恢复, 但是恢复帧是P帧, 比IDR小得多
+    EXPECT_LE(ltr->recovery_frames, idr->recovery_frames);
+    EXPECT_LT(ltr->recovery_bytes, idr->recovery_bytes);
+    EXPECT_LT(ltr->bytes_after_loss, idr->bytes_after_loss);
+}
+
+} // namespace
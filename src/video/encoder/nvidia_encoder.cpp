@@ -34,6 +34,7 @@
 #include <wrl/client.h>
 
 #include <cassert>
+#include <cstring>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -161,8 +162,8 @@ public:
     VideoCodecType codecType() const;
     uint32_t width() const { return params_.width(); }
     uint32_t height() const { return params_.height(); }
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeOneFrame(void* input_frame,
-                                                                       bool request_iframe);
+    std::optional<EncodedFrame> encodeOneFrame(void* input_frame, bool request_iframe,
+                                               ltlib::BufferPool& pool);
     ColorMatrix colorMatrix() const { return static_cast<ColorMatrix>(params_.color_matrix()); }
     bool fullRange() const { return params_.full_range(); }
 
@@ -283,11 +284,12 @@ VideoCodecType NvD3d11EncoderImpl::codecType() const {
     return codec_type_;
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-NvD3d11EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
+std::optional<EncodedFrame>
+NvD3d11EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe,
+                                   ltlib::BufferPool& pool) {
     auto mapped_resource = initInputFrame(input_frame);
     if (!mapped_resource.has_value()) {
-        return nullptr;
+        return std::nullopt;
     }
 
     NV_ENC_PIC_PARAMS params{};
@@ -304,7 +306,7 @@ NvD3d11EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
     if (status != NV_ENC_SUCCESS) {
         // include NV_ENC_ERR_NEED_MORE_INPUT
         LOG(ERR) << "nvEncEncodePicture failed with " << status;
-        return nullptr;
+        return std::nullopt;
     }
     NV_ENC_LOCK_BITSTREAM lbs = {NV_ENC_LOCK_BITSTREAM_VER};
     lbs.outputBitstream = bitstream_output_buffer_;
@@ -312,18 +314,20 @@ NvD3d11EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
     status = nvfuncs_.nvEncLockBitstream(nvencoder_, &lbs);
     if (status != NV_ENC_SUCCESS) {
         LOG(ERR) << "nvEncLockBitstream failed with " << status;
-        return nullptr;
+        return std::nullopt;
     }
-    auto out_frame = std::make_shared<ltproto::client2worker::VideoFrame>();
-    out_frame->set_frame(lbs.bitstreamBufferPtr, lbs.bitstreamSizeInBytes);
+    EncodedFrame out_frame{};
+    out_frame.buffer = pool.acquire(lbs.bitstreamSizeInBytes);
+    out_frame.size = lbs.bitstreamSizeInBytes;
+    memcpy(out_frame.buffer.get(), lbs.bitstreamBufferPtr, out_frame.size);
     status = nvfuncs_.nvEncUnlockBitstream(nvencoder_, lbs.outputBitstream);
     if (status != NV_ENC_SUCCESS) {
         LOG(ERR) << "nvEncUnlockBitstream failed with " << status;
-        return nullptr;
+        return std::nullopt;
     }
 
     if (!uninitInputFrame(mapped_resource.value())) {
-        return nullptr;
+        return std::nullopt;
     }
 
     NV_ENC_STAT encode_stats{};
@@ -332,7 +336,7 @@ NvD3d11EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
     nvfuncs_.nvEncGetEncodeStats(nvencoder_, &encode_stats);
     bool is_keyframe =
         encode_stats.picType == NV_ENC_PIC_TYPE_I || encode_stats.picType == NV_ENC_PIC_TYPE_IDR;
-    out_frame->set_is_keyframe(is_keyframe);
+    out_frame.is_keyframe = is_keyframe;
     return out_frame;
 }
 
@@ -521,6 +525,7 @@ std::unique_ptr<NvD3d11Encoder> NvD3d11Encoder::create(const EncodeParamsHelper&
         return nullptr;
     }
     encoder->impl_ = impl;
+    encoder->initOutputPool(params.bitrate(), static_cast<uint32_t>(params.fps()));
     return encoder;
 }
 
@@ -544,8 +549,8 @@ uint32_t NvD3d11Encoder::height() const {
     return impl_->height();
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame> NvD3d11Encoder::encodeFrame(void* input_frame) {
-    return impl_->encodeOneFrame(input_frame, needKeyframe());
+std::optional<EncodedFrame> NvD3d11Encoder::encodeFrame(void* input_frame) {
+    return impl_->encodeOneFrame(input_frame, needKeyframe(), outputPool());
 }
 
 ColorMatrix NvD3d11Encoder::colorMatrix() const {
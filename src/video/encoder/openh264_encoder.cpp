@@ -30,15 +30,32 @@
 
 #include "openh264_encoder.h"
 
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <thread>
+#include <vector>
+
 #include <wels/codec_api.h>
 
 #include <ltlib/load_library.h>
 #include <ltlib/logging.h>
 #include <ltlib/times.h>
 
+#include "h264_bitstream.h"
+
 namespace {
 
 constexpr int kMaxFPS = 30;
+// 同时保留的长期参考帧数量, 和每隔多少帧标记一个新的LTR
+constexpr int kLTRRefNum = 2;
+constexpr unsigned int kLTRMarkPeriod = 30;
+// 大约8秒, 确认或恢复请求比这更老就只能编IDR了
+constexpr size_t kMaxRefHistory = 256;
+constexpr uint32_t kMaxTemporalLayers = 3;
 
 class OpenH264ParamsHelper {
 public:
@@ -64,18 +81,36 @@ namespace video {
 
 class OpenH264EncoderImpl {
 public:
-    OpenH264EncoderImpl(const EncodeParamsHelper& params);
+    OpenH264EncoderImpl(const EncodeParamsHelper& params, const OpenH264Encoder::Options& options);
     ~OpenH264EncoderImpl();
     bool init();
     void reconfigure(const Encoder::ReconfigureParams& params);
     uint32_t width() const { return params_.width(); }
     uint32_t height() const { return params_.height(); }
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeOneFrame(void* input_frame,
-                                                                       bool request_iframe);
+    uint32_t threads() const { return threads_; }
+    uint32_t temporalLayers() const { return temporal_layers_; }
+    void onFrameAcked(uint64_t picture_id);
+    bool recoverFrom(uint64_t last_good_picture_id);
+    std::optional<EncodedFrame> encodeOneFrame(void* input_frame, bool request_iframe,
+                                               uint64_t picture_id, ltlib::BufferPool& pool);
+
+private:
+    struct RefFrame {
+        uint64_t picture_id;
+        uint32_t idr_pic_id;
+        uint32_t frame_num;
+        bool long_term;
+        bool acked;
+    };
 
 private:
     bool loadApi();
     void generateEncodeParams(const OpenH264ParamsHelper& helper, SEncParamExt& params);
+    void recordRefFrame(std::optional<H264SliceParser::SliceInfo> info, uint64_t picture_id);
+    std::optional<TemporalLayerInfo> layerInfo(uint32_t temporal_id, bool is_keyframe,
+                                               uint64_t picture_id) const;
+    void recordLayerRef(const std::optional<H264SliceParser::SliceInfo>& info, bool is_keyframe,
+                        uint32_t temporal_id, uint64_t picture_id);
 
 private:
     VideoCodecType codec_type_;
@@ -86,11 +121,36 @@ private:
     decltype(&WelsDestroySVCEncoder) destroy_encoder_ = nullptr;
     bool encoder_init_success_ = false;
     OpenH264ParamsHelper params_;
+    uint32_t threads_;
+    uint32_t max_slice_bytes_;
+    bool long_term_reference_;
+    uint32_t temporal_layers_;
+    H264SliceParser slice_parser_;
+    // 当前IDR之后编出来的帧, 按picture_id递增
+    std::deque<RefFrame> ref_history_;
+    std::optional<uint64_t> pending_recovery_;
+    // 每一层最近一个参考帧的picture_id, 当前IDR之前的不算
+    std::vector<std::optional<uint64_t>> layer_refs_;
 };
 
-OpenH264EncoderImpl::OpenH264EncoderImpl(const EncodeParamsHelper& params)
+OpenH264EncoderImpl::OpenH264EncoderImpl(const EncodeParamsHelper& params,
+                                         const OpenH264Encoder::Options& options)
     : codec_type_{params.codec()}
-    , params_{params} {}
+    , params_{params}
+    , threads_{options.threads}
+    , max_slice_bytes_{options.max_slice_bytes}
+    , long_term_reference_{options.long_term_reference}
+    , temporal_layers_{std::clamp(options.temporal_layers, 1u, kMaxTemporalLayers)}
+    , layer_refs_(temporal_layers_) {
+    if (temporal_layers_ > 1) {
+        // openh264的LTR和时域分层都要占用参考帧, 两者同时开启时恢复帧的参考关系算不清
+        long_term_reference_ = false;
+    }
+    if (threads_ == 0) {
+        threads_ = OpenH264Encoder::defaultThreads(params.width(), params.height(),
+                                                   std::thread::hardware_concurrency());
+    }
+}
 
 OpenH264EncoderImpl::~OpenH264EncoderImpl() {
     if (encoder_ != nullptr) {
@@ -127,6 +187,9 @@ bool OpenH264EncoderImpl::init() {
         return false;
     }
     encoder_init_success_ = true;
+    LOG(INFO) << "OpenH264 encoder " << params_.width() << "x" << params_.height() << ", threads "
+              << threads_ << ", max slice bytes " << max_slice_bytes_ << ", ltr "
+              << long_term_reference_ << ", temporal layers " << temporal_layers_;
     int option = EVideoFormatType::videoFormatI420;
     ret = encoder_->SetOption(ENCODER_OPTION_DATAFORMAT, &option);
     if (ret != 0) {
@@ -160,8 +223,128 @@ void OpenH264EncoderImpl::reconfigure(const Encoder::ReconfigureParams& params)
     }
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-OpenH264EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
+void OpenH264EncoderImpl::onFrameAcked(uint64_t picture_id) {
+    // 客户端按顺序解码, 能解出这一帧说明之前的帧也都解出来了
+    for (auto& frame : ref_history_) {
+        if (frame.picture_id > picture_id) {
+            break;
+        }
+        if (frame.acked) {
+            continue;
+        }
+        frame.acked = true;
+        if (!frame.long_term) {
+            continue;
+        }
+        SLTRMarkingFeedback feedback{};
+        feedback.uiFeedbackType = LTR_MARKING_SUCCESS;
+        feedback.uiIDRPicId = frame.idr_pic_id;
+        feedback.iLTRFrameNum = static_cast<int>(frame.frame_num);
+        feedback.iLayerId = 0;
+        int ret = encoder_->SetOption(ENCODER_LTR_MARKING_FEEDBACK, &feedback);
+        if (ret != 0) {
+            LOG(WARNING) << "ISVCEncoder::SetOption(ENCODER_LTR_MARKING_FEEDBACK) failed " << ret;
+        }
+    }
+}
+
+bool OpenH264EncoderImpl::recoverFrom(uint64_t last_good_picture_id) {
+    if (!long_term_reference_ || ref_history_.empty()) {
+        return false;
+    }
+    auto last_good = std::find_if(
+        ref_history_.begin(), ref_history_.end(),
+        [last_good_picture_id](const RefFrame& f) { return f.picture_id == last_good_picture_id; });
+    if (last_good == ref_history_.end()) {
+        // 不在当前IDR周期里, 或者太老了
+        return false;
+    }
+    auto ltr = std::find_if(std::make_reverse_iterator(last_good + 1), ref_history_.rend(),
+                            [](const RefFrame& f) { return f.long_term && f.acked; });
+    if (ltr == ref_history_.rend()) {
+        return false;
+    }
+    SLTRRecoverRequest request{};
+    request.uiFeedbackType = LTR_RECOVERY_REQUEST;
+    request.uiIDRPicId = last_good->idr_pic_id;
+    request.iLastCorrectFrameNum = static_cast<int>(last_good->frame_num);
+    request.iCurrentFrameNum = static_cast<int>(ref_history_.back().frame_num);
+    request.iLayerId = 0;
+    int ret = encoder_->SetOption(ENCODER_LTR_RECOVERY_REQUEST, &request);
+    if (ret != 0) {
+        LOG(WARNING) << "ISVCEncoder::SetOption(ENCODER_LTR_RECOVERY_REQUEST) failed " << ret;
+        return false;
+    }
+    LOGF(INFO, "Recover from LTR(picture_id:%" PRIu64 ", frame_num:%u), last good %" PRIu64,
+         ltr->picture_id, ltr->frame_num, last_good_picture_id);
+    pending_recovery_ = last_good_picture_id;
+    return true;
+}
+
+void OpenH264EncoderImpl::recordRefFrame(std::optional<H264SliceParser::SliceInfo> info,
+                                         uint64_t picture_id) {
+    if (!info.has_value()) {
+        // 解析不了就当作没有可用的参考帧, 下次恢复只能编IDR
+        ref_history_.clear();
+        return;
+    }
+    if (info->idr) {
+        ref_history_.clear();
+    }
+    else if (ref_history_.empty()) {
+        // 不知道属于哪个IDR周期, 等下一个IDR
+        return;
+    }
+    else {
+        // idr_pic_id只在IDR的slice header里有
+        info->idr_pic_id = ref_history_.back().idr_pic_id;
+    }
+    ref_history_.push_back(
+        RefFrame{picture_id, info->idr_pic_id, info->frame_num, info->long_term, false});
+    while (ref_history_.size() > kMaxRefHistory) {
+        ref_history_.pop_front();
+    }
+}
+
+std::optional<TemporalLayerInfo> OpenH264EncoderImpl::layerInfo(uint32_t temporal_id,
+                                                                bool is_keyframe,
+                                                                uint64_t picture_id) const {
+    if (is_keyframe) {
+        return TemporalLayerInfo{temporal_id, 0};
+    }
+    // 和openh264构造参考列表的方式一样: 参考不高于自己这一层的最近一个参考帧
+    std::optional<uint64_t> ref;
+    for (uint32_t tid = 0; tid <= temporal_id && tid < layer_refs_.size(); tid++) {
+        if (layer_refs_[tid].has_value() && (!ref.has_value() || layer_refs_[tid] > ref)) {
+            ref = layer_refs_[tid];
+        }
+    }
+    if (!ref.has_value() || picture_id - ref.value() > 0xffff) {
+        // 不知道参考了谁, 不带SEI, 客户端按普通的帧处理
+        return std::nullopt;
+    }
+    return TemporalLayerInfo{temporal_id, static_cast<uint32_t>(picture_id - ref.value())};
+}
+
+void OpenH264EncoderImpl::recordLayerRef(const std::optional<H264SliceParser::SliceInfo>& info,
+                                         bool is_keyframe, uint32_t temporal_id,
+                                         uint64_t picture_id) {
+    if (temporal_id >= layer_refs_.size()) {
+        return;
+    }
+    if (is_keyframe) {
+        std::fill(layer_refs_.begin(), layer_refs_.end(), std::nullopt);
+    }
+    // 解析失败时当作参考帧, 宁可让客户端多等一帧也不能让它去解缺了参考帧的帧
+    if (!info.has_value() || info->reference) {
+        layer_refs_[temporal_id] = picture_id;
+    }
+}
+
+std::optional<EncodedFrame> OpenH264EncoderImpl::encodeOneFrame(void* input_frame,
+                                                                bool request_iframe,
+                                                                uint64_t picture_id,
+                                                                ltlib::BufferPool& pool) {
     SSourcePicture src{};
     src.iColorFormat = EVideoFormatType::videoFormatI420;
     src.iPicHeight = init_params_.iPicHeight;
@@ -183,24 +366,24 @@ OpenH264EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
     int ret = encoder_->EncodeFrame(&src, &info);
     if (ret != 0) {
         LOG(ERR) << "ISVCEncoder::EncodeFrame failed " << ret;
-        return nullptr;
+        return std::nullopt;
     }
-    auto out_frame = std::make_shared<ltproto::client2worker::VideoFrame>();
+    EncodedFrame out_frame{};
     switch (info.eFrameType) {
     case EVideoFrameType::videoFrameTypeIDR:
     case EVideoFrameType::videoFrameTypeI:
-        out_frame->set_is_keyframe(true);
+        out_frame.is_keyframe = true;
         break;
     case EVideoFrameType::videoFrameTypeP:
-        out_frame->set_is_keyframe(false);
+        out_frame.is_keyframe = false;
         break;
     case EVideoFrameType::videoFrameTypeSkip:
         LOG(ERR) << "FATAL ERROR: ISVCEncoder::EncodeFrame done with 'videoFrameTypeSkip'";
-        return nullptr;
+        return std::nullopt;
     default:
         LOG(ERR) << "FATAL ERROR: ISVCEncoder::EncodeFrame done with unkown eFrameType "
                  << (int)info.eFrameType;
-        return nullptr;
+        return std::nullopt;
     }
     // credit: WebRTC
     size_t required_capacity = 0;
@@ -211,9 +394,31 @@ OpenH264EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
             required_capacity += layerInfo.pNalLengthInByte[nal];
         }
     }
-    std::vector<uint8_t> buff;
-    buff.resize(required_capacity);
-    size_t copied = 0;
+    std::vector<uint8_t> sei;
+    if (pending_recovery_.has_value() && !out_frame.is_keyframe) {
+        sei = makeRecoverySei(pending_recovery_.value());
+    }
+    // 编码器也可能找不到可用的LTR而编了IDR, 那就不需要SEI了
+    pending_recovery_ = std::nullopt;
+    uint32_t temporal_id = 0;
+    if (temporal_layers_ > 1) {
+        for (int layer = 0; layer < info.iLayerNum; ++layer) {
+            if (info.sLayerInfo[layer].uiLayerType == VIDEO_CODING_LAYER) {
+                temporal_id = info.sLayerInfo[layer].uiTemporalId;
+                break;
+            }
+        }
+        auto layer_info = layerInfo(temporal_id, out_frame.is_keyframe, picture_id);
+        if (layer_info.has_value()) {
+            auto layer_sei = makeTemporalLayerSei(layer_info.value());
+            sei.insert(sei.end(), layer_sei.begin(), layer_sei.end());
+        }
+    }
+    // 各层的码流直接拷进池子里的缓冲区, 不再经过中间的vector
+    out_frame.buffer = pool.acquire(sei.size() + required_capacity);
+    uint8_t* buff = out_frame.buffer.get();
+    std::copy(sei.begin(), sei.end(), buff);
+    size_t copied = sei.size();
     for (int layer = 0; layer < info.iLayerNum; ++layer) {
         const SLayerBSInfo& layerInfo = info.sLayerInfo[layer];
         // Iterate NAL units making up this layer, noting fragments.
@@ -222,15 +427,29 @@ OpenH264EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe) {
             layer_len += layerInfo.pNalLengthInByte[nal];
         }
         // Copy the entire layer's data (including start codes).
-        memcpy(buff.data() + copied, layerInfo.pBsBuf, layer_len);
+        memcpy(buff + copied, layerInfo.pBsBuf, layer_len);
         copied += layer_len;
     }
-    out_frame->set_frame(buff.data(), copied);
+    out_frame.size = static_cast<uint32_t>(copied);
+    if (long_term_reference_ || temporal_layers_ > 1) {
+        auto slice = slice_parser_.parse(buff, out_frame.size);
+        if (long_term_reference_) {
+            recordRefFrame(slice, picture_id);
+        }
+        if (temporal_layers_ > 1) {
+            recordLayerRef(slice, out_frame.is_keyframe, temporal_id, picture_id);
+        }
+    }
     return out_frame;
 }
 
 bool OpenH264EncoderImpl::loadApi() {
+#if defined(LT_WINDOWS)
     const std::string kLibName = "openh264-2.4.0-win64.dll";
+#else
+    // 2.4.x的soname, 由系统包管理器安装
+    const std::string kLibName = "libopenh264.so.7";
+#endif // LT_WINDOWS
     openh264_lib_ = ltlib::DynamicLibrary::load(kLibName);
     if (openh264_lib_ == nullptr) {
         LOG(ERR) << "Load library " << kLibName << " failed";
@@ -263,28 +482,78 @@ void OpenH264EncoderImpl::generateEncodeParams(const OpenH264ParamsHelper& helpe
     params.bEnableFrameSkip = false;
     params.uiIntraPeriod = 0;
     params.uiMaxNalSize = 0;
-    params.iMultipleThreadIdc = 1;
-    params.iTemporalLayerNum = 1;
-    params.iNumRefFrame = 1;
+    params.iMultipleThreadIdc = static_cast<unsigned short>(threads_);
+    params.iTemporalLayerNum = static_cast<int>(temporal_layers_);
+    // 分层时T0和中间层的帧都要留着当参考帧
+    params.iNumRefFrame = static_cast<int>(std::max(1u, temporal_layers_ - 1));
+    if (long_term_reference_) {
+        params.bEnableLongTermReference = true;
+        params.iLTRRefNum = kLTRRefNum;
+        params.iLtrMarkPeriod = kLTRMarkPeriod;
+        params.iNumRefFrame = 1 + kLTRRefNum;
+    }
     params.sSpatialLayers[0].iVideoWidth = params.iPicWidth;
     params.sSpatialLayers[0].iVideoHeight = params.iPicHeight;
     params.sSpatialLayers[0].fFrameRate = params.fMaxFrameRate;
     params.sSpatialLayers[0].iSpatialBitrate = params.iTargetBitrate;
     params.sSpatialLayers[0].iMaxSpatialBitrate = params.iMaxBitrate;
-    params.sSpatialLayers[0].sSliceArgument.uiSliceNum = 1;
-    params.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
+    SSliceArgument& slice = params.sSpatialLayers[0].sSliceArgument;
+    if (max_slice_bytes_ != 0) {
+        // 按大小切slice时openh264要求uiMaxNalSize也要设置
+        params.uiMaxNalSize = max_slice_bytes_;
+        slice.uiSliceMode = SM_SIZELIMITED_SLICE;
+        slice.uiSliceSizeConstraint = max_slice_bytes_;
+    }
+    else if (threads_ > 1) {
+        // 一个线程一个slice, slice之间没有依赖才能并行
+        slice.uiSliceMode = SM_FIXEDSLCNUM_SLICE;
+        slice.uiSliceNum = threads_;
+    }
+    else {
+        slice.uiSliceMode = SM_SINGLE_SLICE;
+        slice.uiSliceNum = 1;
+    }
 }
 
 std::unique_ptr<OpenH264Encoder> OpenH264Encoder::create(const EncodeParamsHelper& params) {
+    return create(params, Options{});
+}
+
+std::unique_ptr<OpenH264Encoder> OpenH264Encoder::create(const EncodeParamsHelper& params,
+                                                         const Options& options) {
     auto encoder = std::make_unique<OpenH264Encoder>();
-    auto impl = std::make_shared<OpenH264EncoderImpl>(params);
+    auto impl = std::make_shared<OpenH264EncoderImpl>(params, options);
     if (!impl->init()) {
         return nullptr;
     }
     encoder->impl_ = impl;
+    encoder->initOutputPool(params.bitrate(), static_cast<uint32_t>(params.fps()));
     return encoder;
 }
 
+uint32_t OpenH264Encoder::defaultThreads(uint32_t width, uint32_t height, uint32_t cpu_cores) {
+    // 给采集和网络线程留点余量, 分辨率越低多线程的收益越小而slice的码率开销越明显
+    const uint32_t pixels = width * height;
+    if (pixels >= 1920 * 1080 && cpu_cores > 8) {
+        return 8;
+    }
+    if (pixels > 1280 * 720 && cpu_cores >= 6) {
+        return 4;
+    }
+    if (pixels > 640 * 480 && cpu_cores >= 3) {
+        return 2;
+    }
+    return 1;
+}
+
+uint32_t OpenH264Encoder::threads() const {
+    return impl_->threads();
+}
+
+uint32_t OpenH264Encoder::temporalLayers() const {
+    return impl_->temporalLayers();
+}
+
 void OpenH264Encoder::reconfigure(const ReconfigureParams& params) {
     impl_->reconfigure(params);
 }
@@ -305,9 +574,16 @@ uint32_t OpenH264Encoder::height() const {
     return impl_->height();
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-OpenH264Encoder::encodeFrame(void* input_frame) {
-    return impl_->encodeOneFrame(input_frame, needKeyframe());
+void OpenH264Encoder::onFrameAcked(uint64_t picture_id) {
+    impl_->onFrameAcked(picture_id);
+}
+
+bool OpenH264Encoder::recoverFrom(uint64_t last_good_picture_id) {
+    return impl_->recoverFrom(last_good_picture_id);
+}
+
+std::optional<EncodedFrame> OpenH264Encoder::encodeFrame(void* input_frame) {
+    return impl_->encodeOneFrame(input_frame, needKeyframe(), nextPictureID(), outputPool());
 }
 
 ColorMatrix OpenH264Encoder::colorMatrix() const {
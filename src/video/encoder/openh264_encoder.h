@@ -41,16 +41,37 @@ namespace video {
 
 class OpenH264EncoderImpl;
 class OpenH264Encoder : public Encoder {
+public:
+    struct Options {
+        // 编码线程数, 每个线程负责一个slice. 0表示根据CPU核数和分辨率自动选择
+        uint32_t threads = 0;
+        // 单个slice的字节数上限, 0表示不限制. 设置后按大小切slice而不是按线程数,
+        // 让每个NAL都能装进一个网络包
+        uint32_t max_slice_bytes = 0;
+        // 开启长期参考帧, 丢帧后从客户端确认过的LTR恢复而不是编IDR
+        bool long_term_reference = true;
+        // 时域分层数(1~3). 大于1时最高层的帧不被参考, 发送端拥塞时可以直接丢掉,
+        // 此时不使用长期参考帧
+        uint32_t temporal_layers = 1;
+    };
+
 public:
     static std::unique_ptr<OpenH264Encoder> create(const EncodeParamsHelper& params);
+    static std::unique_ptr<OpenH264Encoder> create(const EncodeParamsHelper& params,
+                                                   const Options& options);
+    static uint32_t defaultThreads(uint32_t width, uint32_t height, uint32_t cpu_cores);
     ~OpenH264Encoder() override = default;
+    uint32_t threads() const;
+    uint32_t temporalLayers() const override;
 
     void reconfigure(const ReconfigureParams& params) override;
     CaptureFormat captureFormat() const override;
     VideoCodecType codecType() const override;
     uint32_t width() const override;
     uint32_t height() const override;
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encodeFrame(void* input_frame) override;
+    void onFrameAcked(uint64_t picture_id) override;
+    bool recoverFrom(uint64_t last_good_picture_id) override;
+    std::optional<EncodedFrame> encodeFrame(void* input_frame) override;
     ColorMatrix colorMatrix() const override;
     bool fullRange() const override;
 
@@ -0,0 +1,190 @@
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <ltproto/client2worker/video_frame.pb.h>
+
+#include <video/capturer/synthetic_video_capturer.h>
+#include <video/decoder/video_decoder.h>
+#include <video/drpipeline/decode_queue.h>
+#include <video/encoder/h264_bitstream.h>
+#include <video/encoder/openh264_encoder.h>
+
+namespace {
+
+using lt::VideoCodecType;
+using lt::video::DecodeQueue;
+using lt::video::OpenH264Encoder;
+using lt::video::SyntheticCapturer;
+
+constexpr uint32_t kWidth = 640;
+constexpr uint32_t kHeight = 360;
+constexpr int kFps = 30;
+constexpr int64_t kFrameIntervalUs = 1'000'000 / kFps;
+constexpr uint32_t kTemporalLayers = 3;
+constexpr uint64_t kFrames = 120;
+
+struct EncodedFrame {
+    uint64_t picture_id;
+    bool is_keyframe;
+    uint32_t temporal_id;
+    std::string data;
+};
+
+std::optional<std::vector<EncodedFrame>> encodeSynthetic(uint32_t temporal_layers) {
+    lt::video::EncodeParamsHelper params{nullptr,
+                                         nullptr,
+                                         -1,
+                                         VideoCodecType::H264_420,
+                                         kWidth,
+                                         kHeight,
+                                         kFps,
+                                         2 * 1000 * 1000,
+                                         true,
+                                         lt::ColorPrimaries::BT709,
+                                         lt::TransferCharacteristics::BT709,
+                                         lt::ColorMatrix::BT601,
+                                         false};
+    OpenH264Encoder::Options options{};
+    options.threads = 1;
+    options.temporal_layers = temporal_layers;
+    auto encoder = OpenH264Encoder::create(params, options);
+    if (encoder == nullptr) {
+        return std::nullopt;
+    }
+    SyntheticCapturer::Params capture_params{};
+    capture_params.width = kWidth;
+    capture_params.height = kHeight;
+    capture_params.fps = kFps;
+    capture_params.content = SyntheticCapturer::Content::MovingWindow;
+    auto capturer = SyntheticCapturer::create(capture_params);
+    if (capturer == nullptr || !capturer->setCaptureFormat(encoder->captureFormat())) {
+        return std::nullopt;
+    }
+    std::vector<EncodedFrame> frames;
+    for (uint64_t i = 0; i < kFrames; i++) {
+        auto captured = capturer->capture();
+        if (!captured.has_value()) {
+            return std::nullopt;
+        }
+        auto encoded = encoder->encode(captured.value());
+        capturer->doneWithFrame();
+        if (!encoded.has_value()) {
+            return std::nullopt;
+        }
+        auto layer = lt::video::findTemporalLayerSei(encoded->data(), encoded->size);
+        frames.push_back({encoded->picture_id, encoded->is_keyframe,
+                          layer.has_value() ? layer->temporal_id : 0,
+                          std::string{reinterpret_cast<const char*>(encoded->data()),
+                                      encoded->size}});
+    }
+    return frames;
+}
+
+struct ReplayResult {
+    uint64_t sent_frames = 0;
+    size_t sent_bytes = 0;
+    uint64_t decoded_frames = 0;
+    uint64_t decode_failures = 0;
+    uint64_t keyframe_requests = 0;
+};
+
+// 丢掉temporal_id >= max_temporal_id的帧, 剩下的经过DecodeQueue交给ffmpeg解码
+std::optional<ReplayResult> replay(const std::vector<EncodedFrame>& frames,
+                                   uint32_t max_temporal_id) {
+    lt::video::Decoder::Params decode_params{};
+    decode_params.codec_type = VideoCodecType::H264_420_SOFT;
+    decode_params.width = kWidth;
+    decode_params.height = kHeight;
+    decode_params.va_type = lt::VaType::None;
+    auto decoder = lt::video::Decoder::create(decode_params);
+    if (decoder == nullptr) {
+        return std::nullopt;
+    }
+    DecodeQueue::Params queue_params{};
+    queue_params.codec = VideoCodecType::H264_420_SOFT;
+    DecodeQueue queue{queue_params};
+    ReplayResult result;
+    for (const auto& encoded : frames) {
+        if (encoded.temporal_id >= max_temporal_id) {
+            continue;
+        }
+        const int64_t now_us = static_cast<int64_t>(encoded.picture_id) * kFrameIntervalUs;
+        result.sent_frames++;
+        result.sent_bytes += encoded.data.size();
+        DecodeQueue::Frame frame{};
+        frame.ltframe_id = encoded.picture_id;
+        frame.is_keyframe = encoded.is_keyframe;
+        frame.data = reinterpret_cast<const uint8_t*>(encoded.data.data());
+        frame.size = static_cast<uint32_t>(encoded.data.size());
+        queue.push(frame, now_us);
+        if (queue.needKeyframe(now_us)) {
+            result.keyframe_requests++;
+        }
+        while (auto to_decode = queue.pop(now_us)) {
+            auto decoded = decoder->decode(to_decode->data, to_decode->size);
+            if (decoded.status == lt::video::DecodeStatus::Failed) {
+                result.decode_failures++;
+                queue.onDecodeFailed();
+            }
+            else {
+                result.decoded_frames++;
+            }
+        }
+    }
+    return result;
+}
+
+TEST(TemporalLayersTest, DroppingHigherLayersKeepsStreamDecodable) {
+    auto frames = encodeSynthetic(kTemporalLayers);
+    if (!frames.has_value()) {
+        GTEST_SKIP() << "OpenH264 is not available";
+    }
+    auto single_layer = encodeSynthetic(1);
+    ASSERT_TRUE(single_layer.has_value());
+    size_t single_layer_bytes = 0;
+    for (const auto& frame : single_layer.value()) {
+        single_layer_bytes += frame.data.size();
+    }
+
+    std::vector<uint64_t> frames_per_layer(kTemporalLayers);
+    for (const auto& frame : frames.value()) {
+        ASSERT_LT(frame.temporal_id, kTemporalLayers);
+        frames_per_layer[frame.temporal_id]++;
+    }
+    // 三层的结构是T0 T2 T1 T2
+    EXPECT_EQ(frames_per_layer[0], kFrames / 4);
+    EXPECT_EQ(frames_per_layer[1], kFrames / 4);
+    EXPECT_EQ(frames_per_layer[2], kFrames / 2);
+
+    std::optional<ReplayResult> full;
+    for (uint32_t dropped = 0; dropped < kTemporalLayers; dropped++) {
+        auto result = replay(frames.value(), kTemporalLayers - dropped);
+        if (!result.has_value()) {
+            GTEST_SKIP() << "ffmpeg is not available";
+        }
+        if (dropped == 0) {
+            full = result;
+        }
+        const double kbps = result->sent_bytes * 8.0 * kFps / kFrames / 1000;
+        const double saving = 100.0 * (1.0 - static_cast<double>(result->sent_bytes) /
+                                                  static_cast<double>(full->sent_bytes));
+        std::printf("drop top %u layer(s): %llu frames, %zu bytes (%.0f kbps), saving %.1f%%\n",
+                    dropped, static_cast<unsigned long long>(result->sent_frames),
+                    result->sent_bytes, kbps, saving);
+        EXPECT_EQ(result->decode_failures, 0u) << dropped;
+        EXPECT_EQ(result->keyframe_requests, 0u) << dropped;
+        EXPECT_EQ(result->decoded_frames, result->sent_frames) << dropped;
+        if (dropped > 0) {
+            EXPECT_LT(result->sent_bytes, full->sent_bytes);
+        }
+    }
+    std::printf("single layer: %zu bytes, %u layers: %zu bytes\n", single_layer_bytes,
+                kTemporalLayers, full->sent_bytes);
+}
+
+} // namespace
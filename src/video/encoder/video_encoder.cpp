@@ -41,9 +41,19 @@
 #include "amd_encoder.h"
 #include "intel_encoder.h"
 #include "nvidia_encoder.h"
+#endif // defined(LT_WINDOWS)
+
+#if defined(LT_WINDOWS) || defined(LT_LINUX)
 #include "params_helper.h"
+#endif // defined(LT_WINDOWS) || defined(LT_LINUX)
+
+#if LT_HAS_OPENH264
 #include "openh264_encoder.h"
-#endif // defined(LT_WINDOWS)
+#endif // LT_HAS_OPENH264
+
+#if LT_HAS_X264
+#include "x264_encoder.h"
+#endif // LT_HAS_X264
 
 #include "video_encoder.h"
 
@@ -240,7 +250,8 @@ std::unique_ptr<Encoder> Encoder::createHard(const InitParams& params) {
 }
 
 std::unique_ptr<Encoder> Encoder::createSoft(const InitParams& params) {
-#if defined(LT_WINDOWS)
+#if defined(LT_WINDOWS) || defined(LT_LINUX)
+    // 软编码不需要device/context, 不走validate()
     EncodeParamsHelper params_helper{params.device,
                                      params.context,
                                      params.luid,
@@ -254,11 +265,36 @@ std::unique_ptr<Encoder> Encoder::createSoft(const InitParams& params) {
                                      params.transfer_func,
                                      params.color_matrix,
                                      params.full_range};
-    return OpenH264Encoder::create(params_helper);
-#else  // defined(LT_WINDOWS)
+#if LT_HAS_X264
+    if (params.soft_backend == SoftBackend::X264) {
+        auto encoder = X264Encoder::create(params_helper);
+        if (encoder != nullptr) {
+            return encoder;
+        }
+        LOG(WARNING) << "Create x264 encoder failed, fallback to OpenH264";
+    }
+#endif // LT_HAS_X264
+#if LT_HAS_OPENH264
+    OpenH264Encoder::Options options{};
+    options.temporal_layers = params.temporal_layers;
+    options.threads = params.soft_threads;
+    options.max_slice_bytes = params.max_slice_bytes;
+    return OpenH264Encoder::create(params_helper, options);
+#elif LT_HAS_X264
+    // 编译时没找到openh264, 只剩x264可用
+    if (params.soft_backend == SoftBackend::X264) {
+        return nullptr;
+    }
+    return X264Encoder::create(params_helper);
+#else
+    (void)params_helper;
+    LOG(ERR) << "No software encoder was built";
+    return nullptr;
+#endif // LT_HAS_OPENH264
+#else  // defined(LT_WINDOWS) || defined(LT_LINUX)
     (void)params;
     return nullptr;
-#endif // defined(LT_WINDOWS)
+#endif // defined(LT_WINDOWS) || defined(LT_LINUX)
 }
 
 bool Encoder::needKeyframe() {
@@ -269,30 +305,65 @@ void Encoder::requestKeyframe() {
     request_keyframe_ = true;
 }
 
-std::shared_ptr<ltproto::client2worker::VideoFrame>
-Encoder::encode(const Capturer::Frame& input_frame) {
+void Encoder::onFrameAcked(uint64_t picture_id) {
+    (void)picture_id;
+}
+
+bool Encoder::recoverFrom(uint64_t last_good_picture_id) {
+    (void)last_good_picture_id;
+    return false;
+}
+
+uint32_t Encoder::temporalLayers() const {
+    return 1;
+}
+
+uint64_t Encoder::reservePictureID() {
+    return frame_id_++;
+}
+
+uint64_t Encoder::nextPictureID() const {
+    return frame_id_;
+}
+
+std::optional<EncodedFrame> Encoder::encode(const Capturer::Frame& input_frame) {
     const int64_t start_encode = ltlib::steady_now_us();
     auto encoded_frame = this->encodeFrame(input_frame.data);
     const int64_t end_encode = ltlib::steady_now_us();
-    if (encoded_frame == nullptr) {
-        return nullptr;
+    if (!encoded_frame.has_value()) {
+        return std::nullopt;
     }
-    encoded_frame->set_capture_timestamp_us(input_frame.capture_timestamp_us);
-    encoded_frame->set_start_encode_timestamp_us(start_encode);
-    encoded_frame->set_end_encode_timestamp_us(end_encode);
-    encoded_frame->set_picture_id(frame_id_++);
-    encoded_frame->set_width(width());
-    encoded_frame->set_height(height());
+    encoded_frame->capture_timestamp_us = input_frame.capture_timestamp_us;
+    encoded_frame->start_encode_timestamp_us = start_encode;
+    encoded_frame->end_encode_timestamp_us = end_encode;
+    encoded_frame->picture_id = frame_id_++;
+    encoded_frame->width = width();
+    encoded_frame->height = height();
     if (!first_frame_) {
         first_frame_ = true;
         LOG(INFO) << "First frame encoded";
     }
-    if (encoded_frame->is_keyframe()) {
+    if (encoded_frame->is_keyframe) {
         LOG(DEBUG) << "SEND KEY FRAME";
     }
     return encoded_frame;
 }
 
+ltlib::BufferPool::Stat Encoder::outputPoolStat() const {
+    return output_pool_ == nullptr ? ltlib::BufferPool::Stat{} : output_pool_->stat();
+}
+
+void Encoder::initOutputPool(uint32_t bitrate_bps, uint32_t fps) {
+    output_pool_ = createEncodedFramePool(bitrate_bps, fps);
+}
+
+ltlib::BufferPool& Encoder::outputPool() {
+    if (output_pool_ == nullptr) {
+        output_pool_ = std::make_unique<ltlib::BufferPool>();
+    }
+    return *output_pool_;
+}
+
 bool Encoder::doneFrame1() const {
     return true;
 }
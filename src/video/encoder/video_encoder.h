@@ -36,10 +36,10 @@
 #include <optional>
 #include <vector>
 
-#include <ltproto/client2worker/video_frame.pb.h>
-
+#include <ltlib/buffer_pool.h>
 #include <transport/transport.h>
 #include <video/capturer/video_capturer.h>
+#include <video/encoder/encoded_frame.h>
 #include <video/types.h>
 
 namespace lt {
@@ -48,6 +48,12 @@ namespace video {
 
 class Encoder {
 public:
+    // 软编码的实现, 都输出H264_420_SOFT
+    enum class SoftBackend {
+        OpenH264,
+        // 需要编译时找到x264, 运行时加载不到会退回OpenH264
+        X264,
+    };
     struct InitParams {
         // 其实有一个device就够了，但是在创建d3ddevice的时候就能顺便获取其他值，就干脆传递过来
         int64_t luid;
@@ -63,6 +69,13 @@ public:
         ColorMatrix color_matrix = ColorMatrix::BT709;
         TransferCharacteristics transfer_func = TransferCharacteristics::BT709;
         bool full_range = false;
+        SoftBackend soft_backend = SoftBackend::OpenH264;
+        // 时域分层数, 目前只有OpenH264支持, 其他编码器忽略
+        uint32_t temporal_layers = 1;
+        // OpenH264的编码线程数, 0表示根据CPU核数和分辨率自动选择. 其他编码器忽略
+        uint32_t soft_threads = 0;
+        // OpenH264单个slice的字节数上限, 0表示不限制. 其他编码器忽略
+        uint32_t max_slice_bytes = 0;
 
         bool validate() const;
     };
@@ -82,11 +95,21 @@ public:
     virtual uint32_t width() const = 0;
     virtual uint32_t height() const = 0;
     void requestKeyframe();
-    std::shared_ptr<ltproto::client2worker::VideoFrame> encode(const Capturer::Frame& input_frame);
+    // 客户端已经正确解码到picture_id这一帧, 只在编码线程调用
+    virtual void onFrameAcked(uint64_t picture_id);
+    // 客户端丢帧后, 让下一帧只参考last_good_picture_id及之前已确认的帧.
+    // 返回false表示做不到, 调用方应该改用requestKeyframe()
+    virtual bool recoverFrom(uint64_t last_good_picture_id);
+    // 大于1时每一帧前面都有时域分层SEI, 见makeTemporalLayerSei()
+    virtual uint32_t temporalLayers() const;
+    std::optional<EncodedFrame> encode(const Capturer::Frame& input_frame);
+    // 给不经过编码器的帧(比如带宽探测包)占一个picture_id, 后面编码出来的帧接着往后编号
+    uint64_t reservePictureID();
     virtual bool doneFrame1() const;
     virtual bool doneFrame2() const;
     virtual ColorMatrix colorMatrix() const = 0;
     virtual bool fullRange() const = 0;
+    ltlib::BufferPool::Stat outputPoolStat() const;
 
     // static std::vector<VideoCodecType> checkSupportedCodecs(uint32_t width, uint32_t height);
     // static std::vector<VideoCodecType> checkSupportedCodecsWithLuid(int64_t luid, uint32_t width,
@@ -94,9 +117,16 @@ public:
 
 protected:
     bool needKeyframe();
-    virtual std::shared_ptr<ltproto::client2worker::VideoFrame> encodeFrame(void* input_frame) = 0;
+    // 下一个编码出来的帧的picture_id
+    uint64_t nextPictureID() const;
+    // 码流要写进outputPool()的缓冲区, 不要自己分配
+    virtual std::optional<EncodedFrame> encodeFrame(void* input_frame) = 0;
+    // 子类在create()里按码率和帧率调用一次, 没调用时用默认的分级
+    void initOutputPool(uint32_t bitrate_bps, uint32_t fps);
+    ltlib::BufferPool& outputPool();
 
 private:
+    std::unique_ptr<ltlib::BufferPool> output_pool_;
     uint64_t frame_id_ = 0;
     std::atomic<bool> request_keyframe_{false};
     bool first_frame_ = false;
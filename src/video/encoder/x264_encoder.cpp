@@ -0,0 +1,301 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "x264_encoder.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+extern "C" {
+#include <x264.h>
+}
+
+#include <ltlib/load_library.h>
+#include <ltlib/logging.h>
+
+namespace {
+
+// x264_encoder_open是带版本号的宏, 动态加载时要拼出真正的符号名
+const std::string kEncoderOpenName = "x264_encoder_open_" + std::to_string(X264_BUILD);
+
+#if defined(LT_WINDOWS)
+const std::string kLibName = "libx264-" + std::to_string(X264_BUILD) + ".dll";
+#else
+const std::string kLibName = "libx264.so." + std::to_string(X264_BUILD);
+#endif // LT_WINDOWS
+
+// 和OpenH264Encoder一样, 采集出来的I420是BT.601 limited range
+constexpr int kVuiColorMatrixBT601 = 6;
+
+} // namespace
+
+namespace lt {
+
+namespace video {
+
+class X264EncoderImpl {
+public:
+    X264EncoderImpl(const EncodeParamsHelper& params, const X264Encoder::Options& options);
+    ~X264EncoderImpl();
+    bool init();
+    void reconfigure(const Encoder::ReconfigureParams& params);
+    uint32_t width() const { return params_.width(); }
+    uint32_t height() const { return params_.height(); }
+    std::optional<EncodedFrame> encodeOneFrame(void* input_frame, bool request_iframe,
+                                               ltlib::BufferPool& pool);
+
+private:
+    bool loadApi();
+    void setRateControl();
+
+private:
+    EncodeParamsHelper params_;
+    X264Encoder::Options options_;
+    std::unique_ptr<ltlib::DynamicLibrary> x264_lib_;
+    x264_t* encoder_ = nullptr;
+    x264_param_t x264_params_{};
+    int64_t pts_ = 0;
+    decltype(&x264_param_default_preset) param_default_preset_ = nullptr;
+    decltype(&x264_param_apply_profile) param_apply_profile_ = nullptr;
+    x264_t* (*encoder_open_)(x264_param_t*) = nullptr;
+    decltype(&x264_encoder_reconfig) encoder_reconfig_ = nullptr;
+    decltype(&x264_encoder_encode) encoder_encode_ = nullptr;
+    decltype(&x264_encoder_close) encoder_close_ = nullptr;
+    decltype(&x264_picture_init) picture_init_ = nullptr;
+};
+
+X264EncoderImpl::X264EncoderImpl(const EncodeParamsHelper& params,
+                                 const X264Encoder::Options& options)
+    : params_{params}
+    , options_{options} {
+    if (options_.rc == EncodeParamsHelper::RcMode::Unknown) {
+        options_.rc = params.rc();
+    }
+}
+
+X264EncoderImpl::~X264EncoderImpl() {
+    if (encoder_ != nullptr) {
+        encoder_close_(encoder_);
+    }
+}
+
+bool X264EncoderImpl::init() {
+    if (params_.codec() != VideoCodecType::H264_420 &&
+        params_.codec() != VideoCodecType::H264_420_SOFT) {
+        LOG(ERR) << "x264 encoder only support H264_420";
+        return false;
+    }
+    if (!loadApi()) {
+        return false;
+    }
+    if (param_default_preset_(&x264_params_, options_.preset.c_str(), "zerolatency") != 0) {
+        LOG(ERR) << "x264_param_default_preset(" << options_.preset << ", zerolatency) failed";
+        return false;
+    }
+    x264_params_.i_threads = options_.threads == 0 ? X264_THREADS_AUTO
+                                                   : static_cast<int>(options_.threads);
+    x264_params_.b_sliced_threads = 1;
+    x264_params_.i_width = static_cast<int>(params_.width());
+    x264_params_.i_height = static_cast<int>(params_.height());
+    x264_params_.i_csp = X264_CSP_I420;
+    x264_params_.i_fps_num = static_cast<uint32_t>(params_.fps());
+    x264_params_.i_fps_den = 1;
+    x264_params_.b_vfr_input = 0;
+    x264_params_.i_keyint_max = X264_KEYINT_MAX_INFINITE;
+    x264_params_.b_repeat_headers = 1;
+    x264_params_.b_annexb = 1;
+    x264_params_.i_log_level = X264_LOG_WARNING;
+    x264_params_.vui.i_colmatrix = kVuiColorMatrixBT601;
+    x264_params_.vui.b_fullrange = 0;
+    setRateControl();
+    if (param_apply_profile_(&x264_params_, "high") != 0) {
+        LOG(ERR) << "x264_param_apply_profile(high) failed";
+        return false;
+    }
+    encoder_ = encoder_open_(&x264_params_);
+    if (encoder_ == nullptr) {
+        LOG(ERR) << "x264_encoder_open failed";
+        return false;
+    }
+    LOG(INFO) << "x264 encoder " << params_.width() << "x" << params_.height() << ", preset "
+              << options_.preset << ", threads " << x264_params_.i_threads << ", "
+              << (options_.rc == EncodeParamsHelper::RcMode::CBR ? "CBR" : "VBR");
+    return true;
+}
+
+void X264EncoderImpl::setRateControl() {
+    const int bitrate_kbps = static_cast<int>(params_.bitrate_kbps());
+    x264_params_.rc.i_rc_method = X264_RC_ABR;
+    x264_params_.rc.i_bitrate = bitrate_kbps;
+    // x264的CBR就是ABR加上和目标码率相等的VBV上限
+    x264_params_.rc.i_vbv_max_bitrate = options_.rc == EncodeParamsHelper::RcMode::CBR
+                                            ? bitrate_kbps
+                                            : static_cast<int>(params_.maxbitrate_kbps());
+    const int vbv_bits = params_.vbvbufsize().value_or(
+        x264_params_.rc.i_vbv_max_bitrate * 1000 / std::max(params_.fps(), 1));
+    x264_params_.rc.i_vbv_buffer_size = std::max(vbv_bits / 1000, 1);
+    x264_params_.rc.f_vbv_buffer_init = 1.0f;
+}
+
+void X264EncoderImpl::reconfigure(const Encoder::ReconfigureParams& params) {
+    if (params.bitrate_bps.has_value()) {
+        params_.set_bitrate(params.bitrate_bps.value());
+    }
+    if (params.fps.has_value()) {
+        params_.set_fps(static_cast<int>(params.fps.value()));
+        x264_params_.i_fps_num = params.fps.value();
+    }
+    if (!params.bitrate_bps.has_value() && !params.fps.has_value()) {
+        return;
+    }
+    // VBV大小跟着帧率走, 所以两种改动都要重新算码控参数
+    setRateControl();
+    int ret = encoder_reconfig_(encoder_, &x264_params_);
+    if (ret != 0) {
+        LOG(ERR) << "x264_encoder_reconfig(bitrate:" << params_.bitrate()
+                 << ", fps:" << params_.fps() << ") failed " << ret;
+    }
+}
+
+std::optional<EncodedFrame>
+X264EncoderImpl::encodeOneFrame(void* input_frame, bool request_iframe, ltlib::BufferPool& pool) {
+    const int width = x264_params_.i_width;
+    const int height = x264_params_.i_height;
+    x264_picture_t pic_in{};
+    x264_picture_t pic_out{};
+    picture_init_(&pic_in);
+    pic_in.img.i_csp = X264_CSP_I420;
+    pic_in.img.i_plane = 3;
+    pic_in.img.i_stride[0] = width;
+    pic_in.img.i_stride[1] = width / 2;
+    pic_in.img.i_stride[2] = width / 2;
+    pic_in.img.plane[0] = reinterpret_cast<uint8_t*>(input_frame);
+    pic_in.img.plane[1] = pic_in.img.plane[0] + width * height;
+    pic_in.img.plane[2] = pic_in.img.plane[1] + width * height / 4;
+    pic_in.i_pts = pts_++;
+    pic_in.i_type = request_iframe ? X264_TYPE_IDR : X264_TYPE_AUTO;
+    x264_nal_t* nals = nullptr;
+    int nal_count = 0;
+    int size = encoder_encode_(encoder_, &nals, &nal_count, &pic_in, &pic_out);
+    if (size < 0) {
+        LOG(ERR) << "x264_encoder_encode failed " << size;
+        return std::nullopt;
+    }
+    if (size == 0 || nal_count == 0) {
+        // zerolatency下不应该出现
+        LOG(WARNING) << "x264_encoder_encode output nothing";
+        return std::nullopt;
+    }
+    EncodedFrame out_frame{};
+    out_frame.is_keyframe = pic_out.b_keyframe != 0;
+    // b_annexb时所有NAL(包括起始码)在内存里是连续的
+    out_frame.buffer = pool.acquire(static_cast<size_t>(size));
+    out_frame.size = static_cast<uint32_t>(size);
+    memcpy(out_frame.buffer.get(), nals[0].p_payload, out_frame.size);
+    return out_frame;
+}
+
+bool X264EncoderImpl::loadApi() {
+    x264_lib_ = ltlib::DynamicLibrary::load(kLibName);
+    if (x264_lib_ == nullptr) {
+        LOG(ERR) << "Load library " << kLibName << " failed";
+        return false;
+    }
+    auto load = [this](const std::string& name, auto& func) {
+        func = reinterpret_cast<std::remove_reference_t<decltype(func)>>(x264_lib_->getFunc(name));
+        if (func == nullptr) {
+            LOG(ERR) << "Load function " << name << " from " << kLibName << " failed";
+            return false;
+        }
+        return true;
+    };
+    return load("x264_param_default_preset", param_default_preset_) &&
+           load("x264_param_apply_profile", param_apply_profile_) &&
+           load(kEncoderOpenName, encoder_open_) &&
+           load("x264_encoder_reconfig", encoder_reconfig_) &&
+           load("x264_encoder_encode", encoder_encode_) &&
+           load("x264_encoder_close", encoder_close_) &&
+           load("x264_picture_init", picture_init_);
+}
+
+std::unique_ptr<X264Encoder> X264Encoder::create(const EncodeParamsHelper& params) {
+    return create(params, Options{});
+}
+
+std::unique_ptr<X264Encoder> X264Encoder::create(const EncodeParamsHelper& params,
+                                                 const Options& options) {
+    auto encoder = std::make_unique<X264Encoder>();
+    auto impl = std::make_shared<X264EncoderImpl>(params, options);
+    if (!impl->init()) {
+        return nullptr;
+    }
+    encoder->impl_ = impl;
+    encoder->initOutputPool(params.bitrate(), static_cast<uint32_t>(params.fps()));
+    return encoder;
+}
+
+void X264Encoder::reconfigure(const ReconfigureParams& params) {
+    impl_->reconfigure(params);
+}
+
+CaptureFormat X264Encoder::captureFormat() const {
+    return CaptureFormat::MEM_I420;
+}
+
+VideoCodecType X264Encoder::codecType() const {
+    return VideoCodecType::H264_420_SOFT;
+}
+
+uint32_t X264Encoder::width() const {
+    return impl_->width();
+}
+
+uint32_t X264Encoder::height() const {
+    return impl_->height();
+}
+
+std::optional<EncodedFrame> X264Encoder::encodeFrame(void* input_frame) {
+    return impl_->encodeOneFrame(input_frame, needKeyframe(), outputPool());
+}
+
+ColorMatrix X264Encoder::colorMatrix() const {
+    return ColorMatrix::BT601;
+}
+
+bool X264Encoder::fullRange() const {
+    return false;
+}
+
+} // namespace video
+
+} // namespace lt
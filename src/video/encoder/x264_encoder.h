@@ -0,0 +1,76 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <video/encoder/params_helper.h>
+#include <video/encoder/video_encoder.h>
+
+namespace lt {
+
+namespace video {
+
+class X264EncoderImpl;
+class X264Encoder : public Encoder {
+public:
+    struct Options {
+        // x264的preset, 从ultrafast到placebo. tune固定是zerolatency
+        std::string preset = "veryfast";
+        // 0表示由x264根据CPU核数决定. 总是用sliced threads, 多线程不会带来额外的帧延迟
+        uint32_t threads = 0;
+        // Unknown表示用EncodeParamsHelper::rc(). 两种模式都受VBV约束
+        EncodeParamsHelper::RcMode rc = EncodeParamsHelper::RcMode::Unknown;
+    };
+
+public:
+    static std::unique_ptr<X264Encoder> create(const EncodeParamsHelper& params);
+    static std::unique_ptr<X264Encoder> create(const EncodeParamsHelper& params,
+                                               const Options& options);
+    ~X264Encoder() override = default;
+
+    void reconfigure(const ReconfigureParams& params) override;
+    CaptureFormat captureFormat() const override;
+    VideoCodecType codecType() const override;
+    uint32_t width() const override;
+    uint32_t height() const override;
+    std::optional<EncodedFrame> encodeFrame(void* input_frame) override;
+    ColorMatrix colorMatrix() const override;
+    bool fullRange() const override;
+
+private:
+    std::shared_ptr<X264EncoderImpl> impl_;
+};
+
+} // namespace video
+
+} // namespace lt
@@ -662,6 +662,21 @@ bool D3D11Pipeline::setDecodedFormat(DecodedFormat format) {
     }
 }
 
+int64_t D3D11Pipeline::lastPresentTime() {
+    DXGI_FRAME_STATISTICS stats{};
+    HRESULT hr = swap_chain_->GetFrameStatistics(&stats);
+    if (FAILED(hr) || stats.SyncQPCTime.QuadPart == 0) {
+        return -1;
+    }
+    LARGE_INTEGER freq{};
+    if (!QueryPerformanceFrequency(&freq) || freq.QuadPart == 0) {
+        return -1;
+    }
+    // MSVC的steady_clock就是QPC, 可以直接和ltlib::steady_now_us()比较
+    const int64_t qpc = stats.SyncQPCTime.QuadPart;
+    return qpc / freq.QuadPart * 1'000'000 + qpc % freq.QuadPart * 1'000'000 / freq.QuadPart;
+}
+
 bool D3D11Pipeline::init() {
     DWM_TIMING_INFO info{};
     info.cbSize = sizeof(DWM_TIMING_INFO);
@@ -89,6 +89,7 @@ public:
     uint32_t displayWidth() override;
     uint32_t displayHeight() override;
     bool setDecodedFormat(DecodedFormat format) override;
+    int64_t lastPresentTime() override;
 
 private:
     bool createD3D();
@@ -0,0 +1,101 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "null_renderer.h"
+
+#include <ltlib/times.h>
+
+namespace lt {
+
+namespace video {
+
+NullRenderer::NullRenderer(const Params& params, uint32_t refresh_rate)
+    : Renderer{params}
+    , width_{params.video_width}
+    , height_{params.video_height}
+    , vsync_interval_us_{1'000'000 / (refresh_rate == 0 ? 60 : refresh_rate)}
+    , vsync_phase_us_{ltlib::steady_now_us()} {}
+
+bool NullRenderer::bindTextures(const std::vector<void*>&) {
+    return true;
+}
+
+Renderer::RenderResult NullRenderer::render(int64_t) {
+    return RenderResult::Success2;
+}
+
+void NullRenderer::switchStretchMode(bool) {}
+
+void NullRenderer::resetRenderTarget() {}
+
+bool NullRenderer::present() {
+    const int64_t now = ltlib::steady_now_us();
+    const int64_t vsyncs = (now - vsync_phase_us_) / vsync_interval_us_ + 1;
+    last_present_time_ = vsync_phase_us_ + vsyncs * vsync_interval_us_;
+    return true;
+}
+
+bool NullRenderer::waitForPipeline(int64_t) {
+    return true;
+}
+
+void* NullRenderer::hwDevice() {
+    return nullptr;
+}
+
+void* NullRenderer::hwContext() {
+    return nullptr;
+}
+
+uint32_t NullRenderer::displayWidth() {
+    return width_;
+}
+
+uint32_t NullRenderer::displayHeight() {
+    return height_;
+}
+
+bool NullRenderer::setDecodedFormat(DecodedFormat) {
+    return true;
+}
+
+int64_t NullRenderer::lastPresentTime() {
+    return last_present_time_;
+}
+
+bool NullRenderer::resetVideoSize(uint32_t video_width, uint32_t video_height) {
+    width_ = video_width;
+    height_ = video_height;
+    return true;
+}
+
+} // namespace video
+
+} // namespace lt
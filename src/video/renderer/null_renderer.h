@@ -0,0 +1,70 @@
+/*
+ * BSD 3-Clause License
+ *
+ * Copyright (c) 2023 Zhennan Tu <zhennan.tu@gmail.com>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include <video/renderer/video_renderer.h>
+
+namespace lt {
+
+namespace video {
+
+// 不输出任何画面的渲染器, 用于没有窗口和GPU的bench.
+// present()不阻塞, 显示时间按refresh_rate模拟成下一个vblank
+class NullRenderer : public Renderer {
+public:
+    NullRenderer(const Params& params, uint32_t refresh_rate);
+    bool bindTextures(const std::vector<void*>& textures) override;
+    RenderResult render(int64_t frame) override;
+    void switchStretchMode(bool stretch) override;
+    void resetRenderTarget() override;
+    bool present() override;
+    bool waitForPipeline(int64_t max_wait_ms) override;
+    void* hwDevice() override;
+    void* hwContext() override;
+    uint32_t displayWidth() override;
+    uint32_t displayHeight() override;
+    bool setDecodedFormat(DecodedFormat format) override;
+    int64_t lastPresentTime() override;
+    bool resetVideoSize(uint32_t video_width, uint32_t video_height) override;
+
+private:
+    uint32_t width_;
+    uint32_t height_;
+    const int64_t vsync_interval_us_;
+    const int64_t vsync_phase_us_;
+    std::atomic<int64_t> last_present_time_{-1};
+};
+
+} // namespace video
+
+} // namespace lt
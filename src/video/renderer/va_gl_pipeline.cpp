@@ -144,6 +144,18 @@ bool VaGlPipeline::detachRenderContext() {
     }
 }
 
+bool VaGlPipeline::resetVideoSize(uint32_t video_width, uint32_t video_height) {
+    // VA surface是解码器的, 这里只需要更新纹理坐标, EGL/GL上下文保持不变
+    if (!attachRenderContext()) {
+        return false;
+    }
+    video_width_ = video_width;
+    video_height_ = video_height;
+    updateVideoVerts();
+    detachRenderContext();
+    return true;
+}
+
 Renderer::RenderResult VaGlPipeline::render(int64_t frame) {
     EGLBoolean egl_ret = eglMakeCurrent(egl_display_, egl_surface_, egl_surface_, egl_context_);
     if (egl_ret != EGL_TRUE) {
@@ -863,6 +875,20 @@ void main() {
     return true;
 }
 
+void VaGlPipeline::updateVideoVerts() {
+    float u = (float)video_width_ / _ALIGN(video_width_, align_);
+    float v = (float)video_height_ / _ALIGN(video_height_, align_);
+    // clang-format off
+    float verts[] = {-1.0f, 1.0f, 0.0f, 0.0f,
+                      1.0f, 1.0f, u, 0.0f,
+                      1.0f, -1.0f, u, v,
+                      -1.0f, -1.0f, 0.0f, v};
+    // clang-format on
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(verts), verts);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 } // namespace video
 
 } // namespace lt
@@ -74,12 +74,14 @@ public:
     bool setDecodedFormat(DecodedFormat format) override;
     bool attachRenderContext() override;
     bool detachRenderContext() override;
+    bool resetVideoSize(uint32_t video_width, uint32_t video_height) override;
 
 private:
     bool loadFuncs();
     bool initVa();
     bool initEGL();
     bool initOpenGL();
+    void updateVideoVerts();
     EGLImage createEGLImage(EGLint attr[]);
     void destroyEGLImage(EGLImage image);
     void resizeWindow(int screen_width, int screen_height);
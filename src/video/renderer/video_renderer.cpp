@@ -184,6 +184,14 @@ bool Renderer::detachRenderContext() {
     return true;
 }
 
+int64_t Renderer::lastPresentTime() {
+    return -1;
+}
+
+bool Renderer::resetVideoSize(uint32_t, uint32_t) {
+    return false;
+}
+
 } // namespace video
 
 } // namespace lt
@@ -79,6 +79,11 @@ public:
     virtual bool setDecodedFormat(DecodedFormat format) = 0;
     virtual bool attachRenderContext();
     virtual bool detachRenderContext();
+    // 最近一帧画面真正显示(vblank)的时间, steady clock, us. 拿不到返回-1
+    virtual int64_t lastPresentTime();
+    // 换分辨率时原地调整, 保留窗口/GL上下文等资源, 之后要用新解码器的纹理重新bindTextures.
+    // 返回false表示不支持, 调用方需要重新创建Renderer
+    virtual bool resetVideoSize(uint32_t video_width, uint32_t video_height);
 
 protected:
     explicit Renderer(const Params& params);
@@ -41,6 +41,8 @@ enum class VaType {
     D3D11,
     VAAPI,
     VTB,
+    // 纯软件解码, 解码结果在内存里
+    None,
 };
 
 // https://www.itu.int/rec/T-REC-H.265-202407-I/en
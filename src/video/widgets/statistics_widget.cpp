@@ -79,9 +79,14 @@ present_fps: %d
     plotLines("prs", stat_.present_time);
     plotLines("net", stat_.net_delay);
     plotLines("dec", stat_.decode_time);
+    plotLines("d2p", stat_.decode_to_present);
     plotLines("bwe", stat_.bwe);
     plotLines("vbw", stat_.video_bw);
     plotLines("los", stat_.loss_rate);
+    for (const auto& input : stat_.input_latency) {
+        ImGui::Text("%-12s n:%-4u p50:%.1fms p95:%.1fms p99:%.1fms", input.name.c_str(),
+                    input.samples, input.p50 / 1000.0, input.p95 / 1000.0, input.p99 / 1000.0);
+    }
     ImGui::End();
 }
 
@@ -33,6 +33,7 @@
 #include <ltproto/client2worker/audio_data.pb.h>
 #include <ltproto/client2worker/change_streaming_params.pb.h>
 #include <ltproto/client2worker/change_streaming_params_ack.pb.h>
+#include <ltproto/client2worker/send_side_stat.pb.h>
 #include <ltproto/common/keep_alive_ack.pb.h>
 #include <ltproto/common/streaming_params.pb.h>
 #include <ltproto/ltproto.h>
@@ -41,6 +42,7 @@
 #include <ltproto/worker2service/start_working_ack.pb.h>
 #include <ltproto/worker2service/worker_bootstrap.pb.h>
 
+#include <audio/audio_packet.h>
 #include <lt_constants.h>
 #include <ltlib/logging.h>
 #include <ltlib/system.h>
@@ -176,7 +178,8 @@ int32_t WorkerStreaming::init() {
         {ltype::kKeepAlive, std::bind(&WorkerStreaming::onKeepAlive, this, ph::_1)},
         {ltype::kChangeStreamingParamsAck,
          std::bind(&WorkerStreaming::onChangeStreamingParamsAck, this, ph::_1)},
-        {ltype::kSwitchMonitor, std::bind(&WorkerStreaming::onSwitchMonitor, this, ph::_1)}};
+        {ltype::kSwitchMonitor, std::bind(&WorkerStreaming::onSwitchMonitor, this, ph::_1)},
+        {ltype::kSendSideStat, std::bind(&WorkerStreaming::onSendSideStat, this, ph::_1)}};
     for (auto& handler : handlers) {
         if (!registerMessageHandler(handler.first, handler.second)) {
             LOG(FATAL) << "Register message handler(" << handler.first << ") failed";
@@ -293,6 +296,10 @@ int32_t WorkerStreaming::negotiateStreamParameters() {
 
     lt::audio::Capturer::Params audio_params{};
     audio_params.type = audio_codec_type_;
+    audio_params.packet_header = client_version_ >= lt::audio::kAudioPacketMinClientVersion;
+    if (!audio_params.packet_header) {
+        LOG(INFO) << "Client version " << client_version_ << " predates audio packet header";
+    }
     audio_params.on_audio_data =
         std::bind(&WorkerStreaming::onCapturedAudioData, this, std::placeholders::_1);
     auto audio = lt::audio::Capturer::create(audio_params);
@@ -313,6 +320,7 @@ int32_t WorkerStreaming::negotiateStreamParameters() {
     video_params.color_matrix = static_cast<ColorMatrix>(color_matrix_);
     video_params.full_range = full_range_;
     video_params.monitor = monitors_[monitor_index_];
+    video_params.probe_bandwidth = true;
     video_params.send_message = std::bind(&WorkerStreaming::sendPipeMessageFromOtherThread, this,
                                           std::placeholders::_1, std::placeholders::_2);
     video_params.register_message_handler =
@@ -528,6 +536,7 @@ void WorkerStreaming::onWorkerBootstrap(
     color_matrix_ = msg->color_matrix();
     full_range_ = msg->full_range();
     audio_codec_type_ = static_cast<lt::AudioCodecType>(atype);
+    client_version_ = msg->client_version();
 
     if (monitor_index_ >= monitors_.size()) {
         LOG(WARNING) << "Parameter invalid: mindex " << monitor_index_ << ", change to 0";
@@ -590,6 +599,8 @@ void WorkerStreaming::onStartWorking(const std::shared_ptr<google::protobuf::Mes
                       std::placeholders::_2);
         input_params.send_message = std::bind(&WorkerStreaming::sendPipeMessageFromOtherThread,
                                               this, std::placeholders::_1, std::placeholders::_2);
+        input_params.report_input_latency =
+            client_version_ >= input::kInputLatencyReportMinClientVersion;
         input_ = input::Executor::create(input_params);
         if (input_ == nullptr) {
             ack->set_err_code(ltproto::ErrorCode::WorkerInitInputFailed);
@@ -662,6 +673,13 @@ void WorkerStreaming::onSwitchMonitor(const std::shared_ptr<google::protobuf::Me
     sendPipeMessage(ltproto::id(msg), msg);
 }
 
+void WorkerStreaming::onSendSideStat(const std::shared_ptr<google::protobuf::MessageLite>& _msg) {
+    auto msg = std::static_pointer_cast<ltproto::client2worker::SendSideStat>(_msg);
+    if (audio_ != nullptr) {
+        audio_->updateLossRate(msg->loss_rate());
+    }
+}
+
 } // namespace worker
 
 } // namespace lt
\ No newline at end of file
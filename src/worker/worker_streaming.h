@@ -104,6 +104,7 @@ private:
     void onKeepAlive(const std::shared_ptr<google::protobuf::MessageLite>& msg);
     void onChangeStreamingParamsAck(const std::shared_ptr<google::protobuf::MessageLite>& msg);
     void onSwitchMonitor(const std::shared_ptr<google::protobuf::MessageLite>& msg);
+    void onSendSideStat(const std::shared_ptr<google::protobuf::MessageLite>& msg);
 
 private:
     std::string trace_id_;
@@ -117,6 +118,7 @@ private:
     std::vector<lt::VideoCodecType> client_codec_types_;
     const std::string pipe_name_;
     AudioCodecType audio_codec_type_ = AudioCodecType::OPUS;
+    int64_t client_version_ = 0;
     bool bootstrap_received_ = false;
     int64_t bootstrap_timeout_deadline_ms_ = 0;
     bool connected_to_service_ = false;